@@ -232,6 +232,26 @@ namespace fs
 		return this->write(buf.get(), total);
 	}
 
+	u64 file_base::read_at(u64 offset, void* buffer, u64 size)
+	{
+		if (this->seek(offset, seek_set) != offset)
+		{
+			return 0;
+		}
+
+		return this->read(buffer, size);
+	}
+
+	u64 file_base::write_at(u64 offset, const void* buffer, u64 size)
+	{
+		if (this->seek(offset, seek_set) != offset)
+		{
+			return 0;
+		}
+
+		return this->write(buffer, size);
+	}
+
 	dir_base::~dir_base()
 	{
 	}
@@ -998,7 +1018,12 @@ fs::file::file(const std::string& path, bs_t<open_mode> mode)
 			const int size = narrow<int>(count, "file::read" HERE);
 
 			DWORD nread;
-			verify("file::read" HERE), ReadFile(m_handle, buffer, size, &nread, NULL);
+			if (!ReadFile(m_handle, buffer, size, &nread, NULL))
+			{
+				// Inaccessible destination memory
+				verify("file::read" HERE), GetLastError() == ERROR_NOACCESS;
+				return 0;
+			}
 
 			return nread;
 		}
@@ -1009,7 +1034,50 @@ fs::file::file(const std::string& path, bs_t<open_mode> mode)
 			const int size = narrow<int>(count, "file::write" HERE);
 
 			DWORD nwritten;
-			verify("file::write" HERE), WriteFile(m_handle, buffer, size, &nwritten, NULL);
+			if (!WriteFile(m_handle, buffer, size, &nwritten, NULL))
+			{
+				// Inaccessible source memory
+				verify("file::write" HERE), GetLastError() == ERROR_NOACCESS;
+				return 0;
+			}
+
+			return nwritten;
+		}
+
+		u64 read_at(u64 offset, void* buffer, u64 count) override
+		{
+			const int size = narrow<int>(count, "file::read_at" HERE);
+
+			// The file pointer is also updated for synchronous handles
+			OVERLAPPED ovl{};
+			ovl.Offset = static_cast<DWORD>(offset);
+			ovl.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+			DWORD nread;
+			if (!ReadFile(m_handle, buffer, size, &nread, &ovl))
+			{
+				const DWORD error = GetLastError();
+				verify("file::read_at" HERE), error == ERROR_HANDLE_EOF || error == ERROR_NOACCESS;
+				return 0;
+			}
+
+			return nread;
+		}
+
+		u64 write_at(u64 offset, const void* buffer, u64 count) override
+		{
+			const int size = narrow<int>(count, "file::write_at" HERE);
+
+			OVERLAPPED ovl{};
+			ovl.Offset = static_cast<DWORD>(offset);
+			ovl.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+			DWORD nwritten;
+			if (!WriteFile(m_handle, buffer, size, &nwritten, &ovl))
+			{
+				verify("file::write_at" HERE), GetLastError() == ERROR_NOACCESS;
+				return 0;
+			}
 
 			return nwritten;
 		}
@@ -1142,7 +1210,13 @@ fs::file::file(const std::string& path, bs_t<open_mode> mode)
 		u64 read(void* buffer, u64 count) override
 		{
 			const auto result = ::read(m_fd, buffer, count);
-			verify("file::read" HERE), result != -1;
+
+			if (result == -1)
+			{
+				// Inaccessible destination memory
+				verify("file::read" HERE), errno == EFAULT;
+				return 0;
+			}
 
 			return result;
 		}
@@ -1150,7 +1224,39 @@ fs::file::file(const std::string& path, bs_t<open_mode> mode)
 		u64 write(const void* buffer, u64 count) override
 		{
 			const auto result = ::write(m_fd, buffer, count);
-			verify("file::write" HERE), result != -1;
+
+			if (result == -1)
+			{
+				// Inaccessible source memory
+				verify("file::write" HERE), errno == EFAULT;
+				return 0;
+			}
+
+			return result;
+		}
+
+		u64 read_at(u64 offset, void* buffer, u64 count) override
+		{
+			const auto result = ::pread(m_fd, buffer, count, offset);
+
+			if (result == -1)
+			{
+				verify("file::read_at" HERE), errno == EFAULT;
+				return 0;
+			}
+
+			return result;
+		}
+
+		u64 write_at(u64 offset, const void* buffer, u64 count) override
+		{
+			const auto result = ::pwrite(m_fd, buffer, count, offset);
+
+			if (result == -1)
+			{
+				verify("file::write_at" HERE), errno == EFAULT;
+				return 0;
+			}
 
 			return result;
 		}
@@ -1295,6 +1401,90 @@ bool fs::file::set_delete(bool autodelete) const
 }
 #endif
 
+fs::file_map::file_map(const file& f)
+{
+	if (!f)
+	{
+		g_tls_error = fs::error::inval;
+		return;
+	}
+
+	const u64 size = f.size();
+
+	if (size == 0)
+	{
+		return;
+	}
+
+	const auto handle = f.get_handle();
+
+#ifdef _WIN32
+	if (handle != INVALID_HANDLE_VALUE)
+	{
+		if (const HANDLE mapping = CreateFileMappingW(handle, NULL, PAGE_READONLY, 0, 0, NULL))
+		{
+			const auto ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+
+			if (ptr)
+			{
+				m_ptr = static_cast<const u8*>(ptr);
+				m_size = size;
+				m_mapped = true;
+				return;
+			}
+		}
+	}
+#else
+	if (handle != -1)
+	{
+		const auto ptr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, handle, 0);
+
+		if (ptr != MAP_FAILED)
+		{
+			m_ptr = static_cast<const u8*>(ptr);
+			m_size = size;
+			m_mapped = true;
+			return;
+		}
+	}
+#endif
+
+	// Fallback: read the whole file
+	m_copy.reset(new u8[size]);
+
+	const u64 pos = f.pos();
+
+	if (f.seek(0), f.read(m_copy.get(), size) != size)
+	{
+		f.seek(pos);
+		m_copy.reset();
+		g_tls_error = fs::error::inval;
+		return;
+	}
+
+	f.seek(pos);
+	m_ptr = m_copy.get();
+	m_size = size;
+}
+
+void fs::file_map::close()
+{
+	if (m_mapped)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_ptr);
+#else
+		::munmap(const_cast<u8*>(m_ptr), m_size);
+#endif
+	}
+
+	m_copy.reset();
+	m_ptr = nullptr;
+	m_size = 0;
+	m_mapped = false;
+}
+
 void fs::dir::xnull() const
 {
 	fmt::throw_exception<std::logic_error>("fs::dir is null");
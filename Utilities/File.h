@@ -86,6 +86,8 @@ namespace fs
 		virtual u64 size() = 0;
 		virtual native_handle get_handle();
 		virtual u64 write_gather(const iovec_clone* buffers, u64 buf_count);
+		virtual u64 read_at(u64 offset, void* buffer, u64 size);
+		virtual u64 write_at(u64 offset, const void* buffer, u64 size);
 	};
 
 	// Directory entry (TODO)
@@ -247,6 +249,7 @@ namespace fs
 		}
 
 		// Read the data from the file and return the amount of data written in buffer
+		// Inaccessible buffer memory isn't an error for native files: returns 0, or a short count if the system transferred some data
 		u64 read(void* buffer, u64 count) const
 		{
 			if (!m_file) xnull();
@@ -254,12 +257,27 @@ namespace fs
 		}
 
 		// Write the data to the file and return the amount of data actually written
+		// Inaccessible buffer memory isn't an error for native files: returns 0, or a short count if the system transferred some data
 		u64 write(const void* buffer, u64 count) const
 		{
 			if (!m_file) xnull();
 			return m_file->write(buffer, count);
 		}
 
+		// Read the data at specified offset (thread-safe for native files, the current position is unspecified after the call)
+		u64 read_at(u64 offset, void* buffer, u64 count) const
+		{
+			if (!m_file) xnull();
+			return m_file->read_at(offset, buffer, count);
+		}
+
+		// Write the data at specified offset (thread-safe for native files, the current position is unspecified after the call)
+		u64 write_at(u64 offset, const void* buffer, u64 count) const
+		{
+			if (!m_file) xnull();
+			return m_file->write_at(offset, buffer, count);
+		}
+
 		// Change current position, returns resulting position
 		u64 seek(s64 offset, seek_mode whence = seek_set) const
 		{
@@ -383,6 +401,71 @@ namespace fs
 #endif
 	};
 
+	// Read-only view of the file contents (memory mapped if possible)
+	class file_map final
+	{
+		const u8* m_ptr = nullptr;
+		u64 m_size = 0;
+
+		// Fallback storage for files without native handle (virtual devices)
+		std::unique_ptr<u8[]> m_copy;
+
+		bool m_mapped = false;
+
+	public:
+		file_map() = default;
+
+		// Map the whole file (doesn't need to outlive the view)
+		explicit file_map(const file& f);
+
+		file_map(const file_map&) = delete;
+
+		file_map(file_map&& other)
+			: m_ptr(std::exchange(other.m_ptr, nullptr))
+			, m_size(std::exchange(other.m_size, 0))
+			, m_copy(std::move(other.m_copy))
+			, m_mapped(std::exchange(other.m_mapped, false))
+		{
+		}
+
+		file_map& operator=(file_map&& other)
+		{
+			if (this != &other)
+			{
+				close();
+				m_ptr = std::exchange(other.m_ptr, nullptr);
+				m_size = std::exchange(other.m_size, 0);
+				m_copy = std::move(other.m_copy);
+				m_mapped = std::exchange(other.m_mapped, false);
+			}
+
+			return *this;
+		}
+
+		~file_map()
+		{
+			close();
+		}
+
+		// Unmap explicitly
+		void close();
+
+		const u8* data() const
+		{
+			return m_ptr;
+		}
+
+		u64 size() const
+		{
+			return m_size;
+		}
+
+		explicit operator bool() const
+		{
+			return m_ptr != nullptr;
+		}
+	};
+
 	class dir final
 	{
 		std::unique_ptr<dir_base> m_dir;
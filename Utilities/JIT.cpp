@@ -6,6 +6,7 @@
 #include "mutex.h"
 #include "sysinfo.h"
 #include "VirtualMemory.h"
+#include "pack_archive.h"
 #include <immintrin.h>
 
 // Memory manager mutex
@@ -686,6 +687,129 @@ public:
 	}
 };
 
+// Object record in pack archive: header, name (padded to 8 bytes), object
+struct pack_object_header
+{
+	u32 name_size;
+	u32 obj_size;
+};
+
+static u64 get_object_key(llvm::StringRef name)
+{
+	// FNV 64-bit
+	u64 result = 14695981039346656037ull;
+
+	for (const char c : name)
+	{
+		result ^= static_cast<u8>(c);
+		result *= 1099511628211ull;
+	}
+
+	return result;
+}
+
+// Get object from the archive (empty if not found or doesn't match the name)
+static llvm::StringRef find_object(const utils::pack_archive& cache, u32 tag, llvm::StringRef name)
+{
+	const auto blob = cache.find(tag, get_object_key(name));
+
+	if (!blob || blob.size < sizeof(pack_object_header))
+	{
+		return {};
+	}
+
+	pack_object_header header;
+	std::memcpy(&header, blob.data, sizeof(header));
+
+	const u64 obj_pos = sizeof(header) + ::align<u64>(header.name_size, 8);
+
+	if (header.name_size != name.size() || obj_pos + header.obj_size > blob.size || std::memcmp(blob.data + sizeof(header), name.data(), name.size()) != 0)
+	{
+		return {};
+	}
+
+	return {reinterpret_cast<const char*>(blob.data + obj_pos), header.obj_size};
+}
+
+// Get loadable object from the archive (invalid object is removed)
+static llvm::StringRef load_object(utils::pack_archive& cache, u32 tag, const std::string& name)
+{
+	const auto obj = find_object(cache, tag, name);
+
+	if (obj.empty())
+	{
+		return {};
+	}
+
+	if (auto result = llvm::object::ObjectFile::createObjectFile(llvm::MemoryBufferRef(obj, name)); !result)
+	{
+		LOG_ERROR(GENERAL, "LLVM: Invalid object in %s: %s", cache.get_path(), name);
+		llvm::consumeError(result.takeError());
+		cache.remove(tag, get_object_key(name));
+		return {};
+	}
+
+	return obj;
+}
+
+// Object cache backed by pack archive
+class PackObjectCache final : public llvm::ObjectCache
+{
+	utils::pack_archive& m_cache;
+	const u32 m_tag;
+	const std::string& m_name;
+
+public:
+	// Copy of the compiled object (optional)
+	std::unique_ptr<llvm::MemoryBuffer>* object;
+
+	// Compiled object can be stored (module was prepared)
+	bool store = true;
+
+	PackObjectCache(utils::pack_archive& cache, u32 tag, const std::string& name, std::unique_ptr<llvm::MemoryBuffer>* object)
+		: m_cache(cache)
+		, m_tag(tag)
+		, m_name(name)
+		, object(object)
+	{
+	}
+
+	~PackObjectCache() override = default;
+
+	void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef obj) override
+	{
+		if (object)
+		{
+			*object = llvm::MemoryBuffer::getMemBufferCopy(obj.getBuffer(), m_name);
+		}
+
+		if (store && jit_compiler::store_object(m_cache, m_tag, m_name, obj.getBufferStart(), ::narrow<u32>(obj.getBufferSize())))
+		{
+			LOG_NOTICE(GENERAL, "LLVM: Created module: %s", module->getName().data());
+		}
+	}
+
+	std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) override
+	{
+		const auto obj = load_object(m_cache, m_tag, m_name);
+
+		if (obj.empty())
+		{
+			// Compile again
+			return nullptr;
+		}
+
+		LOG_NOTICE(GENERAL, "LLVM: Loaded module: %s", module->getName().data());
+
+		if (object)
+		{
+			*object = llvm::MemoryBuffer::getMemBufferCopy(obj, m_name);
+		}
+
+		return llvm::MemoryBuffer::getMemBuffer(obj, m_name, false);
+	}
+};
+
 std::string jit_compiler::cpu(const std::string& _cpu)
 {
 	std::string m_cpu = _cpu;
@@ -826,6 +950,105 @@ void jit_compiler::add(const std::string& path)
 	m_engine->addObjectFile(std::move(llvm::object::ObjectFile::createObjectFile(*ObjectCache::load(path)).get()));
 }
 
+void jit_compiler::add(std::unique_ptr<llvm::Module> module, utils::pack_archive& cache, u32 tag, const std::string& name, std::unique_ptr<llvm::MemoryBuffer>* object, const std::function<void(llvm::Module&)>& prepare)
+{
+	PackObjectCache pcache{cache, tag, name, object};
+
+	if (prepare && load_object(cache, tag, name).empty())
+	{
+		prepare(*module);
+	}
+	else if (prepare)
+	{
+		// Valid objects are never replaced, but the module must not be compiled unprepared and stored
+		pcache.store = false;
+	}
+
+	m_engine->setObjectCache(&pcache);
+
+	const auto ptr = module.get();
+	m_engine->addModule(std::move(module));
+	m_engine->generateCodeForModule(ptr);
+	m_engine->setObjectCache(nullptr);
+
+	for (auto& func : ptr->functions())
+	{
+		// Delete IR to lower memory consumption
+		func.deleteBody();
+	}
+}
+
+bool jit_compiler::add(utils::pack_archive& cache, u32 tag, const std::string& name)
+{
+	const auto obj = load_object(cache, tag, name);
+
+	if (obj.empty())
+	{
+		return false;
+	}
+
+	// Use the mapped memory directly
+	auto buf = llvm::MemoryBuffer::getMemBuffer(obj, name, false);
+	auto result = llvm::object::ObjectFile::createObjectFile(*buf);
+
+	if (!result)
+	{
+		llvm::consumeError(result.takeError());
+		return false;
+	}
+
+	m_engine->addObjectFile({std::move(result.get()), std::move(buf)});
+	return true;
+}
+
+void jit_compiler::add(std::unique_ptr<llvm::MemoryBuffer> object)
+{
+	auto result = llvm::object::ObjectFile::createObjectFile(*object);
+
+	if (!result)
+	{
+		fmt::throw_exception("LLVM: Invalid object: %s", object->getBufferIdentifier().data());
+	}
+
+	m_engine->addObjectFile({std::move(result.get()), std::move(object)});
+}
+
+bool jit_compiler::has_object(const utils::pack_archive& cache, u32 tag, const std::string& name)
+{
+	return !find_object(cache, tag, name).empty();
+}
+
+bool jit_compiler::store_object(utils::pack_archive& cache, u32 tag, const std::string& name, const void* data, u32 size)
+{
+	pack_object_header header;
+	header.name_size = ::size32(name);
+	header.obj_size = size;
+
+	const u32 obj_pos = sizeof(header) + ::align<u32>(header.name_size, 8);
+
+	std::vector<u8> record(obj_pos + size);
+	std::memcpy(record.data(), &header, sizeof(header));
+	std::memcpy(record.data() + sizeof(header), name.data(), name.size());
+	std::memcpy(record.data() + obj_pos, data, size);
+
+	const u64 key = get_object_key(name);
+
+	if (cache.contains(tag, key))
+	{
+		if (!cache.find(tag, key) || has_object(cache, tag, name))
+		{
+			// Already stored (possibly in this session)
+			return false;
+		}
+
+		// Replace invalid object or colliding name
+		cache.remove(tag, key);
+	}
+
+	// Objects are only loaded once, don't keep them in memory
+	return cache.append(tag, key, record.data(), ::size32(record), false);
+}
+
 void jit_compiler::fin()
 {
 	m_engine->finalizeObject();
@@ -109,6 +109,11 @@ FT build_function_asm(F&& builder)
 #endif
 #include "define_new_memleakdetect.h"
 
+namespace utils
+{
+	class pack_archive;
+}
+
 // Temporary compiler interface
 class jit_compiler final
 {
@@ -151,6 +156,22 @@ public:
 	// Add object (path to obj file)
 	void add(const std::string& path);
 
+	// Add module (object is stored in the archive under specified name, and optionally returned)
+	// Optional prepare function is called on the module only if it needs to be compiled (stored object not loaded)
+	void add(std::unique_ptr<llvm::Module> module, utils::pack_archive& cache, u32 tag, const std::string& name, std::unique_ptr<llvm::MemoryBuffer>* object = nullptr, const std::function<void(llvm::Module&)>& prepare = {});
+
+	// Add object from the archive, returns false if it's not found or invalid (invalid object is removed)
+	bool add(utils::pack_archive& cache, u32 tag, const std::string& name);
+
+	// Add object from memory
+	void add(std::unique_ptr<llvm::MemoryBuffer> object);
+
+	// Check whether the archive contains a loadable object with specified name (objects stored in this session aren't loadable)
+	static bool has_object(const utils::pack_archive& cache, u32 tag, const std::string& name);
+
+	// Store object in the archive (replaces invalid objects, returns false if already stored)
+	static bool store_object(utils::pack_archive& cache, u32 tag, const std::string& name, const void* data, u32 size);
+
 	// Finalize
 	void fin();
 
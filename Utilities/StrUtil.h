@@ -36,52 +36,95 @@ namespace fmt
 	std::string replace_first(const std::string& src, const std::string& from, const std::string& to);
 	std::string replace_all(const std::string& src, const std::string& from, const std::string& to);
 
+	// Get the index of the first pattern of the list found at the position (list_size if none)
+	template <typename T, size_t list_size>
+	size_t match_pattern(const std::string& src, size_t pos, const T (&list)[list_size])
+	{
+		for (size_t i = 0; i < list_size; ++i)
+		{
+			const std::string& from = list[i].first;
+
+			if (!from.empty() && src[pos] == from[0] && src.compare(pos, from.length(), from) == 0)
+			{
+				return i;
+			}
+		}
+
+		return list_size;
+	}
+
+	// Replace the patterns in a single pass (replaced text is not scanned again), the source is returned as is if nothing matches
 	template <size_t list_size>
 	std::string replace_all(std::string src, const std::pair<std::string, std::string> (&list)[list_size])
 	{
-		for (size_t pos = 0; pos < src.length(); ++pos)
+		std::string result;
+		size_t copied = 0;
+
+		for (size_t pos = 0; pos < src.length();)
 		{
-			for (size_t i = 0; i < list_size; ++i)
-			{
-				const size_t comp_length = list[i].first.length();
+			const size_t i = match_pattern(src, pos, list);
 
-				if (src.length() - pos < comp_length)
-					continue;
+			if (i == list_size)
+			{
+				pos++;
+				continue;
+			}
 
-				if (src.substr(pos, comp_length) == list[i].first)
-				{
-					src = (pos ? src.substr(0, pos) + list[i].second : list[i].second) + src.substr(pos + comp_length);
-					pos += list[i].second.length() - 1;
-					break;
-				}
+			if (!copied)
+			{
+				result.reserve(src.length() + 64);
 			}
+
+			result.append(src, copied, pos - copied);
+			result += list[i].second;
+			pos += list[i].first.length();
+			copied = pos;
 		}
 
-		return src;
+		if (!copied)
+		{
+			return src;
+		}
+
+		result.append(src, copied);
+		return result;
 	}
 
+	// Same as above, the replacement is generated once per match
 	template <size_t list_size>
 	std::string replace_all(std::string src, const std::pair<std::string, std::function<std::string()>> (&list)[list_size])
 	{
-		for (size_t pos = 0; pos < src.length(); ++pos)
+		std::string result;
+		size_t copied = 0;
+
+		for (size_t pos = 0; pos < src.length();)
 		{
-			for (size_t i = 0; i < list_size; ++i)
-			{
-				const size_t comp_length = list[i].first.length();
+			const size_t i = match_pattern(src, pos, list);
 
-				if (src.length() - pos < comp_length)
-					continue;
+			if (i == list_size)
+			{
+				pos++;
+				continue;
+			}
 
-				if (src.substr(pos, comp_length) == list[i].first)
-				{
-					src = (pos ? src.substr(0, pos) + list[i].second() : list[i].second()) + src.substr(pos + comp_length);
-					pos += list[i].second().length() - 1;
-					break;
-				}
+			if (!copied)
+			{
+				result.reserve(src.length() + 64);
 			}
+
+			result.append(src, copied, pos - copied);
+			result += list[i].second();
+			pos += list[i].first.length();
+			copied = pos;
 		}
 
-		return src;
+		if (!copied)
+		{
+			return src;
+		}
+
+		result.append(src, copied);
+		return result;
 	}
 
 	std::vector<std::string> split(const std::string& source, std::initializer_list<std::string> separators, bool is_skip_empty = true);
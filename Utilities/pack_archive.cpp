@@ -0,0 +1,407 @@
+#include "pack_archive.h"
+#include "BEType.h"
+#include "StrFmt.h"
+#include "Log.h"
+
+namespace
+{
+	struct pack_header
+	{
+		nse_t<u64, 1> magic;
+		le_t<u32> format;
+		le_t<u32> version;
+	};
+
+	struct record_header
+	{
+		le_t<u32> tag;
+		le_t<u32> size;
+		le_t<u64> key;
+		le_t<u32> flags;
+		le_t<u32> check;
+	};
+
+	CHECK_SIZE(pack_header, 16);
+	CHECK_SIZE(record_header, 24);
+
+	constexpr u64 c_pack_magic = "RPCSPACK"_u64;
+	constexpr u32 c_pack_format = 1;
+
+	// Record flags
+	constexpr u32 c_record_removed = 1;
+
+	constexpr u32 get_check(u32 tag, u32 size, u64 key, u32 flags)
+	{
+		return tag ^ size ^ static_cast<u32>(key) ^ static_cast<u32>(key >> 32) ^ flags ^ "PACK"_u32;
+	}
+
+	constexpr u64 get_record_size(u32 size)
+	{
+		return sizeof(record_header) + ::align<u64>(size, 8);
+	}
+}
+
+utils::pack_archive::~pack_archive()
+{
+	close();
+}
+
+bool utils::pack_archive::open(const std::string& path, u32 version, bool read_only)
+{
+	close();
+
+	std::lock_guard lock(m_mutex);
+
+	m_path = path;
+	m_version = version;
+	m_read_only = read_only;
+
+	return load();
+}
+
+void utils::pack_archive::close()
+{
+	std::lock_guard lock(m_mutex);
+
+	m_index.clear();
+	m_entries.clear();
+	m_appended.clear();
+	m_map.close();
+	m_file.close();
+	m_garbage = 0;
+	m_writable = false;
+}
+
+bool utils::pack_archive::load()
+{
+	// Prevent concurrent appending from other processes, fallback to read-only access
+	m_writable = !m_read_only && m_file.open(m_path, fs::read + fs::write + fs::create + fs::lock);
+
+	if (!m_writable && !m_file.open(m_path, fs::read))
+	{
+		LOG_ERROR(GENERAL, "pack_archive: failed to open %s (%s)", m_path, fs::g_tls_error);
+		return false;
+	}
+
+	const u64 file_size = m_file.size();
+
+	pack_header header{};
+
+	if (file_size < sizeof(pack_header) || !m_file.read(header) || header.magic != c_pack_magic || header.format != c_pack_format || header.version != m_version)
+	{
+		if (!m_writable)
+		{
+			LOG_ERROR(GENERAL, "pack_archive: %s is invalid or outdated", m_path);
+			m_file.close();
+			return false;
+		}
+
+		if (file_size)
+		{
+			LOG_WARNING(GENERAL, "pack_archive: %s is invalid or outdated, discarding", m_path);
+		}
+
+		header.magic = c_pack_magic;
+		header.format = c_pack_format;
+		header.version = m_version;
+
+		m_file.trunc(0);
+		m_file.seek(0);
+		m_file.write(header);
+		return true;
+	}
+
+	m_map = fs::file_map(m_file);
+
+	if (!m_map)
+	{
+		LOG_ERROR(GENERAL, "pack_archive: failed to map %s", m_path);
+		m_file.close();
+		m_writable = false;
+		return false;
+	}
+
+	// Build the index
+	u64 pos = sizeof(pack_header);
+
+	while (pos + sizeof(record_header) <= file_size)
+	{
+		record_header rec;
+		std::memcpy(&rec, m_map.data() + pos, sizeof(record_header));
+
+		if (rec.check != get_check(rec.tag, rec.size, rec.key, rec.flags) || pos + get_record_size(rec.size) > file_size)
+		{
+			break;
+		}
+
+		const auto found = m_index.find({rec.tag, rec.key});
+
+		if (found != m_index.end())
+		{
+			// Superseded or removed record
+			auto& old = m_entries[found->second];
+			old.removed = true;
+			m_garbage += get_record_size(old.size);
+			m_index.erase(found);
+		}
+
+		if (rec.flags & c_record_removed)
+		{
+			// Tombstone
+			m_garbage += get_record_size(rec.size);
+		}
+		else
+		{
+			m_index.emplace(std::make_pair(u32{rec.tag}, u64{rec.key}), m_entries.size());
+			m_entries.push_back({m_map.data() + pos + sizeof(record_header), pos + sizeof(record_header), rec.size, rec.tag, rec.key, false});
+		}
+
+		pos += get_record_size(rec.size);
+	}
+
+	if (pos != file_size)
+	{
+		// Probably interrupted while appending
+		LOG_WARNING(GENERAL, "pack_archive: %s has %u bytes of trailing garbage", m_path, file_size - pos);
+
+		if (m_writable)
+		{
+			m_file.trunc(pos);
+		}
+	}
+
+	m_file.seek(pos);
+	return true;
+}
+
+bool utils::pack_archive::write_record(const fs::file& file, u32 tag, u64 key, const void* data, u32 size, u32 flags) const
+{
+	record_header rec;
+	rec.tag = tag;
+	rec.size = size;
+	rec.key = key;
+	rec.flags = flags;
+	rec.check = get_check(tag, size, key, flags);
+
+	static const u8 s_padding[8]{};
+
+	const fs::iovec_clone buffers[]
+	{
+		{&rec, sizeof(rec)},
+		{data ? data : s_padding, size},
+		{s_padding, ::align<u32>(size, 8) - size},
+	};
+
+	// Write everything at once, so a crash can only leave the last record incomplete
+	return file.write_gather(buffers, 3) == get_record_size(size);
+}
+
+utils::pack_archive::blob utils::pack_archive::find(u32 tag, u64 key) const
+{
+	reader_lock lock(m_mutex);
+
+	const auto found = m_index.find({tag, key});
+
+	if (found == m_index.end())
+	{
+		return {};
+	}
+
+	const auto& e = m_entries[found->second];
+
+	if (!e.data)
+	{
+		return {};
+	}
+
+	return {e.data, e.size, e.tag, e.key};
+}
+
+bool utils::pack_archive::contains(u32 tag, u64 key) const
+{
+	reader_lock lock(m_mutex);
+
+	return m_index.count({tag, key}) != 0;
+}
+
+bool utils::pack_archive::append(u32 tag, u64 key, const void* data, u32 size, bool keep)
+{
+	std::lock_guard lock(m_mutex);
+
+	if (!m_writable || m_index.count({tag, key}))
+	{
+		return false;
+	}
+
+	const u64 offset = m_file.pos() + sizeof(record_header);
+
+	if (!write_record(m_file, tag, key, data, size, 0))
+	{
+		LOG_ERROR(GENERAL, "pack_archive: failed to append to %s", m_path);
+		return false;
+	}
+
+	const u8* ptr = nullptr;
+
+	if (keep)
+	{
+		std::unique_ptr<u8[]> copy(new u8[size ? size : 1]);
+		std::memcpy(copy.get(), data, size);
+		ptr = copy.get();
+		m_appended.emplace_back(std::move(copy));
+	}
+
+	m_index.emplace(std::make_pair(tag, key), m_entries.size());
+	m_entries.push_back({ptr, offset, size, tag, key, false});
+	return true;
+}
+
+bool utils::pack_archive::remove(u32 tag, u64 key)
+{
+	std::lock_guard lock(m_mutex);
+
+	const auto found = m_index.find({tag, key});
+
+	if (!m_writable || found == m_index.end())
+	{
+		return false;
+	}
+
+	if (!write_record(m_file, tag, key, nullptr, 0, c_record_removed))
+	{
+		LOG_ERROR(GENERAL, "pack_archive: failed to append to %s", m_path);
+		return false;
+	}
+
+	auto& e = m_entries[found->second];
+	e.removed = true;
+	m_garbage += get_record_size(e.size) + get_record_size(0);
+	m_index.erase(found);
+	return true;
+}
+
+std::size_t utils::pack_archive::count(u32 tag) const
+{
+	reader_lock lock(m_mutex);
+
+	std::size_t result = 0;
+
+	for (const auto& e : m_entries)
+	{
+		if (e.tag == tag && !e.removed)
+		{
+			result++;
+		}
+	}
+
+	return result;
+}
+
+std::vector<utils::pack_archive::blob> utils::pack_archive::get_all(u32 tag) const
+{
+	reader_lock lock(m_mutex);
+
+	std::vector<blob> result;
+
+	for (const auto& e : m_entries)
+	{
+		if (e.tag == tag && !e.removed && e.data)
+		{
+			result.push_back({e.data, e.size, e.tag, e.key});
+		}
+	}
+
+	return result;
+}
+
+bool utils::pack_archive::compact()
+{
+	std::lock_guard lock(m_mutex);
+
+	if (!m_writable)
+	{
+		return false;
+	}
+
+	if (!m_garbage)
+	{
+		return true;
+	}
+
+	const std::string tmp_path = m_path + ".tmp";
+
+	fs::file tmp(tmp_path, fs::rewrite);
+
+	if (!tmp)
+	{
+		LOG_ERROR(GENERAL, "pack_archive: failed to create %s (%s)", tmp_path, fs::g_tls_error);
+		return false;
+	}
+
+	pack_header header;
+	header.magic = c_pack_magic;
+	header.format = c_pack_format;
+	header.version = m_version;
+	tmp.write(header);
+
+	std::vector<u8> buffer;
+
+	for (const auto& e : m_entries)
+	{
+		if (e.removed)
+		{
+			continue;
+		}
+
+		const u8* data = e.data;
+
+		if (!data)
+		{
+			// Read the blob which wasn't kept in memory
+			buffer.resize(e.size);
+
+			if (m_file.read_at(e.offset, buffer.data(), e.size) != e.size)
+			{
+				LOG_ERROR(GENERAL, "pack_archive: failed to read %s", m_path);
+				tmp.close();
+				fs::remove_file(tmp_path);
+				return false;
+			}
+
+			data = buffer.data();
+		}
+
+		if (!write_record(tmp, e.tag, e.key, data, e.size, 0))
+		{
+			LOG_ERROR(GENERAL, "pack_archive: failed to write %s", tmp_path);
+			tmp.close();
+			fs::remove_file(tmp_path);
+			return false;
+		}
+	}
+
+	tmp.sync();
+	tmp.close();
+
+	const u64 reclaimed = m_garbage;
+
+	// Release the old file before replacing it
+	m_index.clear();
+	m_entries.clear();
+	m_appended.clear();
+	m_map.close();
+	m_file.close();
+	m_garbage = 0;
+	m_writable = false;
+
+	if (!fs::rename(tmp_path, m_path, true))
+	{
+		LOG_ERROR(GENERAL, "pack_archive: failed to replace %s (%s)", m_path, fs::g_tls_error);
+		fs::remove_file(tmp_path);
+		load();
+		return false;
+	}
+
+	LOG_NOTICE(GENERAL, "pack_archive: compacted %s (%u bytes reclaimed)", m_path, reclaimed);
+	return load();
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "types.h"
+#include "File.h"
+#include "mutex.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace utils
+{
+	// Append-only archive of binary blobs addressed by (tag, key), used for on-disk caches.
+	// Layout: header, then records (record header + payload padded to 8 bytes).
+	// The file is memory mapped on open and indexed in memory, appended blobs are deduplicated by key.
+	class pack_archive
+	{
+	public:
+		struct blob
+		{
+			const u8* data = nullptr;
+			u32 size = 0;
+			u32 tag = 0;
+			u64 key = 0;
+
+			explicit operator bool() const
+			{
+				return data != nullptr;
+			}
+		};
+
+	private:
+		struct entry
+		{
+			// Null if the blob was appended without keeping a copy
+			const u8* data;
+			u64 offset;
+			u32 size;
+			u32 tag;
+			u64 key;
+			bool removed;
+		};
+
+		struct key_hash
+		{
+			std::size_t operator()(const std::pair<u32, u64>& k) const
+			{
+				return static_cast<std::size_t>(k.second ^ (u64{k.first} * 0x9e3779b97f4a7c15ull));
+			}
+		};
+
+		mutable shared_mutex m_mutex;
+
+		std::string m_path;
+		u32 m_version = 0;
+
+		fs::file m_file;
+		fs::file_map m_map;
+
+		// All live and removed records in file order
+		std::vector<entry> m_entries;
+
+		// Index of live records
+		std::unordered_map<std::pair<u32, u64>, std::size_t, key_hash> m_index;
+
+		// Storage for blobs appended after the file was mapped
+		std::vector<std::unique_ptr<u8[]>> m_appended;
+
+		// Total size of removed or superseded records
+		u64 m_garbage = 0;
+
+		bool m_writable = false;
+
+		// Never modify the file
+		bool m_read_only = false;
+
+		bool load();
+		bool write_record(const fs::file& file, u32 tag, u64 key, const void* data, u32 size, u32 flags) const;
+
+	public:
+		pack_archive() = default;
+
+		pack_archive(const pack_archive&) = delete;
+
+		pack_archive& operator=(const pack_archive&) = delete;
+
+		~pack_archive();
+
+		// Open or create the archive, discarding it if the version doesn't match (unless opened read-only)
+		bool open(const std::string& path, u32 version, bool read_only = false);
+
+		// Close the archive (invalidates all blobs)
+		void close();
+
+		bool is_open() const
+		{
+			return m_file.operator bool();
+		}
+
+		bool is_writable() const
+		{
+			return m_writable;
+		}
+
+		const std::string& get_path() const
+		{
+			return m_path;
+		}
+
+		// Find a live blob (blobs appended without a copy can't be found until the archive is reopened)
+		blob find(u32 tag, u64 key) const;
+
+		// Check whether a live blob exists
+		bool contains(u32 tag, u64 key) const;
+
+		// Append a blob, returns false if the key already exists or the archive is read-only.
+		// If keep is false, the data is only written to the file (saves memory for large blobs).
+		bool append(u32 tag, u64 key, const void* data, u32 size, bool keep = true);
+
+		// Remove a blob (appends a tombstone record)
+		bool remove(u32 tag, u64 key);
+
+		// Get the number of live blobs with specified tag
+		std::size_t count(u32 tag) const;
+
+		// Get all live blobs with specified tag in the order they were appended (same restriction as find)
+		std::vector<blob> get_all(u32 tag) const;
+
+		// Get the amount of bytes compaction would reclaim
+		u64 get_garbage_size() const
+		{
+			return m_garbage;
+		}
+
+		// Rewrite the archive without removed records (invalidates all blobs)
+		bool compact();
+	};
+}
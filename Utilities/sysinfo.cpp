@@ -14,6 +14,17 @@
 #include <errno.h>
 #endif
 
+const bool s_use_ssse3 =
+#ifdef _MSC_VER
+	utils::has_ssse3();
+#elif __SSSE3__
+	true;
+#else
+	false;
+#endif
+
+const bool s_use_avx2 = utils::has_avx2();
+
 bool utils::has_ssse3()
 {
 	static const bool g_value = get_cpuid(0, 0)[0] >= 0x1 && get_cpuid(1, 0)[2] & 0x200;
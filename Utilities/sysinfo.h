@@ -51,3 +51,14 @@ namespace utils
 
 	std::string get_OS_version();
 }
+
+// SIMD paths shared by the hand-vectorized kernels. SSSE3 code is only compiled in when the build targets it (always on MSVC),
+// AVX2 is detected at runtime and its kernels must be marked with AVX2_FUNC
+extern const bool s_use_ssse3;
+extern const bool s_use_avx2;
+
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((__target__("avx2")))
+#endif
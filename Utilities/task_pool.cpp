@@ -0,0 +1,212 @@
+#include "task_pool.h"
+#include "Thread.h"
+#include "StrFmt.h"
+
+struct utils::task_pool::worker
+{
+	shared_mutex mutex;
+	std::deque<task> queue;
+	std::unique_ptr<named_thread<std::function<void()>>> thread;
+};
+
+// Pool and index of the current worker thread
+static thread_local utils::task_pool* s_tls_pool = nullptr;
+static thread_local u32 s_tls_index = 0;
+
+utils::task_pool::task_pool(std::string_view name, u32 threads, int priority)
+{
+	m_workers.resize(std::max<u32>(threads, 1));
+
+	for (auto& w : m_workers)
+	{
+		w = std::make_unique<worker>();
+	}
+
+	// Start threads after all queues are created (they can be accessed by other workers)
+	for (u32 i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i]->thread = std::make_unique<named_thread<std::function<void()>>>(fmt::format("%s %u", name, i), [this, i, priority]
+		{
+			worker_loop(i, priority);
+		});
+	}
+}
+
+utils::task_pool::~task_pool()
+{
+	m_stop = true;
+	notify();
+
+	for (auto& w : m_workers)
+	{
+		// Join
+		w->thread.reset();
+	}
+}
+
+void utils::task_pool::notify()
+{
+	// Synchronize with threads which are about to sleep
+	m_mutex.lock();
+	m_mutex.unlock();
+	m_cond.notify_all();
+}
+
+void utils::task_pool::push(task_group& group, std::function<void()> func)
+{
+	group.m_count++;
+
+	// Keep tasks spawned by a worker in its own queue (they will be stolen if other workers are idle)
+	const u32 index = s_tls_pool == this ? s_tls_index : m_next++ % size();
+
+	// Count the task before it can be popped
+	m_queued++;
+
+	{
+		std::lock_guard lock(m_workers[index]->mutex);
+		m_workers[index]->queue.push_back({std::move(func), &group});
+	}
+
+	notify();
+}
+
+bool utils::task_pool::pop(u32 index, task& out, task_group* group)
+{
+	if (!m_queued)
+	{
+		return false;
+	}
+
+	for (u32 i = 0; i < m_workers.size(); i++)
+	{
+		auto& w = *m_workers[(index + i) % m_workers.size()];
+
+		std::lock_guard lock(w.mutex);
+
+		if (w.queue.empty())
+		{
+			continue;
+		}
+
+		if (group)
+		{
+			// Find the oldest task of the group
+			for (auto it = w.queue.begin(); it != w.queue.end(); ++it)
+			{
+				if (it->group == group)
+				{
+					out = std::move(*it);
+					w.queue.erase(it);
+					m_queued--;
+					return true;
+				}
+			}
+
+			continue;
+		}
+
+		if (i == 0)
+		{
+			// Own queue: oldest task first
+			out = std::move(w.queue.front());
+			w.queue.pop_front();
+		}
+		else
+		{
+			// Steal the newest task
+			out = std::move(w.queue.back());
+			w.queue.pop_back();
+		}
+
+		m_queued--;
+		return true;
+	}
+
+	return false;
+}
+
+void utils::task_pool::run(task& t)
+{
+	try
+	{
+		t.func();
+	}
+	catch (...)
+	{
+		// The task is still completed, so the waiters don't hang
+		if (!t.group->m_failed.exchange(true))
+		{
+			t.group->m_exception = std::current_exception();
+		}
+	}
+
+	t.func = nullptr;
+
+	if (t.group->m_count.sub_fetch(1) == 0)
+	{
+		// Wake up waiters
+		notify();
+	}
+}
+
+void utils::task_pool::worker_loop(u32 index, int priority)
+{
+	s_tls_pool = this;
+	s_tls_index = index;
+
+	if (priority)
+	{
+		thread_ctrl::set_native_priority(priority);
+	}
+
+	task t;
+
+	while (!m_stop)
+	{
+		if (pop(index, t))
+		{
+			run(t);
+			continue;
+		}
+
+		std::lock_guard lock(m_mutex);
+
+		if (!m_queued && !m_stop)
+		{
+			m_cond.wait(m_mutex, 100000);
+		}
+	}
+}
+
+void utils::task_pool::wait(task_group& group)
+{
+	// Start from the own queue if called from a worker
+	const u32 index = s_tls_pool == this ? s_tls_index : 0;
+
+	task t;
+
+	while (!group.done())
+	{
+		// Help executing tasks of the group
+		if (pop(index, t, &group))
+		{
+			run(t);
+			continue;
+		}
+
+		std::lock_guard lock(m_mutex);
+
+		if (!group.done())
+		{
+			m_cond.wait(m_mutex, 10000);
+		}
+	}
+
+	if (group.m_failed)
+	{
+		// Reset the group so it can be reused
+		auto exception = std::exchange(group.m_exception, nullptr);
+		group.m_failed = false;
+		std::rethrow_exception(std::move(exception));
+	}
+}
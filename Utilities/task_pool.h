@@ -0,0 +1,100 @@
+#pragma once
+
+#include "types.h"
+#include "Atomic.h"
+#include "mutex.h"
+#include "cond.h"
+
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utils
+{
+	// Set of tasks which can be waited for
+	class task_group
+	{
+		friend class task_pool;
+
+		// Number of unfinished tasks
+		atomic_t<u64> m_count{0};
+
+		// First exception thrown by a task (rethrown by task_pool::wait)
+		atomic_t<bool> m_failed{false};
+		std::exception_ptr m_exception;
+
+	public:
+		task_group() = default;
+
+		task_group(const task_group&) = delete;
+
+		task_group& operator=(const task_group&) = delete;
+
+		bool done() const
+		{
+			return m_count == 0;
+		}
+	};
+
+	// Persistent pool of worker threads.
+	// Every worker has its own queue, idle workers steal tasks from the queues of other workers.
+	class task_pool
+	{
+		struct task
+		{
+			std::function<void()> func;
+			task_group* group;
+		};
+
+		struct worker;
+
+		std::vector<std::unique_ptr<worker>> m_workers;
+
+		// Idle workers and waiters sleep here
+		shared_mutex m_mutex;
+		cond_variable m_cond;
+
+		// Total number of queued tasks
+		atomic_t<u64> m_queued{0};
+
+		// Round-robin counter for tasks pushed from other threads
+		atomic_t<u32> m_next{0};
+
+		atomic_t<bool> m_stop{false};
+
+		// Try to get a task, starting from the queue of specified worker (optionally only tasks of specified group)
+		bool pop(u32 index, task& out, task_group* group = nullptr);
+
+		// Run a task and update its group
+		void run(task& t);
+
+		void notify();
+
+		void worker_loop(u32 index, int priority);
+
+	public:
+		task_pool(std::string_view name, u32 threads, int priority = 0);
+
+		task_pool(const task_pool&) = delete;
+
+		task_pool& operator=(const task_pool&) = delete;
+
+		~task_pool();
+
+		// Queue a task (tasks pushed from a worker thread go to its own queue)
+		void push(task_group& group, std::function<void()> func);
+
+		// Wait for all tasks of the group, executing its queued tasks meanwhile.
+		// Rethrows the first exception thrown by a task of the group (after all of them have finished).
+		void wait(task_group& group);
+
+		u32 size() const
+		{
+			return ::size32(m_workers);
+		}
+	};
+}
@@ -10,6 +10,17 @@ enum : u32
 	AUDIO_BUFFER_SAMPLES = 256
 };
 
+// Timing information of one cellAudio period, reported to the backend after the mixed buffer was enqueued
+struct audio_period_stats
+{
+	u64 timestamp; // usecs since the audio thread started
+	u64 mix_time; // nsecs spent mixing the ports
+	u64 period_time; // nsecs spent in the whole period, from the ringbuffer update to the enqueue
+	u64 enqueued_samples; // ringbuffer fill level as seen by cellAudio (0 if buffering is disabled)
+	f32 frequency_ratio;
+	bool playing;
+};
+
 class AudioBackend
 {
 public:
@@ -85,6 +96,11 @@ public:
 		return 1.0f;
 	}
 
+	// Called by cellAudio at the end of every audio period, only used for instrumentation
+	virtual void OnPeriodEnd(const audio_period_stats& /* stats */)
+	{
+	}
+
 
 	/*
 	 * Helper methods
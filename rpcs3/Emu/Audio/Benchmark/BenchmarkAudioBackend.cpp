@@ -0,0 +1,227 @@
+﻿#include "stdafx.h"
+#include "Emu/System.h"
+
+#include "BenchmarkAudioBackend.h"
+
+#include <cmath>
+
+BenchmarkAudioBackend::BenchmarkAudioBackend(const std::string& output_path)
+	: m_sampling_rate(get_sampling_rate())
+	, m_sample_size(get_sample_size())
+	, m_channels(get_channels())
+	, m_output_path(output_path.empty() ? fs::get_cache_dir() + "audio_benchmark" : output_path)
+{
+}
+
+BenchmarkAudioBackend::~BenchmarkAudioBackend()
+{
+}
+
+void BenchmarkAudioBackend::update_device(u64 time)
+{
+	// The device keeps the state it had at the end of the previous period until the end of this one
+	if (m_device_playing && time > m_time)
+	{
+		m_device_samples -= (time - m_time) * (m_sampling_rate * static_cast<f64>(m_frequency_ratio)) / 1'000'000.;
+
+		if (m_device_samples <= 0.)
+		{
+			// Starved: stop like a real device would, cellAudio will notice and restart playback
+			m_device_samples = 0.;
+			m_playing = false;
+			m_underruns++;
+		}
+	}
+
+	m_time = std::max(m_time, time);
+	m_device_samples += m_pending_samples;
+	m_pending_samples = 0;
+	m_device_playing = m_playing;
+}
+
+void BenchmarkAudioBackend::Open(u32 num_buffers)
+{
+	m_num_buffers = num_buffers;
+	m_records.clear();
+	m_records.reserve(64 * 1024);
+
+	m_playing = false;
+	m_frequency_ratio = 1.0f;
+	m_device_samples = 0.;
+	m_pending_samples = 0;
+	m_time = 0;
+	m_device_playing = false;
+	m_enqueued = false;
+	m_last_enqueue_time = -1;
+	m_underruns = 0;
+	m_dropped_records = 0;
+}
+
+void BenchmarkAudioBackend::Close()
+{
+	m_playing = false;
+	write_results();
+	m_records.clear();
+}
+
+void BenchmarkAudioBackend::Play()
+{
+	m_playing = true;
+}
+
+void BenchmarkAudioBackend::Pause()
+{
+	m_playing = false;
+}
+
+bool BenchmarkAudioBackend::IsPlaying()
+{
+	return m_playing;
+}
+
+bool BenchmarkAudioBackend::AddData(const void* /* src */, u32 num_samples)
+{
+	const u32 frames = num_samples / m_channels;
+
+	if (m_device_samples + m_pending_samples + frames > m_num_buffers * AUDIO_BUFFER_SAMPLES)
+	{
+		// Device queue is full
+		return false;
+	}
+
+	m_pending_samples += frames;
+	m_enqueued = true;
+	return true;
+}
+
+void BenchmarkAudioBackend::Flush()
+{
+	m_playing = false;
+	m_device_playing = false;
+	m_device_samples = 0.;
+	m_pending_samples = 0;
+}
+
+u64 BenchmarkAudioBackend::GetNumEnqueuedSamples()
+{
+	return static_cast<u64>(std::ceil(m_device_samples)) + m_pending_samples;
+}
+
+f32 BenchmarkAudioBackend::SetFrequencyRatio(f32 new_ratio)
+{
+	// Same range as the OpenAL backend
+	m_frequency_ratio = std::clamp(new_ratio, 0.5f, 2.0f);
+	return m_frequency_ratio;
+}
+
+void BenchmarkAudioBackend::OnPeriodEnd(const audio_period_stats& stats)
+{
+	update_device(stats.timestamp);
+
+	s64 enqueue_delta = -1;
+
+	if (m_enqueued)
+	{
+		if (m_last_enqueue_time >= 0)
+		{
+			enqueue_delta = stats.timestamp - m_last_enqueue_time;
+		}
+
+		m_last_enqueue_time = stats.timestamp;
+		m_enqueued = false;
+	}
+
+	if (m_records.size() >= max_records)
+	{
+		m_dropped_records++;
+		return;
+	}
+
+	m_records.push_back({stats.timestamp, stats.mix_time, stats.period_time, enqueue_delta, stats.enqueued_samples, static_cast<u64>(std::ceil(m_device_samples)), stats.frequency_ratio, stats.playing});
+}
+
+void BenchmarkAudioBackend::write_results()
+{
+	if (m_records.empty())
+	{
+		return;
+	}
+
+	std::string csv = "timestamp_us,mix_time_ns,period_time_ns,enqueue_delta_us,enqueued_samples,device_samples,frequency_ratio,playing\n";
+	csv.reserve(m_records.size() * 56);
+
+	u64 mix_min = UINT64_MAX, mix_max = 0, mix_sum = 0;
+	u64 period_min = UINT64_MAX, period_max = 0, period_sum = 0;
+	u64 fill_min = UINT64_MAX, fill_max = 0, fill_sum = 0;
+	f32 ratio_min = 2.0f, ratio_max = 0.0f;
+
+	// Enqueue jitter is the standard deviation of the interval between two AddData calls
+	u64 delta_count = 0, delta_max = 0;
+	f64 delta_sum = 0., delta_sq_sum = 0.;
+
+	std::vector<u64> mix_times, period_times;
+	mix_times.reserve(m_records.size());
+	period_times.reserve(m_records.size());
+
+	for (const auto& r : m_records)
+	{
+		fmt::append(csv, "%u,%u,%u,%d,%u,%u,%.4f,%u\n", r.timestamp, r.mix_time, r.period_time, r.enqueue_delta, r.enqueued_samples, r.device_samples, r.frequency_ratio, r.playing ? 1 : 0);
+
+		mix_min = std::min(mix_min, r.mix_time);
+		mix_max = std::max(mix_max, r.mix_time);
+		mix_sum += r.mix_time;
+		mix_times.push_back(r.mix_time);
+
+		period_min = std::min(period_min, r.period_time);
+		period_max = std::max(period_max, r.period_time);
+		period_sum += r.period_time;
+		period_times.push_back(r.period_time);
+
+		fill_min = std::min(fill_min, r.device_samples);
+		fill_max = std::max(fill_max, r.device_samples);
+		fill_sum += r.device_samples;
+
+		ratio_min = std::min(ratio_min, r.frequency_ratio);
+		ratio_max = std::max(ratio_max, r.frequency_ratio);
+
+		if (r.enqueue_delta >= 0)
+		{
+			delta_count++;
+			delta_max = std::max<u64>(delta_max, r.enqueue_delta);
+			delta_sum += r.enqueue_delta;
+			delta_sq_sum += static_cast<f64>(r.enqueue_delta) * r.enqueue_delta;
+		}
+	}
+
+	const u64 count = m_records.size();
+
+	const auto mix_p99 = mix_times.begin() + (count * 99) / 100;
+	std::nth_element(mix_times.begin(), mix_p99, mix_times.end());
+
+	const auto period_p99 = period_times.begin() + (count * 99) / 100;
+	std::nth_element(period_times.begin(), period_p99, period_times.end());
+
+	const f64 delta_avg = delta_count ? delta_sum / delta_count : 0.;
+	const f64 delta_jitter = delta_count ? std::sqrt(std::max(delta_sq_sum / delta_count - delta_avg * delta_avg, 0.)) : 0.;
+
+	const std::string json = fmt::format(
+		"{\"periods\": %u, \"dropped_periods\": %u, \"duration_us\": %u, \"sampling_rate\": %u, \"channels\": %u, \"sample_size\": %u, "
+		"\"mix_time_ns\": {\"min\": %u, \"avg\": %u, \"p99\": %u, \"max\": %u}, "
+		"\"period_time_ns\": {\"min\": %u, \"avg\": %u, \"p99\": %u, \"max\": %u}, "
+		"\"enqueue_interval_us\": {\"avg\": %.1f, \"jitter\": %.1f, \"max\": %u}, "
+		"\"device_fill_samples\": {\"min\": %u, \"avg\": %u, \"max\": %u}, "
+		"\"frequency_ratio\": {\"min\": %.4f, \"max\": %.4f}, \"underruns\": %u}\n",
+		count, m_dropped_records, m_records.back().timestamp - m_records.front().timestamp, m_sampling_rate, m_channels, m_sample_size,
+		mix_min, mix_sum / count, *mix_p99, mix_max,
+		period_min, period_sum / count, *period_p99, period_max,
+		delta_avg, delta_jitter, delta_max,
+		fill_min, fill_sum / count, fill_max,
+		ratio_min, ratio_max, m_underruns);
+
+	LOG_SUCCESS(GENERAL, "Audio benchmark: %s", json);
+
+	if (!fs::write_file(m_output_path + ".csv", fs::rewrite, csv) || !fs::write_file(m_output_path + ".json", fs::rewrite, json))
+	{
+		LOG_ERROR(GENERAL, "Audio benchmark: failed to write results to %s.csv/.json", m_output_path);
+	}
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include "Emu/Audio/AudioBackend.h"
+
+#include <string>
+#include <vector>
+
+// Headless backend which consumes audio at a simulated device rate and records the cellAudio scheduling behaviour.
+// The simulated device only advances on the period timestamps reported by cellAudio, so the same sequence of periods always yields the same results.
+// The collected data is written to <output_path>.csv/.json (audio_benchmark in the cache directory by default) when the backend is closed.
+class BenchmarkAudioBackend : public AudioBackend
+{
+	struct period_record
+	{
+		u64 timestamp; // usecs since the audio thread started
+		u64 mix_time; // nsecs
+		u64 period_time; // nsecs
+		s64 enqueue_delta; // usecs since the previous period which enqueued data (-1 if nothing was enqueued this period)
+		u64 enqueued_samples; // cellAudio fill level
+		u64 device_samples; // simulated device fill level
+		f32 frequency_ratio;
+		bool playing;
+	};
+
+	// Periods recorded after this many are dropped (~6 hours of audio)
+	static constexpr u32 max_records = 4 * 1024 * 1024;
+
+	const u32 m_sampling_rate;
+	const u32 m_sample_size;
+	const u32 m_channels;
+	const std::string m_output_path;
+
+	std::vector<period_record> m_records;
+
+	u32 m_num_buffers = 0;
+
+	bool m_playing = false;
+	f32 m_frequency_ratio = 1.0f;
+
+	// Simulated device state, in samples (fractional part kept to stay drift free)
+	// Data added during a period is queued after the device was drained up to the timestamp of that period
+	f64 m_device_samples = 0.;
+	u64 m_pending_samples = 0;
+	u64 m_time = 0; // usecs, timestamp of the last period
+	bool m_device_playing = false; // m_playing at the end of the last period
+
+	bool m_enqueued = false; // AddData succeeded during the current period
+	s64 m_last_enqueue_time = -1;
+	u64 m_underruns = 0;
+	u64 m_dropped_records = 0;
+
+	void update_device(u64 time);
+	void write_results();
+
+public:
+	BenchmarkAudioBackend(const std::string& output_path = {});
+	virtual ~BenchmarkAudioBackend() override;
+
+	virtual const char* GetName() const override { return "Benchmark"; }
+
+	static const u32 capabilities = PLAY_PAUSE_FLUSH | IS_PLAYING | GET_NUM_ENQUEUED_SAMPLES | SET_FREQUENCY_RATIO;
+	virtual u32 GetCapabilities() const override { return capabilities; }
+
+	virtual void Open(u32 num_buffers) override;
+	virtual void Close() override;
+
+	virtual void Play() override;
+	virtual void Pause() override;
+	virtual bool IsPlaying() override;
+
+	virtual bool AddData(const void* src, u32 num_samples) override;
+	virtual void Flush() override;
+
+	virtual u64 GetNumEnqueuedSamples() override;
+	virtual f32 SetFrequencyRatio(f32 new_ratio) override;
+
+	virtual void OnPeriodEnd(const audio_period_stats& stats) override;
+};
@@ -5,7 +5,9 @@
 
 #include "Emu/Cell/lv2/sys_event.h"
 #include "cellAudio.h"
+#include "Utilities/sysinfo.h"
 #include <atomic>
+#include <chrono>
 #include <cmath>
 
 LOG_CHANNEL(cellAudio);
@@ -487,8 +489,16 @@ void cell_audio_thread::operator()()
 	// Main cellAudio loop
 	while (thread_ctrl::state() != thread_state::aborting && !Emu.IsStopped())
 	{
+		const auto period_start = std::chrono::steady_clock::now();
 		const u64 timestamp = ringbuffer->update();
 
+		// Report the period to the backend (instrumentation), mix_time is 0 if nothing was mixed
+		const auto report_period = [&](u64 mix_time)
+		{
+			const u64 period_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - period_start).count();
+			cfg.backend->OnPeriodEnd({timestamp - m_start_time, mix_time, period_time, cfg.buffering_enabled ? ringbuffer->get_enqueued_samples() : 0, ringbuffer->get_frequency_ratio(), ringbuffer->is_playing()});
+		};
+
 		if (Emu.IsPaused())
 		{
 			thread_ctrl::wait_for(10000);
@@ -618,6 +628,7 @@ void cell_audio_thread::operator()()
 					ringbuffer->enqueue_silence(1);
 				}
 				untouched_expected = 0;
+				report_period(0);
 				advance(timestamp);
 				continue;
 			}
@@ -632,6 +643,7 @@ void cell_audio_thread::operator()()
 					// Don't enqueue anything, just advance time
 					cellAudio.trace("advancing time: untouched=%u/%u (expected=%u), enqueued_buffers=0", untouched, active_ports, untouched_expected);
 					untouched_expected = untouched;
+					report_period(0);
 					advance(timestamp);
 					continue;
 				}
@@ -646,6 +658,7 @@ void cell_audio_thread::operator()()
 					// There's no audio in the buffers, simply advance time and hope the game recovers
 					cellAudio.trace("advancing time: untouched=%u/%u (expected=%u), enqueued_buffers=%llu", untouched, active_ports, untouched_expected, enqueued_buffers);
 					untouched_expected = untouched;
+					report_period(0);
 					advance(timestamp);
 					continue;
 				}
@@ -665,6 +678,7 @@ void cell_audio_thread::operator()()
 					ringbuffer->enqueue_silence(1);
 				}
 				untouched_expected = untouched;
+				report_period(0);
 				advance(timestamp);
 				continue;
 			}
@@ -709,6 +723,8 @@ void cell_audio_thread::operator()()
 		}
 
 		// Mix
+		const auto mix_start = std::chrono::steady_clock::now();
+
 		float *buf = ringbuffer->get_current_buffer();
 		if (cfg.audio_channels == 2)
 		{
@@ -723,9 +739,13 @@ void cell_audio_thread::operator()()
 			fmt::throw_exception("Unsupported number of audio channels: %u", cfg.audio_channels);
 		}
 
+		const u64 mix_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mix_start).count();
+
 		// Enqueue
 		ringbuffer->enqueue();
 
+		report_period(mix_time);
+
 		// Advance time
 		advance(timestamp);
 	}
@@ -734,160 +754,326 @@ void cell_audio_thread::operator()()
 	ringbuffer.reset();
 }
 
-template <bool DownmixToStereo>
-void cell_audio_thread::mix(float *out_buffer, s32 offset)
+namespace
 {
-	AUDIT(out_buffer != nullptr);
+	// Load 4 big-endian floats
+	inline __m128 load_be_ps(const be_t<f32>* src)
+	{
+		const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
 
-	constexpr u32 channels = DownmixToStereo ? 2 : 8;
-	constexpr u32 out_buffer_sz = channels * AUDIO_BUFFER_SAMPLES;
+#if defined(_MSC_VER) || defined(__SSSE3__)
+		if (s_use_ssse3)
+		{
+			const __m128i mask = _mm_set_epi8(0xC, 0xD, 0xE, 0xF, 0x8, 0x9, 0xA, 0xB, 0x4, 0x5, 0x6, 0x7, 0x0, 0x1, 0x2, 0x3);
+			return _mm_castsi128_ps(_mm_shuffle_epi8(data, mask));
+		}
+#endif
 
-	bool first_mix = true;
+		// Swap the bytes of every halfword, then the halfwords of every word
+		const __m128i swapped = _mm_or_si128(_mm_slli_epi16(data, 8), _mm_srli_epi16(data, 8));
+		return _mm_castsi128_ps(_mm_shufflehi_epi16(_mm_shufflelo_epi16(swapped, 0xB1), 0xB1));
+	}
 
-	// mixing
-	for (auto& port : ports)
+	template <bool FirstMix>
+	inline void accumulate_ps(float* dst, __m128 value)
 	{
-		if (port.state != audio_port_state::started) continue;
+		if constexpr (FirstMix)
+		{
+			_mm_store_ps(dst, value);
+		}
+		else
+		{
+			_mm_store_ps(dst, _mm_add_ps(_mm_load_ps(dst), value));
+		}
+	}
 
-		auto buf = port.get_vm_ptr(offset);
-		static const float k = 1.0f;
-		float& m = port.level;
+	// Load 8 big-endian floats
+	AVX2_FUNC inline __m256 load_be_ps_avx2(const be_t<f32>* src)
+	{
+		const __m256i mask = _mm256_set_epi8(
+			0xC, 0xD, 0xE, 0xF, 0x8, 0x9, 0xA, 0xB, 0x4, 0x5, 0x6, 0x7, 0x0, 0x1, 0x2, 0x3,
+			0xC, 0xD, 0xE, 0xF, 0x8, 0x9, 0xA, 0xB, 0x4, 0x5, 0x6, 0x7, 0x0, 0x1, 0x2, 0x3);
+
+		return _mm256_castsi256_ps(_mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)), mask));
+	}
 
-		// part of cellAudioSetPortLevel functionality
-		// spread port volume changes over 13ms
-		auto step_volume = [](audio_port& port)
+	template <bool FirstMix>
+	AVX2_FUNC inline void accumulate_ps_avx2(float* dst, __m256 value)
+	{
+		if constexpr (FirstMix)
 		{
-			const auto param = port.level_set.load();
+			_mm256_storeu_ps(dst, value);
+		}
+		else
+		{
+			_mm256_storeu_ps(dst, _mm256_add_ps(_mm256_loadu_ps(dst), value));
+		}
+	}
 
-			if (param.inc != 0.0f)
-			{
-				port.level += param.inc;
-				const bool dec = param.inc < 0.0f;
+	// Stereo port into stereo output, 4 frames at a time
+	template <bool FirstMix, bool Ramp>
+	AVX2_FUNC void mix_stereo_avx2(float* out, const be_t<f32>* in, const float* volume)
+	{
+		const __m256i repeat = _mm256_set_epi32(3, 3, 2, 2, 1, 1, 0, 0);
+		const __m256 level = _mm256_set1_ps(volume[0]);
 
-				if ((!dec && param.value - port.level <= 0.0f) || (dec && param.value - port.level >= 0.0f))
-				{
-					port.level = param.value;
-					port.level_set.compare_and_swap(param, { param.value, 0.0f });
-				}
-			}
-		};
+		for (u32 frame = 0; frame < AUDIO_BUFFER_SAMPLES; frame += 4)
+		{
+			const __m256 vol = Ramp ? _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(volume + frame)), repeat) : level;
+			accumulate_ps_avx2<FirstMix>(out + frame * 2, _mm256_mul_ps(load_be_ps_avx2(in + frame * 2), vol));
+		}
+	}
 
-		if (port.num_channels == 2)
+	// 8 channel port into 8 channel output, one frame at a time
+	template <bool FirstMix, bool Ramp>
+	AVX2_FUNC void mix_surround_avx2(float* out, const be_t<f32>* in, const float* volume)
+	{
+		const __m256 level = _mm256_set1_ps(volume[0]);
+
+		for (u32 frame = 0; frame < AUDIO_BUFFER_SAMPLES; frame++)
 		{
-			if (first_mix)
-			{
-				for (u32 out = 0, in = 0; out < out_buffer_sz; out += channels, in += 2)
-				{
-					step_volume(port);
+			const __m256 vol = Ramp ? _mm256_broadcast_ss(volume + frame) : level;
+			accumulate_ps_avx2<FirstMix>(out + frame * 8, _mm256_mul_ps(load_be_ps_avx2(in + frame * 8), vol));
+		}
+	}
 
-					const float left  = buf[in + 0] * m;
-					const float right = buf[in + 1] * m;
+	// Returns the number of converted samples, the rest is left to the SSE loop
+	AVX2_FUNC u32 convert_to_s16_avx2(float* buffer, u32 count)
+	{
+		const __m256 scale = _mm256_set1_ps(0x8000);
+		const __m256 min = _mm256_set1_ps(-1.f);
+		const __m256 max = _mm256_set1_ps(1.f);
+		u32 i = 0;
 
-					out_buffer[out + 0] = left;
-					out_buffer[out + 1] = right;
+		// The output never overtakes the input: 16 floats are read before 8 are written at half the offset
+		for (; i + 16 <= count; i += 16)
+		{
+			const __m256i lo = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(buffer + i), min), max), scale));
+			const __m256i hi = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(buffer + i + 8), min), max), scale));
 
-					if constexpr (!DownmixToStereo)
-					{
-						out_buffer[out + 2] = 0.0f;
-						out_buffer[out + 3] = 0.0f;
-						out_buffer[out + 4] = 0.0f;
-						out_buffer[out + 5] = 0.0f;
-						out_buffer[out + 6] = 0.0f;
-						out_buffer[out + 7] = 0.0f;
-					}
-				}
-				first_mix = false;
+			// PACKSSDW works within 128-bit lanes
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(buffer + i / 2), _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8));
+		}
+
+		return i;
+	}
+
+	// Volume of two consecutive samples, each repeated for both channels
+	inline __m128 load_stereo_volume(const float* volume)
+	{
+		const __m128 pair = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(volume)));
+		return _mm_unpacklo_ps(pair, pair);
+	}
+
+	// Mix one block of a port into the output buffer
+	// If Ramp is set, volume holds the level of every sample, otherwise only volume[0] is used
+	template <u32 InChannels, bool DownmixToStereo, bool FirstMix, bool Ramp>
+	void mix_port_block(float* out, const be_t<f32>* in, const float* volume)
+	{
+		const __m128 level = _mm_set1_ps(volume[0]);
+		u32 frame = 0;
+
+		if constexpr (InChannels == 2 && DownmixToStereo)
+		{
+			if (s_use_avx2)
+			{
+				return mix_stereo_avx2<FirstMix, Ramp>(out, in, volume);
 			}
-			else
+
+			for (; frame < AUDIO_BUFFER_SAMPLES; frame += 2)
 			{
-				for (u32 out = 0, in = 0; out < out_buffer_sz; out += channels, in += 2)
-				{
-					step_volume(port);
+				const __m128 vol = Ramp ? load_stereo_volume(volume + frame) : level;
+				accumulate_ps<FirstMix>(out + frame * 2, _mm_mul_ps(load_be_ps(in + frame * 2), vol));
+			}
+		}
+		else if constexpr (InChannels == 2)
+		{
+			// Stereo into the front channels of 8 channel output
+			const __m128 zero = _mm_setzero_ps();
 
-					const float left  = buf[in + 0] * m;
-					const float right = buf[in + 1] * m;
+			for (; frame < AUDIO_BUFFER_SAMPLES; frame += 2)
+			{
+				const __m128 vol = Ramp ? load_stereo_volume(volume + frame) : level;
+				const __m128 samples = _mm_mul_ps(load_be_ps(in + frame * 2), vol);
+				float* dst = out + frame * 8;
 
-					out_buffer[out + 0] += left;
-					out_buffer[out + 1] += right;
+				if constexpr (FirstMix)
+				{
+					_mm_store_ps(dst + 0, _mm_movelh_ps(samples, zero));
+					_mm_store_ps(dst + 4, zero);
+					_mm_store_ps(dst + 8, _mm_movehl_ps(zero, samples));
+					_mm_store_ps(dst + 12, zero);
+				}
+				else
+				{
+					_mm_storel_pi(reinterpret_cast<__m64*>(dst), _mm_add_ps(_mm_loadl_pi(zero, reinterpret_cast<const __m64*>(dst)), samples));
+					_mm_storeh_pi(reinterpret_cast<__m64*>(dst + 8), _mm_add_ps(_mm_loadh_pi(zero, reinterpret_cast<const __m64*>(dst + 8)), samples));
 				}
 			}
 		}
-		else if (port.num_channels == 8)
+		else if constexpr (!DownmixToStereo)
 		{
-			if (first_mix)
+			if (s_use_avx2)
 			{
-				for (u32 out = 0, in = 0; out < out_buffer_sz; out += channels, in += 8)
-				{
-					step_volume(port);
-
-					const float left       = buf[in + 0] * m;
-					const float right      = buf[in + 1] * m;
-					const float center     = buf[in + 2] * m;
-					const float low_freq   = buf[in + 3] * m;
-					const float rear_left  = buf[in + 4] * m;
-					const float rear_right = buf[in + 5] * m;
-					const float side_left  = buf[in + 6] * m;
-					const float side_right = buf[in + 7] * m;
-
-					if constexpr (DownmixToStereo)
-					{
-						const float mid = (center + low_freq) * 0.708f;
-						out_buffer[out + 0] = (left + rear_left + side_left + mid) * k;
-						out_buffer[out + 1] = (right + rear_right + side_right + mid) * k;
-					}
-					else
-					{
-						out_buffer[out + 0] = left;
-						out_buffer[out + 1] = right;
-						out_buffer[out + 2] = center;
-						out_buffer[out + 3] = low_freq;
-						out_buffer[out + 4] = rear_left;
-						out_buffer[out + 5] = rear_right;
-						out_buffer[out + 6] = side_left;
-						out_buffer[out + 7] = side_right;
-					}
-				}
-				first_mix = false;
+				return mix_surround_avx2<FirstMix, Ramp>(out, in, volume);
 			}
+
+			for (; frame < AUDIO_BUFFER_SAMPLES; frame++)
+			{
+				const __m128 vol = Ramp ? _mm_load1_ps(volume + frame) : level;
+				accumulate_ps<FirstMix>(out + frame * 8 + 0, _mm_mul_ps(load_be_ps(in + frame * 8 + 0), vol));
+				accumulate_ps<FirstMix>(out + frame * 8 + 4, _mm_mul_ps(load_be_ps(in + frame * 8 + 4), vol));
+			}
+		}
+		else
+		{
+			// 8 channels downmixed to stereo
+			const __m128 mid_scale = _mm_set1_ps(0.708f);
+
+			auto downmix = [&](u32 frame)
+			{
+				const __m128 vol = Ramp ? _mm_load1_ps(volume + frame) : level;
+				const __m128 front = _mm_mul_ps(load_be_ps(in + frame * 8 + 0), vol); // left, right, center, low_freq
+				const __m128 back = _mm_mul_ps(load_be_ps(in + frame * 8 + 4), vol); // rear_left, rear_right, side_left, side_right
+
+				const __m128 mid = _mm_mul_ps(_mm_add_ps(_mm_shuffle_ps(front, front, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(front, front, _MM_SHUFFLE(3, 3, 3, 3))), mid_scale);
+				return _mm_add_ps(_mm_add_ps(_mm_add_ps(front, back), _mm_movehl_ps(back, back)), mid);
+			};
+
+			for (; frame < AUDIO_BUFFER_SAMPLES; frame += 2)
+			{
+				accumulate_ps<FirstMix>(out + frame * 2, _mm_movelh_ps(downmix(frame), downmix(frame + 1)));
+			}
+		}
+	}
+
+	template <u32 InChannels, bool DownmixToStereo>
+	void mix_port_typed(float* out, const be_t<f32>* in, const float* volume, bool first_mix, bool ramp)
+	{
+		if (first_mix)
+		{
+			if (ramp)
+				mix_port_block<InChannels, DownmixToStereo, true, true>(out, in, volume);
+			else
+				mix_port_block<InChannels, DownmixToStereo, true, false>(out, in, volume);
+		}
+		else
+		{
+			if (ramp)
+				mix_port_block<InChannels, DownmixToStereo, false, true>(out, in, volume);
 			else
+				mix_port_block<InChannels, DownmixToStereo, false, false>(out, in, volume);
+		}
+	}
+
+	// part of cellAudioSetPortLevel functionality
+	// spread port volume changes over 13ms, the level of every sample of the block is computed upfront
+	// Returns false if the level is constant over the block (only volume[0] is written)
+	bool step_port_volume(audio_port& port, float* volume)
+	{
+		const auto param = port.level_set.load();
+
+		if (param.inc == 0.0f)
+		{
+			volume[0] = port.level;
+			return false;
+		}
+
+		const bool dec = param.inc < 0.0f;
+		float level = port.level;
+		u32 i = 0;
+
+		for (; i < AUDIO_BUFFER_SAMPLES; i++)
+		{
+			level += param.inc;
+
+			if ((!dec && param.value - level <= 0.0f) || (dec && param.value - level >= 0.0f))
 			{
-				for (u32 out = 0, in = 0; out < out_buffer_sz; out += channels, in += 8)
-				{
-					step_volume(port);
-
-					const float left       = buf[in + 0] * m;
-					const float right      = buf[in + 1] * m;
-					const float center     = buf[in + 2] * m;
-					const float low_freq   = buf[in + 3] * m;
-					const float rear_left  = buf[in + 4] * m;
-					const float rear_right = buf[in + 5] * m;
-					const float side_left  = buf[in + 6] * m;
-					const float side_right = buf[in + 7] * m;
-
-					if constexpr (DownmixToStereo)
-					{
-						const float mid = (center + low_freq) * 0.708f;
-						out_buffer[out + 0] += (left + rear_left + side_left + mid) * k;
-						out_buffer[out + 1] += (right + rear_right + side_right + mid) * k;
-					}
-					else
-					{
-						out_buffer[out + 0] += left;
-						out_buffer[out + 1] += right;
-						out_buffer[out + 2] += center;
-						out_buffer[out + 3] += low_freq;
-						out_buffer[out + 4] += rear_left;
-						out_buffer[out + 5] += rear_right;
-						out_buffer[out + 6] += side_left;
-						out_buffer[out + 7] += side_right;
-					}
-				}
+				level = param.value;
+				port.level_set.compare_and_swap(param, { param.value, 0.0f });
+				break;
 			}
+
+			volume[i] = level;
+		}
+
+		for (; i < AUDIO_BUFFER_SAMPLES; i++)
+		{
+			volume[i] = level;
 		}
+
+		port.level = level;
+		return true;
+	}
+}
+
+void audio_mixer::mix_port(float* out, const be_t<f32>* in, u32 in_channels, bool downmix_to_stereo, const float* volume, bool first_mix, bool ramp)
+{
+	if (in_channels == 2)
+	{
+		if (downmix_to_stereo)
+			mix_port_typed<2, true>(out, in, volume, first_mix, ramp);
 		else
+			mix_port_typed<2, false>(out, in, volume, first_mix, ramp);
+	}
+	else
+	{
+		if (downmix_to_stereo)
+			mix_port_typed<8, true>(out, in, volume, first_mix, ramp);
+		else
+			mix_port_typed<8, false>(out, in, volume, first_mix, ramp);
+	}
+}
+
+void audio_mixer::convert_to_s16(float* buffer, u32 count)
+{
+	u32 i = 0;
+
+	if (s_use_avx2)
+	{
+		i = convert_to_s16_avx2(buffer, count);
+	}
+
+	const __m128 scale = _mm_set1_ps(0x8000);
+	const __m128 min = _mm_set1_ps(-1.f);
+	const __m128 max = _mm_set1_ps(1.f);
+
+	for (; i < count; i += 8)
+	{
+		const __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_load_ps(buffer + i), min), max), scale));
+		const __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_load_ps(buffer + i + 4), min), max), scale));
+		_mm_store_ps(buffer + i / 2, _mm_castsi128_ps(_mm_packs_epi32(lo, hi)));
+	}
+}
+
+template <bool DownmixToStereo>
+void cell_audio_thread::mix(float *out_buffer, s32 offset)
+{
+	AUDIT(out_buffer != nullptr);
+
+	constexpr u32 channels = DownmixToStereo ? 2 : 8;
+	constexpr u32 out_buffer_sz = channels * AUDIO_BUFFER_SAMPLES;
+
+	bool first_mix = true;
+
+	alignas(16) float volume[AUDIO_BUFFER_SAMPLES];
+
+	// mixing
+	for (auto& port : ports)
+	{
+		if (port.state != audio_port_state::started) continue;
+
+		const auto buf = port.get_vm_ptr(offset);
+		const bool ramp = step_port_volume(port, volume);
+
+		if (port.num_channels != 2 && port.num_channels != 8)
 		{
 			fmt::throw_exception("Unknown channel count (port=%u, channel=%d)" HERE, port.number, port.num_channels);
 		}
+
+		audio_mixer::mix_port(out_buffer, buf, port.num_channels, DownmixToStereo, volume, first_mix, ramp);
+
+		first_mix = false;
 	}
 
 	// Nothing was mixed, memset out_buffer to 0
@@ -897,20 +1083,7 @@ void cell_audio_thread::mix(float *out_buffer, s32 offset)
 	}
 	else if (g_cfg.audio.convert_to_u16)
 	{
-		// convert the data from float to u16 with clipping:
-		// 2x MULPS
-		// 2x MAXPS (optional)
-		// 2x MINPS (optional)
-		// 2x CVTPS2DQ (converts float to s32)
-		// PACKSSDW (converts s32 to s16 with signed saturation)
-
-		for (size_t i = 0; i < out_buffer_sz; i += 8)
-		{
-			const auto scale = _mm_set1_ps(0x8000);
-			_mm_store_ps(out_buffer + i / 2, _mm_castsi128_ps(_mm_packs_epi32(
-				_mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(out_buffer + i), scale)),
-				_mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(out_buffer + i + 4), scale)))));
-		}
+		audio_mixer::convert_to_s16(out_buffer, out_buffer_sz);
 	}
 }
 
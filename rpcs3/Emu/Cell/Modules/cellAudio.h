@@ -319,6 +319,16 @@ public:
 };
 
 
+namespace audio_mixer
+{
+	// Mix one block (AUDIO_BUFFER_SAMPLES frames) of a 2 or 8 channel port into a 16-byte aligned 2 or 8 channel buffer
+	// If ramp is set, volume holds the level of every frame, otherwise only volume[0] is used
+	void mix_port(float* out, const be_t<f32>* in, u32 in_channels, bool downmix_to_stereo, const float* volume, bool first_mix, bool ramp);
+
+	// Convert count mixed samples from float to s16 in place, with clipping
+	void convert_to_s16(float* buffer, u32 count);
+}
+
 class cell_audio_thread
 {
 	vm::ptr<char> m_buffer;
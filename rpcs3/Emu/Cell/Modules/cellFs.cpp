@@ -5,11 +5,15 @@
 
 #include "Emu/Cell/lv2/sys_fs.h"
 #include "Emu/Cell/lv2/sys_sync.h"
+#include "Emu/Cell/lv2/sys_ppu_thread.h"
+#include "sysPrxForUser.h"
 #include "cellFs.h"
 
 #include "Utilities/StrUtil.h"
 
 #include <mutex>
+#include <set>
+#include <unordered_map>
 
 LOG_CHANNEL(cellFs);
 
@@ -70,10 +74,15 @@ error_code cellFsWrite(ppu_thread& ppu, u32 fd, vm::cptr<void> buf, u64 nbytes,
 	return sys_fs_write(ppu, fd, buf, nbytes, nwrite ? nwrite : vm::var<u64>{});
 }
 
+static bool fs_st_release(u32 fd);
+
 error_code cellFsClose(ppu_thread& ppu, u32 fd)
 {
 	cellFs.trace("cellFsClose(fd=0x%x)", fd);
 
+	// Stream reading ends with the file, so the ring buffer isn't leaked and the fd can be reused
+	fs_st_release(fd);
+
 	return sys_fs_close(ppu, fd);
 }
 
@@ -649,16 +658,94 @@ error_code cellFsSetDiscReadRetrySetting()
 	return CELL_OK;
 }
 
+// Stream reading state of a file descriptor
+struct fs_st_stream
+{
+	// Serializes operations on the stream (including its I/O)
+	shared_mutex mutex;
+
+	CellFsRingBuffer ringbuf;
+	u64 status = CELL_FS_ST_INITIALIZED | CELL_FS_ST_STOP;
+
+	// Current position and end of the requested range
+	u64 pos = 0;
+	u64 end = 0;
+
+	// Ring buffer in guest memory (copyless mode)
+	u32 ring_addr = 0;
+	u64 ring_pos = 0;
+
+	// Size of the block returned by cellFsStReadGetCurrentAddr
+	u64 current = 0;
+
+	// Set by cellFsStReadFinish (the stream may still be referenced by a concurrent call)
+	bool finished = false;
+};
+
+struct fs_st_manager
+{
+	// Only protects the map, so I/O of a stream doesn't block the others
+	shared_mutex mutex;
+	std::unordered_map<u32, std::shared_ptr<fs_st_stream>> streams;
+
+	std::shared_ptr<fs_st_stream> get(u32 fd)
+	{
+		reader_lock lock(mutex);
+
+		const auto found = streams.find(fd);
+		return found == streams.end() ? nullptr : found->second;
+	}
+};
+
+// Remove the stream of the fd and free its ring buffer
+static bool fs_st_release(u32 fd)
+{
+	const auto m = fxm::get<fs_st_manager>();
+
+	if (!m)
+	{
+		return false;
+	}
+
+	std::shared_ptr<fs_st_stream> stream;
+	{
+		std::lock_guard lock(m->mutex);
+
+		const auto found = m->streams.find(fd);
+
+		if (found == m->streams.end())
+		{
+			return false;
+		}
+
+		stream = std::move(found->second);
+		m->streams.erase(found);
+	}
+
+	// Wait for the operations in progress
+	std::lock_guard lock(stream->mutex);
+
+	stream->finished = true;
+
+	if (stream->ring_addr)
+	{
+		vm::dealloc(stream->ring_addr, vm::main);
+		stream->ring_addr = 0;
+	}
+
+	return true;
+}
+
 s32 cellFsStReadInit(u32 fd, vm::cptr<CellFsRingBuffer> ringbuf)
 {
-	cellFs.todo("cellFsStReadInit(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
+	cellFs.warning("cellFsStReadInit(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
 
 	if (ringbuf->copy & ~CELL_FS_ST_COPYLESS)
 	{
 		return CELL_EINVAL;
 	}
 
-	if (ringbuf->block_size & 0xfff) // check if a multiple of sector size
+	if (!ringbuf->block_size || ringbuf->block_size & 0xfff) // check if a multiple of sector size
 	{
 		return CELL_EINVAL;
 	}
@@ -668,6 +755,11 @@ s32 cellFsStReadInit(u32 fd, vm::cptr<CellFsRingBuffer> ringbuf)
 		return CELL_EINVAL;
 	}
 
+	if (ringbuf->ringbuf_size > UINT32_MAX)
+	{
+		return CELL_EINVAL;
+	}
+
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
 	if (!file)
@@ -680,14 +772,35 @@ s32 cellFsStReadInit(u32 fd, vm::cptr<CellFsRingBuffer> ringbuf)
 		return CELL_EPERM;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+
+	std::lock_guard lock(m->mutex);
+
+	if (m->streams.count(fd))
+	{
+		return CELL_EBUSY;
+	}
+
+	const auto stream = std::make_shared<fs_st_stream>();
+	stream->ringbuf = *ringbuf;
+
+	if (ringbuf->copy == CELL_FS_ST_COPYLESS)
+	{
+		stream->ring_addr = vm::alloc(static_cast<u32>(ringbuf->ringbuf_size), vm::main);
+
+		if (!stream->ring_addr)
+		{
+			return CELL_ENOMEM;
+		}
+	}
 
+	m->streams.emplace(fd, stream);
 	return CELL_OK;
 }
 
 s32 cellFsStReadFinish(u32 fd)
 {
-	cellFs.todo("cellFsStReadFinish(fd=%d)", fd);
+	cellFs.warning("cellFsStReadFinish(fd=%d)", fd);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -696,14 +809,17 @@ s32 cellFsStReadFinish(u32 fd)
 		return CELL_EBADF; // ???
 	}
 
-	// TODO
+	if (!fs_st_release(fd))
+	{
+		return CELL_ENXIO;
+	}
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetRingBuf(u32 fd, vm::ptr<CellFsRingBuffer> ringbuf)
 {
-	cellFs.todo("cellFsStReadGetRingBuf(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
+	cellFs.warning("cellFsStReadGetRingBuf(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -712,14 +828,27 @@ s32 cellFsStReadGetRingBuf(u32 fd, vm::ptr<CellFsRingBuffer> ringbuf)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto stream = fxm::get_always<fs_st_manager>()->get(fd);
+
+	if (!stream)
+	{
+		return CELL_ENXIO;
+	}
+
+	reader_lock lock(stream->mutex);
+
+	if (stream->finished)
+	{
+		return CELL_ENXIO;
+	}
 
+	*ringbuf = stream->ringbuf;
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetStatus(u32 fd, vm::ptr<u64> status)
 {
-	cellFs.todo("cellFsStReadGetRingBuf(fd=%d, status=*0x%x)", fd, status);
+	cellFs.trace("cellFsStReadGetStatus(fd=%d, status=*0x%x)", fd, status);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -728,14 +857,23 @@ s32 cellFsStReadGetStatus(u32 fd, vm::ptr<u64> status)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto stream = fxm::get_always<fs_st_manager>()->get(fd);
 
+	if (!stream)
+	{
+		*status = CELL_FS_ST_NOT_INITIALIZED;
+		return CELL_OK;
+	}
+
+	reader_lock lock(stream->mutex);
+
+	*status = stream->finished ? CELL_FS_ST_NOT_INITIALIZED : stream->status;
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetRegid(u32 fd, vm::ptr<u64> regid)
 {
-	cellFs.todo("cellFsStReadGetRingBuf(fd=%d, regid=*0x%x)", fd, regid);
+	cellFs.todo("cellFsStReadGetRegid(fd=%d, regid=*0x%x)", fd, regid);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -751,7 +889,7 @@ s32 cellFsStReadGetRegid(u32 fd, vm::ptr<u64> regid)
 
 s32 cellFsStReadStart(u32 fd, u64 offset, u64 size)
 {
-	cellFs.todo("cellFsStReadStart(fd=%d, offset=0x%llx, size=0x%llx)", fd, offset, size);
+	cellFs.warning("cellFsStReadStart(fd=%d, offset=0x%llx, size=0x%llx)", fd, offset, size);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -760,14 +898,39 @@ s32 cellFsStReadStart(u32 fd, u64 offset, u64 size)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto stream = fxm::get_always<fs_st_manager>()->get(fd);
 
+	if (!stream)
+	{
+		return CELL_ENXIO;
+	}
+
+	std::lock_guard lock(stream->mutex);
+
+	if (stream->finished)
+	{
+		return CELL_ENXIO;
+	}
+
+	if (stream->status & CELL_FS_ST_PROGRESS)
+	{
+		return CELL_EBUSY;
+	}
+
+	stream->pos = offset;
+	stream->end = size > ~offset ? UINT64_MAX : offset + size;
+	stream->ring_pos = 0;
+	stream->current = 0;
+	stream->status = CELL_FS_ST_INITIALIZED | CELL_FS_ST_PROGRESS;
+
+	// Start filling read-ahead buffers in background
+	lv2_file::read_ahead(file, offset);
 	return CELL_OK;
 }
 
 s32 cellFsStReadStop(u32 fd)
 {
-	cellFs.todo("cellFsStReadStop(fd=%d)", fd);
+	cellFs.warning("cellFsStReadStop(fd=%d)", fd);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -776,14 +939,27 @@ s32 cellFsStReadStop(u32 fd)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto stream = fxm::get_always<fs_st_manager>()->get(fd);
+
+	if (!stream)
+	{
+		return CELL_ENXIO;
+	}
+
+	std::lock_guard lock(stream->mutex);
+
+	if (stream->finished)
+	{
+		return CELL_ENXIO;
+	}
 
+	stream->status = CELL_FS_ST_INITIALIZED | CELL_FS_ST_STOP;
 	return CELL_OK;
 }
 
 s32 cellFsStRead(u32 fd, vm::ptr<u8> buf, u64 size, vm::ptr<u64> rsize)
 {
-	cellFs.todo("cellFsStRead(fd=%d, buf=*0x%x, size=0x%llx, rsize=*0x%x)", fd, buf, size, rsize);
+	cellFs.trace("cellFsStRead(fd=%d, buf=*0x%x, size=0x%llx, rsize=*0x%x)", fd, buf, size, rsize);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -792,14 +968,44 @@ s32 cellFsStRead(u32 fd, vm::ptr<u8> buf, u64 size, vm::ptr<u64> rsize)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto stream = fxm::get_always<fs_st_manager>()->get(fd);
 
+	if (!stream)
+	{
+		return CELL_ENXIO;
+	}
+
+	std::lock_guard lock(stream->mutex);
+
+	if (stream->finished)
+	{
+		return CELL_ENXIO;
+	}
+
+	if (stream->ringbuf.copy == CELL_FS_ST_COPYLESS)
+	{
+		return CELL_EPERM;
+	}
+
+	if (!(stream->status & CELL_FS_ST_PROGRESS))
+	{
+		*rsize = 0;
+		return CELL_OK;
+	}
+
+	reader_lock mp_lock(file->mp->mutex);
+
+	const u64 result = file->op_read(buf, std::min<u64>(size, stream->end - stream->pos), stream->pos);
+	stream->pos += result;
+	*rsize = result;
+
+	lv2_file::read_ahead(file);
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetCurrentAddr(u32 fd, vm::ptr<u32> addr, vm::ptr<u64> size)
 {
-	cellFs.todo("cellFsStReadGetCurrentAddr(fd=%d, addr=*0x%x, size=*0x%x)", fd, addr, size);
+	cellFs.trace("cellFsStReadGetCurrentAddr(fd=%d, addr=*0x%x, size=*0x%x)", fd, addr, size);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -808,14 +1014,44 @@ s32 cellFsStReadGetCurrentAddr(u32 fd, vm::ptr<u32> addr, vm::ptr<u64> size)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto stream = fxm::get_always<fs_st_manager>()->get(fd);
+
+	if (!stream)
+	{
+		return CELL_ENXIO;
+	}
+
+	std::lock_guard lock(stream->mutex);
+
+	if (stream->finished)
+	{
+		return CELL_ENXIO;
+	}
+
+	if (stream->ringbuf.copy != CELL_FS_ST_COPYLESS)
+	{
+		return CELL_EPERM;
+	}
 
+	if (!stream->current && stream->status & CELL_FS_ST_PROGRESS)
+	{
+		// Fill next block of the ring buffer
+		reader_lock mp_lock(file->mp->mutex);
+
+		const u64 block = std::min<u64>(stream->ringbuf.block_size, stream->end - stream->pos);
+		stream->current = file->op_read(vm::cast(stream->ring_addr + stream->ring_pos), block, stream->pos);
+
+		lv2_file::read_ahead(file);
+	}
+
+	*addr = static_cast<u32>(stream->ring_addr + stream->ring_pos);
+	*size = stream->current;
 	return CELL_OK;
 }
 
 s32 cellFsStReadPutCurrentAddr(u32 fd, vm::ptr<u8> addr, u64 size)
 {
-	cellFs.todo("cellFsStReadPutCurrentAddr(fd=%d, addr=*0x%x, size=0x%llx)", fd, addr, size);
+	cellFs.trace("cellFsStReadPutCurrentAddr(fd=%d, addr=*0x%x, size=0x%llx)", fd, addr, size);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -824,14 +1060,40 @@ s32 cellFsStReadPutCurrentAddr(u32 fd, vm::ptr<u8> addr, u64 size)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto stream = fxm::get_always<fs_st_manager>()->get(fd);
 
+	if (!stream)
+	{
+		return CELL_ENXIO;
+	}
+
+	std::lock_guard lock(stream->mutex);
+
+	if (stream->finished)
+	{
+		return CELL_ENXIO;
+	}
+
+	if (stream->ringbuf.copy != CELL_FS_ST_COPYLESS)
+	{
+		return CELL_EPERM;
+	}
+
+	if (addr.addr() != stream->ring_addr + stream->ring_pos || size > stream->current)
+	{
+		return CELL_EINVAL;
+	}
+
+	// Release the block
+	stream->pos += stream->current;
+	stream->ring_pos = (stream->ring_pos + stream->ringbuf.block_size) % stream->ringbuf.ringbuf_size;
+	stream->current = 0;
 	return CELL_OK;
 }
 
 s32 cellFsStReadWait(u32 fd, u64 size)
 {
-	cellFs.todo("cellFsStReadWait(fd=%d, size=0x%llx)", fd, size);
+	cellFs.trace("cellFsStReadWait(fd=%d, size=0x%llx)", fd, size);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -840,8 +1102,7 @@ s32 cellFsStReadWait(u32 fd, u64 size)
 		return CELL_EBADF;
 	}
 
-	// TODO
-
+	// Data is read on demand, read-ahead buffers are awaited by the readers
 	return CELL_OK;
 }
 
@@ -863,86 +1124,201 @@ s32 cellFsStReadWaitCallback(u32 fd, u64 size, vm::ptr<void(s32 xfd, u64 xsize)>
 
 using fs_aio_cb_t = vm::ptr<void(vm::ptr<CellFsAio> xaio, s32 error, s32 xid, u64 size)>;
 
-// temporarily
-struct lv2_fs_mount_point
+// Completed AIO request (empty callback stops the AIO thread)
+struct fs_aio_result
 {
-	std::mutex mutex;
+	vm::ptr<CellFsAio> aio;
+	fs_aio_cb_t func;
+	s32 error;
+	s32 xid;
+	u64 size;
 };
 
-struct fs_aio_thread : ppu_thread
+struct fs_aio_manager
 {
-	using ppu_thread::ppu_thread;
+	// AIO thread, executes completion callbacks
+	u32 ppu_tid = 0;
 
-	void non_task()
-	{
-		while (cmd64 cmd = cmd_wait())
-		{
-			const u32 type = cmd.arg1<u32>();
-			const s32 xid = cmd.arg2<s32>();
-			const cmd64 cmd2 = cmd_get(1);
-			const auto aio = cmd2.arg1<vm::ptr<CellFsAio>>();
-			const auto func = cmd2.arg2<fs_aio_cb_t>();
-			cmd_pop(1);
+	lf_queue<fs_aio_result> done;
 
-			s32 error = CELL_OK;
-			u64 result = 0;
+	// Requests not yet started (can be cancelled)
+	shared_mutex mutex;
+	std::set<s32> pending;
 
-			const auto file = idm::get<lv2_fs_object, lv2_file>(aio->fd);
+	// Requests not yet passed to the AIO thread, cellFsAioFinish waits for them
+	u32 in_flight = 0;
+	cond_variable in_flight_cond;
 
-			if (!file || (type == 1 && file->flags & CELL_FS_O_WRONLY) || (type == 2 && !(file->flags & CELL_FS_O_ACCMODE)))
-			{
-				error = CELL_EBADF;
-			}
-			else
-			{
-				std::lock_guard lock(file->mp->mutex);
+	// Set by cellFsAioFinish, no more requests are accepted
+	bool finished = false;
+};
 
-				const auto old_pos = file->file.pos(); file->file.seek(aio->offset);
+// Pass a completed request to the AIO thread
+static void fs_aio_complete(fs_aio_manager& m, fs_aio_result&& result)
+{
+	m.done.push(std::move(result));
+
+	if (const auto thread = idm::get<named_thread<ppu_thread>>(m.ppu_tid))
+	{
+		thread_ctrl::notify(*thread);
+	}
+}
+
+static void fsAioEntry(ppu_thread& ppu)
+{
+	const auto m = fxm::get<fs_aio_manager>();
 
-				result = type == 2
-					? file->op_write(aio->buf, aio->size)
-					: file->op_read(aio->buf, aio->size);
+	if (m)
+	{
+		for (auto cmds = m->done.pop_all(); !Emu.IsStopped(); cmds ? cmds.pop_front() : cmds = m->done.pop_all())
+		{
+			if (!cmds)
+			{
+				// Woken up by fs_aio_complete() or by the emulator stopping
+				thread_ctrl::wait();
+				continue;
+			}
 
-				file->file.seek(old_pos);
+			if (!cmds->func)
+			{
+				break;
 			}
 
-			func(*this, aio, error, xid, result);
-			lv2_obj::sleep(*this);
+			cmds->func(ppu, cmds->aio, cmds->error, cmds->xid, cmds->size);
 		}
 	}
-};
 
-struct fs_aio_manager
-{
-	std::shared_ptr<fs_aio_thread> thread;
-};
+	_sys_ppu_thread_exit(ppu, 0);
+}
 
-s32 cellFsAioInit(vm::cptr<char> mount_point)
+s32 cellFsAioInit(ppu_thread& ppu, vm::cptr<char> mount_point)
 {
 	cellFs.warning("cellFsAioInit(mount_point=%s)", mount_point);
 
 	// TODO: create AIO thread (if not exists) for specified mount point
 	const auto m = fxm::make<fs_aio_manager>();
 
-	fmt::throw_exception("cellFsAio disabled, use LLE.");
+	if (!m)
+	{
+		return CELL_OK;
+	}
+
+	// Run thread
+	vm::var<u64> _tid;
+	vm::var<char[]> _name = vm::make_str("HLE FS AIO Thread");
+	ppu_execute<&sys_ppu_thread_create>(ppu, +_tid, 0x10000, 0, 1000, 0x4000, SYS_PPU_THREAD_CREATE_INTERRUPT, +_name);
+	m->ppu_tid = static_cast<u32>(*_tid);
+
+	const auto thrd = idm::get<named_thread<ppu_thread>>(m->ppu_tid);
+
+	thrd->cmd_list
+	({
+		{ ppu_cmd::hle_call, FIND_FUNC(fsAioEntry) },
+	});
+
+	thrd->state -= cpu_flag::stop;
+	thread_ctrl::notify(*thrd);
 
 	return CELL_OK;
 }
 
-s32 cellFsAioFinish(vm::cptr<char> mount_point)
+s32 cellFsAioFinish(ppu_thread& ppu, vm::cptr<char> mount_point)
 {
 	cellFs.warning("cellFsAioFinish(mount_point=%s)", mount_point);
 
 	// TODO: delete existing AIO thread for specified mount point
+	const auto m = fxm::withdraw<fs_aio_manager>();
+
+	if (!m)
+	{
+		return CELL_OK;
+	}
+
+	lv2_obj::sleep(ppu);
 
+	{
+		// Every request gets its callback before the AIO thread stops
+		std::lock_guard lock(m->mutex);
+
+		m->finished = true;
+
+		while (m->in_flight)
+		{
+			m->in_flight_cond.wait(m->mutex);
+		}
+	}
+
+	fs_aio_complete(*m, fs_aio_result{});
+
+	ppu_execute<&sys_interrupt_thread_disestablish>(ppu, m->ppu_tid);
 	return CELL_OK;
 }
 
 atomic_t<s32> g_fs_aio_id;
 
+static s32 fs_aio_submit(const std::shared_ptr<fs_aio_manager>& m, bool is_write, vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
+{
+	const s32 xid = ++g_fs_aio_id;
+
+	{
+		std::lock_guard lock(m->mutex);
+
+		if (m->finished)
+		{
+			return CELL_ENXIO;
+		}
+
+		m->pending.emplace(xid);
+		m->in_flight++;
+	}
+
+	*id = xid;
+
+	// Host I/O is performed in background, the callback is executed by the AIO thread
+	fxm::get_always<lv2_fs_io_engine>()->submit([=]
+	{
+		s32 error = CELL_OK;
+		u64 result = 0;
+
+		if (std::lock_guard lock(m->mutex); !m->pending.erase(xid))
+		{
+			error = CELL_ECANCELED;
+		}
+		else if (const auto file = idm::get<lv2_fs_object, lv2_file>(aio->fd); !file || (!is_write && file->flags & CELL_FS_O_WRONLY) || (is_write && !(file->flags & CELL_FS_O_ACCMODE)))
+		{
+			error = CELL_EBADF;
+		}
+		else
+		{
+			reader_lock lock(file->mp->mutex);
+
+			if (is_write)
+			{
+				result = file->op_write(aio->buf, aio->size, aio->offset);
+			}
+			else
+			{
+				result = file->op_read(aio->buf, aio->size, aio->offset);
+				lv2_file::read_ahead(file);
+			}
+		}
+
+		fs_aio_complete(*m, fs_aio_result{aio, func, error, xid, result});
+
+		std::lock_guard lock(m->mutex);
+
+		if (--m->in_flight == 0)
+		{
+			m->in_flight_cond.notify_all();
+		}
+	});
+
+	return CELL_OK;
+}
+
 s32 cellFsAioRead(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
 {
-	cellFs.warning("cellFsAioRead(aio=*0x%x, id=*0x%x, func=*0x%x)", aio, id, func);
+	cellFs.trace("cellFsAioRead(aio=*0x%x, id=*0x%x, func=*0x%x)", aio, id, func);
 
 	// TODO: detect mount point and send AIO request to the AIO thread of this mount point
 
@@ -953,20 +1329,12 @@ s32 cellFsAioRead(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
 		return CELL_ENXIO;
 	}
 
-	const s32 xid = (*id = ++g_fs_aio_id);
-
-	m->thread->cmd_list
-	({
-		{ 1, xid },
-		{ aio, func },
-	});
-
-	return CELL_OK;
+	return fs_aio_submit(m, false, aio, id, func);
 }
 
 s32 cellFsAioWrite(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
 {
-	cellFs.warning("cellFsAioWrite(aio=*0x%x, id=*0x%x, func=*0x%x)", aio, id, func);
+	cellFs.trace("cellFsAioWrite(aio=*0x%x, id=*0x%x, func=*0x%x)", aio, id, func);
 
 	// TODO: detect mount point and send AIO request to the AIO thread of this mount point
 
@@ -977,24 +1345,31 @@ s32 cellFsAioWrite(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
 		return CELL_ENXIO;
 	}
 
-	const s32 xid = (*id = ++g_fs_aio_id);
-
-	m->thread->cmd_list
-	({
-		{ 2, xid },
-		{ aio, func },
-	});
-
-	return CELL_OK;
+	return fs_aio_submit(m, true, aio, id, func);
 }
 
 s32 cellFsAioCancel(s32 id)
 {
-	cellFs.todo("cellFsAioCancel(id=%d) -> CELL_EINVAL", id);
+	cellFs.warning("cellFsAioCancel(id=%d)", id);
+
+	const auto m = fxm::get<fs_aio_manager>();
+
+	if (!m)
+	{
+		return CELL_EINVAL;
+	}
 
-	// TODO: cancelled requests return CELL_ECANCELED through their own callbacks
+	// Cancelled requests return CELL_ECANCELED through their own callbacks
+	std::lock_guard lock(m->mutex);
+
+	if (!m->pending.count(id))
+	{
+		// Already started or completed
+		return CELL_EINVAL;
+	}
 
-	return CELL_EINVAL;
+	m->pending.erase(id);
+	return CELL_OK;
 }
 
 s32 cellFsArcadeHddSerialNumber()
@@ -1022,6 +1397,8 @@ DECLARE(ppu_module_manager::cellFs)("sys_fs", []()
 	REG_FUNC(sys_fs, cellFsAioInit);
 	REG_FUNC(sys_fs, cellFsAioRead);
 	REG_FUNC(sys_fs, cellFsAioWrite);
+
+	REG_FUNC(sys_fs, fsAioEntry).flag(MFF_HIDDEN);
 	REG_FUNC(sys_fs, cellFsAllocateFileAreaByFdWithInitialData);
 	REG_FUNC(sys_fs, cellFsAllocateFileAreaByFdWithoutZeroFill);
 	REG_FUNC(sys_fs, cellFsAllocateFileAreaWithInitialData);
@@ -2,6 +2,8 @@
 #include "Utilities/VirtualMemory.h"
 #include "Utilities/sysinfo.h"
 #include "Utilities/JIT.h"
+#include "Utilities/task_pool.h"
+#include "Utilities/pack_archive.h"
 #include "Crypto/sha1.h"
 #include "Emu/Memory/vm_reservation.h"
 #include "Emu/System.h"
@@ -54,13 +56,7 @@
 #include <cfenv>
 #include "Utilities/GSL.h"
 
-const bool s_use_ssse3 =
-#ifdef _MSC_VER
-	utils::has_ssse3();
-#elif __SSSE3__
-	true;
-#else
-	false;
+#if !defined(_MSC_VER) && !defined(__SSSE3__)
 #define _mm_shuffle_epi8
 #endif
 
@@ -165,7 +161,9 @@ extern const ppu_decoder<ppu_interpreter_fast> g_ppu_interpreter_fast([](auto& t
 
 extern void ppu_initialize();
 extern void ppu_initialize(const ppu_module& info);
-static void ppu_initialize2(class jit_compiler& jit, const ppu_module& module_part, const std::string& cache_path, const std::string& obj_name);
+#ifdef LLVM_AVAILABLE
+static void ppu_initialize2(class jit_compiler& jit, const ppu_module& module_part, const struct ppu_jit_job& job, std::unique_ptr<llvm::MemoryBuffer>* object, const std::string& obj_name, struct ppu_jit_stats& stats);
+#endif
 extern void ppu_execute_syscall(ppu_thread& ppu, u64 code);
 
 // Get pointer to executable cache
@@ -1291,6 +1289,128 @@ extern bool ppu_stdcx(ppu_thread& ppu, u32 addr, u64 reg_value)
 	return result;
 }
 
+// Compiled PPU module info
+struct ppu_jit_module
+{
+	std::vector<u64*> vars;
+	std::vector<ppu_function_t> funcs;
+};
+
+// Time spent in PPU LLVM compilation stages (summed over all threads, in microseconds)
+struct ppu_jit_stats
+{
+	atomic_t<u64> hash{0};
+	atomic_t<u64> probe{0};
+	atomic_t<u64> translate{0};
+	atomic_t<u64> optimize{0};
+	atomic_t<u64> codegen{0};
+	atomic_t<u64> load{0};
+
+	atomic_t<u32> loaded{0};
+	atomic_t<u32> compiled{0};
+
+	const u64 start = get_system_time();
+
+	~ppu_jit_stats()
+	{
+		if (!loaded && !compiled)
+		{
+			return;
+		}
+
+		LOG_NOTICE(PPU, "LLVM: %u modules loaded, %u compiled in %.3fs (hash: %.3fs, cache: %.3fs, translation: %.3fs, optimization: %.3fs, codegen: %.3fs, loading: %.3fs)",
+			loaded, compiled, (get_system_time() - start) / 1000000., hash / 1000000., probe / 1000000., translate / 1000000., optimize / 1000000., codegen / 1000000., load / 1000000.);
+	}
+};
+
+// PPU module compilation in progress
+struct ppu_jit_job
+{
+	const ppu_module& info;
+
+	// Cache directory
+	std::string cache_path;
+
+	// Object archive (null if unavailable)
+	utils::pack_archive* pack = nullptr;
+
+	// Prefix for object names in the archive (module directory)
+	std::string pack_prefix;
+
+	// Permanently loaded compiled module
+	ppu_jit_module* jit_mod = nullptr;
+
+	// Compiler instance (deferred initialization)
+	std::shared_ptr<class jit_compiler> jit;
+
+	// Global variables to initialize
+	std::vector<std::pair<std::string, u64>> globals;
+
+	// Difference between function name and current location
+	u32 reloc = 0;
+
+	ppu_jit_job(const ppu_module& info)
+		: info(info)
+	{
+	}
+};
+
+// Persistent thread pool for PPU LLVM compilation
+struct ppu_jit_pool : utils::task_pool
+{
+	static u32 get_thread_count()
+	{
+		// Max number of threads
+		const u32 max_threads = static_cast<u32>(g_cfg.core.llvm_threads);
+		const u32 thread_count = max_threads > 0 ? std::min(max_threads, std::thread::hardware_concurrency()) : std::thread::hardware_concurrency();
+		return std::max<u32>(thread_count, 1);
+	}
+
+	ppu_jit_pool()
+		: task_pool("PPU Worker", get_thread_count(), -1)
+	{
+	}
+};
+
+// Compiler mutex (global)
+static shared_mutex s_ppu_jit_mutex;
+
+// Packed PPU object cache: one archive per title directory (modules are stored with their directory name as a prefix)
+struct ppu_object_cache
+{
+	static constexpr u32 version = 1;
+	static constexpr u32 tag = "PPUO"_u32;
+
+	shared_mutex mutex;
+
+	// Directory -> archive
+	std::unordered_map<std::string, std::unique_ptr<utils::pack_archive>> archives;
+
+	utils::pack_archive* get(const std::string& dir)
+	{
+		std::lock_guard lock(mutex);
+
+		auto& pack = archives[dir];
+
+		if (!pack)
+		{
+			pack = std::make_unique<utils::pack_archive>();
+
+			if (pack->open(dir + "ppu.pack", version) && pack->is_writable() && pack->get_garbage_size())
+			{
+				// Compact before any object is loaded
+				pack->compact();
+			}
+		}
+
+		return pack->is_open() ? pack.get() : nullptr;
+	}
+};
+
+static std::unique_ptr<ppu_jit_job> ppu_initialize_start(const ppu_module& info, utils::task_group& group, ppu_jit_stats& stats);
+static void ppu_initialize_part(ppu_jit_job& job, const ppu_module& part, ppu_jit_stats& stats);
+static void ppu_initialize_finish(ppu_jit_job& job);
+
 extern void ppu_initialize()
 {
 	const auto _main = fxm::get<ppu_module>();
@@ -1305,9 +1425,6 @@ extern void ppu_initialize()
 		return;
 	}
 
-	// Initialize main module
-	ppu_initialize(*_main);
-
 	std::vector<lv2_prx*> prx_list;
 
 	idm::select<lv2_obj, lv2_prx>([&](u32, lv2_prx& prx)
@@ -1315,10 +1432,32 @@ extern void ppu_initialize()
 		prx_list.emplace_back(&prx);
 	});
 
-	// Initialize preloaded libraries
-	for (auto ptr : prx_list)
 	{
-		ppu_initialize(*ptr);
+		ppu_jit_stats stats;
+		utils::task_group group;
+		std::vector<std::unique_ptr<ppu_jit_job>> jobs;
+
+		// Queue main module and preloaded libraries at once, so their parts are processed in parallel
+		jobs.emplace_back(ppu_initialize_start(*_main, group, stats));
+
+		for (auto ptr : prx_list)
+		{
+			jobs.emplace_back(ppu_initialize_start(*ptr, group, stats));
+		}
+
+		if (!group.done())
+		{
+			fxm::get_always<ppu_jit_pool>()->wait(group);
+		}
+
+		// Link modules in the original order
+		for (auto& job : jobs)
+		{
+			if (job)
+			{
+				ppu_initialize_finish(*job);
+			}
+		}
 	}
 
 	// Initialize SPU cache
@@ -1326,6 +1465,22 @@ extern void ppu_initialize()
 }
 
 extern void ppu_initialize(const ppu_module& info)
+{
+	ppu_jit_stats stats;
+	utils::task_group group;
+
+	if (const auto job = ppu_initialize_start(info, group, stats))
+	{
+		if (!group.done())
+		{
+			fxm::get_always<ppu_jit_pool>()->wait(group);
+		}
+
+		ppu_initialize_finish(*job);
+	}
+}
+
+static std::unique_ptr<ppu_jit_job> ppu_initialize_start(const ppu_module& info, utils::task_group& group, ppu_jit_stats& stats)
 {
 	if (g_cfg.core.ppu_decoder != ppu_decoder_type::llvm)
 	{
@@ -1346,7 +1501,7 @@ extern void ppu_initialize(const ppu_module& info)
 			}
 		}
 
-		return;
+		return nullptr;
 	}
 
 	// Link table
@@ -1390,8 +1545,10 @@ extern void ppu_initialize(const ppu_module& info)
 		return link_table;
 	}();
 
+	auto job = std::make_unique<ppu_jit_job>(info);
+
 	// Get cache path for this executable
-	std::string cache_path;
+	std::string& cache_path = job->cache_path;
 
 	if (info.name.empty())
 	{
@@ -1424,55 +1581,58 @@ extern void ppu_initialize(const ppu_module& info)
 	// Initialize progress dialog
 	g_progr = "Compiling PPU modules...";
 
-	// Compiled PPU module info
-	struct jit_module
-	{
-		std::vector<u64*> vars;
-		std::vector<ppu_function_t> funcs;
-	};
+	// Permanently loaded compiled PPU modules (name -> data)
+	job->jit_mod = &fxm::get_always<std::unordered_map<std::string, ppu_jit_module>>()->emplace(cache_path + info.name, ppu_jit_module{}).first->second;
 
-	struct jit_core_allocator
+	if (job->jit_mod->vars.empty())
 	{
-		::semaphore<0x7fffffff> sem;
+		// Open object archive in the parent directory
+		const std::size_t dir_pos = cache_path.find_last_of('/', cache_path.size() - 2) + 1;
+		job->pack = fxm::get_always<ppu_object_cache>()->get(cache_path.substr(0, dir_pos));
+		job->pack_prefix = cache_path.substr(dir_pos);
 
-		jit_core_allocator(s32 arg)
-			: sem(arg)
+		if (job->pack && job->pack->is_writable())
 		{
-		}
-	};
-
-	// Permanently loaded compiled PPU modules (name -> data)
-	jit_module& jit_mod = fxm::get_always<std::unordered_map<std::string, jit_module>>()->emplace(cache_path + info.name, jit_module{}).first->second;
+			// Move loose object files into the archive
+			for (auto&& entry : fs::dir(cache_path))
+			{
+				if (entry.is_directory || entry.name.compare(0, 8, "v3-tane-") != 0 || entry.name.compare(entry.name.size() - 4, 4, ".obj") != 0)
+				{
+					continue;
+				}
 
-	// Compiler instance (deferred initialization)
-	std::shared_ptr<jit_compiler> jit;
+				const std::string pack_name = job->pack_prefix + entry.name;
 
-	// Compiler mutex (global)
-	static shared_mutex jmutex;
+				if (!jit_compiler::has_object(*job->pack, ppu_object_cache::tag, pack_name))
+				{
+					const fs::file obj(cache_path + entry.name);
+					const auto data = obj ? obj.to_vector<u8>() : std::vector<u8>{};
 
-	// Initialize global semaphore with the max number of threads
-	u32 max_threads = static_cast<u32>(g_cfg.core.llvm_threads);
-	s32 thread_count = max_threads > 0 ? std::min(max_threads, std::thread::hardware_concurrency()) : std::thread::hardware_concurrency();
-	const auto jcores = fxm::get_always<jit_core_allocator>(std::max<s32>(thread_count, 1));
+					if (data.empty() || !jit_compiler::store_object(*job->pack, ppu_object_cache::tag, pack_name, data.data(), ::size32(data)))
+					{
+						continue;
+					}
+				}
 
-	// Worker threads
-	std::vector<std::thread> jthreads;
+				fs::remove_file(cache_path + entry.name);
+			}
+		}
+	}
 
-	// Global variables to initialize
-	std::vector<std::pair<std::string, u64>> globals;
+	const auto pool = fxm::get_always<ppu_jit_pool>();
 
 	// Split module into fragments <= 1 MiB
 	std::size_t fpos = 0;
 
 	// Difference between function name and current location
-	const u32 reloc = info.name.empty() ? 0 : info.segs.at(0).addr;
+	const u32 reloc = job->reloc = info.name.empty() ? 0 : info.segs.at(0).addr;
 
-	while (jit_mod.vars.empty() && fpos < info.funcs.size())
+	while (job->jit_mod->vars.empty() && fpos < info.funcs.size())
 	{
 		// Initialize compiler instance
-		if (!jit && get_current_cpu_thread())
+		if (!job->jit && get_current_cpu_thread())
 		{
-			jit = std::make_shared<jit_compiler>(s_link_table, g_cfg.core.llvm_cpu);
+			job->jit = std::make_shared<jit_compiler>(s_link_table, g_cfg.core.llvm_cpu);
 		}
 
 		// First function in current module part
@@ -1514,177 +1674,249 @@ extern void ppu_initialize(const ppu_module& info)
 			fpos++;
 		}
 
-		// Compute module hash to generate (hopefully) unique object name
-		std::string obj_name;
+		if (Emu.IsStopped())
 		{
-			sha1_context ctx;
-			u8 output[20];
-			sha1_starts(&ctx);
+			break;
+		}
 
-			for (const auto& func : part.funcs)
+		job->globals.emplace_back(fmt::format("__mptr%x", suffix), (u64)vm::g_base_addr);
+		job->globals.emplace_back(fmt::format("__cptr%x", suffix), (u64)vm::g_exec_addr);
+
+		// Initialize segments for relocations
+		for (u32 i = 0; i < info.segs.size(); i++)
+		{
+			job->globals.emplace_back(fmt::format("__seg%u_%x", i, suffix), info.segs[i].addr);
+		}
+
+		// Hashing, cache lookup, compilation and loading are done by the pool
+		pool->push(group, [job = job.get(), part = std::move(part), &stats]()
+		{
+			ppu_initialize_part(*job, part, stats);
+		});
+	}
+
+	return job;
+#else
+	fmt::throw_exception("LLVM is not available in this build.");
+#endif
+}
+
+static void ppu_initialize_part(ppu_jit_job& job, const ppu_module& part, ppu_jit_stats& stats)
+{
+#ifdef LLVM_AVAILABLE
+	if (Emu.IsStopped())
+	{
+		return;
+	}
+
+	const std::string& cache_path = job.cache_path;
+	const u32 reloc = job.reloc;
+
+	u64 stamp = get_system_time();
+
+	// Compute module hash to generate (hopefully) unique object name
+	std::string obj_name;
+	{
+		sha1_context ctx;
+		u8 output[20];
+		sha1_starts(&ctx);
+
+		for (const auto& func : part.funcs)
+		{
+			if (func.size == 0)
 			{
-				if (func.size == 0)
+				continue;
+			}
+
+			const be_t<u32> addr = func.addr - reloc;
+			const be_t<u32> size = func.size;
+			sha1_update(&ctx, reinterpret_cast<const u8*>(&addr), sizeof(addr));
+			sha1_update(&ctx, reinterpret_cast<const u8*>(&size), sizeof(size));
+
+			for (const auto& block : func.blocks)
+			{
+				if (block.second == 0 || reloc)
 				{
 					continue;
 				}
 
-				const be_t<u32> addr = func.addr - reloc;
-				const be_t<u32> size = func.size;
-				sha1_update(&ctx, reinterpret_cast<const u8*>(&addr), sizeof(addr));
-				sha1_update(&ctx, reinterpret_cast<const u8*>(&size), sizeof(size));
+				// Find relevant relocations
+				auto low = std::lower_bound(part.relocs.cbegin(), part.relocs.cend(), block.first);
+				auto high = std::lower_bound(low, part.relocs.cend(), block.first + block.second);
+				auto addr = block.first;
 
-				for (const auto& block : func.blocks)
+				for (; low != high; ++low)
 				{
-					if (block.second == 0 || reloc)
-					{
-						continue;
-					}
-
-					// Find relevant relocations
-					auto low = std::lower_bound(part.relocs.cbegin(), part.relocs.cend(), block.first);
-					auto high = std::lower_bound(low, part.relocs.cend(), block.first + block.second);
-					auto addr = block.first;
+					// Aligned relocation address
+					const u32 roff = low->addr & ~3;
 
-					for (; low != high; ++low)
+					if (roff > addr)
 					{
-						// Aligned relocation address
-						const u32 roff = low->addr & ~3;
-
-						if (roff > addr)
-						{
-							// Hash from addr to the beginning of the relocation
-							sha1_update(&ctx, vm::_ptr<const u8>(addr), roff - addr);
-						}
-
-						// Hash relocation type instead
-						const be_t<u32> type = low->type;
-						sha1_update(&ctx, reinterpret_cast<const u8*>(&type), sizeof(type));
-
-						// Set the next addr
-						addr = roff + 4;
+						// Hash from addr to the beginning of the relocation
+						sha1_update(&ctx, vm::_ptr<const u8>(addr), roff - addr);
 					}
 
-					// Hash from addr to the end of the block
-					sha1_update(&ctx, vm::_ptr<const u8>(addr), block.second - (addr - block.first));
-				}
+					// Hash relocation type instead
+					const be_t<u32> type = low->type;
+					sha1_update(&ctx, reinterpret_cast<const u8*>(&type), sizeof(type));
 
-				if (reloc)
-				{
-					continue;
+					// Set the next addr
+					addr = roff + 4;
 				}
 
-				sha1_update(&ctx, vm::_ptr<const u8>(func.addr), func.size);
+				// Hash from addr to the end of the block
+				sha1_update(&ctx, vm::_ptr<const u8>(addr), block.second - (addr - block.first));
 			}
 
-			if (false)
+			if (reloc)
 			{
-				const be_t<u64> forced_upd = 3;
-				sha1_update(&ctx, reinterpret_cast<const u8*>(&forced_upd), sizeof(forced_upd));
+				continue;
 			}
 
-			sha1_finish(&ctx, output);
+			sha1_update(&ctx, vm::_ptr<const u8>(func.addr), func.size);
+		}
 
-			// Settings: should be populated by settings which affect codegen (TODO)
-			enum class ppu_settings : u32
-			{
-				non_win32,
+		if (false)
+		{
+			const be_t<u64> forced_upd = 3;
+			sha1_update(&ctx, reinterpret_cast<const u8*>(&forced_upd), sizeof(forced_upd));
+		}
+
+		sha1_finish(&ctx, output);
+
+		// Settings: should be populated by settings which affect codegen (TODO)
+		enum class ppu_settings : u32
+		{
+			non_win32,
 
-				__bitset_enum_max
-			};
+			__bitset_enum_max
+		};
 
-			be_t<bs_t<ppu_settings>> settings{};
+		be_t<bs_t<ppu_settings>> settings{};
 
 #ifndef _WIN32
-			settings += ppu_settings::non_win32;
+		settings += ppu_settings::non_win32;
 #endif
 
-			// Write version, hash, CPU, settings
-			fmt::append(obj_name, "v3-tane-%s-%s-%s.obj", fmt::base57(output, 16), fmt::base57(settings), jit_compiler::cpu(g_cfg.core.llvm_cpu));
-		}
+		// Write version, hash, CPU, settings
+		fmt::append(obj_name, "v3-tane-%s-%s-%s.obj", fmt::base57(output, 16), fmt::base57(settings), jit_compiler::cpu(g_cfg.core.llvm_cpu));
+	}
 
-		if (Emu.IsStopped())
+	const u64 hashed = get_system_time();
+	stats.hash += hashed - stamp;
+
+	const std::string pack_name = job.pack_prefix + obj_name;
+
+	// Check object in the archive (use object files if it can't be written)
+	const bool use_file = !job.pack || !job.pack->is_writable();
+
+	bool cached = job.pack && jit_compiler::has_object(*job.pack, ppu_object_cache::tag, pack_name);
+
+	if (!cached && use_file)
+	{
+		cached = fs::is_file(cache_path + obj_name);
+	}
+
+	stamp = get_system_time();
+	stats.probe += stamp - hashed;
+
+	if (cached)
+	{
+		if (!job.jit)
 		{
-			break;
+			stats.loaded++;
+			LOG_SUCCESS(PPU, "LLVM: Already exists: %s", obj_name);
+			return;
 		}
 
-		globals.emplace_back(fmt::format("__mptr%x", suffix), (u64)vm::g_base_addr);
-		globals.emplace_back(fmt::format("__cptr%x", suffix), (u64)vm::g_exec_addr);
+		std::lock_guard lock(s_ppu_jit_mutex);
 
-		// Initialize segments for relocations
-		for (u32 i = 0; i < info.segs.size(); i++)
+		if (job.pack && job.jit->add(*job.pack, ppu_object_cache::tag, pack_name))
 		{
-			globals.emplace_back(fmt::format("__seg%u_%x", i, suffix), info.segs[i].addr);
+			stats.loaded++;
 		}
-
-		// Check object file
-		if (fs::is_file(cache_path + obj_name))
+		else if (use_file && fs::is_file(cache_path + obj_name))
 		{
-			if (!jit)
-			{
-				LOG_SUCCESS(PPU, "LLVM: Already exists: %s", obj_name);
-				continue;
-			}
-
-			std::lock_guard lock(jmutex);
-			jit->add(cache_path + obj_name);
-
-			LOG_SUCCESS(PPU, "LLVM: Loaded module %s", obj_name);
-			continue;
+			job.jit->add(cache_path + obj_name);
+			stats.loaded++;
 		}
+		else
+		{
+			// Invalid object, compile again
+			cached = false;
+		}
+	}
+
+	// Compiled object (if not loaded from the cache)
+	std::unique_ptr<llvm::MemoryBuffer> object;
 
+	if (!cached)
+	{
 		// Update progress dialog
 		g_progr_ptotal++;
 
-		// Create worker thread for compilation
-		jthreads.emplace_back([&jit, obj_name = obj_name, part = std::move(part), &cache_path, jcores]()
+		if (!Emu.IsStopped())
 		{
-			// Set low priority
-			thread_ctrl::set_native_priority(-1);
-
-			// Allocate "core"
-			{
-				std::lock_guard jlock(jcores->sem);
+			LOG_WARNING(PPU, "LLVM: Compiling module %s%s", cache_path, obj_name);
 
-				if (!Emu.IsStopped())
-				{
-					LOG_WARNING(PPU, "LLVM: Compiling module %s%s", cache_path, obj_name);
+			// Use another JIT instance
+			jit_compiler jit2({}, g_cfg.core.llvm_cpu, 0x1);
+			ppu_initialize2(jit2, part, job, job.jit && !use_file ? &object : nullptr, obj_name, stats);
+			stats.compiled++;
+		}
 
-					// Use another JIT instance
-					jit_compiler jit2({}, g_cfg.core.llvm_cpu, 0x1);
-					ppu_initialize2(jit2, part, cache_path, obj_name);
-				}
+		g_progr_pdone++;
 
-				g_progr_pdone++;
-			}
+		if (Emu.IsStopped() || !job.jit || (use_file ? !fs::is_file(cache_path + obj_name) : !object))
+		{
+			return;
+		}
 
-			if (Emu.IsStopped() || !jit || !fs::is_file(cache_path + obj_name))
-			{
-				return;
-			}
+		stamp = get_system_time();
 
-			// Proceed with original JIT instance
-			std::lock_guard lock(jmutex);
-			jit->add(cache_path + obj_name);
+		// Proceed with original JIT instance
+		std::lock_guard lock(s_ppu_jit_mutex);
 
-			LOG_SUCCESS(PPU, "LLVM: Compiled module %s", obj_name);
-		});
+		if (use_file)
+		{
+			job.jit->add(cache_path + obj_name);
+		}
+		else
+		{
+			job.jit->add(std::move(object));
+		}
 	}
 
-	// Join worker threads
-	for (auto& thread : jthreads)
+	stats.load += get_system_time() - stamp;
+
+	if (cached)
+	{
+		LOG_SUCCESS(PPU, "LLVM: Loaded module %s", obj_name);
+	}
+	else
 	{
-		thread.join();
+		LOG_SUCCESS(PPU, "LLVM: Compiled module %s", obj_name);
 	}
+#endif
+}
 
+static void ppu_initialize_finish(ppu_jit_job& job)
+{
+#ifdef LLVM_AVAILABLE
 	if (Emu.IsStopped() || !get_current_cpu_thread())
 	{
 		return;
 	}
 
+	const ppu_module& info = job.info;
+	const auto& jit = job.jit;
+	auto& jit_mod = *job.jit_mod;
+	const u32 reloc = job.reloc;
+
 	// Jit can be null if the loop doesn't ever enter.
 	if (jit && jit_mod.vars.empty())
 	{
-		std::lock_guard lock(jmutex);
+		std::lock_guard lock(s_ppu_jit_mutex);
 		jit->fin();
 
 		// Get and install function addresses
@@ -1704,7 +1936,7 @@ extern void ppu_initialize(const ppu_module& info)
 		}
 
 		// Initialize global variables
-		for (auto& var : globals)
+		for (auto& var : job.globals)
 		{
 			const u64 addr = jit->get(var.first);
 
@@ -1748,16 +1980,16 @@ extern void ppu_initialize(const ppu_module& info)
 			}
 		}
 	}
-#else
-	fmt::throw_exception("LLVM is not available in this build.");
 #endif
 }
 
-static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, const std::string& cache_path, const std::string& obj_name)
-{
 #ifdef LLVM_AVAILABLE
+static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, const ppu_jit_job& job, std::unique_ptr<llvm::MemoryBuffer>* object, const std::string& obj_name, ppu_jit_stats& stats)
+{
 	using namespace llvm;
 
+	const std::string& cache_path = job.cache_path;
+
 	// Create LLVM module
 	std::unique_ptr<Module> module = std::make_unique<Module>(obj_name, jit.get_context());
 
@@ -1816,11 +2048,17 @@ static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, co
 
 			if (module_part.funcs[fi].size)
 			{
+				const u64 start = get_system_time();
+
 				// Translate
 				if (const auto func = translator.Translate(module_part.funcs[fi]))
 				{
+					const u64 translated = get_system_time();
+					stats.translate += translated - start;
+
 					// Run optimization passes
 					pm.run(*func);
+					stats.optimize += get_system_time() - translated;
 				}
 				else
 				{
@@ -1859,7 +2097,18 @@ static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, co
 		LOG_NOTICE(PPU, "LLVM: %zu functions generated", module->getFunctionList().size());
 	}
 
+	const u64 start = get_system_time();
+
 	// Load or compile module
-	jit.add(std::move(module), cache_path);
-#endif // LLVM_AVAILABLE
+	if (job.pack && job.pack->is_writable())
+	{
+		jit.add(std::move(module), *job.pack, ppu_object_cache::tag, job.pack_prefix + obj_name, object);
+	}
+	else
+	{
+		jit.add(std::move(module), cache_path);
+	}
+
+	stats.codegen += get_system_time() - start;
 }
+#endif // LLVM_AVAILABLE
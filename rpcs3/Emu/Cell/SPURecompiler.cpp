@@ -12,14 +12,19 @@
 #include "SPUAnalyser.h"
 #include "SPUInterpreter.h"
 #include "SPUDisAsm.h"
+#include "Utilities/task_pool.h"
 #include <algorithm>
 #include <mutex>
 #include <thread>
 
+#include <zlib.h>
+
 extern atomic_t<const char*> g_progr;
 extern atomic_t<u64> g_progr_ptotal;
 extern atomic_t<u64> g_progr_pdone;
 
+extern u64 get_system_time();
+
 const spu_decoder<spu_itype> s_spu_itype;
 const spu_decoder<spu_iname> s_spu_iname;
 const spu_decoder<spu_iflag> s_spu_iflag;
@@ -206,25 +211,145 @@ DECLARE(spu_runtime::g_tail_escape) = build_function_asm<void(*)(spu_thread*, sp
 
 DECLARE(spu_runtime::g_interpreter) = nullptr;
 
+namespace
+{
+	// SPU cache record tags
+	constexpr u32 c_spu_cache_func = "SPUF"_u32;
+	constexpr u32 c_spu_cache_hits = "SPUH"_u32;
+
+	// SPU cache format version
+	constexpr u32 c_spu_cache_version = 2;
+
+	struct spu_cache_func
+	{
+		le_t<u32> addr;
+		le_t<u32> size; // Number of instructions
+		le_t<u32> packed; // Size of compressed data (0 if stored as is)
+		le_t<u32> reserved;
+	};
+
+	struct spu_cache_hits
+	{
+		le_t<u64> key;
+		le_t<u32> hits;
+		le_t<u32> reserved;
+	};
+
+	CHECK_SIZE(spu_cache_func, 16);
+	CHECK_SIZE(spu_cache_hits, 16);
+}
+
 spu_cache::spu_cache(const std::string& loc)
-	: m_file(loc, fs::read + fs::write + fs::create + fs::append)
 {
+	if (!m_pack.open(loc, c_spu_cache_version))
+	{
+		return;
+	}
+
+	if (m_pack.is_writable() && m_pack.get_garbage_size() >= 0x400000)
+	{
+		// Reclaim space of superseded statistics
+		m_pack.compact();
+	}
+
+	if (const auto blob = m_pack.find(c_spu_cache_hits, 0))
+	{
+		for (u32 i = 0; i + sizeof(spu_cache_hits) <= blob.size; i += sizeof(spu_cache_hits))
+		{
+			spu_cache_hits entry;
+			std::memcpy(&entry, blob.data + i, sizeof(entry));
+			m_hits[entry.key] = entry.hits;
+		}
+	}
 }
 
 spu_cache::~spu_cache()
 {
+	if (m_runtime)
+	{
+		// Collect the lookups of this session
+		for (const auto& [key, hits] : m_runtime->take_hits())
+		{
+			if (m_hits.count(key) || m_pack.contains(c_spu_cache_func, key))
+			{
+				m_hits[key] += hits;
+				m_hits_dirty = true;
+			}
+		}
+	}
+
+	if (!m_hits_dirty || !m_pack.is_writable())
+	{
+		return;
+	}
+
+	// Save statistics
+	std::vector<spu_cache_hits> data;
+	data.reserve(m_hits.size());
+
+	for (const auto& [key, hits] : m_hits)
+	{
+		spu_cache_hits entry{};
+		entry.key = key;
+		entry.hits = hits;
+		data.emplace_back(entry);
+	}
+
+	m_pack.remove(c_spu_cache_hits, 0);
+	m_pack.append(c_spu_cache_hits, 0, data.data(), ::size32(data) * sizeof(spu_cache_hits), false);
 }
 
-std::deque<std::vector<u32>> spu_cache::get()
+u64 spu_cache::get_key(const std::vector<u32>& func)
 {
-	std::deque<std::vector<u32>> result;
+	sha1_context ctx;
+	u8 output[20];
 
-	if (!m_file)
+	sha1_starts(&ctx);
+	sha1_update(&ctx, reinterpret_cast<const u8*>(func.data()), func.size() * 4);
+	sha1_finish(&ctx, output);
+
+	u64 key;
+	std::memcpy(&key, output, sizeof(key));
+	return key;
+}
+
+std::vector<u8> spu_cache::pack_function(const std::vector<u32>& func)
+{
+	const u32 size = ::size32(func) - 1;
+
+	spu_cache_func header{};
+	header.addr = func[0];
+	header.size = size;
+
+	// Instructions are stored in their original (big-endian) form
+	std::vector<u8> data(sizeof(header) + size * 4);
+	std::memcpy(data.data() + sizeof(header), func.data() + 1, size * 4);
+
+	// Try to compress (only keep compressed data if it's noticeably smaller)
+	std::vector<u8> packed(sizeof(header) + compressBound(size * 4));
+	uLongf packed_size = ::narrow<uLongf>(packed.size() - sizeof(header));
+
+	if (compress2(packed.data() + sizeof(header), &packed_size, data.data() + sizeof(header), size * 4, Z_BEST_SPEED) == Z_OK && packed_size < size * 4 - size / 2)
 	{
-		return result;
+		header.packed = ::narrow<u32>(packed_size);
+		packed.resize(sizeof(header) + packed_size);
+		data = std::move(packed);
 	}
 
-	m_file.seek(0);
+	std::memcpy(data.data(), &header, sizeof(header));
+	return data;
+}
+
+void spu_cache::import(const std::string& path)
+{
+	fs::file file(path);
+
+	if (!file)
+	{
+		return;
+	}
+
+	u32 count = 0;
 
 	// TODO: signal truncated or otherwise broken file
 	while (true)
@@ -233,7 +358,7 @@ std::deque<std::vector<u32>> spu_cache::get()
 		be_t<u32> addr;
 		std::vector<u32> func;
 
-		if (!m_file.read(size) || !m_file.read(addr))
+		if (!file.read(size) || !file.read(addr))
 		{
 			break;
 		}
@@ -241,7 +366,7 @@ std::deque<std::vector<u32>> spu_cache::get()
 		func.resize(size + 1);
 		func[0] = addr;
 
-		if (m_file.read(func.data() + 1, func.size() * 4 - 4) != func.size() * 4 - 4)
+		if (file.read(func.data() + 1, func.size() * 4 - 4) != func.size() * 4 - 4)
 		{
 			break;
 		}
@@ -252,7 +377,95 @@ std::deque<std::vector<u32>> spu_cache::get()
 			continue;
 		}
 
-		result.emplace_front(std::move(func));
+		// Duplicates are counted as hits, the functions are precompiled in this session
+		store(func, true);
+		m_hits[get_key(func)]++;
+		m_hits_dirty = true;
+		count++;
+	}
+
+	file.close();
+
+	LOG_NOTICE(SPU, "SPU Cache: imported %u entries (%u unique) from %s", count, m_hits.size(), path);
+
+	if (m_pack.is_writable())
+	{
+		fs::remove_file(path);
+	}
+}
+
+std::vector<std::vector<u32>> spu_cache::get()
+{
+	std::vector<std::vector<u32>> result;
+
+	if (!m_pack.is_open())
+	{
+		return result;
+	}
+
+	const auto entries = m_pack.get_all(c_spu_cache_func);
+
+	// Sort by hit count (stable: keep file order for equal counts)
+	std::vector<std::pair<u32, std::size_t>> order;
+	order.reserve(entries.size());
+
+	{
+		reader_lock lock(m_mutex);
+
+		for (std::size_t i = 0; i < entries.size(); i++)
+		{
+			const auto found = m_hits.find(entries[i].key);
+			order.emplace_back(found == m_hits.end() ? 0 : found->second, i);
+		}
+	}
+
+	std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b)
+	{
+		return a.first > b.first;
+	});
+
+	result.reserve(order.size());
+
+	for (const auto& [hits, index] : order)
+	{
+		const auto& blob = entries[index];
+
+		spu_cache_func header;
+
+		if (blob.size < sizeof(header))
+		{
+			continue;
+		}
+
+		std::memcpy(&header, blob.data, sizeof(header));
+
+		std::vector<u32> func(header.size + 1);
+		func[0] = header.addr;
+
+		const u8* src = blob.data + sizeof(header);
+		const u32 src_size = blob.size - sizeof(header);
+
+		if (header.packed)
+		{
+			uLongf size = header.size * 4;
+
+			if (header.packed > src_size || uncompress(reinterpret_cast<u8*>(func.data() + 1), &size, src, header.packed) != Z_OK || size != header.size * 4)
+			{
+				LOG_ERROR(SPU, "SPU Cache: failed to decompress function 0x%05x", header.addr);
+				continue;
+			}
+		}
+		else
+		{
+			if (header.size * 4 > src_size)
+			{
+				continue;
+			}
+
+			std::memcpy(func.data() + 1, src, header.size * 4);
+		}
+
+		result.emplace_back(std::move(func));
 	}
 
 	return result;
@@ -260,23 +473,33 @@ std::deque<std::vector<u32>> spu_cache::get()
 
 void spu_cache::add(const std::vector<u32>& func)
 {
-	if (!m_file)
+	// Functions are only read on startup, don't keep them in memory
+	store(func, false);
+}
+
+void spu_cache::store(const std::vector<u32>& func, bool keep)
+{
+	if (!m_pack.is_open())
 	{
 		return;
 	}
 
-	be_t<u32> size = ::size32(func) - 1;
-	be_t<u32> addr = func[0];
+	const u64 key = get_key(func);
 
-	const fs::iovec_clone gather[3]
+	if (reader_lock lock(m_mutex); m_pack.contains(c_spu_cache_func, key))
 	{
-		{&size, sizeof(size)},
-		{&addr, sizeof(addr)},
-		{func.data() + 1, func.size() * 4 - 4}
-	};
+		return;
+	}
+
+	// Compress without holding the lock
+	const auto data = pack_function(func);
+
+	std::lock_guard lock(m_mutex);
 
-	// Append data
-	m_file.write_gather(gather, 3);
+	if (!m_pack.contains(c_spu_cache_func, key))
+	{
+		m_pack.append(c_spu_cache_func, key, data.data(), ::size32(data), keep);
+	}
 }
 
 void spu_cache::initialize()
@@ -291,7 +514,8 @@ void spu_cache::initialize()
 	}
 
 	// SPU cache file (version + block size type)
-	const std::string loc = ppu_cache + "spu-" + fmt::to_lower(g_cfg.core.spu_block_size.to_string()) + "-v1-tane.dat";
+	const std::string type = fmt::to_lower(g_cfg.core.spu_block_size.to_string());
+	const std::string loc = ppu_cache + "spu-" + type + "-v2-tane.pack";
 
 	auto cache = std::make_shared<spu_cache>(loc);
 
@@ -301,14 +525,23 @@ void spu_cache::initialize()
 		return;
 	}
 
-	// Read cache
-	auto func_list = cache->get();
+	// Convert old cache file
+	const std::string old_loc = ppu_cache + "spu-" + type + "-v1-tane.dat";
+
+	if (fs::is_file(old_loc))
+	{
+		cache->import(old_loc);
+	}
+
+	// Read cache (most requested functions first)
+	const auto func_list = cache->get();
 	atomic_t<std::size_t> fnext{};
 	atomic_t<u8> fail_flag{0};
 
-	// Initialize compiler instances for parallel compilation
+	// Initialize compiler instances for parallel compilation (no more than the number of functions)
 	u32 max_threads = static_cast<u32>(g_cfg.core.llvm_threads);
 	u32 thread_count = max_threads > 0 ? std::min(max_threads, std::thread::hardware_concurrency()) : std::thread::hardware_concurrency();
+	thread_count = std::max<u32>(std::min<u32>(thread_count, ::size32(func_list)), 1);
 	std::vector<std::unique_ptr<spu_recompiler_base>> compilers{thread_count};
 
 	if (g_cfg.core.spu_decoder == spu_decoder_type::fast)
@@ -369,7 +602,7 @@ void spu_cache::initialize()
 		// Build functions
 		for (std::size_t func_i = fnext++; func_i < func_list.size(); func_i = fnext++)
 		{
-			std::vector<u32>& func = func_list[func_i];
+			const std::vector<u32>& func = func_list[func_i];
 
 			if (Emu.IsStopped() || fail_flag)
 			{
@@ -446,6 +679,13 @@ void spu_cache::initialize()
 		LOG_SUCCESS(SPU, "SPU Runtime: Built %u functions.", func_list.size());
 	}
 
+	if (!compilers.empty())
+	{
+		// Count function lookups from now on (precompilation doesn't count)
+		cache->m_runtime = fxm::get_always<spu_runtime>();
+		cache->m_runtime->take_hits();
+	}
+
 	// Register cache instance
 	fxm::import<spu_cache>([&]() -> std::shared_ptr<spu_cache>&&
 	{
@@ -500,6 +740,144 @@ bool spu_runtime::func_compare::operator()(const std::vector<u32>& lhs, const st
 	}
 }
 
+spu_function_index::table::~table()
+{
+	for (auto& bucket : buckets)
+	{
+		for (node* n = bucket.load(); n;)
+		{
+			delete std::exchange(n, n->next);
+		}
+	}
+}
+
+spu_function_index::spu_function_index()
+	: m_table(new table)
+{
+}
+
+spu_function_index::~spu_function_index()
+{
+	delete m_table.load();
+}
+
+void spu_function_index::add(std::basic_string_view<u32> data, spu_function_t func, u64 key)
+{
+	if (data.empty())
+	{
+		return;
+	}
+
+	const auto t = m_table.load();
+
+	node* const n = new node{nullptr, func, {data.begin(), data.end()}, key};
+
+	if (data.size() == 1)
+	{
+		t->short_count++;
+	}
+
+	auto& bucket = t->buckets[get_bucket(data[0], data.size() > 1 ? data[1] : 0)];
+
+	// Publish the node (it's immutable after that)
+	node* head = bucket.load();
+
+	do
+	{
+		n->next = head;
+	}
+	while (!bucket.compare_exchange(head, n));
+}
+
+spu_function_t spu_function_index::find(std::basic_string_view<u32> data) const
+{
+	if (data.empty())
+	{
+		return nullptr;
+	}
+
+	const auto t = m_table.load();
+
+	for (node* n = t->buckets[get_bucket(data[0], data.size() > 1 ? data[1] : 0)].load(); n; n = n->next)
+	{
+		if (n->data.size() == data.size() && std::equal(data.begin(), data.end(), n->data.begin()))
+		{
+			n->hits++;
+			return n->func;
+		}
+	}
+
+	return nullptr;
+}
+
+spu_function_t spu_function_index::find(const u32* ls, u32 addr) const
+{
+	const auto t = m_table.load();
+
+	// Available LS window
+	const u32* const ptr = ls + addr / 4;
+	const std::size_t max_size = (0x40000 - addr) / 4;
+
+	node* result = nullptr;
+	std::size_t result_size = 0;
+
+	auto search = [&](u32 index)
+	{
+		for (node* n = t->buckets[index].load(); n; n = n->next)
+		{
+			const std::size_t size = n->data.size();
+
+			if (size > result_size && size <= max_size && std::equal(n->data.begin(), n->data.end(), ptr))
+			{
+				result = n;
+				result_size = size;
+			}
+		}
+	};
+
+	const u32 op1 = max_size > 1 ? ptr[1] : 0;
+
+	search(get_bucket(ptr[0], op1));
+
+	if (op1 && t->short_count)
+	{
+		// Single instruction functions
+		search(get_bucket(ptr[0], 0));
+	}
+
+	if (!result)
+	{
+		return nullptr;
+	}
+
+	result->hits++;
+	return result->func;
+}
+
+void spu_function_index::take_hits(table& t, std::unordered_map<u64, u32>& out)
+{
+	for (auto& bucket : t.buckets)
+	{
+		for (node* n = bucket.load(); n; n = n->next)
+		{
+			if (const u32 hits = n->hits.exchange(0))
+			{
+				out[n->key] += hits;
+			}
+		}
+	}
+}
+
+void spu_function_index::take_hits(std::unordered_map<u64, u32>& out)
+{
+	take_hits(*m_table.load(), out);
+}
+
+std::unique_ptr<spu_function_index::table> spu_function_index::reset()
+{
+	return std::unique_ptr<table>(m_table.exchange(new table));
+}
+
 spu_runtime::spu_runtime()
 {
 	// Initialize "empty" block
@@ -543,6 +921,7 @@ bool spu_runtime::add(u64 last_reset_count, void* _where, spu_function_t compile
 
 	// Register function in PIC map
 	m_pic_map[{func.data() + _off, func.size() - _off}] = compiled;
+	m_index.add({func.data() + _off, func.size() - _off}, compiled, spu_cache::get_key(func));
 
 	// Prepare sorted list
 	m_flat_list.clear();
@@ -861,6 +1240,15 @@ bool spu_runtime::add(u64 last_reset_count, void* _where, spu_function_t compile
 
 void* spu_runtime::find(u64 last_reset_count, const std::vector<u32>& func)
 {
+	//
+	const u32 _off = 1 + (func[0] / 4) * (false);
+
+	// Check compiled functions without locking (the caller holds passive_lock)
+	if (last_reset_count == m_reset_count && m_index.find({func.data() + _off, func.size() - _off}))
+	{
+		return g_dispatcher;
+	}
+
 	writer_lock lock(*this);
 
 	// Check reset count
@@ -869,9 +1257,6 @@ void* spu_runtime::find(u64 last_reset_count, const std::vector<u32>& func)
 		return nullptr;
 	}
 
-	//
-	const u32 _off = 1 + (func[0] / 4) * (false);
-
 	// Try to find PIC first
 	const auto found = m_pic_map.find({func.data() + _off, func.size() - _off});
 
@@ -929,28 +1314,18 @@ void* spu_runtime::find(u64 last_reset_count, const std::vector<u32>& func)
 
 spu_function_t spu_runtime::find(const u32* ls, u32 addr) const
 {
-	const u64 reset_count = m_reset_count;
-
-	reader_lock lock(*this);
-
-	if (reset_count != m_reset_count)
-	{
-		return nullptr;
-	}
-
-	const auto upper = m_pic_map.upper_bound({ls + addr / 4, (0x40000 - addr) / 4});
-
-	if (upper != m_pic_map.begin())
-	{
-		const auto found = std::prev(upper);
+	// The caller holds passive_lock, so the index can't be destroyed during the lookup
+	return m_index.find(ls, addr);
+}
 
-		if (found->first.compare(0, found->first.size(), ls + addr / 4, found->first.size()) == 0)
-		{
-			return found->second;
-		}
-	}
+std::unordered_map<u64, u32> spu_runtime::take_hits()
+{
+	writer_lock lock(*this);
 
-	return nullptr;
+	std::unordered_map<u64, u32> result = std::move(m_hits);
+	m_hits.clear();
+	m_index.take_hits(result);
+	return result;
 }
 
 spu_function_t spu_runtime::make_branch_patchpoint() const
@@ -1004,6 +1379,9 @@ u64 spu_runtime::reset(std::size_t last_reset_count)
 		}
 	});
 
+	// Unpublish the index, it may still be accessed by threads without locking
+	auto old_index = m_index.reset();
+
 	// Reset function map (may take some time)
 	m_map.clear();
 	m_pic_map.clear();
@@ -1014,6 +1392,10 @@ u64 spu_runtime::reset(std::size_t last_reset_count)
 		busy_wait();
 	}
 
+	// No more readers, keep the lookup counts
+	spu_function_index::take_hits(*old_index, m_hits);
+	old_index.reset();
+
 	// Reinitialize (TODO)
 	jit_runtime::finalize();
 	jit_runtime::initialize();
@@ -1054,6 +1436,133 @@ void spu_recompiler_base::make_function(const std::vector<u32>& data)
 	}
 }
 
+extern const spu_decoder<spu_interpreter_fast> g_spu_interpreter_fast;
+
+// Background compiler threads for asynchronous SPU compilation
+struct spu_compile_pool
+{
+	static u32 get_thread_count()
+	{
+		// Leave most of the threads to SPU and PPU
+		const u32 max_threads = static_cast<u32>(g_cfg.core.llvm_threads);
+		const u32 thread_count = std::max<u32>(std::thread::hardware_concurrency() / 4, 1);
+		return max_threads > 0 ? std::min(max_threads, thread_count) : thread_count;
+	}
+
+	// Group of all compilation tasks
+	utils::task_group group;
+
+	shared_mutex mutex;
+
+	// Functions being compiled -> completion flag
+	std::map<std::vector<u32>, std::shared_ptr<atomic_t<bool>>> pending;
+
+	// Statistics
+	atomic_t<u64> queue_depth{0};
+	atomic_t<u64> max_queue_depth{0};
+	atomic_t<u64> compiled{0};
+	atomic_t<u64> fallback_blocks{0};
+	atomic_t<u64> fallback_time{0}; // In microseconds
+
+	// Must be the last member: worker threads are joined before the state used by the tasks is destroyed
+	utils::task_pool workers;
+
+	spu_compile_pool()
+		: workers("SPU Worker", get_thread_count(), -1)
+	{
+	}
+
+	~spu_compile_pool()
+	{
+		LOG_NOTICE(SPU, "Async compilation: %u functions compiled, max queue depth: %u, interpreted blocks: %u (%u us)", compiled.load(), max_queue_depth.load(), fallback_blocks.load(), fallback_time.load());
+	}
+
+	// Queue function compilation if necessary, return completion flag
+	std::shared_ptr<atomic_t<bool>> queue(const std::vector<u32>& func)
+	{
+		std::lock_guard lock(mutex);
+
+		auto& done = pending[func];
+
+		if (done)
+		{
+			return done;
+		}
+
+		done = std::make_shared<atomic_t<bool>>(false);
+
+		const u64 depth = ++queue_depth;
+
+		max_queue_depth.atomic_op([&](u64& max)
+		{
+			max = std::max(max, depth);
+		});
+
+		workers.push(group, [this, func, done]
+		{
+			// Compiler instance of the current worker thread
+			thread_local const std::unique_ptr<spu_recompiler_base> compiler = g_cfg.core.spu_decoder == spu_decoder_type::asmjit
+				? spu_recompiler_base::make_asmjit_recompiler()
+				: spu_recompiler_base::make_llvm_recompiler();
+
+			{
+				spu_runtime::passive_lock _passive_lock(compiler->get_runtime());
+				compiler->make_function(func);
+			}
+
+			done->release(true);
+			compiled++;
+			queue_depth--;
+
+			std::lock_guard lock(mutex);
+			pending.erase(func);
+		});
+
+		return done;
+	}
+};
+
+void spu_recompiler_base::interpret(spu_thread& spu, const std::vector<u32>& func, const atomic_t<bool>& done)
+{
+	const auto& table = g_spu_interpreter_fast.get_table();
+
+	const u32 start = func[0];
+	const u32 end = start + (::size32(func) - 1) * 4;
+
+	// Execute instructions until the code leaves the function or the thread is interrupted
+	while (spu.pc >= start && spu.pc < end && func[(spu.pc - start) / 4 + 1] && !spu.state)
+	{
+		// Compiled code is only entered at the start of the function, leaving elsewhere would request a partial function
+		if (spu.pc == start && done)
+		{
+			break;
+		}
+
+		const u32 op = *spu._ptr<const be_t<u32>>(spu.pc);
+
+		if (table[spu_decode(op)](spu, {op}))
+		{
+			spu.pc += 4;
+		}
+	}
+}
+
+spu_async_statistics spu_recompiler_base::get_async_statistics()
+{
+	spu_async_statistics result;
+
+	if (const auto pool = fxm::get<spu_compile_pool>())
+	{
+		result.queue_depth = pool->queue_depth;
+		result.max_queue_depth = pool->max_queue_depth;
+		result.compiled = pool->compiled;
+		result.fallback_blocks = pool->fallback_blocks;
+		result.fallback_time = pool->fallback_time;
+	}
+
+	return result;
+}
+
 void spu_recompiler_base::dispatch(spu_thread& spu, void*, u8* rip)
 {
 	// If code verification failed from a patched patchpoint, clear it with a dispatcher jump
@@ -1083,8 +1592,24 @@ void spu_recompiler_base::dispatch(spu_thread& spu, void*, u8* rip)
 		return;
 	}
 
+	const auto& func = spu.jit->analyse(spu._ptr<u32>(0), spu.pc);
+
+	if (g_cfg.core.spu_async_compile)
+	{
+		// Compile in background, interpret the code meanwhile
+		const auto pool = fxm::get_always<spu_compile_pool>();
+		const auto done = pool->queue(func);
+		const u64 start = get_system_time();
+
+		interpret(spu, func, *done);
+
+		pool->fallback_blocks++;
+		pool->fallback_time += get_system_time() - start;
+		return;
+	}
+
 	// Compile
-	spu.jit->make_function(spu.jit->analyse(spu._ptr<u32>(0), spu.pc));
+	spu.jit->make_function(func);
 
 	// Diagnostic
 	if (g_cfg.core.spu_block_size == spu_block_size_type::giga)
@@ -3159,11 +3684,65 @@ void spu_recompiler_base::dump(std::string& out)
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Vectorize.h"
 
+// Persistent cache of compiled SPU functions (per title)
+struct spu_llvm_cache
+{
+	static constexpr u32 version = 1;
+	static constexpr u32 tag = "SPUO"_u32;
+
+	utils::pack_archive pack;
+
+	// Codegen settings and CPU (part of the object name)
+	std::string suffix;
+
+	spu_llvm_cache()
+	{
+		const std::string cache_path = Emu.PPUCache();
+
+		if (cache_path.empty() || !pack.open(cache_path + "spu-llvm.pack", version))
+		{
+			return;
+		}
+
+		if (pack.is_writable() && pack.get_garbage_size())
+		{
+			pack.compact();
+		}
+
+		enum class spu_settings : u32
+		{
+			accurate_xfloat,
+			approx_xfloat,
+			loop_detection,
+			verification,
+
+			__bitset_enum_max
+		};
+
+		be_t<bs_t<spu_settings>> settings{};
+
+		if (g_cfg.core.spu_accurate_xfloat) settings += spu_settings::accurate_xfloat;
+		if (g_cfg.core.spu_approx_xfloat) settings += spu_settings::approx_xfloat;
+		if (g_cfg.core.spu_loop_detection) settings += spu_settings::loop_detection;
+		if (g_cfg.core.spu_verification) settings += spu_settings::verification;
+
+		fmt::append(suffix, "-%s-%s-%s", fmt::to_lower(g_cfg.core.spu_block_size.to_string()), fmt::base57(settings), jit_compiler::cpu(g_cfg.core.llvm_cpu));
+
+#ifdef _WIN32
+		// Dispatcher address is embedded in the code
+		fmt::append(suffix, "-%x", reinterpret_cast<u64>(+spu_runtime::g_dispatcher));
+#endif
+	}
+};
+
 class spu_llvm_recompiler : public spu_recompiler_base, public cpu_translator
 {
 	// JIT Instance
 	jit_compiler m_jit{{}, jit_compiler::cpu(g_cfg.core.llvm_cpu)};
 
+	// Persistent object cache (may be null)
+	std::shared_ptr<spu_llvm_cache> m_objects;
+
 	// Interpreter table size power
 	const u8 m_interp_magn;
 
@@ -4099,6 +4678,16 @@ public:
 			m_spurt = fxm::get_always<spu_runtime>();
 			cpu_translator::initialize(m_jit.get_context(), m_jit.get_engine());
 
+			if (g_cfg.core.spu_cache && !g_cfg.core.spu_debug && !m_interp_magn)
+			{
+				m_objects = fxm::get_always<spu_llvm_cache>();
+
+				if (!m_objects->pack.is_open())
+				{
+					m_objects.reset();
+				}
+			}
+
 			const auto md_name = llvm::MDString::get(m_context, "branch_weights");
 			const auto md_low = llvm::ValueAsMetadata::get(llvm::ConstantInt::get(GetType<u32>(), 1));
 			const auto md_high = llvm::ValueAsMetadata::get(llvm::ConstantInt::get(GetType<u32>(), 999));
@@ -4147,6 +4736,9 @@ public:
 			fmt::append(m_hash, "spu-0x%05x-%s", func[0], fmt::base57(output));
 		}
 
+		// Object name in the persistent cache
+		const std::string obj_name = m_objects ? m_hash + m_objects->suffix : std::string{};
+
 		if (m_cache)
 		{
 			LOG_SUCCESS(SPU, "LLVM: Building %s (size %u)...", m_hash, func.size() - 1);
@@ -4608,90 +5200,107 @@ public:
 			m_function_table->eraseFromParent();
 		}
 
-		// Initialize pass manager
-		legacy::FunctionPassManager pm(module.get());
-
-		// Basic optimizations
-		pm.add(createEarlyCSEPass());
-		pm.add(createCFGSimplificationPass());
-		pm.add(createNewGVNPass());
-		pm.add(createDeadStoreEliminationPass());
-		pm.add(createLICMPass());
-		pm.add(createAggressiveDCEPass());
-		//pm.add(createLintPass()); // Check
+		std::vector<llvm::Function*> functions;
 
 		for (const auto& func : m_functions)
 		{
-			const auto f = func.second.fn ? func.second.fn : func.second.chunk;
-			pm.run(*f);
+			functions.push_back(func.second.fn ? func.second.fn : func.second.chunk);
+		}
+
+		raw_string_ostream out(log);
+
+		// Optimize and verify the module (skipped if the stored object is loaded, IR is still required to bind external symbols)
+		const auto optimize = [&](llvm::Module& _module)
+		{
+			// Initialize pass manager
+			legacy::FunctionPassManager pm(&_module);
 
-			for (auto& bb : *f)
+			// Basic optimizations
+			pm.add(createEarlyCSEPass());
+			pm.add(createCFGSimplificationPass());
+			pm.add(createNewGVNPass());
+			pm.add(createDeadStoreEliminationPass());
+			pm.add(createLICMPass());
+			pm.add(createAggressiveDCEPass());
+			//pm.add(createLintPass()); // Check
+
+			for (const auto f : functions)
 			{
-				for (auto& i : bb)
+				pm.run(*f);
+
+				for (auto& bb : *f)
 				{
-					// Replace volatile fake store with spu_test_state call
-					if (auto si = dyn_cast<StoreInst>(&i); si && si->getOperand(1) == m_fake_global1)
+					for (auto& i : bb)
 					{
-						m_ir->SetInsertPoint(si);
-
-						CallInst* ci{};
-						if (si->getOperand(0) == m_ir->getFalse())
-						{
-							ci = m_ir->CreateCall(m_test_state, {&*f->arg_begin()});
-							ci->setCallingConv(m_test_state->getCallingConv());
-						}
-						else
+						// Replace volatile fake store with spu_test_state call
+						if (auto si = dyn_cast<StoreInst>(&i); si && si->getOperand(1) == m_fake_global1)
 						{
-							continue;
-						}
+							m_ir->SetInsertPoint(si);
 
-						si->replaceAllUsesWith(ci);
-						si->eraseFromParent();
-						break;
+							CallInst* ci{};
+							if (si->getOperand(0) == m_ir->getFalse())
+							{
+								ci = m_ir->CreateCall(m_test_state, {&*f->arg_begin()});
+								ci->setCallingConv(m_test_state->getCallingConv());
+							}
+							else
+							{
+								continue;
+							}
+
+							si->replaceAllUsesWith(ci);
+							si->eraseFromParent();
+							break;
+						}
 					}
 				}
 			}
-		}
-
-		// Clear context (TODO)
-		m_blocks.clear();
-		m_block_queue.clear();
-		m_functions.clear();
-		m_function_queue.clear();
-		m_function_table = nullptr;
-
-		raw_string_ostream out(log);
-
-		if (g_cfg.core.spu_debug)
-		{
-			fmt::append(log, "LLVM IR at 0x%x:\n", func[0]);
-			out << *module; // print IR
-			out << "\n\n";
-		}
-
-		if (verifyModule(*module, &out))
-		{
-			out.flush();
-			LOG_ERROR(SPU, "LLVM: Verification failed at 0x%x:\n%s", func[0], log);
 
 			if (g_cfg.core.spu_debug)
 			{
-				fs::file(m_spurt->get_cache_path() + "spu-ir.log", fs::write + fs::append).write(log);
+				fmt::append(log, "LLVM IR at 0x%x:\n", func[0]);
+				out << _module; // print IR
+				out << "\n\n";
 			}
 
-			fmt::raw_error("Compilation failed");
-		}
+			if (verifyModule(_module, &out))
+			{
+				out.flush();
+				LOG_ERROR(SPU, "LLVM: Verification failed at 0x%x:\n%s", func[0], log);
+
+				if (g_cfg.core.spu_debug)
+				{
+					fs::file(m_spurt->get_cache_path() + "spu-ir.log", fs::write + fs::append).write(log);
+				}
+
+				fmt::raw_error("Compilation failed");
+			}
+		};
 
 		if (g_cfg.core.spu_debug)
 		{
 			// Testing only
+			optimize(*module);
 			m_jit.add(std::move(module), m_spurt->get_cache_path() + "llvm/");
 		}
+		else if (m_objects)
+		{
+			// Load or compile and store the object (only the optimized module is compiled)
+			m_jit.add(std::move(module), m_objects->pack, spu_llvm_cache::tag, obj_name, nullptr, optimize);
+		}
 		else
 		{
+			optimize(*module);
 			m_jit.add(std::move(module));
 		}
 
+		// Clear context (TODO)
+		m_blocks.clear();
+		m_block_queue.clear();
+		m_functions.clear();
+		m_function_queue.clear();
+		m_function_table = nullptr;
+
 		m_jit.fin();
 
 		// Register function pointer
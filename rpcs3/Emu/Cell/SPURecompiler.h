@@ -4,17 +4,40 @@
 #include "Utilities/mutex.h"
 #include "Utilities/cond.h"
 #include "Utilities/JIT.h"
+#include "Utilities/pack_archive.h"
 #include "SPUThread.h"
 #include <vector>
+#include <array>
 #include <bitset>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <deque>
+#include <unordered_map>
+
+class spu_runtime;
 
 // Helper class
 class spu_cache
 {
-	fs::file m_file;
+	// Deduplicated functions (optionally compressed) and usage statistics
+	utils::pack_archive m_pack;
+
+	shared_mutex m_mutex;
+
+	// Function key -> number of times the function was requested by the dispatcher
+	std::unordered_map<u64, u32> m_hits;
+
+	bool m_hits_dirty = false;
+
+	// Runtime whose function lookups are counted as hits
+	std::shared_ptr<spu_runtime> m_runtime;
+
+	// Serialize function (compressed if it's worth it)
+	static std::vector<u8> pack_function(const std::vector<u32>& func);
+
+	// Append function to the pack (kept in memory if it must be returned by get() in this session)
+	void store(const std::vector<u32>& func, bool keep);
 
 public:
 	spu_cache(const std::string& loc);
@@ -23,16 +46,93 @@ public:
 
 	operator bool() const
 	{
-		return m_file.operator bool();
+		return m_pack.is_open();
 	}
 
-	std::deque<std::vector<u32>> get();
+	// Get all functions, most requested first
+	std::vector<std::vector<u32>> get();
 
+	// Store new function
 	void add(const std::vector<u32>& func);
 
+	// Import old cache format, the imported functions are returned by get()
+	void import(const std::string& path);
+
+	// Get the key of a function (SHA-1 based)
+	static u64 get_key(const std::vector<u32>& func);
+
 	static void initialize();
 };
 
+// Hash index of compiled functions (position-independent data -> compiled function).
+// Lookups don't take locks, new functions are inserted with CAS. Functions can't be removed,
+// the whole table is replaced instead and destroyed when there are no more readers (RCU).
+class spu_function_index
+{
+public:
+	// Must be a power of 2
+	static constexpr u32 bucket_count = 0x4000;
+
+private:
+	struct node
+	{
+		node* next;
+		spu_function_t func;
+		std::vector<u32> data;
+
+		// Cache key of the function and number of lookups which found it
+		u64 key;
+		atomic_t<u32> hits{0};
+	};
+
+	struct table
+	{
+		std::array<atomic_t<node*>, bucket_count> buckets{};
+
+		// Number of functions consisting of a single instruction (hashed differently)
+		atomic_t<u32> short_count{0};
+
+		table() = default;
+
+		table(const table&) = delete;
+
+		~table();
+	};
+
+	atomic_t<table*> m_table;
+
+	// Hash of the first two instructions
+	static u32 get_bucket(u32 op0, u32 op1)
+	{
+		const u64 h = ((u64{op0} << 32) | op1) * 0x9e3779b97f4a7c15ull;
+		return static_cast<u32>(h >> 40) & (bucket_count - 1);
+	}
+
+public:
+	spu_function_index();
+
+	spu_function_index(const spu_function_index&) = delete;
+
+	~spu_function_index();
+
+	// Register compiled function (key is the cache key of the full function)
+	void add(std::basic_string_view<u32> data, spu_function_t func, u64 key);
+
+	// Find compiled function with exactly the same data
+	spu_function_t find(std::basic_string_view<u32> data) const;
+
+	// Find the longest compiled function matching LS contents at specified address
+	spu_function_t find(const u32* ls, u32 addr) const;
+
+	// Replace the table with an empty one, the result must be kept until there are no readers of the old table
+	std::unique_ptr<table> reset();
+
+	// Move lookup counts to the map (cache key -> hits)
+	void take_hits(std::unordered_map<u64, u32>& out);
+
+	static void take_hits(table& t, std::unordered_map<u64, u32>& out);
+};
+
 // Helper class
 class spu_runtime
 {
@@ -50,18 +150,27 @@ class spu_runtime
 		bool operator()(const std::vector<u32>& lhs, const std::vector<u32>& rhs) const;
 	};
 
-	// All functions
+	// All functions, including the ones being compiled (null pointer). Owns the function data,
+	// its elements are the opaque locations returned by find() (stable until reset)
 	std::map<std::vector<u32>, spu_function_t, func_compare> m_map;
 
-	// All functions as PIC
+	// All functions as PIC (views of m_map keys). Sorted order is required to generate the dispatcher,
+	// and it's used to wait for a function which is being compiled
 	std::map<std::basic_string_view<u32>, spu_function_t> m_pic_map;
 
+	// Compiled functions as PIC (lock-free lookup). Keeps own copies of the data because the table
+	// may be still read after reset, when the maps above are cleared
+	spu_function_index m_index;
+
 	// Debug module output location
 	std::string m_cache_path;
 
 	// Scratch vector
 	std::vector<std::pair<std::basic_string_view<u32>, spu_function_t>> m_flat_list;
 
+	// Lookup counts collected from the previous indices
+	std::unordered_map<u64, u32> m_hits;
+
 public:
 
 	// Trampoline to spu_recompiler_base::dispatch
@@ -90,6 +199,9 @@ public:
 	// Generate a patchable trampoline to spu_recompiler_base::branch
 	spu_function_t make_branch_patchpoint() const;
 
+	// Get lookup counts of the functions (cache key -> hits) and reset them
+	std::unordered_map<u64, u32> take_hits();
+
 	// reset() arg retriever, for race avoidance (can result in double reset)
 	u64 get_reset_count() const
 	{
@@ -185,6 +297,16 @@ public:
 	};
 };
 
+// Asynchronous compilation counters
+struct spu_async_statistics
+{
+	u64 queue_depth = 0;
+	u64 max_queue_depth = 0;
+	u64 compiled = 0;
+	u64 fallback_blocks = 0;
+	u64 fallback_time = 0; // In microseconds
+};
+
 // SPU Recompiler instance base class
 class spu_recompiler_base
 {
@@ -350,6 +472,12 @@ public:
 	// Compile function, handle failure
 	void make_function(const std::vector<u32>&);
 
+	// Execute the function with the interpreter while it's being compiled
+	static void interpret(spu_thread&, const std::vector<u32>& func, const atomic_t<bool>& done);
+
+	// Get asynchronous compilation counters (empty if it's not used)
+	static spu_async_statistics get_async_statistics();
+
 	// Default dispatch function fallback (second arg is unused)
 	static void dispatch(spu_thread&, void*, u8* rip);
 
@@ -4,19 +4,16 @@
 
 #include <mutex>
 
+#include "Emu/System.h"
 #include "Emu/Cell/PPUThread.h"
 #include "Crypto/unedat.h"
 #include "Emu/VFS.h"
 #include "Emu/IdManager.h"
 #include "Utilities/StrUtil.h"
+#include "Utilities/asm.h"
 
 LOG_CHANNEL(sys_fs);
 
-struct lv2_fs_mount_point
-{
-	std::mutex mutex;
-};
-
 lv2_fs_mount_point g_mp_sys_dev_hdd0;
 lv2_fs_mount_point g_mp_sys_dev_hdd1;
 lv2_fs_mount_point g_mp_sys_dev_usb;
@@ -63,21 +60,451 @@ lv2_fs_mount_point* lv2_fs_object::get_mp(const char* filename)
 	return &g_mp_sys_dev_hdd0;
 }
 
-u64 lv2_file::op_read(vm::ptr<void> buf, u64 size)
+// I/O size histogram, reported at emulation stop
+struct lv2_fs_io_stats
+{
+	// Power of 2 size buckets: <=512, <=1K, ..., >1G
+	static constexpr u32 bucket_count = 23;
+
+	std::array<atomic_t<u64>, bucket_count> reads{};
+	std::array<atomic_t<u64>, bucket_count> writes{};
+
+	// Bytes transferred directly from/to guest memory
+	atomic_t<u64> direct_bytes{0};
+
+	// Bytes transferred through intermediate buffer
+	atomic_t<u64> buffered_bytes{0};
+
+	// Bytes read in background
+	atomic_t<u64> prefetch_bytes{0};
+
+	// Bytes served from read-ahead buffers
+	atomic_t<u64> prefetch_hits{0};
+
+	static u32 get_bucket(u64 size)
+	{
+		return size <= 512 ? 0 : std::min<u32>(bucket_count - 1, 64 - static_cast<u32>(utils::cntlz64(size - 1, true)) - 9);
+	}
+
+	~lv2_fs_io_stats()
+	{
+		if (!direct_bytes && !buffered_bytes && !prefetch_hits)
+		{
+			return;
+		}
+
+		std::string out;
+
+		for (u32 i = 0; i < bucket_count; i++)
+		{
+			if (const u64 r = reads[i], w = writes[i]; r || w)
+			{
+				const bool last = i == bucket_count - 1;
+				fmt::append(out, "\n%s0x%x bytes: read=%u, write=%u", last ? ">" : "<=", last ? 512u << (i - 1) : 512u << i, r, w);
+			}
+		}
+
+		sys_fs.notice("I/O statistics: direct=0x%llx bytes, buffered=0x%llx bytes, read-ahead=0x%llx bytes (0x%llx used)%s", direct_bytes, buffered_bytes, prefetch_bytes, prefetch_hits, out);
+	}
+};
+
+// Size of intermediate buffer
+constexpr u64 c_fs_buffer_size = 0x10000;
+
+static u8* get_fs_buffer()
+{
+	static thread_local std::unique_ptr<u8[]> s_buffer;
+
+	if (!s_buffer)
+	{
+		s_buffer.reset(new u8[c_fs_buffer_size]);
+	}
+
+	return s_buffer.get();
+}
+
+// Check guest memory range and touch every page to resolve host protection (such as RSX texture cache)
+static bool probe_guest_range(u32 addr, u64 size, bool is_write)
+{
+	if (!size || u64{addr} + size > 0x1'0000'0000 || !vm::check_addr(addr, static_cast<u32>(size), is_write ? vm::page_writable : vm::page_readable))
+	{
+		return false;
+	}
+
+	const u32 last = static_cast<u32>(addr + size - 1);
+
+	for (u32 page = addr / 4096; page <= last / 4096; page++)
+	{
+		const u32 probe = std::max(page * 4096, addr);
+
+		if (is_write)
+		{
+			// Atomic no-op write
+			vm::_ref<atomic_t<u8>>(probe).fetch_add(0);
+		}
+		else
+		{
+			static_cast<const volatile u8*>(vm::base(probe))[0];
+		}
+	}
+
+	return true;
+}
+
+struct lv2_fs_prefetch_block
+{
+	// Weak reference: pending blocks are owned by the engine's own queues
+	const std::weak_ptr<lv2_fs_io_engine> engine;
+	std::unique_ptr<u8[]> data;
+
+	// File offset
+	const u64 offset;
+
+	// Modification counter value at the time of scheduling
+	const u64 gen;
+
+	// Amount of data read (valid if ready)
+	u64 size = 0;
+
+	bool ready = false;
+
+	lv2_fs_prefetch_block(const std::shared_ptr<lv2_fs_io_engine>& engine, std::unique_ptr<u8[]> data, u64 offset, u64 gen)
+		: engine(engine)
+		, data(std::move(data))
+		, offset(offset)
+		, gen(gen)
+	{
+	}
+
+	~lv2_fs_prefetch_block()
+	{
+		if (const auto _engine = engine.lock())
+		{
+			_engine->free_block(std::move(data));
+		}
+	}
+};
+
+void lv2_fs_io_worker::operator()()
+{
+	for (auto tasks = queue.pop_all(); thread_ctrl::state() != thread_state::aborting; tasks ? tasks.pop_front() : tasks = queue.pop_all())
+	{
+		if (!tasks)
+		{
+			queue.wait();
+			continue;
+		}
+
+		if (*tasks)
+		{
+			(*tasks)();
+		}
+	}
+}
+
+lv2_fs_io_engine::lv2_fs_io_engine()
+{
+	for (u32 i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i] = std::make_unique<named_thread<lv2_fs_io_worker>>(fmt::format("FS I/O Thread %u", i));
+	}
+}
+
+void lv2_fs_io_engine::submit(std::function<void()> task)
+{
+	// Round-robin distribution, so slow requests don't block each other
+	m_workers[m_next++ % m_workers.size()]->queue.push(std::move(task));
+}
+
+std::unique_ptr<u8[]> lv2_fs_io_engine::alloc_block()
+{
+	std::lock_guard lock(m_pool_mutex);
+
+	if (!m_pool.empty())
+	{
+		auto result = std::move(m_pool.back());
+		m_pool.pop_back();
+		return result;
+	}
+
+	if (m_pool_allocated >= block_count)
+	{
+		return nullptr;
+	}
+
+	m_pool_allocated++;
+	return std::make_unique<u8[]>(block_size);
+}
+
+void lv2_fs_io_engine::free_block(std::unique_ptr<u8[]> block)
+{
+	if (block)
+	{
+		std::lock_guard lock(m_pool_mutex);
+		m_pool.emplace_back(std::move(block));
+	}
+}
+
+static atomic_t<u64>& get_write_gen(lv2_fs_mount_point* mp, const char* filename)
+{
+	// FNV-1a hash of the file name
+	u32 hash = 0x811c9dc5;
+
+	for (; *filename; filename++)
+	{
+		hash = (hash ^ static_cast<u8>(*filename)) * 0x01000193;
+	}
+
+	return mp->write_gen[hash % mp->write_gen.size()];
+}
+
+atomic_t<u64>& lv2_file::get_write_gen() const
+{
+	return ::get_write_gen(mp, name.data());
+}
+
+bool lv2_file::is_native() const
+{
+	// Emulated files don't have a native handle
+	static const fs::native_handle s_invalid = fs::file{}.get_handle();
+
+	return file.get_handle() != s_invalid;
+}
+
+u64 lv2_file::op_read(vm::ptr<void> buf, u64 size, u64 offset)
+{
+	const auto stats = fxm::get_always<lv2_fs_io_stats>();
+	stats->reads[lv2_fs_io_stats::get_bucket(size)]++;
+
+	u64 result = 0;
+
+	// Copy data read in background
+	if (std::lock_guard lock(ra_mutex); !ra_blocks.empty())
+	{
+		const u64 gen = get_write_gen();
+
+		while (result < size && !ra_blocks.empty())
+		{
+			const auto block_ptr = ra_blocks.front();
+			auto& block = *block_ptr;
+			const u64 pos = offset + result;
+
+			if (pos < block.offset)
+			{
+				// Non-sequential access
+				ra_blocks.clear();
+				break;
+			}
+
+			if (pos >= block.offset + lv2_fs_io_engine::block_size)
+			{
+				// Skipped
+				ra_blocks.pop_front();
+				continue;
+			}
+
+			while (!block.ready && !Emu.IsStopped())
+			{
+				ra_cond.wait(ra_mutex, 10000);
+			}
+
+			if (!block.ready || block.gen != gen)
+			{
+				// File modified
+				ra_blocks.clear();
+				break;
+			}
+
+			if (pos >= block.offset + block.size)
+			{
+				// End of file (at the time of reading)
+				break;
+			}
+
+			const u64 count = std::min<u64>(size - result, block.offset + block.size - pos);
+			std::memcpy(static_cast<u8*>(buf.get_ptr()) + result, block.data.get() + (pos - block.offset), count);
+			result += count;
+		}
+
+		stats->prefetch_hits += result;
+	}
+
+	std::unique_lock io_lock(io_mutex, std::defer_lock);
+
+	if (!is_native())
+	{
+		io_lock.lock();
+	}
+
+	// Read directly into guest memory, protection may still change before the read (then fallback is used for the rest)
+	if (result < size && probe_guest_range(buf.addr() + static_cast<u32>(result), size - result, true))
+	{
+		const u64 nread = file.read_at(offset + result, static_cast<u8*>(buf.get_ptr()) + result, size - result);
+		stats->direct_bytes += nread;
+		result += nread;
+	}
+
+	// Copy data from intermediate buffer (avoid passing faulting vm pointer to a native API)
+	while (result < size)
+	{
+		const auto local_buf = get_fs_buffer();
+		const u64 block = std::min<u64>(size - result, c_fs_buffer_size);
+		const u64 nread = file.read_at(offset + result, local_buf, block);
+		std::memcpy(static_cast<u8*>(buf.get_ptr()) + result, local_buf, nread);
+		stats->buffered_bytes += nread;
+		result += nread;
+
+		if (nread < block)
+		{
+			break;
+		}
+	}
+
+	if (io_lock)
+	{
+		io_lock.unlock();
+	}
+
+	// Detect sequential access
+	std::lock_guard lock(ra_mutex);
+	ra_streak = offset == ra_next ? ra_streak + 1 : 0;
+	ra_next = offset + result;
+
+	return result;
+}
+
+u64 lv2_file::op_write(vm::cptr<void> buf, u64 size, u64 offset)
 {
-	// Copy data from intermediate buffer (avoid passing vm pointer to a native API)
-	std::unique_ptr<u8[]> local_buf(new u8[size]);
-	const u64 result = file.read(local_buf.get(), size);
-	std::memcpy(buf.get_ptr(), local_buf.get(), result);
+	const auto stats = fxm::get_always<lv2_fs_io_stats>();
+	stats->writes[lv2_fs_io_stats::get_bucket(size)]++;
+
+	u64 result = 0;
+
+	std::unique_lock io_lock(io_mutex, std::defer_lock);
+
+	if (!is_native())
+	{
+		io_lock.lock();
+	}
+
+	// Write directly from guest memory
+	if (probe_guest_range(buf.addr(), size, false))
+	{
+		result = file.write_at(offset, buf.get_ptr(), size);
+		stats->direct_bytes += result;
+	}
+
+	// Copy data to intermediate buffer (avoid passing faulting vm pointer to a native API)
+	while (result < size)
+	{
+		const auto local_buf = get_fs_buffer();
+		const u64 block = std::min<u64>(size - result, c_fs_buffer_size);
+		std::memcpy(local_buf, static_cast<const u8*>(buf.get_ptr()) + result, block);
+		const u64 nwritten = file.write_at(offset + result, local_buf, block);
+		stats->buffered_bytes += nwritten;
+		result += nwritten;
+
+		if (nwritten < block)
+		{
+			break;
+		}
+	}
+
+	if (result)
+	{
+		// Invalidate read-ahead buffers of all descriptors of this file
+		get_write_gen()++;
+	}
+
 	return result;
 }
 
-u64 lv2_file::op_write(vm::cptr<void> buf, u64 size)
+void lv2_file::read_ahead(const std::shared_ptr<lv2_file>& _file)
 {
-	// Copy data to intermediate buffer (avoid passing vm pointer to a native API)
-	std::unique_ptr<u8[]> local_buf(new u8[size]);
-	std::memcpy(local_buf.get(), buf.get_ptr(), size);
-	return file.write(local_buf.get(), size);
+	// Wait for a few sequential reads
+	if (std::lock_guard lock(_file->ra_mutex); _file->ra_streak < 2)
+	{
+		return;
+	}
+
+	read_ahead(_file, -1);
+}
+
+void lv2_file::read_ahead(const std::shared_ptr<lv2_file>& _file, u64 offset)
+{
+	// Amount of blocks to keep in flight per file
+	constexpr u32 depth = 4;
+
+	if (!_file->is_native())
+	{
+		return;
+	}
+
+	std::lock_guard lock(_file->ra_mutex);
+
+	if (offset != -1)
+	{
+		// Start streaming from specified offset
+		_file->ra_blocks.clear();
+		_file->ra_next = offset;
+		_file->ra_streak = 2;
+	}
+
+	// Drop blocks which cannot be used anymore
+	while (!_file->ra_blocks.empty() && _file->ra_blocks.front()->offset + lv2_fs_io_engine::block_size <= _file->ra_next)
+	{
+		_file->ra_blocks.pop_front();
+	}
+
+	if (!_file->ra_blocks.empty() && _file->ra_blocks.front()->offset > _file->ra_next)
+	{
+		_file->ra_blocks.clear();
+	}
+
+	if (_file->ra_blocks.size() >= depth)
+	{
+		return;
+	}
+
+	u64 pos = _file->ra_blocks.empty() ? _file->ra_next : _file->ra_blocks.back()->offset + lv2_fs_io_engine::block_size;
+
+	const u64 file_size = _file->file.size();
+
+	if (pos >= file_size)
+	{
+		return;
+	}
+
+	const auto engine = fxm::get_always<lv2_fs_io_engine>();
+	const u64 gen = _file->get_write_gen();
+
+	while (_file->ra_blocks.size() < depth && pos < file_size)
+	{
+		auto data = engine->alloc_block();
+
+		if (!data)
+		{
+			// Pool exhausted
+			break;
+		}
+
+		auto block = std::make_shared<lv2_fs_prefetch_block>(engine, std::move(data), pos, gen);
+
+		engine->submit([_file, block]
+		{
+			const u64 nread = _file->file.read_at(block->offset, block->data.get(), lv2_fs_io_engine::block_size);
+
+			fxm::get_always<lv2_fs_io_stats>()->prefetch_bytes += nread;
+
+			std::lock_guard lock(_file->ra_mutex);
+			block->size = nread;
+			block->ready = true;
+			_file->ra_cond.notify_all();
+		});
+
+		_file->ra_blocks.emplace_back(std::move(block));
+		pos += lv2_fs_io_engine::block_size;
+	}
 }
 
 struct lv2_file::file_view : fs::file_base
@@ -109,10 +536,14 @@ struct lv2_file::file_view : fs::file_base
 
 	u64 read(void* buffer, u64 size) override
 	{
-		const u64 old_pos = m_file->file.pos();
-		const u64 new_pos = m_file->file.seek(m_off + m_pos);
-		const u64 result = m_file->file.read(buffer, size);
-		verify(HERE), old_pos == m_file->file.seek(old_pos);
+		std::unique_lock io_lock(m_file->io_mutex, std::defer_lock);
+
+		if (!m_file->is_native())
+		{
+			io_lock.lock();
+		}
+
+		const u64 result = m_file->file.read_at(m_off + m_pos, buffer, size);
 
 		m_pos += result;
 		return result;
@@ -321,6 +752,12 @@ error_code sys_fs_open(ppu_thread& ppu, vm::cptr<char> path, s32 flags, vm::ptr<
 		return {CELL_EIO, path};
 	}
 
+	if (open_mode & fs::trunc)
+	{
+		// Invalidate read-ahead buffers of other descriptors
+		get_write_gen(lv2_fs_object::get_mp(path.get_ptr()), path.get_ptr())++;
+	}
+
 	if ((flags & CELL_FS_O_MSELF) && (!verify_mself(*fd, file)))
 	{
 		return {CELL_ENOTMSELF, path};
@@ -397,9 +834,15 @@ error_code sys_fs_read(ppu_thread& ppu, u32 fd, vm::ptr<void> buf, u64 nbytes, v
 		return CELL_EBADF;
 	}
 
-	std::lock_guard lock(file->mp->mutex);
+	std::lock_guard lock(file->mutex);
+
+	reader_lock mp_lock(file->mp->mutex);
+
+	const u64 result = file->op_read(buf, nbytes, file->pos);
+	file->pos += result;
+	*nread = result;
 
-	*nread = file->op_read(buf, nbytes);
+	lv2_file::read_ahead(file);
 
 	return CELL_OK;
 }
@@ -417,14 +860,32 @@ error_code sys_fs_write(ppu_thread& ppu, u32 fd, vm::cptr<void> buf, u64 nbytes,
 		return CELL_EBADF;
 	}
 
-	std::lock_guard lock(file->mp->mutex);
+	std::lock_guard lock(file->mutex);
 
 	if (file->lock)
 	{
 		return CELL_EBUSY;
 	}
 
-	*nwrite = file->op_write(buf, nbytes);
+	if (file->flags & CELL_FS_O_APPEND)
+	{
+		// Appending depends on the file size, which can be changed by other descriptors
+		std::lock_guard mp_lock(file->mp->mutex);
+
+		file->pos = file->file.size();
+
+		const u64 result = file->op_write(buf, nbytes, file->pos);
+		file->pos += result;
+		*nwrite = result;
+
+		return CELL_OK;
+	}
+
+	reader_lock mp_lock(file->mp->mutex);
+
+	const u64 result = file->op_write(buf, nbytes, file->pos);
+	file->pos += result;
+	*nwrite = result;
 
 	return CELL_OK;
 }
@@ -708,7 +1169,7 @@ error_code sys_fs_fstat(ppu_thread& ppu, u32 fd, vm::ptr<CellFsStat> sb)
 		return CELL_EBADF;
 	}
 
-	std::lock_guard lock(file->mp->mutex);
+	reader_lock lock(file->mp->mutex);
 
 	const fs::stat_t& info = file->file.stat();
 
@@ -953,21 +1414,23 @@ error_code sys_fs_fcntl(ppu_thread& ppu, u32 fd, u32 op, vm::ptr<void> _arg, u32
 			return CELL_EBADF;
 		}
 
-		std::lock_guard lock(file->mp->mutex);
+		// Positional access doesn't need the descriptor lock
+		reader_lock lock(file->mp->mutex);
 
 		if (op == 0x8000000b && file->lock)
 		{
 			return CELL_EBUSY;
 		}
 
-		const u64 old_pos = file->file.pos();
-		const u64 new_pos = file->file.seek(arg->offset);
-
-		arg->out_size = op == 0x8000000a
-			? file->op_read(arg->buf, arg->size)
-			: file->op_write(arg->buf, arg->size);
-
-		verify(HERE), old_pos == file->file.seek(old_pos);
+		if (op == 0x8000000a)
+		{
+			arg->out_size = file->op_read(arg->buf, arg->size, arg->offset);
+			lv2_file::read_ahead(file);
+		}
+		else
+		{
+			arg->out_size = file->op_write(arg->buf, arg->size, arg->offset);
+		}
 
 		arg->out_code = CELL_OK;
 		return CELL_OK;
@@ -1308,22 +1771,21 @@ error_code sys_fs_lseek(ppu_thread& ppu, u32 fd, s64 offset, s32 whence, vm::ptr
 		return CELL_EBADF;
 	}
 
-	std::lock_guard lock(file->mp->mutex);
+	std::lock_guard lock(file->mutex);
 
-	const u64 result = file->file.seek(offset, static_cast<fs::seek_mode>(whence));
+	const u64 base =
+		whence == CELL_FS_SEEK_SET ? 0 :
+		whence == CELL_FS_SEEK_CUR ? file->pos :
+		file->file.size();
 
-	if (result == -1)
+	if (offset < 0 && 0 - static_cast<u64>(offset) > base)
 	{
-		switch (auto error = fs::g_tls_error)
-		{
-		case fs::error::inval: return CELL_EINVAL;
-		default: sys_fs.error("sys_fs_lseek(): unknown error %s", error);
-		}
-
-		return CELL_EIO; // ???
+		return CELL_EINVAL;
 	}
 
-	*pos = result;
+	file->pos = base + offset;
+
+	*pos = file->pos;
 	return CELL_OK;
 }
 
@@ -1429,6 +1891,7 @@ error_code sys_fs_truncate(ppu_thread& ppu, vm::cptr<char> path, u64 size)
 		return {CELL_EIO, path}; // ???
 	}
 
+	get_write_gen(lv2_fs_object::get_mp(path.get_ptr()), path.get_ptr())++;
 	return CELL_OK;
 }
 
@@ -1456,9 +1919,14 @@ error_code sys_fs_ftruncate(ppu_thread& ppu, u32 fd, u64 size)
 	{
 		const u64 fsize = file->file.size();
 
-		if (size > fsize && !file->file.write(std::vector<u8>(size - fsize)))
+		if (size > fsize)
 		{
-			return CELL_ENOSPC;
+			const std::vector<u8> zeros(size - fsize);
+
+			if (file->file.write_at(fsize, zeros.data(), zeros.size()) != zeros.size())
+			{
+				return CELL_ENOSPC;
+			}
 		}
 	}
 	else if (!file->file.trunc(size))
@@ -1472,6 +1940,7 @@ error_code sys_fs_ftruncate(ppu_thread& ppu, u32 fd, u64 size)
 		return CELL_EIO; // ???
 	}
 
+	file->get_write_gen()++;
 	return CELL_OK;
 }
 
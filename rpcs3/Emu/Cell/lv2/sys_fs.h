@@ -3,6 +3,13 @@
 #include "Emu/Memory/vm_ptr.h"
 #include "Emu/Cell/ErrorCodes.h"
 #include "Utilities/File.h"
+#include "Utilities/mutex.h"
+#include "Utilities/cond.h"
+#include "Utilities/lockless.h"
+#include "Utilities/Thread.h"
+
+#include <deque>
+#include <functional>
 
 // Open Flags
 enum : s32
@@ -119,7 +126,59 @@ struct FsMselfEntry
 	u8 m_reserve[16];
 };
 
-struct lv2_fs_mount_point;
+struct lv2_fs_mount_point
+{
+	// Shared for data access, exclusive for operations which affect every descriptor (such as truncation)
+	shared_mutex mutex;
+
+	// Modification counters indexed by file name hash (used to discard stale read-ahead data)
+	std::array<atomic_t<u64>, 64> write_gen{};
+};
+
+// Background I/O worker
+struct lv2_fs_io_worker
+{
+	lf_queue<std::function<void()>> queue;
+
+	void operator()();
+
+	void on_abort()
+	{
+		// Wake up the thread
+		queue.push();
+	}
+};
+
+// Background I/O thread pool, used for read-ahead and asynchronous requests
+class lv2_fs_io_engine
+{
+	std::array<std::unique_ptr<named_thread<lv2_fs_io_worker>>, 4> m_workers;
+
+	atomic_t<u32> m_next{0};
+
+	// Free read-ahead buffers
+	shared_mutex m_pool_mutex;
+	std::vector<std::unique_ptr<u8[]>> m_pool;
+	u32 m_pool_allocated = 0;
+
+public:
+	// Read-ahead buffer size
+	static constexpr u64 block_size = 0x100000;
+
+	// Read-ahead buffer pool limit
+	static constexpr u32 block_count = 32;
+
+	lv2_fs_io_engine();
+
+	// Execute task on a worker thread
+	void submit(std::function<void()> task);
+
+	// Get read-ahead buffer (may return nullptr if the pool is exhausted)
+	std::unique_ptr<u8[]> alloc_block();
+
+	// Return read-ahead buffer to the pool
+	void free_block(std::unique_ptr<u8[]> block);
+};
 
 struct lv2_fs_object
 {
@@ -162,6 +221,9 @@ struct lv2_fs_object
 	}
 };
 
+// Read-ahead buffer
+struct lv2_fs_prefetch_block;
+
 struct lv2_file final : lv2_fs_object
 {
 	const fs::file file;
@@ -171,6 +233,22 @@ struct lv2_file final : lv2_fs_object
 	// Stream lock
 	atomic_t<u32> lock{0};
 
+	// Current position (independent from the host file position)
+	u64 pos = 0;
+
+	// Serializes access to the current position
+	shared_mutex mutex;
+
+	// Serializes positional access to emulated files (such as decrypted EDATA), which is implemented using seek
+	shared_mutex io_mutex;
+
+	// Read-ahead state (protected by ra_mutex)
+	shared_mutex ra_mutex;
+	cond_variable ra_cond;
+	u64 ra_next = 0; // End offset of the last read
+	u32 ra_streak = 0; // Number of consecutive sequential reads
+	std::deque<std::shared_ptr<lv2_fs_prefetch_block>> ra_blocks;
+
 	lv2_file(const char* filename, fs::file&& file, s32 mode, s32 flags)
 		: lv2_fs_object(lv2_fs_object::get_mp(filename), filename)
 		, file(std::move(file))
@@ -187,11 +265,23 @@ struct lv2_file final : lv2_fs_object
 	{
 	}
 
-	// File reading with intermediate buffer
-	u64 op_read(vm::ptr<void> buf, u64 size);
+	// File reading at specified offset (directly into guest memory if possible)
+	u64 op_read(vm::ptr<void> buf, u64 size, u64 offset);
+
+	// File writing at specified offset (directly from guest memory if possible)
+	u64 op_write(vm::cptr<void> buf, u64 size, u64 offset);
+
+	// Schedule background reading of the following data if sequential access was detected
+	static void read_ahead(const std::shared_ptr<lv2_file>& _file);
+
+	// Schedule background reading from specified offset (explicit streaming)
+	static void read_ahead(const std::shared_ptr<lv2_file>& _file, u64 offset);
+
+	// Get modification counter of the file
+	atomic_t<u64>& get_write_gen() const;
 
-	// File writing with intermediate buffer
-	u64 op_write(vm::cptr<void> buf, u64 size);
+	// Check whether positional access is thread-safe
+	bool is_native() const;
 
 	// For MSELF support
 	struct file_view;
@@ -23,12 +23,26 @@ namespace rsx
 				auto it = frame_capture.memory_data_map.find(data_hash);
 				if (it != frame_capture.memory_data_map.end())
 				{
-					if (it->second.data != data.data)
+					// The data was moved to the capture file, compare with the stored copy
+					std::vector<u8> stored(it->second.size);
+
+					if (it->second.size != data.data.size() ||
+						!frame_capture.storage->load(it->second.chunks, stored.data(), stored.size()) ||
+						std::memcmp(stored.data(), data.data.data(), stored.size()) != 0)
 						// screw this
 						fmt::throw_exception("Memory map hash collision detected...cant capture");
 				}
 				else
+				{
+					// Move data to the capture file (deduplicated in chunks and compressed)
+					data.size = data.data.size();
+
+					if (!frame_capture.storage->store(data.data.data(), data.data.size(), data.chunks))
+						fmt::throw_exception("Failed to store captured memory...cant capture");
+
+					data.data = {};
 					frame_capture.memory_data_map.insert(std::make_pair(data_hash, std::move(data)));
+				}
 
 				u64 block_hash = XXH64(&block, sizeof(frame_capture_data::memory_block), 0);
 				mem_changes.insert(block_hash);
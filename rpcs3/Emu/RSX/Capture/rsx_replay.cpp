@@ -9,9 +9,176 @@
 
 #include <map>
 #include <exception>
+#include <zlib.h>
+
+#include "xxhash.h"
 
 namespace rsx
 {
+	namespace
+	{
+		// Capture file record tags
+		constexpr u32 c_capture_chunk = "RRCC"_u32;
+		constexpr u32 c_capture_frame = "RRCF"_u32;
+
+		struct capture_blob_header
+		{
+			le_t<u64> size;   // Unpacked size
+			le_t<u64> packed; // Size of compressed data (0 if stored as is)
+		};
+
+		CHECK_SIZE(capture_blob_header, 16);
+
+		std::vector<u8> pack_blob(const void* data, std::size_t size)
+		{
+			std::vector<u8> result(sizeof(capture_blob_header) + compressBound(::narrow<uLong>(size)));
+
+			uLongf packed = ::narrow<uLongf>(result.size() - sizeof(capture_blob_header));
+
+			capture_blob_header header{size, 0};
+
+			if (compress2(result.data() + sizeof(header), &packed, static_cast<const Bytef*>(data), ::narrow<uLong>(size), Z_BEST_SPEED) == Z_OK && packed < size)
+			{
+				header.packed = packed;
+				result.resize(sizeof(header) + packed);
+			}
+			else
+			{
+				std::memcpy(result.data() + sizeof(header), data, size);
+				result.resize(sizeof(header) + size);
+			}
+
+			std::memcpy(result.data(), &header, sizeof(header));
+			return result;
+		}
+
+		bool unpack_blob(const utils::pack_archive::blob& blob, u8* dst, std::size_t size)
+		{
+			capture_blob_header header;
+
+			if (!blob || blob.size < sizeof(header))
+			{
+				return false;
+			}
+
+			std::memcpy(&header, blob.data, sizeof(header));
+
+			if (header.size != size || sizeof(header) + (header.packed ? header.packed : header.size) > blob.size)
+			{
+				return false;
+			}
+
+			if (!header.packed)
+			{
+				std::memcpy(dst, blob.data + sizeof(header), size);
+				return true;
+			}
+
+			uLongf unpacked = ::narrow<uLongf>(size);
+			return uncompress(dst, &unpacked, blob.data + sizeof(header), ::narrow<uLong>(header.packed)) == Z_OK && unpacked == size;
+		}
+	}
+
+	bool capture_storage::create(const std::string& path)
+	{
+		fs::remove_file(path);
+		return m_pack.open(path, FRAME_CAPTURE_VERSION) && m_pack.is_writable();
+	}
+
+	bool capture_storage::open(const std::string& path)
+	{
+		return m_pack.open(path, FRAME_CAPTURE_VERSION, true);
+	}
+
+	bool capture_storage::store(const u8* data, std::size_t size, std::vector<u64>& chunks)
+	{
+		chunks.clear();
+		chunks.reserve((size + chunk_size - 1) / chunk_size);
+
+		std::vector<u8> stored;
+
+		for (std::size_t pos = 0; pos < size; pos += chunk_size)
+		{
+			const std::size_t count = std::min<std::size_t>(size - pos, chunk_size);
+			const u64 key = XXH64(data + pos, count, 0);
+
+			if (m_pack.contains(c_capture_chunk, key))
+			{
+				// Deduplicated chunk, make sure it's not a hash collision
+				stored.resize(count);
+
+				if (!unpack_blob(m_pack.find(c_capture_chunk, key), stored.data(), count) || std::memcmp(stored.data(), data + pos, count) != 0)
+				{
+					LOG_ERROR(RSX, "Capture: chunk hash collision detected (key=0x%llx)", key);
+					return false;
+				}
+			}
+			else
+			{
+				// Only compress new chunks (the compressed copy is kept to compare the chunks deduplicated later)
+				const auto packed = pack_blob(data + pos, count);
+
+				if (!m_pack.append(c_capture_chunk, key, packed.data(), ::size32(packed)))
+				{
+					LOG_ERROR(RSX, "Capture: failed to write chunk to %s", m_pack.get_path());
+					return false;
+				}
+			}
+
+			chunks.push_back(key);
+		}
+
+		return true;
+	}
+
+	bool capture_storage::load(const std::vector<u64>& chunks, u8* dst, std::size_t size) const
+	{
+		std::size_t pos = 0;
+
+		for (u64 key : chunks)
+		{
+			const std::size_t count = std::min<std::size_t>(size - pos, chunk_size);
+
+			if (pos >= size || !unpack_blob(m_pack.find(c_capture_chunk, key), dst + pos, count))
+			{
+				return false;
+			}
+
+			pos += count;
+		}
+
+		return pos == size;
+	}
+
+	bool capture_storage::write_frame(const std::string& data)
+	{
+		const auto packed = pack_blob(data.data(), data.size());
+		return m_pack.append(c_capture_frame, 0, packed.data(), ::size32(packed), false);
+	}
+
+	std::string capture_storage::read_frame() const
+	{
+		const auto blob = m_pack.find(c_capture_frame, 0);
+
+		capture_blob_header header;
+
+		if (!blob || blob.size < sizeof(header))
+		{
+			return {};
+		}
+
+		std::memcpy(&header, blob.data, sizeof(header));
+
+		std::string result(header.size, '\0');
+
+		if (!unpack_blob(blob, reinterpret_cast<u8*>(result.data()), result.size()))
+		{
+			return {};
+		}
+
+		return result;
+	}
+
 	be_t<u32> rsx_replay_thread::allocate_context()
 	{
 		u32 buffer_size = 4;
@@ -114,8 +281,10 @@ namespace rsx
 			if (it_data == frame->memory_data_map.end())
 				fmt::throw_exception("requested memory data state for command not found in memory_data_map");
 
+			// Unpack memory chunks directly to the destination
 			const auto& data_block = it_data->second;
-			std::memcpy(vm::base(get_address(memblock.offset, memblock.location)), data_block.data.data(), data_block.data.size());
+			if (!frame->storage->load(data_block.chunks, vm::_ptr<u8>(get_address(memblock.offset, memblock.location)), data_block.size))
+				fmt::throw_exception("failed to load memory data from the capture file");
 		}
 
 		if (replay_cmd.display_buffer_state != 0 && replay_cmd.display_buffer_state != cs.display_buffer_hash)
@@ -175,6 +344,15 @@ namespace rsx
 
 		auto fifo_stops = alloc_write_fifo(context_id);
 
+		const u64 bench_start = get_system_time();
+		u32 loop_count = 0;
+
+		if (bench_loops)
+		{
+			get_current_renderer()->frontend_stats.reset();
+			get_current_renderer()->frontend_stats.enabled = true;
+		}
+
 		while (!Emu.IsStopped())
 		{
 			// Load registers while the RSX is still idle
@@ -188,8 +366,11 @@ namespace rsx
 			auto last_flip = render->int_flip_index;
 
 			size_t stopIdx = 0;
-			for (const auto& replay_cmd : frame->replay_commands)
+			size_t frameIdx = 0;
+			for (u32 cmdIdx = 0; cmdIdx < frame->replay_commands.size(); cmdIdx++)
 			{
+				const auto& replay_cmd = frame->replay_commands[cmdIdx];
+
 				while (Emu.IsPaused())
 					std::this_thread::sleep_for(10ms);
 
@@ -210,6 +391,24 @@ namespace rsx
 
 				stopIdx++;
 
+				if (frameIdx < frame->frame_starts.size() && frame->frame_starts[frameIdx] == cmdIdx)
+				{
+					// End of a captured frame, flip manually if it was done by syscall
+					if (render->int_flip_index == last_flip)
+					{
+						render->request_emu_flip(1u);
+
+						// Wait for the flip before overwriting memory with the state of the next frame
+						while (render->int_flip_index == last_flip && !Emu.IsStopped())
+						{
+							std::this_thread::yield();
+						}
+					}
+
+					last_flip = render->int_flip_index;
+					frameIdx++;
+				}
+
 				apply_frame_state(context_id, replay_cmd);
 
 				// move put ptr to next stop
@@ -236,11 +435,60 @@ namespace rsx
 				render->request_emu_flip(1u);
 			}
 
+			if (bench_loops)
+			{
+				if (++loop_count == bench_loops)
+				{
+					report_benchmark(get_system_time() - bench_start);
+
+					Emu.CallAfter([]()
+					{
+						Emu.Stop();
+						Emu.GetCallbacks().exit();
+					});
+
+					break;
+				}
+
+				continue;
+			}
+
 			// random pause to not destroy gpu
 			std::this_thread::sleep_for(10ms);
 		}
 	}
 
+	void rsx_replay_thread::report_benchmark(u64 time_us)
+	{
+		const auto& stats = get_current_renderer()->frontend_stats;
+		const double seconds = std::max<u64>(time_us, 1) / 1000000.;
+
+		const u64 methods = stats.methods.load();
+		const u64 draws = stats.draws.load();
+
+		const std::string result = fmt::format(
+			"{\"loops\": %u, \"frames\": %u, \"commands\": %u, \"time_us\": %u, "
+			"\"methods\": %u, \"methods_per_sec\": %.1f, \"draws\": %u, \"draws_per_sec\": %.1f, "
+			"\"flattener_time_us\": %u, \"vertex_upload_time_us\": %u, \"texture_decode_time_us\": %u, "
+			"\"program_lookup_time_us\": %u, \"programs_linked\": %u}\n",
+			bench_loops, bench_loops * (frame->frame_starts.size() + 1), frame->replay_commands.size(), time_us,
+			methods, methods / seconds, draws, draws / seconds,
+			stats.flattener_time / 1000, stats.vertex_upload_time / 1000, stats.texture_decode_time / 1000,
+			stats.program_lookup_time / 1000, stats.programs_linked.load());
+
+		LOG_SUCCESS(RSX, "Capture Replay benchmark: %s", result);
+
+		if (bench_output.empty())
+		{
+			std::fputs(result.c_str(), stdout);
+			std::fflush(stdout);
+		}
+		else if (!fs::write_file(bench_output, fs::rewrite, result))
+		{
+			LOG_ERROR(RSX, "Capture Replay: failed to write benchmark results to %s", bench_output);
+		}
+	}
+
 	void rsx_replay_thread::operator()()
 	{
 		try
@@ -5,6 +5,7 @@
 #include "Emu/Cell/PPUModule.h"
 #include "Emu/Cell/lv2/sys_sync.h"
 #include "Emu/RSX/rsx_methods.h"
+#include "Utilities/pack_archive.h"
 
 #include <cereal/types/vector.hpp>
 #include <cereal/types/array.hpp>
@@ -15,16 +16,53 @@
 namespace rsx
 {
 	constexpr u32 FRAME_CAPTURE_MAGIC = 0x52524300; // ascii 'RRC/0'
-	constexpr u32 FRAME_CAPTURE_VERSION = 0x4;
+	constexpr u32 FRAME_CAPTURE_VERSION = 0x6;
+
+	// Capture file: compressed frame data and content-addressed compressed memory chunks (shared by all memory blocks)
+	class capture_storage
+	{
+		utils::pack_archive m_pack;
+
+	public:
+		static constexpr u32 chunk_size = 0x10000;
+
+		// Create a new capture file
+		bool create(const std::string& path);
+
+		// Open existing capture file (read-only, memory mapped)
+		bool open(const std::string& path);
+
+		const std::string& get_path() const
+		{
+			return m_pack.get_path();
+		}
+
+		// Split data into chunks and store the new ones, get chunk keys (false on write error or hash collision)
+		bool store(const u8* data, std::size_t size, std::vector<u64>& chunks);
+
+		// Unpack chunks to the destination
+		bool load(const std::vector<u64>& chunks, u8* dst, std::size_t size) const;
+
+		// Store serialized frame data
+		bool write_frame(const std::string& data);
+
+		// Get serialized frame data (empty on error)
+		std::string read_frame() const;
+	};
+
 	struct frame_capture_data
 	{
 		struct memory_block_data
 		{
-			std::vector<u8> data;
+			std::vector<u8> data;    // Raw data, only used while capturing (moved to the capture storage)
+			u64 size = 0;
+			std::vector<u64> chunks; // Chunk keys in the capture storage
+
 			template<typename Archive>
 			void serialize(Archive& ar)
 			{
-				ar(data);
+				ar(size);
+				ar(chunks);
 			}
 		};
 
@@ -155,8 +193,12 @@ namespace rsx
 		std::unordered_map<u64, display_buffers_state> display_buffers_map;
 		// actual command queue to hold everything above
 		std::vector<replay_command> replay_commands;
+		// Index of the first command of every frame after the first one (memory is only stored if it changed between frames)
+		std::vector<u32> frame_starts;
 		// Initial registers state at the beginning of the capture
 		rsx::rsx_state reg_state;
+		// Storage of memory data (not serialized)
+		std::shared_ptr<capture_storage> storage;
 
 		template<typename Archive>
 		void serialize(Archive & ar)
@@ -169,6 +211,7 @@ namespace rsx
 			ar(display_buffers_map);
 			ar(replay_commands);
 			ar(reg_state);
+			ar(frame_starts);
 		}
 
 		void reset()
@@ -177,8 +220,12 @@ namespace rsx
 			version = FRAME_CAPTURE_VERSION;
 			tile_map.clear();
 			memory_map.clear();
+			memory_data_map.clear();
+			display_buffers_map.clear();
 			replay_commands.clear();
+			frame_starts.clear();
 			reg_state = method_registers;
+			storage.reset();
 		}
 	};
 
@@ -209,9 +256,15 @@ namespace rsx
 		current_state cs;
 		std::unique_ptr<frame_capture_data> frame;
 
+		// Benchmark mode: number of replays and result file (stdout if empty)
+		u32 bench_loops = 0;
+		std::string bench_output;
+
 	public:
-		rsx_replay_thread(std::unique_ptr<frame_capture_data>&& frame_data)
-			:frame(std::move(frame_data))
+		rsx_replay_thread(std::unique_ptr<frame_capture_data>&& frame_data, u32 bench_loops = 0, std::string bench_output = {})
+			: frame(std::move(frame_data))
+			, bench_loops(bench_loops)
+			, bench_output(std::move(bench_output))
 		{
 		}
 
@@ -221,5 +274,6 @@ namespace rsx
 		be_t<u32> allocate_context();
 		std::vector<u32> alloc_write_fifo(be_t<u32> context_id);
 		void apply_frame_state(be_t<u32> context_id, const frame_capture_data::replay_command& replay_cmd);
+		void report_benchmark(u64 time_us);
 	};
 }
@@ -8,13 +8,7 @@
 
 #define DEBUG_VERTEX_STREAMING 0
 
-const bool s_use_ssse3 =
-#ifdef _MSC_VER
-	utils::has_ssse3();
-#elif __SSSE3__
-	true;
-#else
-	false;
+#if !defined(_MSC_VER) && !defined(__SSSE3__)
 #define _mm_shuffle_epi8(opa, opb) opb
 #endif
 
@@ -54,6 +48,24 @@ namespace
 		return{ X, Y, Z, 1 };
 	}
 
+	/**
+	 * Shuffle pairs of 128-bit blocks with the given byte mask, advancing both pointers.
+	 * Kept out of line so that it is the only code built with AVX2 enabled.
+	 */
+	AVX2_FUNC void stream_data_to_memory_shuffled_avx2(__m128i*& dst_ptr, __m128i*& src_ptr, u32 block_pairs, __m128i mask)
+	{
+		const __m256i mask256 = _mm256_broadcastsi128_si256(mask);
+
+		for (u32 i = 0; i < block_pairs; ++i)
+		{
+			const __m256i vector = _mm256_loadu_si256((const __m256i*)src_ptr);
+			_mm256_storeu_si256((__m256i*)dst_ptr, _mm256_shuffle_epi8(vector, mask256));
+
+			src_ptr += 2;
+			dst_ptr += 2;
+		}
+	}
+
 	inline void stream_data_to_memory_swapped_u32(void *dst, const void *src, u32 vertex_count, u8 stride)
 	{
 		const __m128i mask = _mm_set_epi8(
@@ -66,9 +78,16 @@ namespace
 		__m128i* src_ptr = (__m128i*)src;
 
 		const u32 dword_count = (vertex_count * (stride >> 2));
-		const u32 iterations = dword_count >> 2;
+		u32 iterations = dword_count >> 2;
 		const u32 remaining = dword_count % 4;
 
+		if (LIKELY(s_use_avx2))
+		{
+			// Two blocks per iteration, the last odd block is left for the SSE loop
+			stream_data_to_memory_shuffled_avx2(dst_ptr, src_ptr, iterations / 2, mask);
+			iterations %= 2;
+		}
+
 		if (LIKELY(s_use_ssse3))
 		{
 			for (u32 i = 0; i < iterations; ++i)
@@ -117,9 +136,15 @@ namespace
 		__m128i* src_ptr = (__m128i*)src;
 
 		const u32 word_count = (vertex_count * (stride >> 1));
-		const u32 iterations = word_count >> 3;
+		u32 iterations = word_count >> 3;
 		const u32 remaining = word_count % 8;
 
+		if (LIKELY(s_use_avx2))
+		{
+			stream_data_to_memory_shuffled_avx2(dst_ptr, src_ptr, iterations / 2, mask);
+			iterations %= 2;
+		}
+
 		if (LIKELY(s_use_ssse3))
 		{
 			for (u32 i = 0; i < iterations; ++i)
@@ -345,6 +370,68 @@ namespace
 		}
 	}
 
+	/**
+	 * Decode CMP vectors to RGBA16 (see decode_cmp_vector), 4 vertices per iteration.
+	 * Destination stride must be 8. Returns the number of vertices processed, the remainder is left to the caller.
+	 */
+	inline u32 stream_data_to_memory_cmp(void *dst, const void *src, u32 vertex_count, u32 src_stride, bool swap_endianness)
+	{
+		const __m128i mask = _mm_set_epi8(
+			0xC, 0xD, 0xE, 0xF,
+			0x8, 0x9, 0xA, 0xB,
+			0x4, 0x5, 0x6, 0x7,
+			0x0, 0x1, 0x2, 0x3);
+
+		const __m128i mask_11 = _mm_set1_epi32(0x7FF);
+		const __m128i w = _mm_set1_epi32(1 << 16);
+
+		const char *src_ptr = (const char *)src;
+		__m128i* dst_ptr = (__m128i*)dst;
+
+		const u32 iterations = vertex_count / 4;
+
+		for (u32 i = 0; i < iterations; ++i)
+		{
+			__m128i vec;
+
+			if (src_stride == 4)
+			{
+				vec = _mm_loadu_si128((const __m128i*)src_ptr);
+			}
+			else
+			{
+				vec = _mm_setr_epi32(*(const s32*)src_ptr, *(const s32*)(src_ptr + src_stride), *(const s32*)(src_ptr + src_stride * 2), *(const s32*)(src_ptr + src_stride * 3));
+			}
+
+			src_ptr += src_stride * 4;
+
+			if (swap_endianness)
+			{
+				if (LIKELY(s_use_ssse3))
+				{
+					vec = _mm_shuffle_epi8(vec, mask);
+				}
+				else
+				{
+					vec = _mm_or_si128(_mm_slli_epi16(vec, 8), _mm_srli_epi16(vec, 8));
+					vec = _mm_or_si128(_mm_slli_epi32(vec, 16), _mm_srli_epi32(vec, 16));
+				}
+			}
+
+			// Every component fits in 16 bits, pack X|Y and Z|W into dwords and interleave them
+			const __m128i x = _mm_slli_epi32(_mm_and_si128(vec, mask_11), 5);
+			const __m128i y = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(vec, 11), mask_11), 5);
+			const __m128i z = _mm_slli_epi32(_mm_srli_epi32(vec, 22), 6);
+			const __m128i xy = _mm_or_si128(x, _mm_slli_epi32(y, 16));
+			const __m128i zw = _mm_or_si128(z, w);
+
+			_mm_storeu_si128(dst_ptr++, _mm_unpacklo_epi32(xy, zw));
+			_mm_storeu_si128(dst_ptr++, _mm_unpackhi_epi32(xy, zw));
+		}
+
+		return iterations * 4;
+	}
+
 	template <typename T, typename U, int N>
 	void copy_whole_attribute_array_impl(void *raw_dst, void *raw_src, u8 dst_stride, u32 src_stride, u32 vertex_count)
 	{
@@ -379,6 +466,9 @@ namespace
 		u32 src_offset = 0;
 		u32 src_limit = src_stride * src_vertex_count;
 
+		// A single source vertex is fetched with a stride of 0
+		if (src_limit == 0) src_limit = 1;
+
 		for (u32 vertex = 0; vertex < vertex_count; ++vertex)
 		{
 			T* typed_dst = (T*)dst_ptr;
@@ -521,7 +611,19 @@ void write_vertex_array_data_to_buffer(gsl::span<gsl::byte> raw_dst_span, gsl::s
 	case rsx::vertex_base_type::cmp:
 	{
 		gsl::span<u16> dst_span = as_span_workaround<u16>(raw_dst_span);
-		for (u32 i = 0; i < count; ++i)
+
+		u32 i = 0;
+
+#if !DEBUG_VERTEX_STREAMING
+		if (dst_stride == 8 && src_ptr.size_bytes() >= 4)
+		{
+			// Only decode vertices which are fully inside of the source range
+			const u32 src_count = attribute_src_stride ? ((u32)src_ptr.size_bytes() - 4) / attribute_src_stride + 1 : count;
+			i = stream_data_to_memory_cmp(raw_dst_span.data(), src_ptr.data(), std::min(count, src_count), attribute_src_stride, swap_endianness);
+		}
+#endif
+
+		for (; i < count; ++i)
 		{
 			u32 src_value;
 			memcpy(&src_value, src_ptr.subspan(attribute_src_stride * i).data(), sizeof(u32));
@@ -559,111 +661,122 @@ namespace
 		return value;
 	}
 
-	struct untouched_impl
+	/**
+	 * The index paths are only gated on SSSE3, so unsigned min/max are built from SSE2 instructions
+	 */
+	template <typename T>
+	struct simd_index_ops;
+
+	template <>
+	struct simd_index_ops<u16>
 	{
-		static
-		std::tuple<u16, u16, u32> upload_u16_swapped(const void *src, void *dst, u32 count)
-		{
-			const __m128i mask = _mm_set_epi8(
-				0xE, 0xF, 0xC, 0xD,
-				0xA, 0xB, 0x8, 0x9,
-				0x6, 0x7, 0x4, 0x5,
-				0x2, 0x3, 0x0, 0x1);
+		static __m128i set1(u32 value) { return _mm_set1_epi16(static_cast<s16>(value)); }
+		static __m128i cmpeq(__m128i a, __m128i b) { return _mm_cmpeq_epi16(a, b); }
+		static __m128i min(__m128i a, __m128i b) { return _mm_subs_epu16(a, _mm_subs_epu16(a, b)); }
+		static __m128i max(__m128i a, __m128i b) { return _mm_adds_epu16(b, _mm_subs_epu16(a, b)); }
+	};
 
-			auto src_stream = (const __m128i*)src;
-			auto dst_stream = (__m128i*)dst;
+	template <>
+	struct simd_index_ops<u32>
+	{
+		static __m128i set1(u32 value) { return _mm_set1_epi32(static_cast<s32>(value)); }
+		static __m128i cmpeq(__m128i a, __m128i b) { return _mm_cmpeq_epi32(a, b); }
 
-			__m128i min = _mm_set1_epi16(0xFFFF);
-			__m128i max = _mm_set1_epi16(0);
+		static __m128i cmpgt(__m128i a, __m128i b)
+		{
+			const __m128i sign = _mm_set1_epi32(0x80000000);
+			return _mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+		}
 
-			const auto iterations = count / 8;
-			for (unsigned n = 0; n < iterations; ++n)
-			{
-				const __m128i raw = _mm_loadu_si128(src_stream++);
-				const __m128i value = _mm_shuffle_epi8(raw, mask);
-				max = _mm_max_epu16(max, value);
-				min = _mm_min_epu16(min, value);
-				_mm_storeu_si128(dst_stream++, value);
-			}
+		static __m128i min(__m128i a, __m128i b)
+		{
+			const __m128i a_greater = cmpgt(a, b);
+			return _mm_or_si128(_mm_and_si128(a_greater, b), _mm_andnot_si128(a_greater, a));
+		}
 
-			const __m128i mask_step1 = _mm_set_epi8(
-				0, 0, 0, 0, 0, 0, 0, 0,
-				0xF, 0xE, 0xD, 0xC, 0xB, 0xA, 0x9, 0x8);
+		static __m128i max(__m128i a, __m128i b)
+		{
+			const __m128i a_greater = cmpgt(a, b);
+			return _mm_or_si128(_mm_and_si128(a_greater, a), _mm_andnot_si128(a_greater, b));
+		}
+	};
 
-			const __m128i mask_step2 = _mm_set_epi8(
-				0, 0, 0, 0, 0, 0, 0, 0,
-				0, 0, 0, 0, 0x7, 0x6, 0x5, 0x4);
+	/**
+	 * Build a pshufb mask selecting the listed index lanes of a big endian vector and byteswapping them.
+	 * Unused bytes of the result are zeroed.
+	 */
+	template <typename T>
+	__m128i make_index_shuffle(std::initializer_list<u8> lanes)
+	{
+		alignas(16) u8 bytes[16];
+		std::memset(bytes, 0x80, sizeof(bytes));
 
-			const __m128i mask_step3 = _mm_set_epi8(
-				0, 0, 0, 0, 0, 0, 0, 0,
-				0, 0, 0, 0, 0, 0, 0x3, 0x2);
+		u32 pos = 0;
+		for (const u8 lane : lanes)
+		{
+			for (u32 byte = 0; byte < sizeof(T); ++byte)
+			{
+				bytes[pos++] = static_cast<u8>(lane * sizeof(T) + sizeof(T) - 1 - byte);
+			}
+		}
 
-			__m128i tmp = _mm_shuffle_epi8(min, mask_step1);
-			min = _mm_min_epu16(min, tmp);
-			tmp = _mm_shuffle_epi8(min, mask_step2);
-			min = _mm_min_epu16(min, tmp);
-			tmp = _mm_shuffle_epi8(min, mask_step3);
-			min = _mm_min_epu16(min, tmp);
+		return _mm_load_si128(reinterpret_cast<const __m128i*>(bytes));
+	}
 
-			tmp = _mm_shuffle_epi8(max, mask_step1);
-			max = _mm_max_epu16(max, tmp);
-			tmp = _mm_shuffle_epi8(max, mask_step2);
-			max = _mm_max_epu16(max, tmp);
-			tmp = _mm_shuffle_epi8(max, mask_step3);
-			max = _mm_max_epu16(max, tmp);
+	template <typename T>
+	__m128i make_index_swap_shuffle()
+	{
+		if constexpr (sizeof(T) == 2)
+			return make_index_shuffle<T>({0, 1, 2, 3, 4, 5, 6, 7});
+		else
+			return make_index_shuffle<T>({0, 1, 2, 3});
+	}
 
-			const u16 min_index = u16(_mm_cvtsi128_si32(min) & 0xFFFF);
-			const u16 max_index = u16(_mm_cvtsi128_si32(max) & 0xFFFF);
+	template <typename T>
+	void fold_min_max(T& min_index, T& max_index, __m128i min, __m128i max)
+	{
+		alignas(16) T mins[16 / sizeof(T)];
+		alignas(16) T maxs[16 / sizeof(T)];
+		_mm_store_si128(reinterpret_cast<__m128i*>(mins), min);
+		_mm_store_si128(reinterpret_cast<__m128i*>(maxs), max);
 
-			return std::make_tuple(min_index, max_index, count);
+		for (u32 i = 0; i < 16 / sizeof(T); ++i)
+		{
+			min_index = std::min(min_index, mins[i]);
+			max_index = std::max(max_index, maxs[i]);
 		}
+	}
 
+	struct untouched_impl
+	{
+		/**
+		 * Swap indices and track their range, count must be a multiple of the vector size
+		 */
+		template<typename T>
 		static
-		std::tuple<u32, u32, u32> upload_u32_swapped(const void *src, void *dst, u32 count)
+		std::tuple<T, T, u32> upload_swapped(const void *src, void *dst, u32 count)
 		{
-			const __m128i mask = _mm_set_epi8(
-				0xC, 0xD, 0xE, 0xF,
-				0x8, 0x9, 0xA, 0xB,
-				0x4, 0x5, 0x6, 0x7,
-				0x0, 0x1, 0x2, 0x3);
+			using ops = simd_index_ops<T>;
+			const __m128i mask = make_index_swap_shuffle<T>();
 
 			auto src_stream = (const __m128i*)src;
 			auto dst_stream = (__m128i*)dst;
 
-			__m128i min = _mm_set1_epi32(~0u);
-			__m128i max = _mm_set1_epi32(0);
+			__m128i min = _mm_set1_epi32(-1);
+			__m128i max = _mm_setzero_si128();
 
-			const auto iterations = count / 4;
+			const auto iterations = count / (16 / sizeof(T));
 			for (unsigned n = 0; n < iterations; ++n)
 			{
 				const __m128i raw = _mm_loadu_si128(src_stream++);
 				const __m128i value = _mm_shuffle_epi8(raw, mask);
-				max = _mm_max_epu32(max, value);
-				min = _mm_min_epu32(min, value);
+				max = ops::max(max, value);
+				min = ops::min(min, value);
 				_mm_storeu_si128(dst_stream++, value);
 			}
 
-			// Aggregate min-max
-			const __m128i mask_step1 = _mm_set_epi8(
-				0, 0, 0, 0, 0, 0, 0, 0,
-				0xF, 0xE, 0xD, 0xC, 0xB, 0xA, 0x9, 0x8);
-
-			const __m128i mask_step2 = _mm_set_epi8(
-				0, 0, 0, 0, 0, 0, 0, 0,
-				0, 0, 0, 0, 0x7, 0x6, 0x5, 0x4);
-
-			__m128i tmp = _mm_shuffle_epi8(min, mask_step1);
-			min = _mm_min_epu16(min, tmp);
-			tmp = _mm_shuffle_epi8(min, mask_step2);
-			min = _mm_min_epu16(min, tmp);
-
-			tmp = _mm_shuffle_epi8(max, mask_step1);
-			max = _mm_max_epu16(max, tmp);
-			tmp = _mm_shuffle_epi8(max, mask_step2);
-			max = _mm_max_epu16(max, tmp);
-
-			const u32 min_index = u32(_mm_cvtsi128_si32(min));
-			const u32 max_index = u32(_mm_cvtsi128_si32(max));
+			T min_index = index_limit<T>(), max_index = 0;
+			fold_min_max(min_index, max_index, min, max);
 
 			return std::make_tuple(min_index, max_index, count);
 		}
@@ -678,16 +791,8 @@ namespace
 
 			if (s_use_ssse3 && remaining >= 32)
 			{
-				if constexpr (std::is_same<T, u32>::value)
-				{
-					const auto count = (remaining & ~0x3);
-					std::tie(min_index, max_index, written) = upload_u32_swapped(src.data(), dst.data(), count);
-				}
-				else if constexpr (std::is_same<T, u16>::value)
-				{
-					const auto count = (remaining & ~0x7);
-					std::tie(min_index, max_index, written) = upload_u16_swapped(src.data(), dst.data(), count);
-				}
+				const auto count = remaining & ~(16 / sizeof(T) - 1);
+				std::tie(min_index, max_index, written) = upload_swapped<T>(src.data(), dst.data(), count);
 
 				remaining -= written;
 			}
@@ -714,10 +819,60 @@ namespace
 		static
 		std::tuple<T, T, u32> upload_untouched(gsl::span<to_be_t<const T>> src, gsl::span<T> dst, u32 restart_index, bool skip_restart)
 		{
+			if (restart_index > index_limit<T>())
+			{
+				// Restart index cannot be matched by any index of this type
+				return untouched_impl::upload_untouched(src, dst);
+			}
+
 			T min_index = index_limit<T>(), max_index = 0;
 			u32 dst_index = 0;
+			u32 src_index = 0;
 
-			for (const T index : src)
+			if (s_use_ssse3)
+			{
+				// Swap, restart detection and range tracking in a single pass
+				using ops = simd_index_ops<T>;
+				constexpr u32 lanes = 16 / sizeof(T);
+
+				const __m128i mask = make_index_swap_shuffle<T>();
+				const __m128i restart = ops::set1(restart_index);
+
+				__m128i min = _mm_set1_epi32(-1);
+				__m128i max = _mm_setzero_si128();
+
+				const u32 count = src.size() & ~(lanes - 1);
+				for (; src_index < count; src_index += lanes)
+				{
+					const __m128i value = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src.data() + src_index)), mask);
+					const __m128i is_restart = ops::cmpeq(value, restart);
+
+					if (skip_restart && _mm_movemask_epi8(is_restart))
+					{
+						// Restart indices are dropped, compact this block
+						for (u32 i = 0; i < lanes; ++i)
+						{
+							const T index = src[src_index + i];
+							if (index != restart_index)
+							{
+								dst[dst_index++] = min_max(min_index, max_index, index);
+							}
+						}
+
+						continue;
+					}
+
+					// Restart indices become index_limit (all bits set) and are excluded from the range
+					min = ops::min(min, _mm_or_si128(value, is_restart));
+					max = ops::max(max, _mm_andnot_si128(is_restart, value));
+					_mm_storeu_si128((__m128i*)(dst.data() + dst_index), _mm_or_si128(value, is_restart));
+					dst_index += lanes;
+				}
+
+				fold_min_max(min_index, max_index, min, max);
+			}
+
+			for (const T index : src.subspan(src_index))
 			{
 				if (index == restart_index)
 				{
@@ -766,7 +921,50 @@ namespace
 		T anchor = invalid_index;
 		T last_index = invalid_index;
 
-		for (const T index : src)
+		constexpr u32 lanes = 16 / sizeof(T);
+
+		if (s_use_ssse3 && !is_primitive_restart_enabled && src.size() > lanes + 1)
+		{
+			// Every block loads the indices following the last emitted one and emits lanes / 2 triangles.
+			// The anchor is stored in the last lane, which is not otherwise used.
+			using ops = simd_index_ops<T>;
+			constexpr u32 tris = lanes / 2;
+
+			static const __m128i swap = make_index_swap_shuffle<T>();
+			static const __m128i expand_lo = sizeof(T) == 2 ? make_index_shuffle<u16>({7, 0, 1, 7, 1, 2, 7, 2}) : make_index_shuffle<u32>({3, 0, 1, 3});
+			static const __m128i expand_hi = sizeof(T) == 2 ? make_index_shuffle<u16>({3, 7, 3, 4}) : make_index_shuffle<u32>({1, 2});
+			static const __m128i anchor_lane = sizeof(T) == 2 ? _mm_setr_epi16(0, 0, 0, 0, 0, 0, 0, -1) : _mm_setr_epi32(0, 0, 0, -1);
+			static const __m128i new_lanes = sizeof(T) == 2 ? _mm_setr_epi16(0, -1, -1, -1, -1, 0, 0, 0) : _mm_setr_epi32(0, -1, -1, 0);
+
+			// Swap back to big endian so the anchor can go through the same shuffles
+			const __m128i anchor_vec = _mm_and_si128(anchor_lane, _mm_shuffle_epi8(ops::set1(src[0]), swap));
+
+			__m128i min = _mm_set1_epi32(-1);
+			__m128i max = _mm_setzero_si128();
+
+			for (src_idx = 1; src_idx + lanes <= src.size(); src_idx += tris)
+			{
+				const __m128i raw = _mm_or_si128(_mm_andnot_si128(anchor_lane, _mm_loadu_si128((const __m128i*)(src.data() + src_idx))), anchor_vec);
+				const __m128i value = _mm_shuffle_epi8(raw, swap);
+
+				// Only the last index of every triangle is tracked, as in the scalar loop
+				min = ops::min(min, _mm_or_si128(value, _mm_andnot_si128(new_lanes, _mm_set1_epi32(-1))));
+				max = ops::max(max, _mm_and_si128(value, new_lanes));
+
+				_mm_storeu_si128((__m128i*)(dst.data() + dst_idx), _mm_shuffle_epi8(raw, expand_lo));
+				_mm_storel_epi64((__m128i*)(dst.data() + dst_idx + lanes), _mm_shuffle_epi8(raw, expand_hi));
+				dst_idx += tris * 3;
+			}
+
+			fold_min_max(min_index, max_index, min, max);
+
+			needs_anchor = false;
+			anchor = src[0];
+			last_index = src[src_idx];
+			src_idx++;
+		}
+
+		for (const T index : src.subspan(src_idx))
 		{
 			if (needs_anchor)
 			{
@@ -811,10 +1009,39 @@ namespace
 		verify(HERE), (4 * dst.size_bytes() >= 6 * src.size_bytes());
 
 		u32 dst_idx = 0;
+		u32 src_idx = 0;
 		u8 set_size = 0;
 		T tmp_indices[4];
 
-		for (const T index : src)
+		if (s_use_ssse3 && !is_primitive_restart_enabled)
+		{
+			// Every block holds 1 (u32) or 2 (u16) quads and is expanded to 6 or 12 indices
+			using ops = simd_index_ops<T>;
+			constexpr u32 lanes = 16 / sizeof(T);
+
+			static const __m128i swap = make_index_swap_shuffle<T>();
+			static const __m128i expand_lo = sizeof(T) == 2 ? make_index_shuffle<u16>({0, 1, 2, 2, 3, 0, 4, 5}) : make_index_shuffle<u32>({0, 1, 2, 2});
+			static const __m128i expand_hi = sizeof(T) == 2 ? make_index_shuffle<u16>({6, 6, 7, 4}) : make_index_shuffle<u32>({3, 0});
+
+			__m128i min = _mm_set1_epi32(-1);
+			__m128i max = _mm_setzero_si128();
+
+			for (; src_idx + lanes <= src.size(); src_idx += lanes)
+			{
+				const __m128i raw = _mm_loadu_si128((const __m128i*)(src.data() + src_idx));
+				const __m128i value = _mm_shuffle_epi8(raw, swap);
+				min = ops::min(min, value);
+				max = ops::max(max, value);
+
+				_mm_storeu_si128((__m128i*)(dst.data() + dst_idx), _mm_shuffle_epi8(raw, expand_lo));
+				_mm_storel_epi64((__m128i*)(dst.data() + dst_idx + lanes), _mm_shuffle_epi8(raw, expand_hi));
+				dst_idx += lanes / 2 * 3;
+			}
+
+			fold_min_max(min_index, max_index, min, max);
+		}
+
+		for (const T index : src.subspan(src_idx))
 		{
 			if (is_primitive_restart_enabled && index == primitive_restart_index)
 			{
@@ -914,27 +1141,76 @@ u32 get_index_type_size(rsx::index_array_type type)
 	fmt::throw_exception("Wrong index type" HERE);
 }
 
+namespace
+{
+	/**
+	 * Write reps repetitions of a pattern of 8 * N u16 indices, adding step to the pattern after every repetition.
+	 * Returns the number of repetitions written.
+	 */
+	template <u32 N>
+	u32 stream_index_pattern(u16* dst, const u16 (&pattern)[8 * N], const u16 (&step)[8 * N], u32 reps)
+	{
+		__m128i value[N];
+		__m128i inc[N];
+
+		for (u32 i = 0; i < N; ++i)
+		{
+			value[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + i * 8));
+			inc[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(step + i * 8));
+		}
+
+		auto dst_stream = reinterpret_cast<__m128i*>(dst);
+
+		for (u32 rep = 0; rep < reps; ++rep)
+		{
+			for (u32 i = 0; i < N; ++i)
+			{
+				_mm_storeu_si128(dst_stream++, value[i]);
+				value[i] = _mm_add_epi16(value[i], inc[i]);
+			}
+		}
+
+		return reps;
+	}
+}
+
 void write_index_array_for_non_indexed_non_native_primitive_to_buffer(char* dst, rsx::primitive_type draw_mode, unsigned count)
 {
 	unsigned short *typedDst = (unsigned short *)(dst);
 	switch (draw_mode)
 	{
 	case rsx::primitive_type::line_loop:
-		for (unsigned i = 0; i < count; ++i)
+	{
+		static const u16 pattern[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+		static const u16 step[8] = { 8, 8, 8, 8, 8, 8, 8, 8 };
+
+		for (unsigned i = stream_index_pattern<1>(typedDst, pattern, step, count / 8) * 8; i < count; ++i)
 			typedDst[i] = i;
 		typedDst[count] = 0;
 		return;
+	}
 	case rsx::primitive_type::triangle_fan:
 	case rsx::primitive_type::polygon:
-		for (unsigned i = 0; i < (count - 2); i++)
+	{
+		// 8 triangles per repetition
+		static const u16 pattern[24] = { 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 5, 0, 5, 6, 0, 6, 7, 0, 7, 8, 0, 8, 9 };
+		static const u16 step[24] = { 0, 8, 8, 0, 8, 8, 0, 8, 8, 0, 8, 8, 0, 8, 8, 0, 8, 8, 0, 8, 8, 0, 8, 8 };
+
+		for (unsigned i = stream_index_pattern<3>(typedDst, pattern, step, (count - 2) / 8) * 8; i < (count - 2); i++)
 		{
 			typedDst[3 * i] = 0;
 			typedDst[3 * i + 1] = i + 2 - 1;
 			typedDst[3 * i + 2] = i + 2;
 		}
 		return;
+	}
 	case rsx::primitive_type::quads:
-		for (unsigned i = 0; i < count / 4; i++)
+	{
+		// 4 quads per repetition
+		static const u16 pattern[24] = { 0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4, 8, 9, 10, 10, 11, 8, 12, 13, 14, 14, 15, 12 };
+		static const u16 step[24] = { 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16 };
+
+		for (unsigned i = stream_index_pattern<3>(typedDst, pattern, step, count / 16) * 4; i < count / 4; i++)
 		{
 			// First triangle
 			typedDst[6 * i] = 4 * i;
@@ -946,6 +1222,7 @@ void write_index_array_for_non_indexed_non_native_primitive_to_buffer(char* dst,
 			typedDst[6 * i + 5] = 4 * i;
 		}
 		return;
+	}
 	case rsx::primitive_type::quad_strip:
 	case rsx::primitive_type::points:
 	case rsx::primitive_type::lines:
@@ -989,9 +1266,16 @@ namespace
 		case rsx::primitive_type::line_loop:
 		{
 			const auto &returnvalue = upload_untouched<T>(src, dst, draw_mode, restart_index_enabled, restart_index);
-			const auto index_count = dst.size_bytes() / sizeof(T);
-			dst[index_count] = src[0];
-			return returnvalue;
+			const u32 index_count = std::get<2>(returnvalue);
+
+			if (index_count == 0)
+			{
+				return returnvalue;
+			}
+
+			// Close the loop after the last written index
+			dst[index_count] = dst[0];
+			return std::make_tuple(std::get<0>(returnvalue), std::get<1>(returnvalue), index_count + 1);
 		}
 		case rsx::primitive_type::polygon:
 		case rsx::primitive_type::triangle_fan:
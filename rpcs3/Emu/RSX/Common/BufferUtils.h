@@ -35,6 +35,8 @@ u32 get_index_type_size(rsx::index_array_type type);
  * Write count indexes using (first, first + count) ranges.
  * Returns min/max index found during the process and the number of valid indices written to the buffer.
  * The function expands index buffer for non native primitive type if expands(draw_mode) return true.
+ * Expanded line loops are closed by repeating the first index after the last one, the returned count includes it:
+ * dst must hold get_index_count(draw_mode, count) indices, and the result is the number of indices to draw.
  */
 std::tuple<u32, u32, u32> write_index_array_data_to_buffer(gsl::span<gsl::byte> dst, gsl::span<const gsl::byte> src,
 	rsx::index_array_type, rsx::primitive_type draw_mode, bool restart_index_enabled, u32 restart_index,
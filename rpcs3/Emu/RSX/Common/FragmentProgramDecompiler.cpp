@@ -163,7 +163,9 @@ void FragmentProgramDecompiler::AddFlowOp(const std::string& code)
 
 void FragmentProgramDecompiler::AddCode(const std::string& code)
 {
-	main.append(m_code_level, '\t') += Format(code) + "\n";
+	main.append(m_code_level, '\t');
+	main += Format(code);
+	main += '\n';
 }
 
 std::string FragmentProgramDecompiler::GetMask()
@@ -310,6 +312,12 @@ bool FragmentProgramDecompiler::DstExpectsSca()
 
 std::string FragmentProgramDecompiler::Format(const std::string& code, bool ignore_redirects)
 {
+	if (code.find('$') == code.npos)
+	{
+		// Nothing to replace, skip building the list
+		return code;
+	}
+
 	const std::pair<std::string, std::function<std::string()>> repl_list[] =
 	{
 		{ "$$", []() -> std::string { return "$"; } },
@@ -994,6 +1002,9 @@ std::string FragmentProgramDecompiler::Decompile()
 	m_loop_count = 0;
 	m_code_level = 1;
 
+	// Roughly one line of code per instruction
+	main.reserve(m_prog.ucode_length * 4);
+
 	enum
 	{
 		FORCE_NONE,
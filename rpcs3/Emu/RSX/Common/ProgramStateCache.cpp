@@ -4,29 +4,40 @@
 
 #include <stack>
 
+#include "xxhash.h"
+
 using namespace program_hash_util;
 
 size_t vertex_program_utils::get_vertex_program_ucode_hash(const RSXVertexProgram &program)
 {
-	// 64-bit Fowler/Noll/Vo FNV-1a hash code
-	size_t hash = 0xCBF29CE484222325ULL;
+	const u32 instruction_count = ::size32(program.data) / 4;
+
+	if (instruction_count <= 512 && (program.instruction_mask << (512 - instruction_count)).count() == instruction_count)
+	{
+		// All instructions are active (always the case for programs without branches)
+		return XXH64(program.data.data(), instruction_count * 16, 0);
+	}
+
+	// Inactive instructions do not take part in the comparison and must not affect the hash
+	verify(HERE), instruction_count <= 512;
+
+	alignas(16) qword buffer[512];
 	const qword *instbuffer = (const qword*)program.data.data();
-	size_t instIndex = 0;
-	bool end = false;
-	for (unsigned i = 0; i < program.data.size() / 4; i++)
+
+	for (u32 i = 0; i < instruction_count; i++)
 	{
 		if (program.instruction_mask[i])
 		{
-			const qword inst = instbuffer[instIndex];
-			hash ^= inst.dword[0];
-			hash += (hash << 1) + (hash << 4) + (hash << 5) + (hash << 7) + (hash << 8) + (hash << 40);
-			hash ^= inst.dword[1];
-			hash += (hash << 1) + (hash << 4) + (hash << 5) + (hash << 7) + (hash << 8) + (hash << 40);
+			buffer[i] = instbuffer[i];
+		}
+		else
+		{
+			buffer[i].dword[0] = 0;
+			buffer[i].dword[1] = 0;
 		}
-
-		instIndex++;
 	}
-	return hash;
+
+	return XXH64(buffer, instruction_count * 16, 0);
 }
 
 vertex_program_utils::vertex_program_metadata vertex_program_utils::analyse_vertex_program(const u32* data, u32 entry, RSXVertexProgram& dst_prog)
@@ -246,7 +257,7 @@ vertex_program_utils::vertex_program_metadata vertex_program_utils::analyse_vert
 
 size_t vertex_program_storage_hash::operator()(const RSXVertexProgram &program) const
 {
-	size_t hash = vertex_program_utils::get_vertex_program_ucode_hash(program);
+	size_t hash = program.ucode_hash ? program.ucode_hash : vertex_program_utils::get_vertex_program_ucode_hash(program);
 	hash ^= program.output_mask;
 	hash ^= program.texture_dimensions;
 	return hash;
@@ -254,6 +265,8 @@ size_t vertex_program_storage_hash::operator()(const RSXVertexProgram &program)
 
 bool vertex_program_compare::operator()(const RSXVertexProgram &binary1, const RSXVertexProgram &binary2) const
 {
+	if (binary1.ucode_hash && binary2.ucode_hash && binary1.ucode_hash != binary2.ucode_hash)
+		return false;
 	if (binary1.output_mask != binary2.output_mask)
 		return false;
 	if (binary1.texture_dimensions != binary2.texture_dimensions)
@@ -265,6 +278,11 @@ bool vertex_program_compare::operator()(const RSXVertexProgram &binary1, const R
 	if (!binary1.skip_vertex_input_check && !binary2.skip_vertex_input_check && binary1.rsx_vertex_inputs != binary2.rsx_vertex_inputs)
 		return false;
 
+	// Fast path: identical ucode, inactive slots included
+	if (binary1.instruction_mask == binary2.instruction_mask &&
+		std::memcmp(binary1.data.data(), binary2.data.data(), binary1.data.size() * sizeof(u32)) == 0)
+		return true;
+
 	const qword *instBuffer1 = (const qword*)binary1.data.data();
 	const qword *instBuffer2 = (const qword*)binary2.data.data();
 	size_t instIndex = 0;
@@ -393,17 +411,17 @@ fragment_program_utils::fragment_program_metadata fragment_program_utils::analys
 
 size_t fragment_program_utils::get_fragment_program_ucode_hash(const RSXFragmentProgram& program)
 {
-	// 64-bit Fowler/Noll/Vo FNV-1a hash code
-	size_t hash = 0xCBF29CE484222325ULL;
+	// Embedded constants are skipped, so the instructions are gathered first and hashed in blocks
+	alignas(16) qword buffer[256];
+	u64 hash = 0;
+	u32 count = 0;
+
 	const qword *instbuffer = (const qword*)program.addr;
 	size_t instIndex = 0;
 	while (true)
 	{
 		const qword& inst = instbuffer[instIndex];
-		hash ^= inst.dword[0];
-		hash += (hash << 1) + (hash << 4) + (hash << 5) + (hash << 7) + (hash << 8) + (hash << 40);
-		hash ^= inst.dword[1];
-		hash += (hash << 1) + (hash << 4) + (hash << 5) + (hash << 7) + (hash << 8) + (hash << 40);
+		buffer[count++] = inst;
 		instIndex++;
 		// Skip constants
 		if (fragment_program_utils::is_constant(inst.word[1]) ||
@@ -412,15 +430,22 @@ size_t fragment_program_utils::get_fragment_program_ucode_hash(const RSXFragment
 			instIndex++;
 
 		bool end = (inst.word[0] >> 8) & 0x1;
-		if (end)
-			return hash;
+		if (end || count == std::size(buffer))
+		{
+			// Each block is chained through the seed
+			hash = XXH64(buffer, count * sizeof(qword), hash);
+			count = 0;
+
+			if (end)
+				return hash;
+		}
 	}
 	return 0;
 }
 
 size_t fragment_program_storage_hash::operator()(const RSXFragmentProgram& program) const
 {
-	size_t hash = fragment_program_utils::get_fragment_program_ucode_hash(program);
+	size_t hash = program.ucode_hash ? program.ucode_hash : fragment_program_utils::get_fragment_program_ucode_hash(program);
 	hash ^= program.ctrl;
 	hash ^= program.texture_dimensions;
 	hash ^= program.unnormalized_coords;
@@ -435,6 +460,9 @@ size_t fragment_program_storage_hash::operator()(const RSXFragmentProgram& progr
 
 bool fragment_program_compare::operator()(const RSXFragmentProgram& binary1, const RSXFragmentProgram& binary2) const
 {
+	if (binary1.ucode_hash && binary2.ucode_hash && binary1.ucode_hash != binary2.ucode_hash)
+		return false;
+
 	if (binary1.ctrl != binary2.ctrl || binary1.texture_dimensions != binary2.texture_dimensions || binary1.unnormalized_coords != binary2.unnormalized_coords ||
 		binary1.back_color_diffuse_output != binary2.back_color_diffuse_output || binary1.back_color_specular_output != binary2.back_color_specular_output ||
 		binary1.front_back_color_enabled != binary2.front_back_color_enabled ||
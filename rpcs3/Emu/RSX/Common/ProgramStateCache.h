@@ -9,6 +9,8 @@
 #include "Utilities/Log.h"
 
 #include <deque>
+#include <functional>
+#include <optional>
 
 enum class SHADER_TYPE
 {
@@ -82,6 +84,49 @@ namespace program_hash_util
 	{
 		bool operator()(const RSXFragmentProgram &binary1, const RSXFragmentProgram &binary2) const;
 	};
+
+	// Bump allocator owning the ucode copies referenced by cached fragment programs
+	class program_ucode_arena
+	{
+		static constexpr u32 block_size = 64 * 1024;
+
+		std::vector<std::unique_ptr<u8[]>> m_blocks;
+		u32 m_block_offset = block_size;
+
+	public:
+		void* store(const void* src, u32 length)
+		{
+			u8* dst;
+
+			if (length > block_size)
+			{
+				// Oversized programs get a block of their own
+				m_blocks.emplace_back(new u8[length]);
+				dst = m_blocks.back().get();
+				m_block_offset = block_size;
+			}
+			else
+			{
+				if (m_block_offset + length > block_size)
+				{
+					m_blocks.emplace_back(new u8[block_size]);
+					m_block_offset = 0;
+				}
+
+				dst = m_blocks.back().get() + m_block_offset;
+				m_block_offset = ::align(m_block_offset + length, 16);
+			}
+
+			std::memcpy(dst, src, length);
+			return dst;
+		}
+
+		void clear()
+		{
+			m_blocks.clear();
+			m_block_offset = block_size;
+		}
+	};
 }
 
 
@@ -173,6 +218,23 @@ public:
 		}
 	};
 
+	struct async_preload_task_entry
+	{
+		RSXVertexProgram vp;
+		RSXFragmentProgram fp;
+		pipeline_properties props;
+
+		std::vector<u8> tmp_cache;
+
+		async_preload_task_entry(RSXVertexProgram _V, const RSXFragmentProgram& _F, pipeline_properties _P)
+			: vp(std::move(_V)), fp(_F), props(std::move(_P))
+		{
+			tmp_cache.resize(fp.ucode_length);
+			std::memcpy(tmp_cache.data(), fp.addr, fp.ucode_length);
+			fp.addr = tmp_cache.data();
+		}
+	};
+
 protected:
 	shared_mutex m_pipeline_mutex;
 	shared_mutex m_decompiler_mutex;
@@ -181,6 +243,7 @@ protected:
 	bool m_cache_miss_flag; // Set if last lookup did not find any usable cached programs
 	bool m_program_compiled_flag; // Set if last lookup caused program to be linked
 
+	program_hash_util::program_ucode_arena m_fragment_ucode_storage; // Must outlive the fragment program keys
 	binary_to_vertex_program m_vertex_shader_cache;
 	binary_to_fragment_program m_fragment_shader_cache;
 	std::unordered_map <pipeline_key, pipeline_storage_type, pipeline_key_hash, pipeline_key_compare> m_storage;
@@ -188,6 +251,10 @@ protected:
 	std::unordered_map <pipeline_key, std::unique_ptr<async_link_task_entry>, pipeline_key_hash, pipeline_key_compare> m_link_queue;
 	std::deque<async_decompile_task_entry> m_decompile_queue;
 
+	// Pipelines from the on-disk cache built in the background, only when no pipeline requested by the game is pending
+	// Their programs are compiled by the decompiler thread as well, unless another pipeline already needed them
+	std::deque<async_preload_task_entry> m_preload_queue;
+
 	vertex_program_type __null_vertex_program;
 	fragment_program_type __null_fragment_program;
 	pipeline_storage_type __null_pipeline_handle;
@@ -228,17 +295,48 @@ protected:
 		}
 
 		LOG_NOTICE(RSX, "FP not found in buffer!");
-		void* fragment_program_ucode_copy = malloc(rsx_fp.ucode_length);
-		std::memcpy(fragment_program_ucode_copy, rsx_fp.addr, rsx_fp.ucode_length);
 		RSXFragmentProgram new_fp_key = rsx_fp;
-		new_fp_key.addr = fragment_program_ucode_copy;
+		new_fp_key.addr = m_fragment_ucode_storage.store(rsx_fp.addr, rsx_fp.ucode_length);
 		fragment_program_type &new_shader = m_fragment_shader_cache[new_fp_key];
 		backend_traits::recompile_fragment_program(rsx_fp, new_shader, m_next_id++);
 
 		return std::forward_as_tuple(new_shader, false);
 	}
 
+	// Create the cache entries of the programs which are not cached yet, and add the jobs compiling them.
+	// Entries and ids are allocated here, so the jobs are independent and can run on any thread without locking.
+	// The entries must not be looked up before all jobs have completed.
+	void add_program_compile_jobs(const RSXVertexProgram& rsx_vp, const RSXFragmentProgram& rsx_fp, std::vector<std::function<void()>>& jobs)
+	{
+		if (auto [I, inserted] = m_vertex_shader_cache.try_emplace(rsx_vp); inserted)
+		{
+			jobs.emplace_back([&key = I->first, &shader = I->second, id = m_next_id++]()
+			{
+				backend_traits::recompile_vertex_program(key, shader, id);
+			});
+		}
+
+		if (m_fragment_shader_cache.find(rsx_fp) == m_fragment_shader_cache.end())
+		{
+			RSXFragmentProgram new_fp_key = rsx_fp;
+			new_fp_key.addr = m_fragment_ucode_storage.store(rsx_fp.addr, rsx_fp.ucode_length);
+
+			const auto I = m_fragment_shader_cache.try_emplace(new_fp_key).first;
+
+			jobs.emplace_back([&key = I->first, &shader = I->second, id = m_next_id++]()
+			{
+				backend_traits::recompile_fragment_program(key, shader, id);
+			});
+		}
+	}
+
 public:
+	// Queue a pipeline and its programs to be built in the background by async_update
+	void add_preload_pipeline(const RSXVertexProgram& rsx_vp, const RSXFragmentProgram& rsx_fp, pipeline_properties props)
+	{
+		std::lock_guard lock(m_pipeline_mutex);
+		m_preload_queue.emplace_back(rsx_vp, rsx_fp, std::move(props));
+	}
 
 	struct program_buffer_patch_entry
 	{
@@ -310,13 +408,6 @@ public:
 
 public:
 	program_state_cache() = default;
-	~program_state_cache()
-	{
-		for (auto& pair : m_fragment_shader_cache)
-		{
-			free(pair.first.addr);
-		}
-	}
 
 	const vertex_program_type& get_transform_program(const RSXVertexProgram& rsx_vp) const
 	{
@@ -372,6 +463,8 @@ public:
 			}
 		}
 
+		std::optional<async_preload_task_entry> preload_task;
+		std::unique_ptr<async_link_task_entry> preload_entry;
 		async_link_task_entry* link_entry;
 		pipeline_key key;
 		{
@@ -382,20 +475,63 @@ public:
 				link_entry = It->second.get();
 				key = It->first;
 			}
+			else if (!m_preload_queue.empty())
+			{
+				// Take the entry out of the queue, clear() may empty it while the pipeline is built
+				lock.upgrade();
+
+				if (m_preload_queue.empty())
+				{
+					return { busy, false };
+				}
+
+				preload_task.emplace(std::move(m_preload_queue.front()));
+				m_preload_queue.pop_front();
+			}
 			else
 			{
 				return { busy, false };
 			}
 		}
 
+		if (preload_task)
+		{
+			{
+				// Compile the programs no other pipeline needed yet
+				std::lock_guard lock(m_decompiler_mutex);
+				const auto& vertex_program = std::get<0>(search_vertex_program(preload_task->vp));
+				const auto& fragment_program = std::get<0>(search_fragment_program(preload_task->fp));
+
+				backend_traits::validate_pipeline_properties(vertex_program, fragment_program, preload_task->props);
+				preload_entry = std::make_unique<async_link_task_entry>(vertex_program, fragment_program, preload_task->props);
+			}
+
+			link_entry = preload_entry.get();
+			key = { link_entry->vp.id, link_entry->fp.id, link_entry->props };
+
+			reader_lock lock(m_pipeline_mutex);
+
+			if (m_storage.find(key) != m_storage.end())
+			{
+				// Already built on request of the game
+				return { true, false };
+			}
+		}
+
 		pipeline_storage_type pipeline = backend_traits::build_pipeline(link_entry->vp, link_entry->fp, link_entry->props, std::forward<Args>(args)...);
 		LOG_SUCCESS(RSX, "New program compiled successfully");
 
 		std::lock_guard lock(m_pipeline_mutex);
-		m_storage[key] = std::move(pipeline);
-		m_link_queue.erase(key);
 
-		return { (busy || !m_link_queue.empty()), true };
+		// Never replace a pipeline, the renderer may be using it
+		m_storage.try_emplace(key, std::move(pipeline));
+
+		if (!preload_entry)
+		{
+			m_link_queue.erase(key);
+		}
+
+		return { (busy || !m_link_queue.empty() || !m_preload_queue.empty()), true };
 	}
 
 	template<typename... Args>
@@ -425,11 +561,16 @@ public:
 			backend_traits::validate_pipeline_properties(vertex_program, fragment_program, pipelineProperties);
 			pipeline_key key = { vertex_program.id, fragment_program.id, pipelineProperties };
 
-			const auto I = m_storage.find(key);
-			if (I != m_storage.end())
 			{
-				m_cache_miss_flag = false;
-				return I->second;
+				// Pipelines may be inserted by the decompiler thread at any time
+				reader_lock lock(m_pipeline_mutex);
+
+				const auto I = m_storage.find(key);
+				if (I != m_storage.end())
+				{
+					m_cache_miss_flag = false;
+					return I->second;
+				}
 			}
 
 			if (allow_async)
@@ -444,7 +585,7 @@ public:
 
 				pipeline_storage_type pipeline = backend_traits::build_pipeline(vertex_program, fragment_program, pipelineProperties, std::forward<Args>(args)...);
 				std::lock_guard lock(m_pipeline_mutex);
-				auto &rtn = m_storage[key] = std::move(pipeline);
+				auto &rtn = m_storage.try_emplace(key, std::move(pipeline)).first->second;
 				LOG_SUCCESS(RSX, "New program compiled successfully");
 				return rtn;
 			}
@@ -575,6 +716,10 @@ public:
 
 	void clear()
 	{
+		// The decompiler thread may still be taking pipelines from the preload queue
+		std::lock_guard lock(m_pipeline_mutex);
+
 		m_storage.clear();
+		m_preload_queue.clear();
 	}
 };
@@ -3,6 +3,9 @@
 #include "TextureUtils.h"
 #include "../RSXThread.h"
 #include "../rsx_utils.h"
+#include "Emu/IdManager.h"
+#include "Utilities/sysinfo.h"
+#include "Utilities/task_pool.h"
 
 namespace
 {
@@ -20,6 +23,35 @@ namespace
 		return{ (T*)unformated_span.data(), ::narrow<int>(unformated_span.size_bytes() / sizeof(T)) };
 	}
 
+	// Byteswap count 16 or 32-bit words
+	template <typename T>
+	void copy_swapped(void* dst, const void* src, u32 count)
+	{
+		static_assert(sizeof(T) == 2 || sizeof(T) == 4, "Unsupported word size");
+
+		u32 done = 0;
+
+#if defined(_MSC_VER) || defined(__SSSE3__)
+		if (s_use_ssse3)
+		{
+			const __m128i mask = sizeof(T) == 2
+				? _mm_set_epi8(0xE, 0xF, 0xC, 0xD, 0xA, 0xB, 0x8, 0x9, 0x6, 0x7, 0x4, 0x5, 0x2, 0x3, 0x0, 0x1)
+				: _mm_set_epi8(0xC, 0xD, 0xE, 0xF, 0x8, 0x9, 0xA, 0xB, 0x4, 0x5, 0x6, 0x7, 0x0, 0x1, 0x2, 0x3);
+
+			for (; done + 16 / sizeof(T) <= count; done += 16 / sizeof(T))
+			{
+				const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const T*>(src) + done));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(static_cast<T*>(dst) + done), _mm_shuffle_epi8(value, mask));
+			}
+		}
+#endif
+
+		for (; done < count; ++done)
+		{
+			static_cast<T*>(dst)[done] = se_storage<T>::swap(static_cast<const T*>(src)[done]);
+		}
+	}
+
 	// TODO: Make this function part of GSL
 	// Note: Doesn't handle overlapping range detection.
 	template<typename T1, typename T2>
@@ -29,6 +61,12 @@ namespace
 		{
 			std::memcpy(dst.data(), src.data(), src.size_bytes());
 		}
+		else if constexpr ((std::is_same<T1, u16>::value && std::is_same<std::remove_cv_t<T2>, be_t<u16>>::value) ||
+			(std::is_same<T1, u32>::value && std::is_same<std::remove_cv_t<T2>, be_t<u32>>::value))
+		{
+			verify(HERE), (dst.size() == src.size());
+			copy_swapped<T1>(dst.data(), src.data(), ::size32(src));
+		}
 		else
 		{
 			static_assert(std::is_convertible<T1, T2>::value, "Cannot convert source and destination span type.");
@@ -391,6 +429,149 @@ std::vector<rsx_subresource_layout> get_subresources_layout(const rsx::vertex_te
 	return get_subresources_layout_impl(texture);
 }
 
+namespace
+{
+	// Worker threads decoding large texture uploads
+	struct texture_decode_pool : utils::task_pool
+	{
+		static u32 get_thread_count()
+		{
+			// The RSX thread helps while waiting, leave the other threads to the emulated cores
+			return std::clamp<u32>(std::thread::hardware_concurrency() / 4, 1, 4);
+		}
+
+		texture_decode_pool()
+			: task_pool("Texture Decoder", get_thread_count())
+		{
+		}
+	};
+
+	// Smaller uploads are decoded on the calling thread
+	constexpr u32 s_parallel_upload_threshold = 512 * 1024;
+
+	// Approximate amount of data decoded by a single task
+	constexpr u32 s_upload_band_size = 256 * 1024;
+
+	// Formats whose rows can be decoded independently when the texture is linear
+	bool supports_row_split(int format)
+	{
+		switch (format)
+		{
+		case CELL_GCM_TEXTURE_COMPRESSED_B8R8_G8R8:
+		case CELL_GCM_TEXTURE_COMPRESSED_R8B8_R8G8:
+			// Source and destination block sizes differ
+			return false;
+		default:
+			return true;
+		}
+	}
+}
+
+texture_upload_batch::texture_upload_batch(const std::vector<rsx_subresource_layout>& layouts, int format, bool is_swizzled, bool vtc_support, size_t dst_row_pitch_multiple_of)
+	: m_layouts(layouts)
+	, m_format(format)
+	, m_is_swizzled(is_swizzled)
+	, m_vtc_support(vtc_support)
+	, m_dst_row_pitch_multiple_of(dst_row_pitch_multiple_of)
+	, m_groups(layouts.size())
+{
+	size_t total_size = 0;
+
+	for (const auto& layout : layouts)
+	{
+		total_size += layout.data.size_bytes();
+	}
+
+	if (total_size >= s_parallel_upload_threshold)
+	{
+		m_pool = fxm::get_always<texture_decode_pool>();
+	}
+}
+
+texture_upload_batch::~texture_upload_batch()
+{
+	// The tasks write to buffers owned by the caller
+	for (u32 i = 0; i < m_groups.size(); i++)
+	{
+		try
+		{
+			wait(i);
+		}
+		catch (const std::exception& e)
+		{
+			LOG_ERROR(RSX, "Texture decoding failed: %s", e.what());
+		}
+	}
+}
+
+void texture_upload_batch::decode(u32 index, gsl::span<gsl::byte> dst_buffer)
+{
+	const auto& layout = m_layouts[index];
+
+	if (!m_pool)
+	{
+		upload_texture_subresource(dst_buffer, layout, m_format, m_is_swizzled, m_vtc_support, m_dst_row_pitch_multiple_of);
+		return;
+	}
+
+	verify(HERE), !m_groups[index];
+	m_groups[index] = std::make_unique<utils::task_group>();
+	auto& group = *m_groups[index];
+
+	const int format = m_format;
+	const bool is_swizzled = m_is_swizzled;
+	const bool vtc_support = m_vtc_support;
+	const size_t dst_row_pitch_multiple_of = m_dst_row_pitch_multiple_of;
+
+	if (is_swizzled || layout.depth > 1 || layout.width_in_block > layout.pitch_in_block || layout.data.size_bytes() <= s_upload_band_size || !supports_row_split(format))
+	{
+		// Swizzled and volume data is decoded as a whole
+		m_pool->push(group, [=]()
+		{
+			upload_texture_subresource(dst_buffer, layout, format, is_swizzled, vtc_support, dst_row_pitch_multiple_of);
+		});
+
+		return;
+	}
+
+	// Split linear images into bands of rows
+	const u8 block_size = get_format_block_size_in_bytes(format);
+	const u32 src_row_size = layout.pitch_in_block * block_size;
+	const u32 dst_row_size = get_row_pitch_in_block(block_size, layout.width_in_block, dst_row_pitch_multiple_of) * block_size;
+	const u32 band_rows = std::max<u32>(s_upload_band_size / src_row_size, 1);
+
+	for (u32 row = 0; row < layout.height_in_block; row += band_rows)
+	{
+		rsx_subresource_layout band = layout;
+		band.height_in_block = static_cast<u16>(std::min<u32>(band_rows, layout.height_in_block - row));
+		band.data = layout.data.subspan(row * src_row_size, band.height_in_block * src_row_size);
+
+		const auto band_dst = dst_buffer.subspan(row * dst_row_size);
+
+		m_pool->push(group, [=]()
+		{
+			upload_texture_subresource(band_dst, band, format, is_swizzled, vtc_support, dst_row_pitch_multiple_of);
+		});
+	}
+}
+
+void texture_upload_batch::wait(u32 index)
+{
+	if (const auto group = std::move(m_groups[index]))
+	{
+		// Help with the decoding
+		m_pool->wait(*group);
+	}
+}
+
+void texture_upload_batch::wait()
+{
+	for (u32 i = 0; i < m_groups.size(); i++)
+	{
+		wait(i);
+	}
+}
+
 void upload_texture_subresource(gsl::span<gsl::byte> dst_buffer, const rsx_subresource_layout &src_layout, int format, bool is_swizzled, bool vtc_support, size_t dst_row_pitch_multiple_of)
 {
 	u16 w = src_layout.width_in_block;
@@ -3,8 +3,15 @@
 #include "../RSXTexture.h"
 
 #include <vector>
+#include <memory>
 #include "Utilities/GSL.h"
 
+namespace utils
+{
+	class task_pool;
+	class task_group;
+}
+
 namespace rsx
 {
 	enum texture_upload_context : u32
@@ -118,6 +125,42 @@ std::vector<rsx_subresource_layout> get_subresources_layout(const rsx::vertex_te
 
 void upload_texture_subresource(gsl::span<gsl::byte> dst_buffer, const rsx_subresource_layout &src_layout, int format, bool is_swizzled, bool vtc_support, size_t dst_row_pitch_multiple_of);
 
+/**
+ * Decoding of the subresources of a texture upload.
+ * Large uploads are split across worker threads, every subresource can be waited for separately.
+ * The layouts and the destination buffers must outlive the batch, the destructor waits for all subresources.
+ */
+class texture_upload_batch
+{
+	const std::vector<rsx_subresource_layout>& m_layouts;
+	const int m_format;
+	const bool m_is_swizzled;
+	const bool m_vtc_support;
+	const size_t m_dst_row_pitch_multiple_of;
+
+	// Null if the upload is small enough to be decoded on the calling thread
+	std::shared_ptr<utils::task_pool> m_pool;
+
+	// Pending decoding of every subresource
+	std::vector<std::unique_ptr<utils::task_group>> m_groups;
+
+public:
+	texture_upload_batch(const std::vector<rsx_subresource_layout>& layouts, int format, bool is_swizzled, bool vtc_support, size_t dst_row_pitch_multiple_of);
+
+	texture_upload_batch(const texture_upload_batch&) = delete;
+
+	~texture_upload_batch();
+
+	// Start decoding subresource to the destination (may decode immediately)
+	void decode(u32 index, gsl::span<gsl::byte> dst_buffer);
+
+	// Wait for the subresource, rethrows decoding errors
+	void wait(u32 index);
+
+	// Wait for all subresources
+	void wait();
+};
+
 u8 get_format_block_size_in_bytes(int format);
 u8 get_format_block_size_in_texel(int format);
 u8 get_format_block_size_in_bytes(rsx::surface_color_format format);
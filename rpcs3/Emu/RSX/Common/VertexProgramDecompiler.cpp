@@ -223,6 +223,12 @@ std::string VertexProgramDecompiler::GetTex()
 
 std::string VertexProgramDecompiler::Format(const std::string& code)
 {
+	if (code.find('$') == code.npos)
+	{
+		// Nothing to replace, skip building the list
+		return code;
+	}
+
 	const std::pair<std::string, std::function<std::string()>> repl_list[] =
 	{
 		{ "$$", []() -> std::string { return "$"; } },
@@ -333,7 +339,6 @@ u32 VertexProgramDecompiler::GetAddr()
 
 void VertexProgramDecompiler::AddCode(const std::string& code)
 {
-	m_body.push_back(Format(code) + ";");
 	m_cur_instr->body.push_back(Format(code));
 }
 
@@ -355,6 +360,8 @@ std::string VertexProgramDecompiler::NotZeroPositive(const std::string& code)
 std::string VertexProgramDecompiler::BuildCode()
 {
 	std::string main_body;
+	main_body.reserve(m_instr_count * 64);
+
 	for (uint i = 0, lvl = 1; i < m_instr_count; i++)
 	{
 		lvl -= m_instructions[i].close_scopes;
@@ -375,7 +382,8 @@ std::string VertexProgramDecompiler::BuildCode()
 
 		for (const auto& instruction_body : m_instructions[i].body)
 		{
-			main_body.append(lvl, '\t') += instruction_body + "\n";
+			main_body.append(lvl, '\t') += instruction_body;
+			main_body += '\n';
 		}
 
 		lvl += m_instructions[i].open_scopes;
@@ -760,8 +768,5 @@ std::string VertexProgramDecompiler::Decompile()
 		AddCode("}");
 	}
 
-	std::string result = BuildCode();
-
-	m_body.clear();
-	return result;
+	return BuildCode();
 }
@@ -60,7 +60,6 @@ struct VertexProgramDecompiler
 	Instruction* m_cur_instr;
 	size_t m_instr_count;
 
-	std::vector<std::string> m_body;
 	std::stack<u32> m_call_stack;
 
 	const RSXVertexProgram& m_prog;
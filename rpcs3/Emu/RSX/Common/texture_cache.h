@@ -335,11 +335,21 @@ namespace rsx
 		//Memory usage
 		const u32 m_max_zombie_objects = 64; //Limit on how many texture objects to keep around for reuse after they are invalidated
 
+		//Eviction
+		u64 m_frame_index = 0;
+		static const u32 m_min_eviction_age = 2; // Sections sampled within this many frames are never evicted
+
 		//Other statistics
 		std::atomic<u32> m_flushes_this_frame = { 0 };
 		std::atomic<u32> m_misses_this_frame  = { 0 };
 		std::atomic<u32> m_speculations_this_frame = { 0 };
 		std::atomic<u32> m_unavoidable_hard_faults_this_frame = { 0 };
+		std::atomic<u32> m_hits_this_frame = { 0 };
+		std::atomic<u32> m_uploads_this_frame = { 0 };
+		std::atomic<u32> m_evictions_this_frame = { 0 };
+		std::atomic<u64> m_total_hits = { 0 };
+		std::atomic<u64> m_total_uploads = { 0 };
+		std::atomic<u64> m_total_evictions = { 0 };
 		static const u32 m_predict_max_flushes_per_frame = 50; // Above this number the predictions are disabled
 
 		// Invalidation
@@ -1023,6 +1033,104 @@ namespace rsx
 			m_temporary_subresource_cache.clear();
 			m_predictor.on_frame_end();
 			reset_frame_statistics();
+
+			// Evictions are reported with the statistics of the next frame
+			enforce_memory_budget();
+			m_frame_index++;
+		}
+
+		u64 get_frame_index() const
+		{
+			return m_frame_index;
+		}
+
+		/**
+		 * Evicts cold shader_read sections until the texture memory in use fits the configured budget.
+		 * Only sections whose data can be re-uploaded from guest memory are considered; sections sampled
+		 * recently or expected to be read back by the predictor are kept.
+		 */
+		void enforce_memory_budget()
+		{
+			const u64 budget = u64{g_cfg.video.texture_cache_budget} * 0x100000;
+			if (budget == 0 || m_storage.m_texture_memory_in_use <= budget)
+			{
+				return;
+			}
+
+			std::lock_guard lock(m_cache_mutex);
+
+			// Zombie objects go first
+			m_storage.purge_unreleased_sections();
+
+			if (m_storage.m_texture_memory_in_use <= budget)
+			{
+				return;
+			}
+
+			// Leave some headroom to avoid evicting again on the next frame
+			const u64 target = budget - (budget / 8);
+
+			// Cold sections are evicted first, frequently sampled ones age slower
+			std::vector<std::pair<u64, section_storage_type*>> candidates;
+			m_storage.for_each_section_in_use([&](section_storage_type& tex)
+			{
+				if (!tex.exists() || tex.is_dirty() ||
+					tex.get_context() != rsx::texture_upload_context::shader_read ||
+					tex.get_memory_read_flags() == rsx::memory_read_flags::flush_always)
+				{
+					return;
+				}
+
+				const u64 age = m_frame_index - tex.last_access_frame;
+				if (age < m_min_eviction_age || m_predictor.predict(tex))
+				{
+					return;
+				}
+
+				const u64 score = (age << 4) / (std::min(tex.access_count, 15u) + 1);
+				candidates.emplace_back(score, &tex);
+			});
+
+			std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b)
+			{
+				return a.first > b.first;
+			});
+
+			u64 memory_in_use = m_storage.m_texture_memory_in_use;
+			u32 evicted = 0;
+
+			for (const auto& candidate : candidates)
+			{
+				if (memory_in_use <= target)
+				{
+					break;
+				}
+
+				auto &tex = *candidate.second;
+				if (tex.is_locked())
+				{
+					tex.discard(/* set_dirty */ true);
+				}
+				else
+				{
+					tex.set_dirty(true);
+				}
+
+				// Release what was accounted for the section, not its current size
+				memory_in_use -= std::min<u64>(memory_in_use, tex.get_memory_usage());
+				evicted++;
+			}
+
+			if (evicted)
+			{
+				m_storage.purge_unreleased_sections();
+
+				// Sampler descriptors may still reference the evicted views
+				update_cache_tag();
+
+				m_evictions_this_frame += evicted;
+				m_total_evictions += evicted;
+			}
 		}
 
 		template <bool check_unlocked = false>
@@ -1057,14 +1165,10 @@ namespace rsx
 		template <bool check_unlocked = false>
 		section_storage_type *find_texture_from_dimensions(u32 rsx_address, u32 format, u16 width = 0, u16 height = 0, u16 depth = 0, u16 mipmaps = 0)
 		{
-			auto &block = m_storage.block_for(rsx_address);
-			for (auto &tex : block)
+			const auto test_range = address_range::start_length(rsx_address, 1);
+			for (auto It = m_storage.range_begin(test_range, full_range, check_unlocked); It != m_storage.range_end(); It++)
 			{
-				if constexpr (check_unlocked)
-				{
-					if (!tex.is_locked())
-						continue;
-				}
+				auto &tex = *It;
 
 				if (!tex.is_dirty() && tex.matches(rsx_address, format, width, height, depth, mipmaps))
 				{
@@ -2041,6 +2145,7 @@ namespace rsx
 				// Most mesh textures are stored as compressed to make the most of the limited memory
 				if (auto cached_texture = find_texture_from_dimensions(texaddr, format, tex_width, tex_height, depth))
 				{
+					on_texture_hit(*cached_texture);
 					return{ cached_texture->get_view(tex.remap(), tex.decoded_remap()), cached_texture->get_context(), cached_texture->is_depth_texture(), scale_x, scale_y, cached_texture->get_image_type() };
 				}
 			}
@@ -2067,6 +2172,7 @@ namespace rsx
 				{
 					if (cached_texture->matches(texaddr, format, tex_width, tex_height, depth, 0))
 					{
+						on_texture_hit(*cached_texture);
 						return{ cached_texture->get_view(tex.remap(), tex.decoded_remap()), cached_texture->get_context(), cached_texture->is_depth_texture(), scale_x, scale_y, cached_texture->get_image_type() };
 					}
 				}
@@ -2257,6 +2363,9 @@ namespace rsx
 			//Invalidate
 			invalidate_range_impl_base(cmd, tex_range, invalidation_cause::read, std::forward<Args>(extras)...);
 
+			m_uploads_this_frame++;
+			m_total_uploads++;
+
 			//NOTE: SRGB correction is to be handled in the fragment shader; upload as linear RGB
 			return{ upload_image_from_cpu(cmd, tex_range, tex_width, tex_height, depth, tex.get_exact_mipmap_count(), tex_pitch, format,
 				texture_upload_context::shader_read, subresources_layout, extended_dimension, is_swizzled)->get_view(tex.remap(), tex.decoded_remap()),
@@ -2985,6 +3094,16 @@ namespace rsx
 			m_misses_this_frame.store(0u);
 			m_speculations_this_frame.store(0u);
 			m_unavoidable_hard_faults_this_frame.store(0u);
+			m_hits_this_frame.store(0u);
+			m_uploads_this_frame.store(0u);
+			m_evictions_this_frame.store(0u);
+		}
+
+		void on_texture_hit(section_storage_type& section)
+		{
+			section.on_access(m_frame_index);
+			m_hits_this_frame++;
+			m_total_hits++;
 		}
 
 		void on_flush()
@@ -3047,6 +3166,36 @@ namespace rsx
 			return m_unavoidable_hard_faults_this_frame;
 		}
 
+		u32 get_num_texture_hits() const
+		{
+			return m_hits_this_frame;
+		}
+
+		u32 get_num_texture_uploads() const
+		{
+			return m_uploads_this_frame;
+		}
+
+		u32 get_num_evictions() const
+		{
+			return m_evictions_this_frame;
+		}
+
+		u64 get_total_texture_hits() const
+		{
+			return m_total_hits;
+		}
+
+		u64 get_total_texture_uploads() const
+		{
+			return m_total_uploads;
+		}
+
+		u64 get_total_evictions() const
+		{
+			return m_total_evictions;
+		}
+
 		f32 get_cache_miss_ratio() const
 		{
 			const auto num_flushes = m_flushes_this_frame.load();
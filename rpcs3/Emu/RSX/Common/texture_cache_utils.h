@@ -293,6 +293,273 @@ namespace rsx
 	};
 
 
+	/**
+	 * Interval index used in Ranged Storage Blocks
+	 * AVL tree of address ranges ordered by start address, every node also stores the highest end address of its subtree
+	 * (overlap queries visit O(log n + k) nodes instead of every section of the block)
+	 */
+	template <typename section_storage_type>
+	class ranged_storage_block_index
+	{
+	public:
+		using value_type = section_storage_type;
+		using size_type = u32;
+
+		static constexpr u32 nil = UINT32_MAX;
+		static constexpr u32 max_height = 48; // An AVL tree with 2^32 nodes is at most 46 levels high
+
+		// Query state, nodes are visited in ascending start address order
+		struct cursor
+		{
+			std::array<u32, max_height> stack;
+			u32 depth = 0;
+		};
+
+	private:
+		struct node
+		{
+			u32 start;
+			u32 end;
+			u32 max_end;
+			u32 left;
+			u32 right;
+			u32 height;
+			value_type *value;
+		};
+
+		std::vector<node> m_nodes;
+		std::vector<u32> m_free;
+		u32 m_root = nil;
+		size_type m_size = 0;
+
+		// Nodes are ordered by start address, then by value to make keys unique
+		inline bool less(u32 start, const value_type *value, const node &n) const
+		{
+			return start < n.start || (start == n.start && value < n.value);
+		}
+
+		inline u32 height(u32 n) const
+		{
+			return n == nil ? 0 : m_nodes[n].height;
+		}
+
+		inline void update(u32 n)
+		{
+			auto &_node = m_nodes[n];
+			_node.height = 1 + std::max(height(_node.left), height(_node.right));
+			_node.max_end = _node.end;
+
+			if (_node.left != nil)
+				_node.max_end = std::max(_node.max_end, m_nodes[_node.left].max_end);
+
+			if (_node.right != nil)
+				_node.max_end = std::max(_node.max_end, m_nodes[_node.right].max_end);
+		}
+
+		u32 rotate_left(u32 n)
+		{
+			const u32 r = m_nodes[n].right;
+			m_nodes[n].right = m_nodes[r].left;
+			m_nodes[r].left = n;
+			update(n);
+			update(r);
+			return r;
+		}
+
+		u32 rotate_right(u32 n)
+		{
+			const u32 l = m_nodes[n].left;
+			m_nodes[n].left = m_nodes[l].right;
+			m_nodes[l].right = n;
+			update(n);
+			update(l);
+			return l;
+		}
+
+		u32 balance(u32 n)
+		{
+			update(n);
+
+			auto &_node = m_nodes[n];
+			const s32 factor = s32(height(_node.left)) - s32(height(_node.right));
+
+			if (factor > 1)
+			{
+				const auto &l = m_nodes[_node.left];
+				if (height(l.left) < height(l.right))
+				{
+					_node.left = rotate_left(_node.left);
+				}
+
+				return rotate_right(n);
+			}
+
+			if (factor < -1)
+			{
+				const auto &r = m_nodes[_node.right];
+				if (height(r.right) < height(r.left))
+				{
+					_node.right = rotate_right(_node.right);
+				}
+
+				return rotate_left(n);
+			}
+
+			return n;
+		}
+
+		u32 insert_node(u32 n, u32 new_node)
+		{
+			if (n == nil)
+				return new_node;
+
+			const auto &_new = m_nodes[new_node];
+			if (less(_new.start, _new.value, m_nodes[n]))
+			{
+				m_nodes[n].left = insert_node(m_nodes[n].left, new_node);
+			}
+			else
+			{
+				m_nodes[n].right = insert_node(m_nodes[n].right, new_node);
+			}
+
+			return balance(n);
+		}
+
+		u32 remove_min(u32 n, u32 &min_node)
+		{
+			if (m_nodes[n].left == nil)
+			{
+				min_node = n;
+				return m_nodes[n].right;
+			}
+
+			m_nodes[n].left = remove_min(m_nodes[n].left, min_node);
+			return balance(n);
+		}
+
+		u32 erase_node(u32 n, u32 start, const value_type *value)
+		{
+			verify(HERE), n != nil;
+
+			auto &_node = m_nodes[n];
+			if (start == _node.start && value == _node.value)
+			{
+				const u32 left = _node.left;
+				const u32 right = _node.right;
+
+				m_free.push_back(n);
+				m_size--;
+
+				if (right == nil)
+					return left;
+
+				u32 successor;
+				const u32 new_right = remove_min(right, successor);
+				m_nodes[successor].left = left;
+				m_nodes[successor].right = new_right;
+				return balance(successor);
+			}
+
+			if (less(start, value, _node))
+			{
+				_node.left = erase_node(_node.left, start, value);
+			}
+			else
+			{
+				_node.right = erase_node(_node.right, start, value);
+			}
+
+			return balance(n);
+		}
+
+		inline void push_left(cursor &c, u32 n, u32 range_start) const
+		{
+			// Subtrees ending before the range are skipped entirely
+			while (n != nil && m_nodes[n].max_end >= range_start)
+			{
+				AUDIT(c.depth < max_height);
+				c.stack[c.depth++] = n;
+				n = m_nodes[n].left;
+			}
+		}
+
+	public:
+		ranged_storage_block_index() = default;
+
+		inline size_type size() const { return m_size; }
+		inline bool empty() const { return m_size == 0; }
+
+		void clear()
+		{
+			m_nodes.clear();
+			m_free.clear();
+			m_root = nil;
+			m_size = 0;
+		}
+
+		void insert(const address_range &range, value_type *value)
+		{
+			AUDIT(range.valid());
+
+			u32 n;
+			if (m_free.empty())
+			{
+				n = ::size32(m_nodes);
+				m_nodes.emplace_back();
+			}
+			else
+			{
+				n = m_free.back();
+				m_free.pop_back();
+			}
+
+			m_nodes[n] = { range.start, range.end, range.end, nil, nil, 1, value };
+			m_root = insert_node(m_root, n);
+			m_size++;
+		}
+
+		void erase(const address_range &range, const value_type *value)
+		{
+			AUDIT(range.valid());
+			m_root = erase_node(m_root, range.start, value);
+		}
+
+		// Returns the first value whose range overlaps the given range
+		value_type* query_begin(cursor &c, const address_range &range) const
+		{
+			c.depth = 0;
+			push_left(c, m_root, range.start);
+			return query_next(c, range);
+		}
+
+		// Returns the next overlapping value, the end of the range may grow between calls
+		value_type* query_next(cursor &c, const address_range &range) const
+		{
+			while (c.depth > 0)
+			{
+				const auto &_node = m_nodes[c.stack[--c.depth]];
+
+				if (_node.start > range.end)
+				{
+					// Every remaining node starts after the range
+					c.depth = 0;
+					break;
+				}
+
+				push_left(c, _node.right, range.start);
+
+				if (_node.end >= range.start)
+				{
+					return _node.value;
+				}
+			}
+
+			return nullptr;
+		}
+	};
+
+
 	/**
 	 * Ranged storage
 	 */
@@ -311,6 +578,9 @@ namespace rsx
 
 		using size_type = typename block_container_type::size_type;
 
+		using index_type = ranged_storage_block_index<section_storage_type>;
+		using index_cursor = typename index_type::cursor;
+
 		static constexpr u32 num_blocks = ranged_storage_type::num_blocks;
 		static constexpr u32 block_size = ranged_storage_type::block_size;
 
@@ -322,6 +592,7 @@ namespace rsx
 		u32 index = 0;
 		address_range range = {};
 		block_container_type sections = {};
+		index_type section_index; // owned sections with a valid range, keyed by their page range
 		unowned_container_type unowned; // pointers to sections from other blocks that overlap this block
 		std::atomic<u32> exists_count = 0;
 		std::atomic<u32> locked_count = 0;
@@ -411,6 +682,7 @@ namespace rsx
 			AUDIT(unreleased_count == 0);
 			AUDIT(locked_count == 0);
 			sections.clear();
+			section_index.clear();
 		}
 
 		inline bool is_first_block() const
@@ -465,6 +737,7 @@ namespace rsx
 		{
 			AUDIT(section.valid_range());
 			AUDIT(range.overlaps(section.get_section_base()));
+			section_index.insert(section.get_section_range().to_page_range(), &section);
 			add_owned_section_overlaps(section);
 		}
 
@@ -472,6 +745,7 @@ namespace rsx
 		{
 			AUDIT(section.valid_range());
 			AUDIT(range.overlaps(section.get_section_base()));
+			section_index.erase(section.get_section_range().to_page_range(), &section);
 			remove_owned_section_overlaps(section);
 		}
 
@@ -543,6 +817,19 @@ namespace rsx
 		inline unowned_iterator unowned_end() { return unowned.end(); }
 		inline unowned_const_iterator unowned_end() const { return unowned.end(); }
 		inline bool unowned_empty() const { return unowned.empty(); }
+
+		/**
+		 * Owned sections overlapping a range
+		 */
+		inline section_storage_type* index_begin(index_cursor &cursor, const address_range &_range) const
+		{
+			return section_index.query_begin(cursor, _range);
+		}
+
+		inline section_storage_type* index_next(index_cursor &cursor, const address_range &_range) const
+		{
+			return section_index.query_next(cursor, _range);
+		}
 	};
 
 
@@ -681,6 +968,18 @@ namespace rsx
 			AUDIT(m_unreleased_texture_objects == 0);
 		}
 
+		template <typename F>
+		void for_each_section_in_use(F&& func)
+		{
+			for (auto *block : m_in_use)
+			{
+				for (auto &tex : *block)
+				{
+					func(tex);
+				}
+			}
+		}
+
 
 		/**
 		 * Callbacks
@@ -698,12 +997,12 @@ namespace rsx
 
 		void on_section_resources_created(const section_storage_type &section)
 		{
-			m_texture_memory_in_use += section.get_section_size();
+			m_texture_memory_in_use += section.get_memory_usage();
 		}
 
 		void on_section_resources_destroyed(const section_storage_type &section)
 		{
-			u64 size = section.get_section_size();
+			u64 size = section.get_memory_usage();
 			u64 prev_size = m_texture_memory_in_use.fetch_sub(size);
 			ASSERT(prev_size >= size);
 		}
@@ -728,7 +1027,7 @@ namespace rsx
 		 * Ranged Iterator
 		 */
 		 // Iterator
-		template <typename T, typename unowned_iterator, typename section_iterator, typename block_type, typename parent_type>
+		template <typename T, typename unowned_iterator, typename block_type, typename parent_type>
 		class range_iterator_tmpl
 		{
 		public:
@@ -747,9 +1046,10 @@ namespace rsx
 				block(&storage.block_for(range.start)),
 				unowned_it(block->unowned_begin()),
 				unowned_remaining(true),
-				cur_block_it(block->begin()),
 				locked_only(_locked_only)
 			{
+				cur_block_obj = block->index_begin(cursor, range);
+
 				// do a "fake" iteration to ensure the internal state is consistent
 				next(false);
 			}
@@ -760,10 +1060,10 @@ namespace rsx
 			section_bounds bounds;
 
 			block_type *block = nullptr;
-			bool needs_overlap_check = true;
 			bool unowned_remaining = false;
 			unowned_iterator unowned_it = {};
-			section_iterator cur_block_it = {};
+			typename block_type::index_cursor cursor;
+			pointer cur_block_obj = nullptr;
 			pointer obj = nullptr;
 			bool locked_only = false;
 
@@ -803,19 +1103,18 @@ namespace rsx
 				// Go to next block
 				do
 				{
-					// Iterate current block
+					// Iterate current block (the index only holds sections with a valid range)
 					do
 					{
-						auto blk_end = block->end();
-						if (iterate && cur_block_it != blk_end)
+						if (iterate && cur_block_obj != nullptr)
 						{
-							++cur_block_it;
+							cur_block_obj = block->index_next(cursor, range);
 						}
 
-						if (cur_block_it != blk_end)
+						if (cur_block_obj != nullptr)
 						{
-							obj = &(*cur_block_it);
-							if (obj->valid_range() && (!locked_only || obj->is_locked()) && (!needs_overlap_check || obj->overlaps(range, bounds)))
+							obj = cur_block_obj;
+							if ((!locked_only || obj->is_locked()) && obj->overlaps(range, bounds))
 								return;
 
 							iterate = true;
@@ -836,11 +1135,11 @@ namespace rsx
 							return;
 						}
 
-						needs_overlap_check = (block->get_end() > range.end);
-						cur_block_it = block->begin();
 						iterate = false;
 					} while (locked_only && block->get_locked_count() == 0); // find a block with locked sections
 
+					cur_block_obj = block->index_begin(cursor, range);
+
 				} while (true);
 			}
 
@@ -875,8 +1174,8 @@ namespace rsx
 			}
 		};
 
-		using range_iterator = range_iterator_tmpl<section_storage_type, typename block_type::unowned_iterator, typename block_type::iterator, block_type, ranged_storage>;
-		using range_const_iterator = range_iterator_tmpl<const section_storage_type, typename block_type::unowned_const_iterator, typename block_type::const_iterator, const block_type, const ranged_storage>;
+		using range_iterator = range_iterator_tmpl<section_storage_type, typename block_type::unowned_iterator, block_type, ranged_storage>;
+		using range_const_iterator = range_iterator_tmpl<const section_storage_type, typename block_type::unowned_const_iterator, const block_type, const ranged_storage>;
 
 		inline range_iterator range_begin(const address_range &range, section_bounds bounds, bool locked_only = false) {
 			return range_iterator(*this, range, bounds, locked_only);
@@ -1000,6 +1299,13 @@ namespace rsx
 		u64 cache_tag = 0;
 		u64 last_write_tag = 0;
 
+		// Eviction heuristics: last frame this section was sampled, and number of frames it was sampled in
+		u64 last_access_frame = 0;
+		u32 access_count = 0;
+
+		// Memory accounted to the storage while the resources exist
+		u32 memory_usage = 0;
+
 		~cached_texture_section()
 		{
 			AUDIT(!exists());
@@ -1057,6 +1363,9 @@ namespace rsx
 			cache_tag = 0ull;
 			last_write_tag = 0ull;
 
+			last_access_frame = m_tex_cache->get_frame_index();
+			access_count = 0;
+
 			m_predictor_entry = nullptr;
 
 			readback_behaviour = rsx::memory_read_flags::flush_once;
@@ -1080,6 +1389,11 @@ namespace rsx
 		 */
 		inline bool is_destroyed() const { return !exists(); } // this section is currently destroyed
 
+		u32 get_memory_usage() const
+		{
+			return memory_usage;
+		}
+
 	protected:
 		void on_section_resources_created()
 		{
@@ -1089,6 +1403,9 @@ namespace rsx
 			if (triggered_exists_callbacks) return;
 			triggered_exists_callbacks = true;
 
+			// The same amount is released when the resources are destroyed, even if the range changes meanwhile
+			memory_usage = get_section_size();
+
 			// Callbacks
 			m_block->on_section_resources_created(*derived());
 			m_storage->on_section_resources_created(*derived());
@@ -1330,6 +1647,15 @@ namespace rsx
 			m_tex_cache->on_miss(*derived());
 		}
 
+		void on_access(u64 frame)
+		{
+			if (last_access_frame != frame)
+			{
+				last_access_frame = frame;
+				access_count++;
+			}
+		}
+
 		void touch(u64 tag)
 		{
 			last_write_tag = tag;
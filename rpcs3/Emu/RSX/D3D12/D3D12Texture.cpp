@@ -113,9 +113,13 @@ namespace {
 		u8 block_size_in_texel = get_format_block_size_in_texel(format);
 		bool is_swizzled = !(texture.format() & CELL_GCM_TEXTURE_LN);
 		size_t offset_in_buffer = 0;
+
+		// Subresources are decoded while the next copies are recorded
+		texture_upload_batch upload_batch(input_layouts, format, is_swizzled, false, 256);
+
 		for (const rsx_subresource_layout &layout : input_layouts)
 		{
-			upload_texture_subresource(mapped_buffer.subspan(offset_in_buffer), layout, format, is_swizzled, false, 256);
+			upload_batch.decode(::narrow<u32>(mip_level), mapped_buffer.subspan(offset_in_buffer));
 			UINT row_pitch = align(layout.width_in_block * block_size_in_bytes, 256);
 			command_list->CopyTextureRegion(&CD3DX12_TEXTURE_COPY_LOCATION(existing_texture, (UINT)mip_level), 0, 0, 0,
 				&CD3DX12_TEXTURE_COPY_LOCATION(texture_buffer_heap.get_heap(),
@@ -133,6 +137,9 @@ namespace {
 			offset_in_buffer = align(offset_in_buffer, 512);
 			mip_level++;
 		}
+
+		// The command list is not executed yet, so the data only has to be ready before unmapping
+		upload_batch.wait();
 		texture_buffer_heap.unmap(CD3DX12_RANGE(heap_offset, heap_offset + buffer_size));
 
 		command_list->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(existing_texture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
@@ -27,6 +27,16 @@ u64 GLGSRender::get_cycles()
 	return thread_ctrl::get_cycles(static_cast<named_thread<GLGSRender>&>(*this));
 }
 
+rsx::texture_cache_statistics GLGSRender::get_texture_cache_statistics() const
+{
+	rsx::texture_cache_statistics result;
+	result.hits = m_gl_texture_cache.get_total_texture_hits();
+	result.uploads = m_gl_texture_cache.get_total_texture_uploads();
+	result.evictions = m_gl_texture_cache.get_total_evictions();
+	result.memory_in_use = m_gl_texture_cache.get_texture_memory_in_use();
+	return result;
+}
+
 GLGSRender::GLGSRender() : GSRender()
 {
 	m_shaders_cache = std::make_unique<gl::shader_cache>(m_prog_buffer, "opengl", "v1.6");
@@ -959,7 +969,7 @@ void GLGSRender::on_init_thread()
 
 			void update_msg(u32 index, u32 processed, u32 entry_count) override
 			{
-				const char *text = index == 0 ? "Loading pipeline object %u of %u" : "Compiling pipeline object %u of %u";
+				const char *text = index == 0 ? "Compiling shader program %u of %u" : "Linking pipeline object %u of %u";
 				dlg->progress_bar_set_message(index, fmt::format(text, processed, entry_count));
 				owner->flip(0);
 			}
@@ -1784,6 +1794,11 @@ void GLGSRender::flip(int buffer, bool emu_flip)
 		m_text_printer.print_text(0, 126, m_frame->client_width(), m_frame->client_height(), fmt::format("Unreleased textures: %7d", num_dirty_textures));
 		m_text_printer.print_text(0, 144, m_frame->client_width(), m_frame->client_height(), fmt::format("Texture memory: %12dM", texture_memory_size));
 		m_text_printer.print_text(0, 162, m_frame->client_width(), m_frame->client_height(), fmt::format("Flush requests: %12d  = %2d (%3d%%) hard faults, %2d unavoidable, %2d misprediction(s), %2d speculation(s)", num_flushes, num_misses, cache_miss_ratio, num_unavoidable, num_mispredict, num_speculate));
+
+		const auto num_hits = m_gl_texture_cache.get_num_texture_hits();
+		const auto num_uploads = m_gl_texture_cache.get_num_texture_uploads();
+		const auto num_evictions = m_gl_texture_cache.get_num_evictions();
+		m_text_printer.print_text(0, 180, m_frame->client_width(), m_frame->client_height(), fmt::format("Texture lookups: %11d  = %4d hits, %4d upload(s), %4d eviction(s)", num_hits + num_uploads, num_hits, num_uploads, num_evictions));
 	}
 
 	m_frame->flip(m_context);
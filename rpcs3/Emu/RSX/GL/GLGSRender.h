@@ -352,6 +352,7 @@ private:
 
 public:
 	u64 get_cycles() final;
+	rsx::texture_cache_statistics get_texture_cache_statistics() const override;
 	GLGSRender();
 
 private:
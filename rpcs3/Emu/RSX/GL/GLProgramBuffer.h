@@ -112,11 +112,10 @@ public:
 		get_graphics_pipeline(vp, fp, props, false, std::forward<Args>(args)...);
 	}
 
-    void preload_programs(RSXVertexProgram &vp, RSXFragmentProgram &fp)
-    {
-		search_vertex_program(vp);
-		search_fragment_program(fp);
-    }
+	void preload_programs(RSXVertexProgram &vp, RSXFragmentProgram &fp, std::vector<std::function<void()>>& compile_jobs)
+	{
+		add_program_compile_jobs(vp, fp, compile_jobs);
+	}
 
 	bool check_cache_missed() const
 	{
@@ -462,14 +462,45 @@ namespace gl
 			height = align(height, 4);
 		}
 
+		// Every subresource is decoded to its own part of the staging buffer, so it can be uploaded as soon as it is ready
+		const u8 block_size = get_format_block_size_in_bytes(format);
+		std::vector<size_t> staging_offsets;
+		staging_offsets.reserve(input_layouts.size());
+
+		size_t staging_size = 0;
+
+		for (const rsx_subresource_layout &layout : input_layouts)
+		{
+			// Extra padding bytes in case of realignment
+			staging_offsets.push_back(staging_size);
+			staging_size += align<size_t>(align<u32>(layout.width_in_block * block_size, 4) * layout.height_in_block * layout.depth + 8, 16);
+		}
+
+		staging_buffer.resize(std::max(staging_buffer.size(), staging_size));
+
+		texture_upload_batch upload_batch(input_layouts, format, is_swizzled, vtc_support, 4);
+
+		for (u32 i = 0; i < input_layouts.size(); i++)
+		{
+			const size_t size = (i + 1 < input_layouts.size() ? staging_offsets[i + 1] : staging_size) - staging_offsets[i];
+			upload_batch.decode(i, { staging_buffer.data() + staging_offsets[i], ::narrow<int>(size) });
+		}
+
+		// Wait for the subresource only
+		auto get_staging_data = [&](int index)
+		{
+			upload_batch.wait(index);
+			return staging_buffer.data() + staging_offsets[index];
+		};
+
 		if (dim == rsx::texture_dimension_extended::texture_dimension_1d)
 		{
 			if (!is_compressed_format(format))
 			{
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glTexSubImage1D(GL_TEXTURE_1D, mip_level++, 0, layout.width_in_block, gl_format, gl_type, staging_buffer.data());
+					const auto data = get_staging_data(mip_level);
+					glTexSubImage1D(GL_TEXTURE_1D, mip_level++, 0, layout.width_in_block, gl_format, gl_type, data);
 				}
 			}
 			else
@@ -477,8 +508,8 @@ namespace gl
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
 					u32 size = layout.width_in_block * ((format == CELL_GCM_TEXTURE_COMPRESSED_DXT1) ? 8 : 16);
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glCompressedTexSubImage1D(GL_TEXTURE_1D, mip_level++, 0, layout.width_in_block * 4, gl_format, size, staging_buffer.data());
+					const auto data = get_staging_data(mip_level);
+					glCompressedTexSubImage1D(GL_TEXTURE_1D, mip_level++, 0, layout.width_in_block * 4, gl_format, size, data);
 				}
 			}
 			return;
@@ -490,8 +521,8 @@ namespace gl
 			{
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glTexSubImage2D(GL_TEXTURE_2D, mip_level++, 0, 0, layout.width_in_block, layout.height_in_block, gl_format, gl_type, staging_buffer.data());
+					const auto data = get_staging_data(mip_level);
+					glTexSubImage2D(GL_TEXTURE_2D, mip_level++, 0, 0, layout.width_in_block, layout.height_in_block, gl_format, gl_type, data);
 				}
 			}
 			else
@@ -499,8 +530,8 @@ namespace gl
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
 					u32 size = layout.width_in_block * layout.height_in_block * ((format == CELL_GCM_TEXTURE_COMPRESSED_DXT1) ? 8 : 16);
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glCompressedTexSubImage2D(GL_TEXTURE_2D, mip_level++, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, gl_format, size, staging_buffer.data());
+					const auto data = get_staging_data(mip_level);
+					glCompressedTexSubImage2D(GL_TEXTURE_2D, mip_level++, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, gl_format, size, data);
 				}
 			}
 			return;
@@ -515,8 +546,8 @@ namespace gl
 			{
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + mip_level / mipmap_count, mip_level % mipmap_count, 0, 0, layout.width_in_block, layout.height_in_block, gl_format, gl_type, staging_buffer.data());
+					const auto data = get_staging_data(mip_level);
+					glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + mip_level / mipmap_count, mip_level % mipmap_count, 0, 0, layout.width_in_block, layout.height_in_block, gl_format, gl_type, data);
 					mip_level++;
 				}
 			}
@@ -525,8 +556,8 @@ namespace gl
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
 					u32 size = layout.width_in_block * layout.height_in_block * ((format == CELL_GCM_TEXTURE_COMPRESSED_DXT1) ? 8 : 16);
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glCompressedTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + mip_level / mipmap_count, mip_level % mipmap_count, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, gl_format, size, staging_buffer.data());
+					const auto data = get_staging_data(mip_level);
+					glCompressedTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + mip_level / mipmap_count, mip_level % mipmap_count, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, gl_format, size, data);
 					mip_level++;
 				}
 			}
@@ -539,8 +570,8 @@ namespace gl
 			{
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glTexSubImage3D(GL_TEXTURE_3D, mip_level++, 0, 0, 0, layout.width_in_block, layout.height_in_block, depth, gl_format, gl_type, staging_buffer.data());
+					const auto data = get_staging_data(mip_level);
+					glTexSubImage3D(GL_TEXTURE_3D, mip_level++, 0, 0, 0, layout.width_in_block, layout.height_in_block, depth, gl_format, gl_type, data);
 				}
 			}
 			else
@@ -548,8 +579,8 @@ namespace gl
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
 					u32 size = layout.width_in_block * layout.height_in_block * layout.depth * ((format == CELL_GCM_TEXTURE_COMPRESSED_DXT1) ? 8 : 16);
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glCompressedTexSubImage3D(GL_TEXTURE_3D, mip_level++, 0, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, layout.depth, gl_format, size, staging_buffer.data());
+					const auto data = get_staging_data(mip_level);
+					glCompressedTexSubImage3D(GL_TEXTURE_3D, mip_level++, 0, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, layout.depth, gl_format, size, data);
 				}
 			}
 			return;
@@ -1,14 +1,37 @@
 ﻿#include "stdafx.h"
 #include "NullGSRender.h"
 #include "Emu/System.h"
+#include "Emu/Memory/vm.h"
+#include "Emu/RSX/Common/BufferUtils.h"
+#include "Emu/RSX/Common/TextureUtils.h"
 
 u64 NullGSRender::get_cycles()
 {
 	return thread_ctrl::get_cycles(static_cast<named_thread<NullGSRender>&>(*this));
 }
 
+namespace
+{
+	struct null_sampled_image_descriptor : public rsx::sampled_image_descriptor_base
+	{
+		u32 encoded_component_map() const override
+		{
+			return 0;
+		}
+	};
+}
+
 NullGSRender::NullGSRender() : GSRender()
 {
+	for (auto& sampler : fs_sampler_state)
+	{
+		sampler = std::make_unique<null_sampled_image_descriptor>();
+	}
+
+	for (auto& sampler : vs_sampler_state)
+	{
+		sampler = std::make_unique<null_sampled_image_descriptor>();
+	}
 }
 
 bool NullGSRender::do_method(u32 cmd, u32 value)
@@ -16,7 +39,172 @@ bool NullGSRender::do_method(u32 cmd, u32 value)
 	return false;
 }
 
+void NullGSRender::upload_vertex_data()
+{
+	auto& clause = rsx::method_registers.current_draw_clause;
+
+	struct draw_command_visitor
+	{
+		NullGSRender& self;
+
+		// Returns first vertex and vertex count
+		std::pair<u32, u32> operator()(const rsx::draw_array_command&)
+		{
+			const auto& clause = rsx::method_registers.current_draw_clause;
+			return {clause.min_index(), clause.get_elements_count()};
+		}
+
+		std::pair<u32, u32> operator()(const rsx::draw_indexed_array_command& command)
+		{
+			const auto& clause = rsx::method_registers.current_draw_clause;
+			const auto type = clause.is_immediate_draw ? rsx::index_array_type::u32 : rsx::method_registers.index_type();
+			const u32 max_size = get_index_count(clause.primitive, clause.get_elements_count()) * get_index_type_size(type);
+
+			self.m_index_data.resize(max_size);
+
+			u32 min_index, max_index, index_count;
+			std::tie(min_index, max_index, index_count) = write_index_array_data_to_buffer({reinterpret_cast<gsl::byte*>(self.m_index_data.data()), max_size},
+				command.raw_index_buffer, type, clause.primitive, rsx::method_registers.restart_index_enabled(), rsx::method_registers.restart_index(),
+				[](rsx::primitive_type prim) { return !is_primitive_native(prim); });
+
+			if (min_index >= max_index)
+			{
+				return {0, 0};
+			}
+
+			return {rsx::get_index_from_base(min_index, rsx::method_registers.vertex_data_base_index()), max_index - min_index + 1};
+		}
+
+		std::pair<u32, u32> operator()(const rsx::draw_inlined_array&)
+		{
+			const u32 stream_length = ::size32(rsx::method_registers.current_draw_clause.inline_vertex_array) * sizeof(u32);
+			return {0, stream_length / self.m_vertex_layout.interleaved_blocks[0].attribute_stride};
+		}
+	};
+
+	clause.begin();
+	analyse_inputs_interleaved(m_vertex_layout);
+
+	if (!m_vertex_layout.validate())
+	{
+		return;
+	}
+
+	do
+	{
+		if (clause.execute_pipeline_dependencies() & rsx::vertex_base_changed)
+		{
+			for (auto& info : m_vertex_layout.interleaved_blocks)
+			{
+				const auto vertex_base_offset = rsx::method_registers.vertex_data_base_offset();
+				info.real_offset_address = rsx::get_address(rsx::get_vertex_offset_from_base(vertex_base_offset, info.base_offset), info.memory_location);
+			}
+		}
+
+		const auto [first, count] = std::visit(draw_command_visitor{*this}, get_draw_command(rsx::method_registers));
+
+		if (!count)
+		{
+			continue;
+		}
+
+		const auto required = calculate_memory_requirements(m_vertex_layout, first, count);
+		m_persistent_data.resize(required.first);
+		m_volatile_data.resize(required.second);
+
+		write_vertex_data_to_memory(m_vertex_layout, first, count, m_persistent_data.data(), m_volatile_data.data());
+	}
+	while (clause.next());
+}
+
+void NullGSRender::upload_textures()
+{
+	for (u32 i = 0; i < rsx::limits::fragment_textures_count; ++i)
+	{
+		auto& tex = rsx::method_registers.fragment_textures[i];
+		auto& data = m_texture_data[i];
+
+		if (!tex.enabled())
+		{
+			continue;
+		}
+
+		const u32 texaddr = rsx::get_address(tex.offset(), tex.location());
+		const u32 size = ::narrow<u32>(get_texture_size(tex));
+
+		if (!size || !vm::check_addr(texaddr, size))
+		{
+			continue;
+		}
+
+		const u32 format = tex.format() & ~(CELL_GCM_TEXTURE_LN | CELL_GCM_TEXTURE_UN);
+		const bool is_swizzled = !(tex.format() & CELL_GCM_TEXTURE_LN);
+
+		data.resize(get_placed_texture_storage_size(tex, 256));
+
+		std::size_t offset = 0;
+
+		for (const auto& layout : get_subresources_layout(tex))
+		{
+			const std::size_t row_pitch = ::align(layout.width_in_block * get_format_block_size_in_bytes(format), 256);
+			const std::size_t image_size = row_pitch * layout.height_in_block * layout.depth;
+
+			if (offset + image_size > data.size())
+			{
+				break;
+			}
+
+			m_texture_fences.push_back(rsx::g_dma_manager.upload_texture({reinterpret_cast<gsl::byte*>(data.data() + offset), image_size}, layout, format, is_swizzled, false, 256));
+			offset += image_size;
+		}
+	}
+
+	// Large subresources are decoded by the offload workers
+	for (const auto& fence : m_texture_fences)
+	{
+		rsx::g_dma_manager.wait(fence);
+	}
+
+	m_texture_fences.clear();
+}
+
+void NullGSRender::load_program()
+{
+	if (m_graphics_state & rsx::pipeline_state::invalidate_pipeline_bits)
+	{
+		get_current_fragment_program(fs_sampler_state);
+		get_current_vertex_program(vs_sampler_state);
+	}
+
+	u32 properties = 0;
+	m_prog_buffer.get_graphics_pipeline(current_vertex_program, current_fragment_program, properties, false);
+
+	if (m_prog_buffer.check_program_linked_flag())
+	{
+		frontend_stats.programs_linked++;
+	}
+}
+
 void NullGSRender::end()
 {
+	if (UNLIKELY(frontend_stats.enabled))
+	{
+		// Run the common upload paths to measure the front-end cost without a backend
+		const u64 start = rsx::frontend_statistics::timestamp();
+		upload_textures();
+
+		// Every texture is decoded, like on a texture cache miss
+		const u64 mid = rsx::frontend_statistics::timestamp();
+		upload_vertex_data();
+
+		const u64 program_start = rsx::frontend_statistics::timestamp();
+		load_program();
+
+		frontend_stats.texture_decode_time += mid - start;
+		frontend_stats.vertex_upload_time += program_start - mid;
+		frontend_stats.program_lookup_time += rsx::frontend_statistics::timestamp() - program_start;
+	}
+
+	frontend_stats.draws++;
 	rsx::method_registers.current_draw_clause.end();
 }
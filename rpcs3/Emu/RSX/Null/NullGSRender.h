@@ -1,5 +1,34 @@
 ﻿#pragma once
 #include "Emu/RSX/GSRender.h"
+#include "Emu/RSX/Common/ProgramStateCache.h"
+#include "Emu/RSX/RSXOffload.h"
+
+// Program cache without a backend, only used to benchmark program lookups
+struct null_program_traits
+{
+	struct program_type
+	{
+		u32 id = 0;
+	};
+
+	using vertex_program_type = program_type;
+	using fragment_program_type = program_type;
+	using pipeline_storage_type = u32;
+	using pipeline_properties = u32;
+
+	static void recompile_fragment_program(const RSXFragmentProgram&, fragment_program_type& program, size_t id) { program.id = static_cast<u32>(id); }
+	static void recompile_vertex_program(const RSXVertexProgram&, vertex_program_type& program, size_t id) { program.id = static_cast<u32>(id); }
+	static void validate_pipeline_properties(const vertex_program_type&, const fragment_program_type&, pipeline_properties&) {}
+	static pipeline_storage_type build_pipeline(const vertex_program_type&, const fragment_program_type&, const pipeline_properties&) { return 1; }
+};
+
+struct null_program_buffer : public program_state_cache<null_program_traits>
+{
+	bool check_program_linked_flag() const
+	{
+		return m_program_compiled_flag;
+	}
+};
 
 class NullGSRender : public GSRender
 {
@@ -8,6 +37,22 @@ public:
 	NullGSRender();
 
 private:
+	// Scratch storage for the front-end benchmark (data is never consumed)
+	rsx::vertex_input_layout m_vertex_layout;
+	std::vector<u8> m_index_data;
+	std::vector<u8> m_persistent_data;
+	std::vector<u8> m_volatile_data;
+	std::array<std::vector<u8>, rsx::limits::fragment_textures_count> m_texture_data;
+	std::vector<rsx::dma_fence> m_texture_fences;
+
+	null_program_buffer m_prog_buffer;
+	std::array<std::unique_ptr<rsx::sampled_image_descriptor_base>, rsx::limits::fragment_textures_count> fs_sampler_state = {};
+	std::array<std::unique_ptr<rsx::sampled_image_descriptor_base>, rsx::limits::vertex_textures_count> vs_sampler_state = {};
+
+	void upload_vertex_data();
+	void upload_textures();
+	void load_program();
+
 	bool do_method(u32 cmd, u32 value) final;
 	void end() override;
 };
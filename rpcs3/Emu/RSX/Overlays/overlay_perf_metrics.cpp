@@ -5,6 +5,7 @@
 #include "Emu/Cell/SPUThread.h"
 #include "Emu/Cell/RawSPUThread.h"
 #include "Emu/Cell/PPUThread.h"
+#include "Emu/Cell/SPURecompiler.h"
 #include "Utilities/sysinfo.h"
 
 namespace rsx
@@ -115,8 +116,14 @@ namespace rsx
 			case detail_level::minimal:
 			case detail_level::low: m_titles.text = ""; break;
 			case detail_level::medium: m_titles.text = fmt::format("\n\n%s", title1_medium); break;
-			case detail_level::high: m_titles.text = fmt::format("\n\n%s\n\n\n\n\n\n%s", title1_high, title2); break;
+			case detail_level::high: m_titles.text = fmt::format("\n\n%s\n\n\n\n\n\n%s\n\n\n%s", title1_high, title2, title3); break;
 			}
+
+			if (m_detail == detail_level::high && g_cfg.core.spu_async_compile)
+			{
+				m_titles.text += fmt::format("\n\n\n\n\n%s", title4);
+			}
+
 			m_titles.auto_resize();
 			m_titles.refresh();
 		}
@@ -244,6 +251,15 @@ namespace rsx
 				f32 rsx_usage{0};
 				u32 rsx_load{0};
 
+				u64 texture_memory{0};
+				u64 texture_lookups{0};
+				u64 texture_hits{0};
+				u64 texture_evictions{0};
+
+				spu_async_statistics spu_stats;
+				u64 spu_fallback_blocks{0};
+				u64 spu_fallback_time{0};
+
 				std::shared_ptr<GSRender> rsx_thread;
 
 				std::string perf_text;
@@ -258,6 +274,23 @@ namespace rsx
 					rsx_thread = fxm::get<GSRender>();
 					rsx_load = rsx_thread->get_load();
 
+					const auto tex_stats = rsx_thread->get_texture_cache_statistics();
+					texture_memory = tex_stats.memory_in_use / (1024 * 1024);
+					texture_hits = tex_stats.hits - m_texture_hits;
+					texture_lookups = texture_hits + (tex_stats.uploads - m_texture_uploads);
+					texture_evictions = tex_stats.evictions - m_texture_evictions;
+
+					m_texture_hits = tex_stats.hits;
+					m_texture_uploads = tex_stats.uploads;
+					m_texture_evictions = tex_stats.evictions;
+
+					spu_stats = spu_recompiler_base::get_async_statistics();
+					spu_fallback_blocks = spu_stats.fallback_blocks - m_spu_fallback_blocks;
+					spu_fallback_time = spu_stats.fallback_time - m_spu_fallback_time;
+
+					m_spu_fallback_blocks = spu_stats.fallback_blocks;
+					m_spu_fallback_time = spu_stats.fallback_time;
+
 					total_threads = CPUStats::get_thread_count();
 
 					// fallthrough
@@ -336,8 +369,23 @@ namespace rsx
 					                         " RSX   : %04.1f %% ( 1)\n"
 					                         " Total : %04.1f %% (%2u)\n\n"
 					                         "%s\n"
-					                         " RSX   : %02u %%",
-					    fps, frametime, std::string(title1_high.size(), ' '), ppu_usage, ppus, spu_usage, spus, rsx_usage, cpu_usage, total_threads, std::string(title2.size(), ' '), rsx_load);
+					                         " RSX   : %02u %%\n\n"
+					                         "%s\n"
+					                         " Memory    : %u MB\n"
+					                         " Hit rate  : %04.1f %%\n"
+					                         " Evictions : %u",
+					    fps, frametime, std::string(title1_high.size(), ' '), ppu_usage, ppus, spu_usage, spus, rsx_usage, cpu_usage, total_threads, std::string(title2.size(), ' '), rsx_load,
+					    std::string(title3.size(), ' '), texture_memory, texture_lookups ? 100.f * texture_hits / texture_lookups : 0.f, texture_evictions);
+
+					if (g_cfg.core.spu_async_compile)
+					{
+						perf_text += fmt::format("\n\n"
+						                         "%s\n"
+						                         " Queue       : %u (max %u)\n"
+						                         " Interpreted : %u (%.1fms)",
+						    std::string(title4.size(), ' '), spu_stats.queue_depth, spu_stats.max_queue_depth, spu_fallback_blocks, spu_fallback_time / 1000.);
+					}
+
 					break;
 				}
 				}
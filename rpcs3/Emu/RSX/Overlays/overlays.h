@@ -330,7 +330,7 @@ namespace rsx
 			   minimal - fps
 			   low - fps, total cpu usage
 			   medium - fps, detailed cpu usage
-			   high - fps, frametime, detailed cpu usage, thread number, rsx load
+			   high - fps, frametime, detailed cpu usage, thread number, rsx load, texture cache
 			 */
 			detail_level m_detail;
 
@@ -353,9 +353,20 @@ namespace rsx
 			bool m_force_update;
 			bool m_is_initialised{ false };
 
+			// Texture cache counters at the previous update
+			u64 m_texture_hits{ 0 };
+			u64 m_texture_uploads{ 0 };
+			u64 m_texture_evictions{ 0 };
+
+			// SPU interpreter fallback counters at the previous update
+			u64 m_spu_fallback_blocks{ 0 };
+			u64 m_spu_fallback_time{ 0 };
+
 			const std::string title1_medium{"CPU Utilization:"};
 			const std::string title1_high{"Host Utilization (CPU):"};
 			const std::string title2{"Guest Utilization (PS3):"};
+			const std::string title3{"Texture Cache:"};
+			const std::string title4{"SPU Compiler:"};
 
 			void reset_transform(label& elm) const;
 			void reset_transforms();
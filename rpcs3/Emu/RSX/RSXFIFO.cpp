@@ -79,6 +79,36 @@ namespace rsx
 			return false;
 		}
 
+		u32 FIFO_control::read_unsafe_burst(u32 max_count, const be_t<u32>*& args)
+		{
+			if (!m_remaining_commands || m_command_inc != 4)
+			{
+				return 0;
+			}
+
+			const u32 put = m_ctrl->put;
+			u32 count = std::min(m_remaining_commands, max_count);
+
+			if (put == m_internal_get)
+			{
+				return 0;
+			}
+
+			if (put > m_internal_get)
+			{
+				// Only read the data which is already available
+				count = std::min(count, (put - m_internal_get) / 4);
+			}
+
+			args = vm::_ptr<const be_t<u32>>(m_args_ptr + 4);
+
+			m_command_reg += count * 4;
+			m_args_ptr += count * 4;
+			m_remaining_commands -= count;
+			m_internal_get += count * 4;
+			return count;
+		}
+
 		void FIFO_control::read(register_pair& data)
 		{
 			const u32 put = m_ctrl->put;
@@ -515,7 +545,15 @@ namespace rsx
 
 			if (UNLIKELY(m_flattener.is_enabled()))
 			{
-				switch(m_flattener.test(command))
+				const u64 start = UNLIKELY(frontend_stats.enabled) ? frontend_statistics::timestamp() : 0;
+				const auto op = m_flattener.test(command);
+
+				if (UNLIKELY(start))
+				{
+					frontend_stats.flattener_time += frontend_statistics::timestamp() - start;
+				}
+
+				switch (op)
 				{
 				case FIFO::NOTHING:
 				{
@@ -551,12 +589,30 @@ namespace rsx
 			const u32 reg = command.reg >> 2;
 			const u32 value = command.value;
 
+			frontend_stats.methods++;
 			method_registers.decode(reg, value);
 
 			if (auto method = methods[reg])
 			{
 				method(this, reg, value);
 			}
+
+			if (reg - NV4097_SET_TRANSFORM_CONSTANT < 31 && LIKELY(!capture_current_frame))
+			{
+				// Upload the rest of transform constant run at once (the flattener ignores these commands)
+				const be_t<u32>* args;
+				const u32 index = reg - NV4097_SET_TRANSFORM_CONSTANT + 1;
+
+				if (const u32 count = fifo_ctrl->read_unsafe_burst(32 - index, args))
+				{
+					frontend_stats.methods += count;
+
+					if (method_registers.decode_transform_constants(index, args, count))
+					{
+						m_graphics_state |= rsx::pipeline_state::transform_constants_dirty;
+					}
+				}
+			}
 		}
 		while (fifo_ctrl->read_unsafe(command));
 
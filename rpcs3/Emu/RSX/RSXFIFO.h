@@ -134,6 +134,9 @@ namespace rsx
 
 			void read(register_pair& data);
 			inline bool read_unsafe(register_pair& data);
+
+			// Read the following args of an incrementing run at once (same restrictions as read_unsafe)
+			u32 read_unsafe_burst(u32 max_count, const be_t<u32>*& args);
 		};
 	}
 }
\ No newline at end of file
@@ -231,6 +231,7 @@ struct RSXFragmentProgram
 	u32 offset;
 	u32 ucode_length;
 	u32 ctrl;
+	u64 ucode_hash = 0; // Cached result of get_fragment_program_ucode_hash (0 if not computed)
 	u16 unnormalized_coords;
 	u16 redirected_textures;
 	u16 shadow_textures;
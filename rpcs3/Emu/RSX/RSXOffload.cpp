@@ -1,134 +1,441 @@
 ﻿#include "stdafx.h"
 
 #include "Common/BufferUtils.h"
+#include "Common/TextureUtils.h"
 #include "Emu/System.h"
 #include "RSXOffload.h"
 
+#include <chrono>
 #include <thread>
 
 namespace rsx
 {
+	static bool overlaps(const u8 *a, const u8 *a_end, const u8 *b, const u8 *b_end)
+	{
+		return a != a_end && b != b_end && a < b_end && b < a_end;
+	}
+
+	u32 dma_manager::calibrate_immediate_transfer_size()
+	{
+		using clock = std::chrono::steady_clock;
+
+		constexpr u32 buffer_size = 64 * 1024;
+		constexpr u32 samples = 256;
+
+		std::vector<u8> src(buffer_size, 0xcd), dst(buffer_size);
+
+		// Cost of queueing a job on the calling thread
+		u64 queue_time;
+		{
+			lf_queue<transport_packet> queue;
+			atomic_t<u64> counter{ 0 };
+
+			const auto start = clock::now();
+			for (u32 i = 0; i < samples; ++i)
+			{
+				++counter;
+				queue.push(dependencies{}, dst.data(), src.data(), 64);
+			}
+
+			queue_time = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+		}
+
+		// Inline copy bandwidth (the first pass warms up the caches)
+		std::memcpy(dst.data(), src.data(), buffer_size);
+
+		const auto start = clock::now();
+		for (u32 i = 0; i < samples / 16; ++i)
+		{
+			std::memcpy(dst.data(), src.data(), buffer_size);
+		}
+
+		const u64 copy_time = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+
+		// Size at which copying inline costs as much as queueing, rounded to the nearest 512 bytes
+		const double bytes_per_ns = (double(buffer_size) * (samples / 16)) / std::max<u64>(copy_time, 1);
+		const double break_even = (double(queue_time) / samples) * bytes_per_ns;
+
+		const u32 result = std::clamp<u32>(static_cast<u32>((break_even + 256) / 512) * 512, 512, buffer_size);
+
+		LOG_NOTICE(RSX, "DMA offload: queueing costs %.1fns, copy bandwidth is %.1f bytes/ns, immediate transfer limit set to %u bytes",
+			double(queue_time) / samples, bytes_per_ns, result);
+
+		return result;
+	}
+
 	// initialization
 	void dma_manager::init()
 	{
+		// Workers of a previous session must not touch the reset counters
+		stop_workers();
+
 		m_worker_state = thread_state::created;
-		m_enqueued_count.store(0);
-		m_processed_count = 0;
+		m_worker_count = std::clamp<u32>(std::thread::hardware_concurrency() / 8, 1, max_workers);
+		m_next_worker = 0;
+		m_pending.fill({});
+		m_pending_pos = 0;
+		m_retired.fill(0);
+		m_last_copy_src = nullptr;
+		m_last_copy_dst = nullptr;
+		m_last_copy_worker = 0;
 
-		// Empty work queue in case of stale contents
-		m_work_queue.pop_all();
+		for (auto& w : m_workers)
+		{
+			w.enqueued_count.store(0);
+			w.processed_count.store(0);
 
-		thread_ctrl::spawn("RSX offloader", [this]()
+			// Empty work queue in case of stale contents
+			w.queue.pop_all();
+		}
+
+		if (!g_cfg.video.multithreaded_rsx)
 		{
-			if (!g_cfg.video.multithreaded_rsx)
+			return;
+		}
+
+		static const u32 s_immediate_transfer_size = calibrate_immediate_transfer_size();
+		max_immediate_transfer_size = s_immediate_transfer_size;
+
+		for (u32 i = 0; i < m_worker_count; ++i)
+		{
+			m_workers[i].thread = std::make_unique<named_thread<std::function<void()>>>(fmt::format("RSX offloader %u", i), [this, i]()
 			{
-				// Abort
-				return;
-			}
+				if (g_cfg.core.thread_scheduler_enabled)
+				{
+					thread_ctrl::set_thread_affinity_mask(thread_ctrl::get_affinity_mask(thread_class::rsx));
+				}
+
+				run_worker(i);
+			});
+		}
+	}
 
-			if (g_cfg.core.thread_scheduler_enabled)
+	void dma_manager::run_worker(u32 index)
+	{
+		auto& w = m_workers[index];
+
+		auto is_blocked = [&](const dependencies& deps)
+		{
+			for (u32 i = 0; i < m_worker_count; ++i)
 			{
-				thread_ctrl::set_thread_affinity_mask(thread_ctrl::get_affinity_mask(thread_class::rsx));
+				if (m_workers[i].processed_count.load() < deps[i])
+				{
+					return true;
+				}
 			}
 
-			while (m_worker_state != thread_state::finished)
+			return false;
+		};
+
+		while (m_worker_state != thread_state::finished && thread_ctrl::state() != thread_state::aborting)
+		{
+			if (w.enqueued_count.load() != w.processed_count.load())
 			{
-				if (m_enqueued_count.load() != m_processed_count)
+				// Adjacent raw copies are merged into a single memcpy
+				u8 *copy_dst = nullptr;
+				const u8 *copy_src = nullptr;
+				u32 copy_length = 0;
+				u32 merged = 0;
+
+				auto flush_copy = [&]()
 				{
-					for (auto slice = m_work_queue.pop_all(); slice; slice.pop_front())
+					if (copy_length)
+					{
+						std::memcpy(copy_dst, copy_src, copy_length);
+						w.processed_count += merged;
+						copy_length = 0;
+						merged = 0;
+					}
+				};
+
+				for (auto slice = w.queue.pop_all(); slice; slice.pop_front())
+				{
+					auto& task = *slice;
+
+					if (is_blocked(task.wait_for))
+					{
+						// Complete own work first, other workers may be waiting for it
+						flush_copy();
+
+						while (is_blocked(task.wait_for) && m_worker_state != thread_state::finished && thread_ctrl::state() != thread_state::aborting)
+						{
+							std::this_thread::yield();
+						}
+					}
+
+					if (task.type == raw_copy)
 					{
-						auto task = *slice;
-						switch (task.type)
+						if (copy_length && copy_dst + copy_length == task.dst && copy_src + copy_length == task.src)
 						{
-						case raw_copy:
-							memcpy(task.dst, task.src, task.length);
-							break;
-						case vector_copy:
-							memcpy(task.dst, task.opt_storage.data(), task.length);
-							break;
-						case index_emulate:
-							write_index_array_for_non_indexed_non_native_primitive_to_buffer(
-								reinterpret_cast<char*>(task.dst),
-								static_cast<rsx::primitive_type>(task.aux_param0),
-								task.length);
-							break;
-						default:
-							ASSUME(0);
-							fmt::throw_exception("Unreachable" HERE);
+							copy_length += task.length;
+							merged++;
+							continue;
 						}
 
-						++m_processed_count;
+						flush_copy();
+						copy_dst = static_cast<u8*>(task.dst);
+						copy_src = static_cast<const u8*>(task.src);
+						copy_length = task.length;
+						merged = 1;
+						continue;
 					}
+
+					flush_copy();
+
+					switch (task.type)
+					{
+					case vector_copy:
+						memcpy(task.dst, task.opt_storage.data(), task.length);
+						break;
+					case index_emulate:
+						write_index_array_for_non_indexed_non_native_primitive_to_buffer(
+							reinterpret_cast<char*>(task.dst),
+							static_cast<rsx::primitive_type>(task.aux_param0),
+							task.length);
+						break;
+					case callback:
+						task.opt_callback();
+						break;
+					default:
+						ASSUME(0);
+						fmt::throw_exception("Unreachable" HERE);
+					}
+
+					++w.processed_count;
 				}
-				else
-				{
-					// Yield
-					std::this_thread::yield();
-				}
+
+				flush_copy();
+			}
+			else
+			{
+				// Yield
+				std::this_thread::yield();
+			}
+		}
+
+		w.processed_count = w.enqueued_count.load();
+	}
+
+	void dma_manager::stop_workers()
+	{
+		m_worker_state = thread_state::finished;
+
+		for (auto& w : m_workers)
+		{
+			// Join
+			w.thread.reset();
+		}
+	}
+
+	dma_manager::dependencies dma_manager::get_dependencies(const pending_job& job, u32 index) const
+	{
+		dependencies result = m_retired;
+
+		for (const auto& entry : m_pending)
+		{
+			const u32 worker = entry.fence.worker;
+
+			if (entry.fence.sequence <= result[worker] || worker == index)
+			{
+				continue;
 			}
 
-			m_processed_count = m_enqueued_count.load();
-		});
+			if (overlaps(entry.dst, entry.dst_end, job.dst, job.dst_end) ||
+				overlaps(entry.dst, entry.dst_end, job.src, job.src_end) ||
+				overlaps(entry.src, entry.src_end, job.dst, job.dst_end))
+			{
+				result[worker] = entry.fence.sequence;
+			}
+		}
+
+		for (u32 i = 0; i < max_workers; ++i)
+		{
+			// Jobs of the same worker run in order, completed jobs don't block
+			if (i == index || m_workers[i].processed_count.load() >= result[i])
+			{
+				result[i] = 0;
+			}
+		}
+
+		return result;
+	}
+
+	void dma_manager::wait_for_overlaps(const void *dst, u32 dst_length, const void *src, u32 src_length) const
+	{
+		const auto _dst = static_cast<const u8*>(dst);
+		const auto _src = static_cast<const u8*>(src);
+		const auto deps = get_dependencies({ _dst, _dst + dst_length, _src, _src + src_length }, max_workers);
+
+		for (u32 i = 0; i < m_worker_count; ++i)
+		{
+			wait({ i, deps[i] });
+		}
+	}
+
+	template <typename... Args>
+	dma_fence dma_manager::enqueue(u32 index, const void *dst, u32 dst_length, const void *src, u32 src_length, Args&&... args)
+	{
+		const auto _dst = static_cast<const u8*>(dst);
+		const auto _src = static_cast<const u8*>(src);
+		pending_job job{ _dst, _dst + dst_length, _src, _src + src_length };
+
+		auto& w = m_workers[index];
+		const auto deps = get_dependencies(job, index);
+		const u64 sequence = ++w.enqueued_count;
+		w.queue.push(deps, std::forward<Args>(args)...);
+
+		// Remember the job, the fence of the one it replaces must be reached by all later jobs
+		job.fence = { index, sequence };
+
+		auto& slot = m_pending[m_pending_pos++ % m_pending.size()];
+		m_retired[slot.fence.worker] = std::max(m_retired[slot.fence.worker], slot.fence.sequence);
+		slot = job;
+
+		return job.fence;
+	}
+
+	u32 dma_manager::select_worker(const void *dst, const void *src, u32 length)
+	{
+		u32 index;
+
+		if (dst == m_last_copy_dst && src == m_last_copy_src)
+		{
+			// Continuation of the previous copy, keep it on the same worker so it can be merged
+			index = m_last_copy_worker;
+		}
+		else
+		{
+			index = m_next_worker++ % m_worker_count;
+		}
+
+		m_last_copy_dst = static_cast<u8*>(const_cast<void*>(dst)) + length;
+		m_last_copy_src = static_cast<const u8*>(src) + length;
+		m_last_copy_worker = index;
+		return index;
 	}
 
 	// General transport
-	void dma_manager::copy(void *dst, std::vector<u8>& src, u32 length)
+	dma_fence dma_manager::copy(void *dst, std::vector<u8>& src, u32 length)
 	{
 		if (length <= max_immediate_transfer_size || !g_cfg.video.multithreaded_rsx)
 		{
+			wait_for_overlaps(dst, length, nullptr, 0);
 			std::memcpy(dst, src.data(), length);
+			return {};
 		}
 		else
 		{
-			++m_enqueued_count;
-			m_work_queue.push(dst, src, length);
+			// The source is owned by the job
+			return enqueue(m_next_worker++ % m_worker_count, dst, length, nullptr, 0, dst, src, length);
 		}
 	}
 
-	void dma_manager::copy(void *dst, void *src, u32 length)
+	dma_fence dma_manager::copy(void *dst, void *src, u32 length)
 	{
 		if (length <= max_immediate_transfer_size || !g_cfg.video.multithreaded_rsx)
 		{
+			wait_for_overlaps(dst, length, src, length);
 			std::memcpy(dst, src, length);
+			return {};
 		}
 		else
 		{
-			++m_enqueued_count;
-			m_work_queue.push(dst, src, length);
+			return enqueue(select_worker(dst, src, length), dst, length, src, length, dst, src, length);
 		}
 	}
 
 	// Vertex utilities
-	void dma_manager::emulate_as_indexed(void *dst, rsx::primitive_type primitive, u32 count)
+	dma_fence dma_manager::emulate_as_indexed(void *dst, rsx::primitive_type primitive, u32 count)
 	{
+		const u32 length = get_index_count(primitive, count) * sizeof(u16);
+
 		if (!g_cfg.video.multithreaded_rsx)
 		{
+			wait_for_overlaps(dst, length, nullptr, 0);
 			write_index_array_for_non_indexed_non_native_primitive_to_buffer(
 				reinterpret_cast<char*>(dst), primitive, count);
+			return {};
+		}
+		else
+		{
+			return enqueue(m_next_worker++ % m_worker_count, dst, length, nullptr, 0, dst, primitive, count);
+		}
+	}
+
+	dma_fence dma_manager::convert_vertex_data(gsl::span<gsl::byte> dst, gsl::span<const gsl::byte> src, u32 count, rsx::vertex_base_type type,
+		u32 vector_element_count, u32 attribute_src_stride, u8 dst_stride, bool swap_endianness)
+	{
+		const u32 dst_length = static_cast<u32>(dst.size_bytes());
+		const u32 src_length = static_cast<u32>(src.size_bytes());
+
+		if (src_length <= max_immediate_transfer_size || !g_cfg.video.multithreaded_rsx)
+		{
+			wait_for_overlaps(dst.data(), dst_length, src.data(), src_length);
+			write_vertex_array_data_to_buffer(dst, src, count, type, vector_element_count, attribute_src_stride, dst_stride, swap_endianness);
+			return {};
+		}
+		else
+		{
+			return enqueue(m_next_worker++ % m_worker_count, dst.data(), dst_length, src.data(), src_length, std::function<void()>([=]()
+			{
+				write_vertex_array_data_to_buffer(dst, src, count, type, vector_element_count, attribute_src_stride, dst_stride, swap_endianness);
+			}));
+		}
+	}
+
+	// Texture utilities
+	dma_fence dma_manager::upload_texture(gsl::span<gsl::byte> dst, const rsx_subresource_layout& layout, int format, bool is_swizzled, bool vtc_support, size_t dst_row_pitch_multiple_of)
+	{
+		const u32 dst_length = static_cast<u32>(dst.size_bytes());
+		const u32 src_length = static_cast<u32>(layout.data.size_bytes());
+
+		if (src_length <= max_immediate_transfer_size || !g_cfg.video.multithreaded_rsx)
+		{
+			wait_for_overlaps(dst.data(), dst_length, layout.data.data(), src_length);
+			upload_texture_subresource(dst, layout, format, is_swizzled, vtc_support, dst_row_pitch_multiple_of);
+			return {};
 		}
 		else
 		{
-			++m_enqueued_count;
-			m_work_queue.push(dst, primitive, count);
+			return enqueue(m_next_worker++ % m_worker_count, dst.data(), dst_length, layout.data.data(), src_length, std::function<void()>([=]()
+			{
+				upload_texture_subresource(dst, layout, format, is_swizzled, vtc_support, dst_row_pitch_multiple_of);
+			}));
 		}
 	}
 
 	// Synchronization
+	bool dma_manager::is_signaled(const dma_fence& fence) const
+	{
+		return fence.sequence == 0 || m_workers[fence.worker].processed_count.load() >= fence.sequence;
+	}
+
+	void dma_manager::wait(const dma_fence& fence) const
+	{
+		while (!is_signaled(fence))
+			_mm_pause();
+	}
+
 	void dma_manager::sync()
 	{
-		if (LIKELY(m_enqueued_count.load() == m_processed_count))
+		for (u32 i = 0; i < m_worker_count; ++i)
 		{
-			// Nothing to do
-			return;
-		}
+			auto& w = m_workers[i];
 
-		while (m_enqueued_count.load() != m_processed_count)
-			_mm_lfence();
+			if (LIKELY(w.enqueued_count.load() == w.processed_count.load()))
+			{
+				// Nothing to do
+				continue;
+			}
+
+			while (w.enqueued_count.load() != w.processed_count.load())
+				_mm_lfence();
+		}
 	}
 
 	void dma_manager::join()
 	{
-		m_worker_state = thread_state::finished;
 		sync();
+		stop_workers();
 	}
 }
@@ -3,51 +3,124 @@
 #include "Utilities/types.h"
 #include "Utilities/lockless.h"
 #include "Utilities/Thread.h"
+#include "Utilities/GSL.h"
 #include "gcm_enums.h"
 
+#include <array>
+#include <functional>
+#include <memory>
 #include <vector>
 
+struct rsx_subresource_layout;
+
 namespace rsx
 {
+	// Completion marker of a job submitted to the dma_manager
+	struct dma_fence
+	{
+		u32 worker = 0;
+		u64 sequence = 0; // 0 if the job was executed immediately
+	};
+
 	class dma_manager
 	{
+		static constexpr u32 max_workers = 4;
+
+		// Sequence number per worker which must be reached before a job can run (0 if none)
+		using dependencies = std::array<u64, max_workers>;
+
 		enum op
 		{
 			raw_copy = 0,
 			vector_copy = 1,
-			index_emulate = 2
+			index_emulate = 2,
+			callback = 3
 		};
 
 		struct transport_packet
 		{
 			op type;
 			std::vector<u8> opt_storage;
+			std::function<void()> opt_callback;
 			void *src;
 			void *dst;
 			u32 length;
 			u32 aux_param0;
 			u32 aux_param1;
+			dependencies wait_for;
 
-			transport_packet(void *_dst, void *_src, u32 len)
-				: src(_src), dst(_dst), length(len), type(op::raw_copy)
+			transport_packet(const dependencies& deps, void *_dst, void *_src, u32 len)
+				: src(_src), dst(_dst), length(len), type(op::raw_copy), wait_for(deps)
 			{}
 
-			transport_packet(void *_dst, std::vector<u8>& _src, u32 len)
-				: dst(_dst), opt_storage(std::move(_src)), length(len), type(op::vector_copy)
+			transport_packet(const dependencies& deps, void *_dst, std::vector<u8>& _src, u32 len)
+				: dst(_dst), opt_storage(std::move(_src)), length(len), type(op::vector_copy), wait_for(deps)
 			{}
 
-			transport_packet(void *_dst, rsx::primitive_type prim, u32 len)
-				: dst(_dst), aux_param0(static_cast<u8>(prim)), length(len), type(op::index_emulate)
+			transport_packet(const dependencies& deps, void *_dst, rsx::primitive_type prim, u32 len)
+				: dst(_dst), aux_param0(static_cast<u8>(prim)), length(len), type(op::index_emulate), wait_for(deps)
 			{}
+
+			transport_packet(const dependencies& deps, std::function<void()> func)
+				: opt_callback(std::move(func)), type(op::callback), wait_for(deps)
+			{}
+		};
+
+		struct worker
+		{
+			lf_queue<transport_packet> queue;
+			atomic_t<u64> enqueued_count{ 0 };
+			atomic_t<u64> processed_count{ 0 };
+			std::unique_ptr<named_thread<std::function<void()>>> thread;
+		};
+
+		// Memory touched by a queued job
+		struct pending_job
+		{
+			const u8 *dst = nullptr;
+			const u8 *dst_end = nullptr;
+			const u8 *src = nullptr;
+			const u8 *src_end = nullptr;
+			dma_fence fence;
 		};
 
-		lf_queue<transport_packet> m_work_queue;
-		atomic_t<u64> m_enqueued_count{ 0 };
-		volatile u64 m_processed_count = 0;
+		// Jobs are spread over the workers. A job which overlaps the memory of a recent job queued
+		// on another worker waits for its fence, older jobs are waited for unconditionally
+		std::array<worker, max_workers> m_workers;
+		u32 m_worker_count = 1;
+		u32 m_next_worker = 0;
+
+		std::array<pending_job, 64> m_pending{};
+		u32 m_pending_pos = 0;
+		dependencies m_retired{};
+
+		// End of the last raw copy submitted, used to keep adjacent copies on the same worker
+		const u8 *m_last_copy_src = nullptr;
+		u8 *m_last_copy_dst = nullptr;
+		u32 m_last_copy_worker = 0;
+
 		thread_state m_worker_state = thread_state::detached;
 
-		// TODO: Improved benchmarks here; value determined by profiling on a Ryzen CPU, rounded to the nearest 512 bytes
-		const u32 max_immediate_transfer_size = 3584;
+		// Transfers up to this size are cheaper to do inline than to queue, measured in init()
+		u32 max_immediate_transfer_size = 3584;
+
+		static u32 calibrate_immediate_transfer_size();
+
+		void run_worker(u32 index);
+
+		// Stop and join the worker threads
+		void stop_workers();
+
+		// Fences of the queued jobs which touch the memory, excluding the jobs of the specified worker
+		dependencies get_dependencies(const pending_job& job, u32 index) const;
+
+		// Wait until the queued jobs which touch the memory are complete
+		void wait_for_overlaps(const void *dst, u32 dst_length, const void *src, u32 src_length) const;
+
+		template <typename... Args>
+		dma_fence enqueue(u32 index, const void *dst, u32 dst_length, const void *src, u32 src_length, Args&&... args);
+
+		u32 select_worker(const void *dst, const void *src, u32 length);
 
 	public:
 		dma_manager() = default;
@@ -55,14 +128,23 @@ namespace rsx
 		// initialization
 		void init();
 
+		// Jobs may run on a worker thread: source and destination memory must stay valid until the returned fence is signaled
+
 		// General tranport
-		void copy(void *dst, std::vector<u8>& src, u32 length);
-		void copy(void *dst, void *src, u32 length);
+		dma_fence copy(void *dst, std::vector<u8>& src, u32 length);
+		dma_fence copy(void *dst, void *src, u32 length);
 
 		// Vertex utilities
-		void emulate_as_indexed(void *dst, rsx::primitive_type primitive, u32 count);
+		dma_fence emulate_as_indexed(void *dst, rsx::primitive_type primitive, u32 count);
+		dma_fence convert_vertex_data(gsl::span<gsl::byte> dst, gsl::span<const gsl::byte> src, u32 count, rsx::vertex_base_type type,
+			u32 vector_element_count, u32 attribute_src_stride, u8 dst_stride, bool swap_endianness);
+
+		// Texture utilities
+		dma_fence upload_texture(gsl::span<gsl::byte> dst, const rsx_subresource_layout& layout, int format, bool is_swizzled, bool vtc_support, size_t dst_row_pitch_multiple_of);
 
 		// Synchronization
+		bool is_signaled(const dma_fence& fence) const;
+		void wait(const dma_fence& fence) const;
 		void sync();
 		void join();
 	};
@@ -1254,22 +1254,30 @@ namespace rsx
 		if (!(m_graphics_state & rsx::pipeline_state::vertex_program_dirty))
 			return;
 
-		m_graphics_state &= ~(rsx::pipeline_state::vertex_program_dirty);
-		const u32 transform_program_start = rsx::method_registers.transform_program_start();
 		current_vertex_program.output_mask = rsx::method_registers.vertex_attrib_output_mask();
 		current_vertex_program.skip_vertex_input_check = skip_vertex_inputs;
 
 		current_vertex_program.rsx_vertex_inputs.clear();
-		current_vertex_program.data.reserve(512 * 4);
-		current_vertex_program.jump_table.clear();
 		current_vertex_program.texture_dimensions = 0;
 
-		current_vp_metadata = program_hash_util::vertex_program_utils::analyse_vertex_program
-		(
-			method_registers.transform_program.data(),  // Input raw block
-			transform_program_start,                    // Address of entry point
-			current_vertex_program                      // [out] Program object
-		);
+		if (m_graphics_state & rsx::pipeline_state::vertex_program_ucode_dirty)
+		{
+			// Only the ucode is analysed and hashed, other changes reuse the previous results
+			const u32 transform_program_start = rsx::method_registers.transform_program_start();
+			current_vertex_program.data.reserve(512 * 4);
+			current_vertex_program.jump_table.clear();
+
+			current_vp_metadata = program_hash_util::vertex_program_utils::analyse_vertex_program
+			(
+				method_registers.transform_program.data(),  // Input raw block
+				transform_program_start,                    // Address of entry point
+				current_vertex_program                      // [out] Program object
+			);
+
+			current_vertex_program.ucode_hash = program_hash_util::vertex_program_utils::get_vertex_program_ucode_hash(current_vertex_program);
+		}
+
+		m_graphics_state &= ~(rsx::pipeline_state::vertex_program_dirty | rsx::pipeline_state::vertex_program_ucode_dirty);
 
 		if (!skip_textures && current_vp_metadata.referenced_textures_mask != 0)
 		{
@@ -1497,6 +1505,8 @@ namespace rsx
 		m_graphics_state &= ~(rsx::pipeline_state::fragment_program_dirty);
 		auto &result = current_fragment_program = {};
 
+		// The ucode lives in guest memory and can be rewritten in place without any method call,
+		// so unlike the vertex program it is analysed and hashed again whenever the program is dirty
 		const u32 shader_program = rsx::method_registers.shader_program_address();
 
 		const u32 program_location = (shader_program & 0x3) - 1;
@@ -1508,6 +1518,7 @@ namespace rsx
 		result.addr = ((u8*)result.addr + current_fp_metadata.program_start_offset);
 		result.offset = program_offset + current_fp_metadata.program_start_offset;
 		result.ucode_length = current_fp_metadata.program_ucode_length;
+		result.ucode_hash = program_hash_util::fragment_program_utils::get_fragment_program_ucode_hash(result);
 		result.valid = true;
 		result.ctrl = rsx::method_registers.shader_control() & (CELL_GCM_SHADER_CONTROL_32_BITS_EXPORTS | CELL_GCM_SHADER_CONTROL_DEPTH_EXPORT);
 		result.unnormalized_coords = 0;
@@ -2419,15 +2430,37 @@ namespace rsx
 	{
 		if (user_asked_for_frame_capture && !capture_current_frame)
 		{
-			capture_current_frame = true;
 			user_asked_for_frame_capture = false;
 			frame_debug.reset();
 			frame_capture.reset();
 
-			// random number just to jumpstart the size
-			frame_capture.replay_commands.reserve(8000);
+			// Memory data is written to the capture file during the capture
+			frame_capture.storage = std::make_shared<rsx::capture_storage>();
+
+			if (!frame_capture.storage->create(fs::get_config_dir() + "captures/" + Emu.GetTitleID() + "_" + date_time::current_time_narrow() + "_capture.rrc"))
+			{
+				LOG_ERROR(RSX, "capture failed: can't create %s", frame_capture.storage->get_path());
+				frame_capture.reset();
+			}
+			else
+			{
+				capture_current_frame = true;
+
+				// random number just to jumpstart the size
+				frame_capture.replay_commands.reserve(8000);
+
+				// capture first tile state with nop cmd
+				rsx::frame_capture_data::replay_command replay_cmd;
+				replay_cmd.rsx_command = std::make_pair(NV4097_NO_OPERATION, 0);
+				frame_capture.replay_commands.push_back(replay_cmd);
+				capture::capture_display_tile_state(this, frame_capture.replay_commands.back());
+			}
+		}
+		else if (capture_current_frame && frame_capture.frame_starts.size() + 1 < g_cfg.video.capture_frame_count)
+		{
+			// Start the next frame, capture tile state with nop cmd
+			frame_capture.frame_starts.push_back(::size32(frame_capture.replay_commands));
 
-			// capture first tile state with nop cmd
 			rsx::frame_capture_data::replay_command replay_cmd;
 			replay_cmd.rsx_command = std::make_pair(NV4097_NO_OPERATION, 0);
 			frame_capture.replay_commands.push_back(replay_cmd);
@@ -2438,15 +2471,16 @@ namespace rsx
 			capture_current_frame = false;
 			std::stringstream os;
 			cereal::BinaryOutputArchive archive(os);
-			const std::string& filePath = fs::get_config_dir() + "captures/" + Emu.GetTitleID() + "_" + date_time::current_time_narrow() + "_capture.rrc";
 			archive(frame_capture);
+
+			if (frame_capture.storage->write_frame(os.str()))
 			{
-				// todo: may want to compress this data?
-				fs::file f(filePath, fs::rewrite);
-				f.write(os.str());
+				LOG_SUCCESS(RSX, "capture successful: %s", frame_capture.storage->get_path());
+			}
+			else
+			{
+				LOG_ERROR(RSX, "capture failed: %s", frame_capture.storage->get_path());
 			}
-
-			LOG_SUCCESS(RSX, "capture successful: %s", filePath.c_str());
 
 			frame_capture.reset();
 			Emu.Pause();
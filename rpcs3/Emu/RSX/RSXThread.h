@@ -77,6 +77,8 @@ namespace rsx
 
 		scissor_setup_invalid = 0x400,       // Scissor configuration is broken
 
+		vertex_program_ucode_dirty = 0x1000,  // Vertex program ucode changed, always set with vertex_program_dirty
+
 		invalidate_pipeline_bits = fragment_program_dirty | vertex_program_dirty,
 		memory_barrier_bits = framebuffer_reads_dirty,
 		all_dirty = ~0u
@@ -223,6 +225,48 @@ namespace rsx
 		transient = 2
 	};
 
+	// Command processor statistics (timings are only collected when enabled)
+	// Updated by the FIFO and the renderer threads, read by the replay thread
+	struct frontend_statistics
+	{
+		atomic_t<bool> enabled{false};
+
+		atomic_t<u64> methods{0};
+		atomic_t<u64> draws{0};
+		atomic_t<u64> programs_linked{0};
+
+		// Time in nanoseconds
+		atomic_t<u64> flattener_time{0};
+		atomic_t<u64> vertex_upload_time{0};
+		atomic_t<u64> texture_decode_time{0}; // Texture data decoding, there is no texture cache to look up in the Null renderer
+		atomic_t<u64> program_lookup_time{0};
+
+		void reset()
+		{
+			methods = 0;
+			draws = 0;
+			programs_linked = 0;
+			flattener_time = 0;
+			vertex_upload_time = 0;
+			texture_decode_time = 0;
+			program_lookup_time = 0;
+		}
+
+		static u64 timestamp()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+	};
+
+	// Texture cache counters, accumulated since the renderer was started
+	struct texture_cache_statistics
+	{
+		u64 hits = 0;
+		u64 uploads = 0;
+		u64 evictions = 0;
+		u64 memory_in_use = 0;
+	};
+
 	struct vertex_input_layout
 	{
 		std::vector<interleaved_range_info> interleaved_blocks;  // Interleaved blocks to be uploaded as-is
@@ -446,6 +490,11 @@ namespace rsx
 		// Draw call stats
 		u32 m_draw_calls = 0;
 
+	public:
+		frontend_statistics frontend_stats;
+
+	protected:
+
 		// Profiler
 		rsx::profiling_timer m_profiler;
 
@@ -766,5 +815,8 @@ namespace rsx
 
 		//Get RSX approximate load in %
 		u32 get_load();
+
+		//Get texture cache counters
+		virtual texture_cache_statistics get_texture_cache_statistics() const { return {}; }
 	};
 }
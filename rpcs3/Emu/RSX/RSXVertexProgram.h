@@ -243,6 +243,8 @@ struct RSXVertexProgram
 	std::bitset<512> instruction_mask;
 	std::set<u32> jump_table;
 
+	u64 ucode_hash = 0; // Cached result of get_vertex_program_ucode_hash (0 if not computed)
+
 	rsx::texture_dimension_extended get_texture_dimension(u8 id) const
 	{
 		return (rsx::texture_dimension_extended)((texture_dimensions >> (id * 2)) & 0x3);
@@ -380,6 +380,16 @@ u64 VKGSRender::get_cycles()
 	return thread_ctrl::get_cycles(static_cast<named_thread<VKGSRender>&>(*this));
 }
 
+rsx::texture_cache_statistics VKGSRender::get_texture_cache_statistics() const
+{
+	rsx::texture_cache_statistics result;
+	result.hits = m_texture_cache.get_total_texture_hits();
+	result.uploads = m_texture_cache.get_total_texture_uploads();
+	result.evictions = m_texture_cache.get_total_evictions();
+	result.memory_in_use = m_texture_cache.get_texture_memory_in_use();
+	return result;
+}
+
 VKGSRender::VKGSRender() : GSRender()
 {
 	u32 instance_handle = m_thread_context.createInstance("RPCS3");
@@ -1879,7 +1889,7 @@ void VKGSRender::on_init_thread()
 
 			void update_msg(u32 index, u32 processed, u32 entry_count) override
 			{
-				const char *text = index == 0 ? "Loading pipeline object %u of %u" : "Compiling pipeline object %u of %u";
+				const char *text = index == 0 ? "Compiling shader program %u of %u" : "Linking pipeline object %u of %u";
 				dlg->progress_bar_set_message(index, fmt::format(text, processed, entry_count));
 				owner->flip(0);
 			}
@@ -3436,6 +3446,11 @@ void VKGSRender::flip(int buffer, bool emu_flip)
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 162, direct_fbo->width(), direct_fbo->height(), fmt::format("Texture cache memory: %7dM", texture_memory_size));
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 180, direct_fbo->width(), direct_fbo->height(), fmt::format("Temporary texture memory: %3dM", tmp_texture_memory_size));
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 198, direct_fbo->width(), direct_fbo->height(), fmt::format("Flush requests: %13d  = %2d (%3d%%) hard faults, %2d unavoidable, %2d misprediction(s), %2d speculation(s)", num_flushes, num_misses, cache_miss_ratio, num_unavoidable, num_mispredict, num_speculate));
+
+			const auto num_hits = m_texture_cache.get_num_texture_hits();
+			const auto num_uploads = m_texture_cache.get_num_texture_uploads();
+			const auto num_evictions = m_texture_cache.get_num_evictions();
+			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 216, direct_fbo->width(), direct_fbo->height(), fmt::format("Texture lookups: %12d  = %4d hits, %4d upload(s), %4d eviction(s)", num_hits + num_uploads, num_hits, num_uploads, num_evictions));
 		}
 
 		vk::change_image_layout(*m_current_command_buffer, target_image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, present_layout, subres);
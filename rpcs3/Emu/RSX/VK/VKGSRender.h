@@ -477,6 +477,7 @@ private:
 
 public:
 	u64 get_cycles() final;
+	rsx::texture_cache_statistics get_texture_cache_statistics() const override;
 	VKGSRender();
 	~VKGSRender() override;
 
@@ -184,6 +184,7 @@ struct VKProgramBuffer : public program_state_cache<VKTraits>
 		program_state_cache<VKTraits>::clear();
 		m_vertex_shader_cache.clear();
 		m_fragment_shader_cache.clear();
+		m_fragment_ucode_storage.clear();
 	}
 
 	u64 get_hash(vk::pipeline_props &props)
@@ -208,12 +209,11 @@ struct VKProgramBuffer : public program_state_cache<VKTraits>
 		get_graphics_pipeline(vp, fp, props, false, std::forward<Args>(args)...);
 	}
 
-    void preload_programs(RSXVertexProgram &vp, RSXFragmentProgram &fp)
-    {
-        vp.skip_vertex_input_check = true;
-        search_vertex_program(vp);
-        search_fragment_program(fp);
-    }
+	void preload_programs(RSXVertexProgram &vp, RSXFragmentProgram &fp, std::vector<std::function<void()>>& compile_jobs)
+	{
+		vp.skip_vertex_input_check = true;
+		add_program_compile_jobs(vp, fp, compile_jobs);
+	}
 
 	bool check_cache_missed() const
 	{
@@ -516,6 +516,9 @@ namespace vk
 		u32 block_in_pixel = get_format_block_size_in_texel(format);
 		u8  block_size_in_bytes = get_format_block_size_in_bytes(format);
 
+		// Subresources are decoded while the next copies are recorded
+		texture_upload_batch upload_batch(subresource_layout, format, is_swizzled, false, 256);
+
 		for (const rsx_subresource_layout &layout : subresource_layout)
 		{
 			u32 row_pitch = align(layout.width_in_block * block_size_in_bytes, 256);
@@ -526,9 +529,7 @@ namespace vk
 			void *mapped_buffer = upload_heap.map(offset_in_buffer, image_linear_size + 8);
 			VkBuffer buffer_handle = upload_heap.heap->value;
 
-			gsl::span<gsl::byte> mapped{ (gsl::byte*)mapped_buffer, ::narrow<int>(image_linear_size) };
-			upload_texture_subresource(mapped, layout, format, is_swizzled, false, 256);
-			upload_heap.unmap();
+			upload_batch.decode(mipmap_level, { (gsl::byte*)mapped_buffer, ::narrow<int>(image_linear_size) });
 
 			VkBufferImageCopy copy_info = {};
 			copy_info.bufferOffset = offset_in_buffer;
@@ -567,6 +568,10 @@ namespace vk
 
 			mipmap_level++;
 		}
+
+		// The command buffer is not submitted yet, so the data only has to be ready when returning
+		upload_batch.wait();
+		upload_heap.unmap();
 	}
 
 	VkComponentMapping apply_swizzle_remap(const std::array<VkComponentSwizzle, 4>& base_remap, const std::pair<std::array<u8, 4>, std::array<u8, 4>>& remap_vector)
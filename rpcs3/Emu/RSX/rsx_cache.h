@@ -2,6 +2,8 @@
 #include "Utilities/VirtualMemory.h"
 #include "Utilities/hash.h"
 #include "Utilities/File.h"
+#include "Utilities/pack_archive.h"
+#include "Utilities/task_pool.h"
 #include "Emu/Memory/vm.h"
 #include "gcm_enums.h"
 #include "Common/ProgramStateCache.h"
@@ -413,13 +415,166 @@ namespace rsx
 			pipeline_storage_type pipeline_properties;
 		};
 
+		// Pack record types
+		enum : u32
+		{
+			pack_tag_pipeline = "PIPE"_u32,
+			pack_tag_raw_vp = "RAVP"_u32,
+			pack_tag_raw_fp = "RAFP"_u32,
+		};
+
 		std::string version_prefix;
 		std::string root_path;
 		std::string pipeline_class_name;
 		std::unordered_map<u64, std::vector<u8>> fragment_program_data;
 
+		// Pipelines and deduplicated raw programs
+		utils::pack_archive m_pack;
+
 		backend_storage& m_storage;
 
+		std::string get_pack_path() const
+		{
+			return root_path + "/pipelines/" + pipeline_class_name + "/" + version_prefix + ".pack";
+		}
+
+		bool open_pack()
+		{
+			if (m_pack.is_open())
+			{
+				return true;
+			}
+
+			fs::create_path(root_path + "/pipelines/" + pipeline_class_name);
+			return m_pack.open(get_pack_path(), sizeof(pipeline_data));
+		}
+
+		static u64 get_pipeline_key(const pipeline_data& data, u64 state_hash)
+		{
+			// FNV 64-bit
+			u64 result = 14695981039346656037ull;
+
+			for (u64 value : {data.vertex_program_hash, data.fragment_program_hash, data.pipeline_storage_hash, state_hash})
+			{
+				result ^= value;
+				result *= 1099511628211ull;
+			}
+
+			return result;
+		}
+
+		static u64 get_state_hash(const pipeline_data& data)
+		{
+			u64 state_hash = 0;
+			state_hash ^= rpcs3::hash_base<u32>(data.vp_ctrl);
+			state_hash ^= rpcs3::hash_base<u32>(data.fp_ctrl);
+			state_hash ^= rpcs3::hash_base<u32>(data.vp_texture_dimensions);
+			state_hash ^= rpcs3::hash_base<u32>(data.fp_texture_dimensions);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_unnormalized_coords);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_height);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_pixel_layout);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_lighting_flags);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_shadow_textures);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_redirected_textures);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_alphakill_mask);
+			state_hash ^= rpcs3::hash_base<u64>(data.fp_zfunc_mask);
+			return state_hash;
+		}
+
+		// Import pipelines stored as individual files by older versions, then delete them
+		void migrate_legacy_cache(const std::string& directory_path)
+		{
+			if (!m_pack.is_writable())
+			{
+				// Another instance owns the pack, try again next time
+				LOG_WARNING(RSX, "shader cache: %s is read-only, legacy cache in %s was not migrated", get_pack_path(), directory_path);
+				return;
+			}
+
+			u32 imported = 0;
+			u32 skipped = 0;
+			u32 failed = 0;
+
+			for (const auto& entry : fs::dir(directory_path))
+			{
+				if (entry.is_directory)
+				{
+					continue;
+				}
+
+				if (entry.size != sizeof(pipeline_data))
+				{
+					// Not binary compatible, the loader would discard it as well
+					skipped++;
+					continue;
+				}
+
+				pipeline_data data;
+
+				if (!fs::file(directory_path + "/" + entry.name).read(data))
+				{
+					failed++;
+					continue;
+				}
+
+				const fs::file vp_file(root_path + "/raw/" + fmt::format("%llX.vp", data.vertex_program_hash));
+				const fs::file fp_file(root_path + "/raw/" + fmt::format("%llX.fp", data.fragment_program_hash));
+
+				if (!vp_file || !fp_file)
+				{
+					// References missing programs, can't be loaded
+					skipped++;
+					continue;
+				}
+
+				if (!m_pack.contains(pack_tag_raw_vp, data.vertex_program_hash))
+				{
+					const auto vp_data = vp_file.to_vector<u8>();
+
+					if (!m_pack.append(pack_tag_raw_vp, data.vertex_program_hash, vp_data.data(), ::size32(vp_data)))
+					{
+						failed++;
+						continue;
+					}
+				}
+
+				if (!m_pack.contains(pack_tag_raw_fp, data.fragment_program_hash))
+				{
+					const auto fp_data = fp_file.to_vector<u8>();
+
+					if (!m_pack.append(pack_tag_raw_fp, data.fragment_program_hash, fp_data.data(), ::size32(fp_data)))
+					{
+						failed++;
+						continue;
+					}
+				}
+
+				const u64 key = get_pipeline_key(data, get_state_hash(data));
+
+				// The entry may have been imported by an interrupted migration
+				if (m_pack.contains(pack_tag_pipeline, key) || m_pack.append(pack_tag_pipeline, key, &data, sizeof(pipeline_data)))
+				{
+					imported++;
+				}
+				else
+				{
+					failed++;
+				}
+			}
+
+			if (failed)
+			{
+				// Keep the legacy cache, the remaining entries are imported next time
+				LOG_ERROR(RSX, "shader cache: %u of %u pipeline entries could not be migrated to %s", failed, imported + failed, get_pack_path());
+				return;
+			}
+
+			// Raw programs may still be needed by the other renderers
+			fs::remove_all(directory_path);
+
+			LOG_NOTICE(RSX, "shader cache: %u pipeline entries were migrated to %s (%u invalid entries were discarded)", imported, get_pack_path(), skipped);
+		}
+
 	public:
 
 		struct progress_dialog_helper
@@ -462,7 +617,7 @@ namespace rsx
 
 				Emu.CallAfter([&, index, processed, entry_count]()
 				{
-					const char *text = index == 0 ? "Loading pipeline object %u of %u" : "Compiling pipeline object %u of %u";
+					const char *text = index == 0 ? "Compiling shader program %u of %u" : "Linking pipeline object %u of %u";
 					dlg->ProgressBarSetMsg(index, fmt::format(text, processed, entry_count));
 					ref_cnt--;
 				});
@@ -521,37 +676,27 @@ namespace rsx
 				return;
 			}
 
-			std::string directory_path = root_path + "/pipelines/" + pipeline_class_name + "/" + version_prefix;
-
-			if (!fs::is_dir(directory_path))
+			if (!open_pack())
 			{
-				fs::create_path(directory_path);
-				fs::create_path(root_path + "/raw");
-
 				return;
 			}
 
-			fs::dir root = fs::dir(directory_path);
+			const std::string directory_path = root_path + "/pipelines/" + pipeline_class_name + "/" + version_prefix;
 
-			u32 entry_count = 0;
-			std::vector<fs::dir_entry> entries;
-			for (auto It = root.begin(); It != root.end(); ++It, entry_count++)
+			if (fs::is_dir(directory_path))
 			{
-				fs::dir_entry tmp = *It;
+				migrate_legacy_cache(directory_path);
+			}
 
-				if (tmp.name == "." || tmp.name == "..")
-					continue;
+			const auto entries = m_pack.get_all(pack_tag_pipeline);
 
-				entries.push_back(tmp);
-			}
+			u32 entry_count = ::size32(entries);
 
-			if ((entry_count = (u32)entries.size()) <= 2)
+			if (!entry_count)
 				return;
 
-			root.rewind();
-
 			// Invalid pipeline entries to be removed
-			std::vector<std::string> invalid_entries;
+			std::vector<u64> invalid_entries;
 
 			// Progress dialog
 			std::unique_ptr<progress_dialog_helper> fallback_dlg;
@@ -562,60 +707,132 @@ namespace rsx
 			}
 
 			dlg->create();
-			dlg->set_limit(0, entry_count);
-			dlg->set_limit(1, entry_count);
-			dlg->update_msg(0, 0, entry_count);
-			dlg->update_msg(1, 0, entry_count);
 
 			// Setup worker threads
 			unsigned nb_threads = std::thread::hardware_concurrency();
 			std::vector<std::thread> worker_threads(nb_threads);
 
-			// Preload everything needed to compile the shaders
-			// Can probably be parallelized too, but since it's mostly reading files it's probably not worth it
+			// Unpack the entries in the order they were recorded
 			std::vector<std::tuple<pipeline_storage_type, RSXVertexProgram, RSXFragmentProgram>> unpacked;
+			std::vector<std::function<void()>> compile_jobs;
 			std::chrono::time_point<steady_clock> last_update;
 			u32 processed_since_last_update = 0;
 
 			for (u32 i = 0; (i < entry_count) && !Emu.IsStopped(); i++)
 			{
-				fs::dir_entry tmp = entries[i];
+				const auto& blob = entries[i];
 
-				const auto filename = directory_path + "/" + tmp.name;
-				std::vector<u8> bytes;
-				fs::file f(filename);
-				if (f.size() != sizeof(pipeline_data))
+				if (blob.size != sizeof(pipeline_data))
 				{
-					LOG_ERROR(RSX, "Cached pipeline object %s is not binary compatible with the current shader cache", tmp.name.c_str());
-					invalid_entries.push_back(filename);
+					LOG_ERROR(RSX, "Cached pipeline object 0x%llx is not binary compatible with the current shader cache", blob.key);
+					invalid_entries.push_back(blob.key);
 					continue;
 				}
-				f.read<u8>(bytes, f.size());
 
-				auto entry = unpack(*(pipeline_data*)bytes.data());
-				m_storage.preload_programs(std::get<1>(entry), std::get<2>(entry));
-				unpacked.push_back(entry);
+				pipeline_data data;
+				std::memcpy(&data, blob.data, sizeof(pipeline_data));
+
+				auto entry = unpack(data);
 
-				// Only update the screen at about 10fps since updating it everytime slows down the process
-				std::chrono::time_point<steady_clock> now = std::chrono::steady_clock::now();
-				processed_since_last_update++;
-				if ((std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update) > 100ms) || (i == entry_count - 1))
+				if (std::get<1>(entry).data.empty() || !std::get<2>(entry).ucode_length)
 				{
-					dlg->update_msg(0, i + 1, entry_count);
-					dlg->inc_value(0, processed_since_last_update);
-					last_update = now;
-					processed_since_last_update = 0;
+					LOG_ERROR(RSX, "Cached pipeline object 0x%llx references missing programs", blob.key);
+					invalid_entries.push_back(blob.key);
+					continue;
 				}
+
+				unpacked.push_back(entry);
 			}
 
 			// Account for any invalid entries
 			entry_count = u32(unpacked.size());
 
+			// Pipelines built before the game starts, the others are built in the background by the decompiler thread
+			// They are built in the order they were first used, so the ones needed early are available early
+			const u32 threshold = g_cfg.video.disable_asynchronous_shader_compiler ? 100 : g_cfg.video.shader_preload_threshold;
+			const u32 link_count = (entry_count * threshold + 99) / 100;
+
+			// Collect the unique programs of these pipelines, every program is compiled once no matter how many pipelines use it
+			for (u32 i = 0; i < link_count; i++)
+			{
+				m_storage.preload_programs(std::get<1>(unpacked[i]), std::get<2>(unpacked[i]), compile_jobs);
+			}
+
+			const u32 program_count = ::size32(compile_jobs);
+
+			dlg->set_limit(0, program_count);
+			dlg->set_limit(1, link_count);
+			dlg->update_msg(0, 0, program_count);
+			dlg->update_msg(1, 0, link_count);
+
 			atomic_t<u32> processed(0);
+
+			if (g_cfg.video.renderer == video_renderer::vulkan)
+			{
+				utils::task_pool pool("Shader Compiler", nb_threads);
+				utils::task_group group;
+
+				for (auto& job : compile_jobs)
+				{
+					pool.push(group, [&]()
+					{
+						if (!Emu.IsStopped())
+						{
+							job();
+						}
+
+						processed++;
+					});
+				}
+
+				// Wait for the workers while updating UI
+				u32 last_update_progress = 0;
+
+				while (!group.done())
+				{
+					std::this_thread::sleep_for(100ms);
+
+					const u32 current_progress = processed.load();
+
+					if (current_progress > last_update_progress)
+					{
+						dlg->update_msg(0, current_progress, program_count);
+						dlg->inc_value(0, current_progress - last_update_progress);
+						last_update_progress = current_progress;
+					}
+				}
+
+				// Rethrow the errors of the compile jobs
+				pool.wait(group);
+			}
+			else
+			{
+				// Programs must be compiled on a thread owning a context, the OpenGL backend only creates one for the renderer and one for the decompiler
+				for (u32 i = 0; (i < program_count) && !Emu.IsStopped(); i++)
+				{
+					compile_jobs[i]();
+
+					// Only update the screen at about 10fps since updating it everytime slows down the process
+					std::chrono::time_point<steady_clock> now = std::chrono::steady_clock::now();
+					processed_since_last_update++;
+					if ((std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update) > 100ms) || (i == program_count - 1))
+					{
+						dlg->update_msg(0, i + 1, program_count);
+						dlg->inc_value(0, processed_since_last_update);
+						last_update = now;
+						processed_since_last_update = 0;
+					}
+				}
+			}
+
+			compile_jobs.clear();
+			processed = 0;
+			processed_since_last_update = 0;
+
 			std::function<void(u32)> shader_comp_worker = [&](u32 index)
 			{
 				u32 pos;
-				while (((pos = processed++) < entry_count) && !Emu.IsStopped())
+				while (((pos = processed++) < link_count) && !Emu.IsStopped())
 				{
 					auto& entry = unpacked[pos];
 					m_storage.add_pipeline_entry(std::get<1>(entry), std::get<2>(entry), std::get<0>(entry), std::forward<Args>(args)...);
@@ -634,17 +851,17 @@ namespace rsx
 				u32 current_progress = 0;
 				u32 last_update_progress = 0;
 
-				while ((current_progress < entry_count) && !Emu.IsStopped())
+				while ((current_progress < link_count) && !Emu.IsStopped())
 				{
 					std::this_thread::sleep_for(100ms); // Around 10fps should be good enough
 
-					current_progress = std::min(processed.load(), entry_count);
+					current_progress = std::min(processed.load(), link_count);
 					processed_since_last_update = current_progress - last_update_progress;
 					last_update_progress = current_progress;
 
 					if (processed_since_last_update > 0)
 					{
-						dlg->update_msg(1, current_progress, entry_count);
+						dlg->update_msg(1, current_progress, link_count);
 						dlg->inc_value(1, processed_since_last_update);
 					}
 				}
@@ -656,7 +873,7 @@ namespace rsx
 			else
 			{
 				u32 pos;
-				while (((pos = processed++) < entry_count) && !Emu.IsStopped())
+				while (((pos = processed++) < link_count) && !Emu.IsStopped())
 				{
 					auto& entry = unpacked[pos];
 					m_storage.add_pipeline_entry(std::get<1>(entry), std::get<2>(entry), std::get<0>(entry), std::forward<Args>(args)...);
@@ -664,9 +881,9 @@ namespace rsx
 					// Update screen at about 10fps
 					std::chrono::time_point<steady_clock> now = std::chrono::steady_clock::now();
 					processed_since_last_update++;
-					if ((std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update) > 100ms) || (pos == entry_count - 1))
+					if ((std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update) > 100ms) || (pos == link_count - 1))
 					{
-						dlg->update_msg(1, pos + 1, entry_count);
+						dlg->update_msg(1, pos + 1, link_count);
 						dlg->inc_value(1, processed_since_last_update);
 						last_update = now;
 						processed_since_last_update = 0;
@@ -674,16 +891,33 @@ namespace rsx
 				}
 			}
 
+			if (link_count < entry_count && !Emu.IsStopped())
+			{
+				for (u32 i = link_count; i < entry_count; i++)
+				{
+					auto& entry = unpacked[i];
+					m_storage.add_preload_pipeline(std::get<1>(entry), std::get<2>(entry), std::get<0>(entry));
+				}
+
+				LOG_NOTICE(RSX, "shader cache: %u of %u pipelines will be built in the background", entry_count - link_count, entry_count);
+			}
+
 			if (!invalid_entries.empty())
 			{
-				for (const auto &filename : invalid_entries)
+				for (const u64 key : invalid_entries)
 				{
-					fs::remove_file(filename);
+					m_pack.remove(pack_tag_pipeline, key);
 				}
 
 				LOG_NOTICE(RSX, "shader cache: %d entries were marked as invalid and removed", invalid_entries.size());
 			}
 
+			if (m_pack.get_garbage_size())
+			{
+				// All programs have been copied out of the pack at this point
+				m_pack.compact();
+			}
+
 			dlg->refresh();
 			dlg->close();
 		}
@@ -701,66 +935,53 @@ namespace rsx
 				return;
 			}
 
+			if (!open_pack())
+			{
+				return;
+			}
+
 			pipeline_data data = pack(pipeline, vp, fp);
-			std::string fp_name = root_path + "/raw/" + fmt::format("%llX.fp", data.fragment_program_hash);
-			std::string vp_name = root_path + "/raw/" + fmt::format("%llX.vp", data.vertex_program_hash);
 
-			if (!fs::is_file(fp_name))
+			// Raw programs are shared by many pipelines and only stored once
+			if (!m_pack.contains(pack_tag_raw_fp, data.fragment_program_hash))
 			{
-				fs::file(fp_name, fs::rewrite).write(fp.addr, fp.ucode_length);
+				m_pack.append(pack_tag_raw_fp, data.fragment_program_hash, fp.addr, fp.ucode_length);
 			}
 
-			if (!fs::is_file(vp_name))
+			if (!m_pack.contains(pack_tag_raw_vp, data.vertex_program_hash))
 			{
-				fs::file(vp_name, fs::rewrite).write<u32>(vp.data);
+				m_pack.append(pack_tag_raw_vp, data.vertex_program_hash, vp.data.data(), ::size32(vp.data) * sizeof(u32));
 			}
 
-			u64 state_hash = 0;
-			state_hash ^= rpcs3::hash_base<u32>(data.vp_ctrl);
-			state_hash ^= rpcs3::hash_base<u32>(data.fp_ctrl);
-			state_hash ^= rpcs3::hash_base<u32>(data.vp_texture_dimensions);
-			state_hash ^= rpcs3::hash_base<u32>(data.fp_texture_dimensions);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_unnormalized_coords);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_height);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_pixel_layout);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_lighting_flags);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_shadow_textures);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_redirected_textures);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_alphakill_mask);
-			state_hash ^= rpcs3::hash_base<u64>(data.fp_zfunc_mask);
-
-			std::string pipeline_file_name = fmt::format("%llX+%llX+%llX+%llX.bin", data.vertex_program_hash, data.fragment_program_hash, data.pipeline_storage_hash, state_hash);
-			std::string pipeline_path = root_path + "/pipelines/" + pipeline_class_name + "/" + version_prefix + "/" + pipeline_file_name;
-			fs::file(pipeline_path, fs::rewrite).write(&data, sizeof(pipeline_data));
+			m_pack.append(pack_tag_pipeline, get_pipeline_key(data, get_state_hash(data)), &data, sizeof(pipeline_data));
 		}
 
 		RSXVertexProgram load_vp_raw(u64 program_hash)
 		{
-			std::vector<u32> data;
-			std::string filename = fmt::format("%llX.vp", program_hash);
-
-			fs::file f(root_path + "/raw/" + filename);
-			f.read<u32>(data, f.size() / sizeof(u32));
-
 			RSXVertexProgram vp = {};
-			vp.data = data;
 			vp.skip_vertex_input_check = true;
 
+			if (const auto blob = m_pack.find(pack_tag_raw_vp, program_hash))
+			{
+				vp.data.resize(blob.size / sizeof(u32));
+				std::memcpy(vp.data.data(), blob.data, vp.data.size() * sizeof(u32));
+			}
+
 			return vp;
 		}
 
 		RSXFragmentProgram load_fp_raw(u64 program_hash)
 		{
-			std::vector<u8> data;
-			std::string filename = fmt::format("%llX.fp", program_hash);
+			RSXFragmentProgram fp = {};
 
-			fs::file f(root_path + "/raw/" + filename);
-			f.read<u8>(data, f.size());
+			if (const auto blob = m_pack.find(pack_tag_raw_fp, program_hash))
+			{
+				auto& data = fragment_program_data[program_hash];
+				data.assign(blob.data, blob.data + blob.size);
 
-			RSXFragmentProgram fp = {};
-			fragment_program_data[program_hash] = data;
-			fp.addr = fragment_program_data[program_hash].data();
-			fp.ucode_length = (u32)data.size();
+				fp.addr = data.data();
+				fp.ucode_length = ::size32(data);
+			}
 
 			return fp;
 		}
@@ -419,7 +419,7 @@ namespace rsx
 				}
 
 				method_registers.commit_4_transform_program_instructions(index);
-				rsx->m_graphics_state |= rsx::pipeline_state::vertex_program_dirty;
+				rsx->m_graphics_state |= rsx::pipeline_state::vertex_program_dirty | rsx::pipeline_state::vertex_program_ucode_dirty;
 			}
 		};
 
@@ -427,7 +427,7 @@ namespace rsx
 		{
 			if (method_registers.registers[reg] != method_registers.register_previous_value)
 			{
-				rsx->m_graphics_state |= rsx::pipeline_state::vertex_program_dirty;
+				rsx->m_graphics_state |= rsx::pipeline_state::vertex_program_dirty | rsx::pipeline_state::vertex_program_ucode_dirty;
 			}
 		}
 
@@ -2264,6 +2264,46 @@ namespace rsx
 		register_previous_value = std::exchange(registers[reg], value);
 	}
 
+	bool rsx_state::decode_transform_constants(u32 index, const be_t<u32>* args, u32 count)
+	{
+		verify(HERE), count, index + count <= 32;
+
+		u32* const regs = registers.data() + NV4097_SET_TRANSFORM_CONSTANT + index;
+		register_previous_value = regs[count - 1];
+
+		for (u32 i = 0; i < count; i++)
+		{
+			regs[i] = args[i];
+		}
+
+		// Ignore addresses outside the usable [0, 467] range
+		const u32 load = transform_constant_load();
+		const u32 limit = load < 468 ? (468 - load) * 4 : 0;
+
+		if (index + count > limit)
+		{
+			LOG_WARNING(RSX, "Invalid transform register index (load=%d, index=%d, count=%d)", load, index, count);
+
+			if (index >= limit)
+			{
+				return false;
+			}
+
+			count = limit - index;
+		}
+
+		// Constants are stored contiguously, index them through the flat array (a run can span several vectors)
+		u32* const dst = reinterpret_cast<u32*>(transform_constants.data()) + load * 4 + index;
+
+		if (std::memcmp(dst, regs, count * sizeof(u32)) == 0)
+		{
+			return false;
+		}
+
+		std::memcpy(dst, regs, count * sizeof(u32));
+		return true;
+	}
+
 	bool rsx_state::test(u32 reg, u32 value) const
 	{
 		return registers[reg] == value;
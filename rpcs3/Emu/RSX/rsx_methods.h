@@ -550,6 +550,9 @@ namespace rsx
 
 		void decode(u32 reg, u32 value);
 
+		// Bulk decode of NV4097_SET_TRANSFORM_CONSTANT + index run (big-endian args), returns true if constants changed
+		bool decode_transform_constants(u32 index, const be_t<u32>* args, u32 count);
+
 		bool test(u32 reg, u32 value) const;
 
 		void reset();
@@ -366,12 +366,20 @@ namespace rsx
 				T* dst = static_cast<T*>(output_pixels) + y * adv;
 				offs_x = offs_x0;
 
-				for (int x = 0; x < width; ++x)
+				// Bit 0 of x is always bit 0 of the offset, so texel pairs starting at even x are adjacent in memory
+				int x = 0;
+				for (; x + 1 < width; x += 2)
 				{
-					dst[x] = src[offs_x];
+					std::memcpy(dst + x, src + offs_x, sizeof(T) * 2);
+					offs_x = (offs_x - x_mask) & x_mask;
 					offs_x = (offs_x - x_mask) & x_mask;
 				}
 
+				if (x < width)
+				{
+					dst[x] = src[offs_x];
+				}
+
 				offs_y = (offs_y - y_mask) & y_mask;
 
 				if (offs_y == 0)
@@ -649,6 +657,38 @@ namespace rsx
 		return (surface->get_rsx_pitch() == pitch_required);
 	}
 
+	/**
+	 * Returns position of the first restart index in src[first, count), or count if there is none
+	 */
+	template <typename T>
+	int find_restart_index(const T* src, int first, int count, T restart_index)
+	{
+		static_assert(sizeof(T) == 2 || sizeof(T) == 4, "Unsupported index type");
+
+		constexpr int lanes = 16 / sizeof(T);
+		const __m128i restart = sizeof(T) == 2 ? _mm_set1_epi16(static_cast<s16>(restart_index)) : _mm_set1_epi32(static_cast<s32>(restart_index));
+
+		int n = first;
+		for (; n + lanes <= count; n += lanes)
+		{
+			const __m128i vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + n));
+			const __m128i cmp = sizeof(T) == 2 ? _mm_cmpeq_epi16(vec, restart) : _mm_cmpeq_epi32(vec, restart);
+
+			if (const u32 mask = _mm_movemask_epi8(cmp))
+			{
+				return n + utils::cnttz32(mask, true) / sizeof(T);
+			}
+		}
+
+		for (; n < count; ++n)
+		{
+			if (src[n] == restart_index)
+				break;
+		}
+
+		return n;
+	}
+
 	/**
 	 * Remove restart index and emulate using degenerate triangles
 	 * Can be used as a workaround when restart_index doesnt work too well
@@ -686,9 +726,12 @@ namespace rsx
 			}
 			else
 			{
-				dst[dst_index++] = index;
-				last_index = index;
-				++n;
+				// Copy the whole run up to the next restart index
+				const int end = find_restart_index(src, n, count, restart_index);
+				std::memcpy(dst + dst_index, src + n, (end - n) * sizeof(T));
+				dst_index += end - n;
+				last_index = src[end - 1];
+				n = end;
 			}
 		}
 
@@ -35,6 +35,7 @@
 #include <typeinfo>
 #include <queue>
 #include <fstream>
+#include <sstream>
 #include <memory>
 #include <regex>
 
@@ -219,6 +220,7 @@ void fmt_class_string<audio_renderer>::format(std::string& out, u64 arg)
 		case audio_renderer::pulse: return "PulseAudio";
 #endif
 		case audio_renderer::openal: return "OpenAL";
+		case audio_renderer::benchmark: return "Benchmark";
 		}
 
 		return unknown;
@@ -488,16 +490,34 @@ std::string Emulator::PPUCache() const
 	return _main->cache;
 }
 
-bool Emulator::BootRsxCapture(const std::string& path)
+bool Emulator::BootRsxCapture(const std::string& path, u32 bench_loops, const std::string& bench_output)
 {
 	if (!fs::is_file(path))
 		return false;
 
-	std::fstream f(path, std::ios::in | std::ios::binary);
+	// Memory data is read from the mapped file on demand
+	const auto storage = std::make_shared<rsx::capture_storage>();
+
+	if (!storage->open(path))
+	{
+		LOG_ERROR(LOADER, "Invalid or unsupported rsx capture file!");
+		return false;
+	}
+
+	const std::string frame_data = storage->read_frame();
+
+	if (frame_data.empty())
+	{
+		LOG_ERROR(LOADER, "Rsx capture file is incomplete!");
+		return false;
+	}
+
+	std::istringstream f(frame_data);
 
 	cereal::BinaryInputArchive archive(f);
 	std::unique_ptr<rsx::frame_capture_data> frame = std::make_unique<rsx::frame_capture_data>();
 	archive(*frame);
+	frame->storage = storage;
 
 	if (frame->magic != rsx::FRAME_CAPTURE_MAGIC)
 	{
@@ -514,6 +534,13 @@ bool Emulator::BootRsxCapture(const std::string& path)
 	Init();
 	g_cfg.video.disable_on_disk_shader_cache.set(true);
 
+	if (bench_loops)
+	{
+		// Benchmark the command processor only
+		g_cfg.video.renderer.from_string(fmt::format("%s", video_renderer::null));
+		g_cfg.video.frame_limit.from_string(fmt::format("%s", frame_limit_type::none));
+	}
+
 	vm::init();
 
 	// PS3 'executable'
@@ -529,7 +556,7 @@ bool Emulator::BootRsxCapture(const std::string& path)
 	GetCallbacks().on_run();
 	m_state = system_state::running;
 
-	fxm::make<named_thread<rsx::rsx_replay_thread>>("RSX Replay", std::move(frame));
+	fxm::make<named_thread<rsx::rsx_replay_thread>>("RSX Replay", std::move(frame), bench_loops, bench_output);
 
 	return true;
 }
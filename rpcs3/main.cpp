@@ -127,6 +127,12 @@ int main(int argc, char** argv)
 
 	const QCommandLineOption helpOption = parser.addHelpOption();
 	const QCommandLineOption versionOption = parser.addVersionOption();
+	const QCommandLineOption rsxBenchOption("rsx-bench", "Replay an RSX capture with the Null renderer and report command processor statistics as JSON.", "capture");
+	const QCommandLineOption rsxBenchLoopsOption("rsx-bench-loops", "Number of replays for --rsx-bench.", "count", "10");
+	const QCommandLineOption rsxBenchOutputOption("rsx-bench-output", "Write --rsx-bench results to a file instead of stdout.", "path");
+	parser.addOption(rsxBenchOption);
+	parser.addOption(rsxBenchLoopsOption);
+	parser.addOption(rsxBenchOutputOption);
 	parser.parse(QCoreApplication::arguments());
 	parser.process(app);
 
@@ -138,7 +144,20 @@ int main(int argc, char** argv)
 
 	QStringList args = parser.positionalArguments();
 
-	if (args.length() > 0)
+	if (parser.isSet(rsxBenchOption))
+	{
+		const u32 loops = std::max(parser.value(rsxBenchLoopsOption).toUInt(), 1u);
+
+		QTimer::singleShot(2, [path = sstr(QFileInfo(parser.value(rsxBenchOption)).canonicalFilePath()), loops, output = sstr(parser.value(rsxBenchOutputOption))]()
+		{
+			if (!Emu.BootRsxCapture(path, loops, output))
+			{
+				std::fprintf(stderr, "Failed to boot RSX capture: %s\n", path.c_str());
+				Emu.GetCallbacks().exit();
+			}
+		});
+	}
+	else if (args.length() > 0)
 	{
 		// Propagate command line arguments
 		std::vector<std::string> argv;
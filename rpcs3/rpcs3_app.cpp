@@ -38,6 +38,7 @@
 #include "Emu/RSX/GL/GLGSRender.h"
 #include "Emu/Audio/Null/NullAudioBackend.h"
 #include "Emu/Audio/AL/OpenALBackend.h"
+#include "Emu/Audio/Benchmark/BenchmarkAudioBackend.h"
 #ifdef _MSC_VER
 #include "Emu/RSX/D3D12/D3D12GSRender.h"
 #endif
@@ -270,6 +271,7 @@ void rpcs3_app::InitializeCallbacks()
 #endif
 
 		case audio_renderer::openal: return std::make_shared<OpenALBackend>();
+		case audio_renderer::benchmark: return std::make_shared<BenchmarkAudioBackend>();
 		default: fmt::throw_exception("Invalid audio renderer: %s" HERE, type);
 		}
 	};
@@ -45,6 +45,7 @@ public:
 		SetDAZandFTZ,
 		SPUBlockSize,
 		SPUCache,
+		SPUAsyncCompile,
 		DebugConsoleMode,
 		MaxSPURSThreads,
 
@@ -64,6 +65,7 @@ public:
 		DebugOverlay,
 		LegacyBuffers,
 		GPUTextureScaling,
+		CaptureFrameCount,
 		StretchToDisplayArea,
 		D3D12Adapter,
 		VulkanAdapter,
@@ -80,7 +82,9 @@ public:
 		DisableOnDiskShaderCache,
 		DisableVulkanMemAllocator,
 		DisableAsyncShaderCompiler,
+		ShaderPreloadThreshold,
 		MultithreadedRSX,
+		TextureCacheBudget,
 
 		// Performance Overlay
 		PerfOverlayEnabled,
@@ -256,6 +260,7 @@ private:
 		{ SetDAZandFTZ,             { "Core", "Set DAZ and FTZ"}},
 		{ SPUBlockSize,             { "Core", "SPU Block Size"}},
 		{ SPUCache,                 { "Core", "SPU Cache"}},
+		{ SPUAsyncCompile,          { "Core", "SPU Asynchronous Compilation"}},
 		{ DebugConsoleMode,         { "Core", "Debug Console Mode"}},
 		{ MaxSPURSThreads,          { "Core", "Max SPURS Threads"}},
 
@@ -275,6 +280,7 @@ private:
 		{ DebugOverlay,               { "Video", "Debug overlay"}},
 		{ LegacyBuffers,              { "Video", "Use Legacy OpenGL Buffers"}},
 		{ GPUTextureScaling,          { "Video", "Use GPU texture scaling"}},
+		{ CaptureFrameCount,          { "Video", "Frames To Capture"}},
 		{ StretchToDisplayArea,       { "Video", "Stretch To Display Area"}},
 		{ ForceHighpZ,                { "Video", "Force High Precision Z buffer"}},
 		{ StrictRenderingMode,        { "Video", "Strict Rendering Mode"}},
@@ -286,7 +292,9 @@ private:
 		{ DisableOnDiskShaderCache,   { "Video", "Disable On-Disk Shader Cache"}},
 		{ DisableVulkanMemAllocator,  { "Video", "Disable Vulkan Memory Allocator"}},
 		{ DisableAsyncShaderCompiler, { "Video", "Disable Asynchronous Shader Compiler"}},
+		{ ShaderPreloadThreshold,     { "Video", "Shader Preload Threshold (%)"}},
 		{ MultithreadedRSX,           { "Video", "Multithreaded RSX"}},
+		{ TextureCacheBudget,         { "Video", "Texture Cache Budget (MB)"}},
 		{ AnisotropicFilterOverride,  { "Video", "Anisotropic Filter Override"}},
 		{ ResolutionScale,            { "Video", "Resolution Scale"}},
 		{ MinimumScalableDimension,   { "Video", "Minimum Scalable Dimension"}},
@@ -172,6 +172,9 @@ settings_dialog::settings_dialog(std::shared_ptr<gui_settings> guiSettings, std:
 	xemu_settings->EnhanceCheckBox(ui->spuCache, emu_settings::SPUCache);
 	SubscribeTooltip(ui->spuCache, json_cpu_cbs["spuCache"].toString());
 
+	xemu_settings->EnhanceCheckBox(ui->spuAsyncCompile, emu_settings::SPUAsyncCompile);
+	SubscribeTooltip(ui->spuAsyncCompile, json_cpu_cbs["spuAsyncCompile"].toString());
+
 	xemu_settings->EnhanceCheckBox(ui->enableScheduler, emu_settings::EnableThreadScheduler);
 	SubscribeTooltip(ui->enableScheduler, json_cpu_cbs["enableThreadScheduler"].toString());
 
@@ -569,6 +572,18 @@ settings_dialog::settings_dialog(std::shared_ptr<gui_settings> guiSettings, std:
 	xemu_settings->EnhanceCheckBox(ui->disableAsyncShaders, emu_settings::DisableAsyncShaderCompiler);
 	SubscribeTooltip(ui->disableAsyncShaders, json_gpu_main["disableAsyncShaders"].toString());
 
+	// Every cached pipeline is linked before boot without the asynchronous compiler
+	xemu_settings->EnhanceSpinBox(ui->shaderPreloadThreshold, emu_settings::ShaderPreloadThreshold, "", tr("%"));
+	SubscribeTooltip(ui->shaderPreloadThreshold, json_gpu_main["shaderPreloadThreshold"].toString());
+	ui->shaderPreloadThreshold->setEnabled(!ui->disableAsyncShaders->isChecked());
+	connect(ui->disableAsyncShaders, &QCheckBox::clicked, [=](bool checked)
+	{
+		ui->shaderPreloadThreshold->setEnabled(!checked);
+	});
+
+	xemu_settings->EnhanceSpinBox(ui->textureCacheBudget, emu_settings::TextureCacheBudget, "", tr("MB"));
+	SubscribeTooltip(ui->textureCacheBudget, json_gpu_main["textureCacheBudget"].toString());
+
 	xemu_settings->EnhanceCheckBox(ui->scrictModeRendering, emu_settings::StrictRenderingMode);
 	SubscribeTooltip(ui->scrictModeRendering, json_gpu_main["scrictModeRendering"].toString());
 	connect(ui->scrictModeRendering, &QCheckBox::clicked, [=](bool checked)
@@ -783,7 +798,7 @@ settings_dialog::settings_dialog(std::shared_ptr<gui_settings> guiSettings, std:
 	};
 	auto EnableBuffering = [this, EnableBufferingOptions](const QString& text)
 	{
-		const bool enabled = text == "XAudio2" || text == "OpenAL";
+		const bool enabled = text == "XAudio2" || text == "OpenAL" || text == "Benchmark";
 		ui->enableBuffering->setEnabled(enabled);
 		EnableBufferingOptions(enabled && ui->enableBuffering->isChecked());
 	};
@@ -1345,6 +1360,10 @@ settings_dialog::settings_dialog(std::shared_ptr<gui_settings> guiSettings, std:
 	xemu_settings->EnhanceCheckBox(ui->gpuTextureScaling, emu_settings::GPUTextureScaling);
 	SubscribeTooltip(ui->gpuTextureScaling, json_debug["gpuTextureScaling"].toString());
 
+	// SpinBoxes: gpu debug options
+	xemu_settings->EnhanceSpinBox(ui->captureFrameCount, emu_settings::CaptureFrameCount);
+	SubscribeTooltip(ui->captureFrameCount, json_debug["captureFrameCount"].toString());
+
 	// Checkboxes: core debug options
 	xemu_settings->EnhanceCheckBox(ui->ppuDebug, emu_settings::PPUDebug);
 	SubscribeTooltip(ui->ppuDebug, json_debug["ppuDebug"].toString());
@@ -0,0 +1,115 @@
+#include "stdafx.h"
+#include "test.h"
+#include "Emu/Audio/Benchmark/BenchmarkAudioBackend.h"
+
+namespace
+{
+	struct benchmark_output
+	{
+		std::string csv;
+		std::string json;
+	};
+
+	std::vector<std::string> split_lines(const std::string& text)
+	{
+		std::vector<std::string> result;
+
+		for (std::size_t pos = 0; pos < text.size();)
+		{
+			const std::size_t end = text.find('\n', pos);
+			result.push_back(text.substr(pos, end - pos));
+			pos = end == std::string::npos ? text.size() : end + 1;
+		}
+
+		return result;
+	}
+
+	// Scripted cellAudio session at 48kHz (one sample every 20.83us): 10 periods of 4ms which enqueue a full buffer each,
+	// a 20ms stall which starves the device, then a restart at half speed.
+	// Host timings are replaced by fixed values so that the whole output is reproducible.
+	benchmark_output run_session(const std::string& path)
+	{
+		fs::remove_file(path + ".csv");
+		fs::remove_file(path + ".json");
+
+		BenchmarkAudioBackend backend(path);
+		backend.Open(8);
+
+		const u32 channels = AudioBackend::get_channels();
+		const std::vector<f32> buffer(2 * AUDIO_BUFFER_SAMPLES * channels);
+
+		u64 period = 0;
+		f32 ratio = 1.0f;
+
+		auto end_period = [&](u64 timestamp)
+		{
+			const u64 enqueued = backend.GetNumEnqueuedSamples();
+			backend.OnPeriodEnd({ timestamp, 1000 + period, 2000 + period * 10, enqueued, ratio, backend.IsPlaying() });
+			period++;
+		};
+
+		backend.Play();
+
+		for (; period < 10;)
+		{
+			CHECK(backend.AddData(buffer.data(), AUDIO_BUFFER_SAMPLES * channels));
+			end_period(period * 4000);
+		}
+
+		// Nothing enqueued for 20ms
+		end_period(56000);
+		CHECK(!backend.IsPlaying());
+
+		// Restart like cellAudio does after an underrun
+		backend.Flush();
+		ratio = backend.SetFrequencyRatio(0.5f);
+		CHECK(backend.AddData(buffer.data(), 2 * AUDIO_BUFFER_SAMPLES * channels));
+		backend.Play();
+		end_period(60000);
+
+		CHECK(backend.AddData(buffer.data(), AUDIO_BUFFER_SAMPLES * channels));
+		end_period(64000);
+
+		backend.Close();
+		return { fs::file(path + ".csv").to_string(), fs::file(path + ".json").to_string() };
+	}
+}
+
+TEST_CASE(audio_benchmark_output)
+{
+	CHECK(AudioBackend::get_sampling_rate() == 48000);
+
+	const auto first = run_session(test::get_temp_dir() + "audio_benchmark");
+	const auto second = run_session(test::get_temp_dir() + "audio_benchmark");
+
+	// The simulated device does not depend on the host clock
+	CHECK(first.csv == second.csv);
+	CHECK(first.json == second.json);
+
+	const auto rows = split_lines(first.csv);
+	CHECK_MSG(rows.size() == 14, "%u rows", rows.size());
+	CHECK(rows[0] == "timestamp_us,mix_time_ns,period_time_ns,enqueue_delta_us,enqueued_samples,device_samples,frequency_ratio,playing");
+
+	// Every 4ms period drains 192 samples and adds 256
+	CHECK_MSG(rows[1] == "0,1000,2000,-1,256,256,1.0000,1", "%s", rows[1]);
+	CHECK_MSG(rows[2] == "4000,1001,2010,4000,512,320,1.0000,1", "%s", rows[2]);
+	CHECK_MSG(rows[10] == "36000,1009,2090,4000,1024,832,1.0000,1", "%s", rows[10]);
+
+	// 960 samples would have been played during the stall, cellAudio only notices the underrun in the next period
+	CHECK_MSG(rows[11] == "56000,1010,2100,-1,832,0,1.0000,1", "%s", rows[11]);
+
+	// Restarted: nothing is drained before playback resumes, then 96 samples per period at half speed
+	CHECK_MSG(rows[12] == "60000,1011,2110,24000,512,512,0.5000,1", "%s", rows[12]);
+	CHECK_MSG(rows[13] == "64000,1012,2120,4000,768,672,0.5000,1", "%s", rows[13]);
+
+	const auto contains = [&](const char* text)
+	{
+		return first.json.find(text) != std::string::npos;
+	};
+
+	CHECK_MSG(contains("\"periods\": 13, \"dropped_periods\": 0, \"duration_us\": 64000, \"sampling_rate\": 48000"), "%s", first.json);
+	CHECK_MSG(contains("\"mix_time_ns\": {\"min\": 1000, \"avg\": 1006, \"p99\": 1012, \"max\": 1012}"), "%s", first.json);
+	CHECK_MSG(contains("\"period_time_ns\": {\"min\": 2000, \"avg\": 2060, \"p99\": 2120, \"max\": 2120}"), "%s", first.json);
+	CHECK_MSG(contains("\"enqueue_interval_us\": {\"avg\": 5818.2, \"jitter\": 5749.6, \"max\": 24000}"), "%s", first.json);
+	CHECK_MSG(contains("\"frequency_ratio\": {\"min\": 0.5000, \"max\": 1.0000}, \"underruns\": 1}"), "%s", first.json);
+}
@@ -0,0 +1,198 @@
+#include "stdafx.h"
+#include "test.h"
+#include "Emu/Cell/Modules/cellAudio.h"
+
+#include <cmath>
+
+namespace
+{
+	struct test_port
+	{
+		u32 channels;
+		bool ramp;
+		std::vector<be_t<f32>> data;
+		std::vector<float> volume;
+	};
+
+	float random_float(test::random& rng, float min, float max)
+	{
+		return min + (max - min) * (rng.next() % 0x10000) / float(0xFFFF);
+	}
+
+	test_port make_port(test::random& rng, u32 channels, bool ramp)
+	{
+		test_port port{ channels, ramp, std::vector<be_t<f32>>(channels * AUDIO_BUFFER_SAMPLES), std::vector<float>(AUDIO_BUFFER_SAMPLES) };
+
+		for (auto& sample : port.data)
+		{
+			sample = random_float(rng, -1.f, 1.f);
+		}
+
+		for (auto& level : port.volume)
+		{
+			level = random_float(rng, 0.f, 1.f);
+		}
+
+		return port;
+	}
+
+	// Scalar reference, one frame and one channel at a time as the mixer did before it was vectorized
+	void mix_port_reference(float* out, const test_port& port, bool downmix_to_stereo, bool first_mix)
+	{
+		const u32 out_channels = downmix_to_stereo ? 2 : 8;
+
+		for (u32 frame = 0; frame < AUDIO_BUFFER_SAMPLES; frame++)
+		{
+			const float m = port.ramp ? port.volume[frame] : port.volume[0];
+			const be_t<f32>* in = port.data.data() + frame * port.channels;
+			float* dst = out + frame * out_channels;
+
+			float mixed[8]{};
+			u32 count = 2;
+
+			if (port.channels == 2)
+			{
+				mixed[0] = in[0] * m;
+				mixed[1] = in[1] * m;
+
+				// The first port clears the channels it does not cover
+				if (first_mix) count = out_channels;
+			}
+			else if (downmix_to_stereo)
+			{
+				const float mid = (in[2] * m + in[3] * m) * 0.708f;
+				mixed[0] = in[0] * m + in[4] * m + in[6] * m + mid;
+				mixed[1] = in[1] * m + in[5] * m + in[7] * m + mid;
+			}
+			else
+			{
+				for (u32 c = 0; c < 8; c++) mixed[c] = in[c] * m;
+				count = 8;
+			}
+
+			for (u32 c = 0; c < count; c++)
+			{
+				dst[c] = first_mix ? mixed[c] : dst[c] + mixed[c];
+			}
+		}
+	}
+
+	s16 convert_to_s16_reference(float value)
+	{
+		// CVTPS2DQ rounds to nearest even, as lrint does by default
+		const long result = std::lrint(std::min(std::max(value, -1.f), 1.f) * 32768.f);
+		return static_cast<s16>(std::min<long>(std::max<long>(result, -32768), 32767));
+	}
+
+	void mix_ports(float* out, const std::vector<test_port>& ports, bool downmix_to_stereo)
+	{
+		bool first_mix = true;
+
+		for (const auto& port : ports)
+		{
+			audio_mixer::mix_port(out, port.data.data(), port.channels, downmix_to_stereo, port.volume.data(), first_mix, port.ramp);
+			first_mix = false;
+		}
+	}
+
+	void mix_ports_reference(float* out, const std::vector<test_port>& ports, bool downmix_to_stereo)
+	{
+		bool first_mix = true;
+
+		for (const auto& port : ports)
+		{
+			mix_port_reference(out, port, downmix_to_stereo, first_mix);
+			first_mix = false;
+		}
+	}
+}
+
+TEST_CASE(audio_mixer_matches_scalar)
+{
+	test::random rng;
+
+	alignas(32) float out[AUDIO_MAX_CHANNELS_COUNT * AUDIO_BUFFER_SAMPLES];
+	alignas(32) float expected[AUDIO_MAX_CHANNELS_COUNT * AUDIO_BUFFER_SAMPLES];
+
+	for (u32 iteration = 0; iteration < 25; iteration++)
+	{
+		for (u32 port_count = 1; port_count <= 8; port_count++)
+		{
+			std::vector<test_port> ports;
+
+			for (u32 i = 0; i < port_count; i++)
+			{
+				ports.push_back(make_port(rng, rng.next() % 2 ? 8 : 2, rng.next() % 2 != 0));
+			}
+
+			for (const bool downmix_to_stereo : { true, false })
+			{
+				const u32 count = (downmix_to_stereo ? 2 : 8) * AUDIO_BUFFER_SAMPLES;
+
+				mix_ports(out, ports, downmix_to_stereo);
+				mix_ports_reference(expected, ports, downmix_to_stereo);
+
+				// The kernels round exactly like the scalar code, the tolerance only covers FMA contraction in the reference
+				for (u32 i = 0; i < count; i++)
+				{
+					CHECK_MSG(std::abs(out[i] - expected[i]) <= 1e-6f * std::max(1.f, std::abs(expected[i])),
+						"ports=%u downmix=%d sample %u: %f, expected %f", port_count, downmix_to_stereo, i, out[i], expected[i]);
+				}
+
+				// Sums of several ports go past [-1, 1] and exercise the clipping
+				std::memcpy(expected, out, count * sizeof(float));
+				audio_mixer::convert_to_s16(out, count);
+
+				for (u32 i = 0; i < count; i++)
+				{
+					const s16 value = reinterpret_cast<const s16*>(out)[i];
+					CHECK_MSG(value == convert_to_s16_reference(expected[i]), "ports=%u downmix=%d sample %u: %d from %f", port_count, downmix_to_stereo, i, value, expected[i]);
+				}
+			}
+		}
+	}
+}
+
+BENCHMARK(audio_mixer)
+{
+	test::random rng;
+
+	alignas(32) float out[AUDIO_MAX_CHANNELS_COUNT * AUDIO_BUFFER_SAMPLES];
+
+	for (const u32 in_channels : { 2, 8 })
+	{
+		for (const bool downmix_to_stereo : { true, false })
+		{
+			const u32 count = (downmix_to_stereo ? 2 : 8) * AUDIO_BUFFER_SAMPLES;
+
+			for (u32 port_count = 1; port_count <= 8; port_count++)
+			{
+				std::vector<test_port> ports;
+
+				for (u32 i = 0; i < port_count; i++)
+				{
+					// Half of the ports ramp their volume
+					ports.push_back(make_port(rng, in_channels, i % 2 != 0));
+				}
+
+				const auto label = fmt::format("%uch x%u ports -> %uch", in_channels, port_count, downmix_to_stereo ? 2 : 8);
+
+				test::measure(label + " mix + s16 (per block)", [&]()
+				{
+					mix_ports(out, ports, downmix_to_stereo);
+					audio_mixer::convert_to_s16(out, count);
+				});
+
+				test::measure(label + " scalar reference", [&]()
+				{
+					mix_ports_reference(out, ports, downmix_to_stereo);
+
+					for (u32 i = 0; i < count; i++)
+					{
+						reinterpret_cast<s16*>(out)[i] = convert_to_s16_reference(out[i]);
+					}
+				});
+			}
+		}
+	}
+}
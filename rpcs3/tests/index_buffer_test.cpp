@@ -0,0 +1,466 @@
+#include "stdafx.h"
+#include "test.h"
+#include "Emu/RSX/Common/BufferUtils.h"
+#include "Emu/RSX/rsx_utils.h"
+
+#include <limits>
+
+namespace
+{
+	// Guard entries after every destination span, nothing may be written there
+	constexpr u32 guard_size = 16;
+
+	const rsx::primitive_type s_primitive_types[] =
+	{
+		rsx::primitive_type::points,
+		rsx::primitive_type::lines,
+		rsx::primitive_type::line_loop,
+		rsx::primitive_type::line_strip,
+		rsx::primitive_type::triangles,
+		rsx::primitive_type::triangle_strip,
+		rsx::primitive_type::triangle_fan,
+		rsx::primitive_type::quads,
+		rsx::primitive_type::quad_strip,
+		rsx::primitive_type::polygon,
+	};
+
+	const char* get_primitive_name(rsx::primitive_type mode)
+	{
+		switch (mode)
+		{
+		case rsx::primitive_type::points: return "points";
+		case rsx::primitive_type::lines: return "lines";
+		case rsx::primitive_type::line_loop: return "line_loop";
+		case rsx::primitive_type::line_strip: return "line_strip";
+		case rsx::primitive_type::triangles: return "triangles";
+		case rsx::primitive_type::triangle_strip: return "triangle_strip";
+		case rsx::primitive_type::triangle_fan: return "triangle_fan";
+		case rsx::primitive_type::quads: return "quads";
+		case rsx::primitive_type::quad_strip: return "quad_strip";
+		case rsx::primitive_type::polygon: return "polygon";
+		case rsx::primitive_type::invalid: break;
+		}
+
+		return "invalid";
+	}
+
+	template <typename T>
+	struct index_result
+	{
+		T min = std::numeric_limits<T>::max();
+		T max = 0;
+		std::vector<T> indices;
+
+		T track(T index)
+		{
+			min = std::min(min, index);
+			max = std::max(max, index);
+			return index;
+		}
+	};
+
+	// Scalar reference of write_index_array_data_to_buffer, on host endian indices
+	template <typename T>
+	index_result<T> upload_reference(const std::vector<T>& src, rsx::primitive_type mode, bool restart_enabled, u32 restart_index, bool expand)
+	{
+		constexpr T invalid_index = std::numeric_limits<T>::max();
+		const bool use_restart = restart_enabled && restart_index <= invalid_index;
+
+		index_result<T> result;
+
+		if (!expand || mode == rsx::primitive_type::line_loop)
+		{
+			const bool skip_restart = is_primitive_disjointed(mode);
+
+			for (const T index : src)
+			{
+				if (use_restart && index == restart_index)
+				{
+					if (!skip_restart) result.indices.push_back(invalid_index);
+					continue;
+				}
+
+				result.indices.push_back(result.track(index));
+			}
+
+			if (expand && !result.indices.empty())
+			{
+				result.indices.push_back(result.indices[0]);
+			}
+
+			return result;
+		}
+
+		if (mode == rsx::primitive_type::quads)
+		{
+			T quad[4];
+			u32 size = 0;
+
+			for (const T index : src)
+			{
+				if (use_restart && index == restart_index)
+				{
+					size = 0;
+					continue;
+				}
+
+				quad[size++] = result.track(index);
+
+				if (size == 4)
+				{
+					result.indices.insert(result.indices.end(), { quad[0], quad[1], quad[2], quad[2], quad[3], quad[0] });
+					size = 0;
+				}
+			}
+
+			return result;
+		}
+
+		// Triangle fan and polygon, only the last index of every triangle contributes to the range
+		bool needs_anchor = true;
+		T anchor = invalid_index;
+		T last_index = invalid_index;
+
+		for (const T index : src)
+		{
+			if (use_restart && index == restart_index)
+			{
+				needs_anchor = true;
+				last_index = invalid_index;
+				continue;
+			}
+
+			if (needs_anchor)
+			{
+				anchor = index;
+				needs_anchor = false;
+			}
+			else if (last_index == invalid_index)
+			{
+				last_index = index;
+			}
+			else
+			{
+				result.indices.insert(result.indices.end(), { anchor, last_index, result.track(index) });
+				last_index = index;
+			}
+		}
+
+		return result;
+	}
+
+	template <typename T>
+	constexpr rsx::index_array_type get_index_array_type()
+	{
+		return sizeof(T) == 2 ? rsx::index_array_type::u16 : rsx::index_array_type::u32;
+	}
+
+	template <typename T>
+	std::vector<T> make_indices(test::random& rng, u32 count, bool insert_restart, T restart_index)
+	{
+		std::vector<T> indices(count);
+
+		for (u32 i = 0; i < count; i++)
+		{
+			// Restart index is never the first one, remove_restart_index has nothing to duplicate there
+			indices[i] = insert_restart && i && rng.next() % 8 == 0 ? restart_index : static_cast<T>(rng.next() % 48);
+		}
+
+		return indices;
+	}
+
+	u32 get_output_size(rsx::primitive_type mode, u32 count, bool expand)
+	{
+		if (!expand) return count;
+
+		// The quad kernel requires room for all complete quads
+		if (mode == rsx::primitive_type::quads) return ::align(count, 4) * 6 / 4;
+
+		return get_index_count(mode, count);
+	}
+
+	template <typename T>
+	void check_index_upload(const std::vector<T>& src, rsx::primitive_type mode, bool restart_enabled, u32 restart_index, bool expand)
+	{
+		std::vector<be_t<T>> src_be(src.begin(), src.end());
+
+		const u32 dst_count = get_output_size(mode, ::size32(src), expand);
+		std::vector<T> dst(dst_count + guard_size, 0x5A);
+
+		const auto result = write_index_array_data_to_buffer(
+			{ reinterpret_cast<gsl::byte*>(dst.data()), ::narrow<int>(dst_count * sizeof(T)) },
+			{ reinterpret_cast<const gsl::byte*>(src_be.data()), ::narrow<int>(src_be.size() * sizeof(T)) },
+			get_index_array_type<T>(), mode, restart_enabled, restart_index, [expand](rsx::primitive_type) { return expand; });
+
+		const auto expected = upload_reference(src, mode, restart_enabled, restart_index, expand);
+		const auto context = fmt::format("index size=%u mode=%s count=%u restart=%d restart_index=0x%x expand=%d", sizeof(T), get_primitive_name(mode), src.size(), restart_enabled, restart_index, expand);
+
+		CHECK_MSG(std::get<2>(result) == expected.indices.size(), "%s: %u indices written, expected %u", context, std::get<2>(result), expected.indices.size());
+		CHECK_MSG(std::equal(expected.indices.begin(), expected.indices.end(), dst.begin()), "%s: indices differ", context);
+		CHECK_MSG(std::all_of(dst.begin() + dst_count, dst.end(), [](T value) { return value == T(0x5A); }), "%s: wrote past the end of the buffer", context);
+
+		// The range is meaningless when nothing was tracked, but both sides must still agree
+		CHECK_MSG(std::get<0>(result) == expected.min && std::get<1>(result) == expected.max, "%s: range [%u, %u], expected [%u, %u]",
+			context, std::get<0>(result), std::get<1>(result), expected.min, expected.max);
+	}
+
+	template <typename T>
+	void check_index_uploads(const std::vector<u32>& restart_indices)
+	{
+		test::random rng(sizeof(T));
+
+		std::vector<u32> counts;
+		for (u32 count = 4; count <= 80; count++) counts.push_back(count);
+		counts.insert(counts.end(), { 255, 256, 1024, 4099 });
+
+		for (const auto mode : s_primitive_types)
+		{
+			for (u32 count : counts)
+			{
+				for (const bool expand : { false, true })
+				{
+					if (expand && is_primitive_native(mode))
+					{
+						continue;
+					}
+
+					if (expand && mode == rsx::primitive_type::quads)
+					{
+						count = ::align(count, 4);
+					}
+
+					const auto plain = make_indices<T>(rng, count, false, 0);
+					check_index_upload(plain, mode, false, 0, expand);
+
+					for (const u32 restart_index : restart_indices)
+					{
+						// Without restart indices in the data the result must match the disabled path
+						check_index_upload(plain, mode, true, restart_index, expand);
+						check_index_upload(make_indices<T>(rng, count, true, static_cast<T>(restart_index)), mode, true, restart_index, expand);
+					}
+				}
+			}
+		}
+	}
+
+	// Scalar reference of rsx::remove_restart_index
+	template <typename T>
+	std::vector<T> remove_restart_index_reference(const std::vector<T>& src, T restart_index)
+	{
+		std::vector<T> dst;
+		T last_index = 0;
+
+		for (u32 n = 0; n < src.size();)
+		{
+			if (src[n] != restart_index)
+			{
+				dst.push_back(last_index = src[n++]);
+				continue;
+			}
+
+			while (n < src.size() && src[n] == restart_index) n++;
+
+			if (n == src.size()) break;
+
+			dst.push_back(last_index);
+			if (dst.size() % 2 == 0) dst.push_back(last_index);
+			dst.push_back(last_index = src[n]);
+		}
+
+		return dst;
+	}
+
+	template <typename T>
+	void check_remove_restart_index()
+	{
+		test::random rng(sizeof(T) + 1);
+		const T restart_index = std::numeric_limits<T>::max();
+
+		for (u32 count = 1; count <= 300; count++)
+		{
+			auto src = make_indices<T>(rng, count, true, restart_index);
+			std::vector<T> dst(count * 2 + guard_size, 0x5A);
+
+			const u32 written = rsx::remove_restart_index(dst.data(), src.data(), count, restart_index);
+			const auto expected = remove_restart_index_reference(src, restart_index);
+
+			CHECK_MSG(written == expected.size() && std::equal(expected.begin(), expected.end(), dst.begin()), "index size=%u count=%u", sizeof(T), count);
+			CHECK_MSG(std::all_of(dst.begin() + count * 2, dst.end(), [](T value) { return value == T(0x5A); }), "index size=%u count=%u: wrote past the end", sizeof(T), count);
+		}
+	}
+}
+
+TEST_CASE(index_upload_u16_matches_scalar)
+{
+	// 0x10000 cannot match any u16 index and must behave as if restart was disabled
+	check_index_uploads<u16>({ 0xFFFF, 7, 0x10000 });
+}
+
+TEST_CASE(index_upload_u32_matches_scalar)
+{
+	check_index_uploads<u32>({ 0xFFFFFFFF, 7 });
+}
+
+TEST_CASE(index_upload_line_loop)
+{
+	auto run = [](auto type_tag)
+	{
+		using T = decltype(type_tag);
+		test::random rng(sizeof(T) + 2);
+
+		const T restart_index = std::numeric_limits<T>::max();
+
+		for (u32 count = 1; count <= 100; count++)
+		{
+			for (const bool restart : { false, true })
+			{
+				const auto src = make_indices<T>(rng, count, restart, restart_index);
+				const std::vector<be_t<T>> src_be(src.begin(), src.end());
+
+				// Callers allocate get_index_count() indices, the closing index is written past the source ones
+				const u32 dst_count = get_index_count(rsx::primitive_type::line_loop, count);
+				std::vector<T> dst(dst_count + guard_size, 0x5A);
+
+				const auto result = write_index_array_data_to_buffer(
+					{ reinterpret_cast<gsl::byte*>(dst.data()), ::narrow<int>(dst_count * sizeof(T)) },
+					{ reinterpret_cast<const gsl::byte*>(src_be.data()), ::narrow<int>(count * sizeof(T)) },
+					get_index_array_type<T>(), rsx::primitive_type::line_loop, restart, restart_index, [](rsx::primitive_type) { return true; });
+
+				const u32 written = std::get<2>(result);
+
+				CHECK_MSG(dst_count == count + 1, "index size=%u count=%u: %u indices allocated", sizeof(T), count, dst_count);
+				CHECK_MSG(written == count + 1, "index size=%u count=%u restart=%d: %u indices written", sizeof(T), count, restart, written);
+				CHECK_MSG(dst[written - 1] == dst[0] && dst[0] == src[0], "index size=%u count=%u restart=%d: the loop isn't closed", sizeof(T), count, restart);
+				CHECK_MSG(std::all_of(dst.begin() + dst_count, dst.end(), [](T value) { return value == T(0x5A); }), "index size=%u count=%u: wrote past the end", sizeof(T), count);
+			}
+		}
+
+		// Nothing to close
+		const std::vector<be_t<T>> src_be;
+		std::vector<T> dst(guard_size, 0x5A);
+
+		const auto result = write_index_array_data_to_buffer(
+			{ reinterpret_cast<gsl::byte*>(dst.data()), ::narrow<int>(src_be.size() * sizeof(T)) },
+			{ reinterpret_cast<const gsl::byte*>(src_be.data()), ::narrow<int>(src_be.size() * sizeof(T)) },
+			get_index_array_type<T>(), rsx::primitive_type::line_loop, false, 0, [](rsx::primitive_type) { return true; });
+
+		CHECK(std::get<2>(result) == 0);
+		CHECK(std::all_of(dst.begin(), dst.end(), [](T value) { return value == T(0x5A); }));
+	};
+
+	run(u16{});
+	run(u32{});
+}
+
+TEST_CASE(non_indexed_expansion_matches_scalar)
+{
+	const rsx::primitive_type modes[] = { rsx::primitive_type::line_loop, rsx::primitive_type::triangle_fan, rsx::primitive_type::polygon, rsx::primitive_type::quads };
+
+	for (const auto mode : modes)
+	{
+		for (u32 count = 3; count <= 300; count++)
+		{
+			if (mode == rsx::primitive_type::quads && count % 4)
+			{
+				// Not a valid quad draw, the index count cannot be derived
+				continue;
+			}
+
+			std::vector<u16> expected;
+
+			switch (mode)
+			{
+			case rsx::primitive_type::line_loop:
+				for (u32 i = 0; i < count; i++) expected.push_back(i);
+				expected.push_back(0);
+				break;
+			case rsx::primitive_type::quads:
+				for (u32 i = 0; i < count / 4; i++) expected.insert(expected.end(), { u16(4 * i), u16(4 * i + 1), u16(4 * i + 2), u16(4 * i + 2), u16(4 * i + 3), u16(4 * i) });
+				break;
+			default:
+				for (u32 i = 0; i < count - 2; i++) expected.insert(expected.end(), { u16(0), u16(i + 1), u16(i + 2) });
+				break;
+			}
+
+			std::vector<u16> dst(get_index_count(mode, count) + guard_size, 0x5A);
+			write_index_array_for_non_indexed_non_native_primitive_to_buffer(reinterpret_cast<char*>(dst.data()), mode, count);
+
+			CHECK_MSG(expected.size() == get_index_count(mode, count), "mode=%s count=%u: index count mismatch", get_primitive_name(mode), count);
+			CHECK_MSG(std::equal(expected.begin(), expected.end(), dst.begin()), "mode=%s count=%u: indices differ", get_primitive_name(mode), count);
+			CHECK_MSG(std::all_of(dst.begin() + expected.size(), dst.end(), [](u16 value) { return value == 0x5A; }), "mode=%s count=%u: wrote past the end", get_primitive_name(mode), count);
+		}
+	}
+}
+
+TEST_CASE(remove_restart_index_matches_scalar)
+{
+	check_remove_restart_index<u16>();
+	check_remove_restart_index<u32>();
+}
+
+BENCHMARK(index_upload)
+{
+	constexpr u32 count = 1 << 16;
+
+	struct config
+	{
+		rsx::primitive_type mode;
+		bool restart;
+	};
+
+	const config configs[] =
+	{
+		{ rsx::primitive_type::triangles, false },
+		{ rsx::primitive_type::triangles, true },
+		{ rsx::primitive_type::triangle_strip, true },
+		{ rsx::primitive_type::triangle_fan, false },
+		{ rsx::primitive_type::quads, false },
+	};
+
+	auto run = [&](auto type_tag)
+	{
+		using T = decltype(type_tag);
+		test::random rng;
+
+		for (const auto& entry : configs)
+		{
+			const T restart_index = std::numeric_limits<T>::max();
+			const auto src = make_indices<T>(rng, count, entry.restart, restart_index);
+			const std::vector<be_t<T>> src_be(src.begin(), src.end());
+			const bool expand = !is_primitive_native(entry.mode);
+			std::vector<T> dst(get_index_count(entry.mode, count));
+
+			const auto label = fmt::format("u%u mode=%s restart=%d", sizeof(T) * 8, get_primitive_name(entry.mode), entry.restart);
+
+			test::measure(label + " kernel (per index)", [&]()
+			{
+				write_index_array_data_to_buffer({ reinterpret_cast<gsl::byte*>(dst.data()), ::narrow<int>(dst.size() * sizeof(T)) },
+					{ reinterpret_cast<const gsl::byte*>(src_be.data()), ::narrow<int>(count * sizeof(T)) },
+					get_index_array_type<T>(), entry.mode, entry.restart, restart_index, [](rsx::primitive_type prim) { return !is_primitive_native(prim); });
+			}, count);
+
+			test::measure(label + " scalar reference", [&]()
+			{
+				upload_reference(src, entry.mode, entry.restart, restart_index, expand);
+			}, count);
+		}
+
+		const auto src = make_indices<T>(rng, count, true, std::numeric_limits<T>::max());
+		std::vector<T> dst(count * 2);
+
+		test::measure(fmt::format("u%u remove_restart_index (per index)", sizeof(T) * 8), [&]()
+		{
+			rsx::remove_restart_index(dst.data(), const_cast<T*>(src.data()), count, std::numeric_limits<T>::max());
+		}, count);
+	};
+
+	run(u16{});
+	run(u32{});
+
+	std::vector<u16> dst(get_index_count(rsx::primitive_type::quads, count));
+
+	test::measure("non-indexed quads (per vertex)", [&]()
+	{
+		write_index_array_for_non_indexed_non_native_primitive_to_buffer(reinterpret_cast<char*>(dst.data()), rsx::primitive_type::quads, count);
+	}, count);
+}
@@ -0,0 +1,160 @@
+#include "stdafx.h"
+#include "test.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace test
+{
+	struct failure : std::runtime_error
+	{
+		using std::runtime_error::runtime_error;
+	};
+
+	std::vector<test_case>& get_cases()
+	{
+		static std::vector<test_case> cases;
+		return cases;
+	}
+
+	static std::vector<std::string> s_data_paths;
+
+	const std::vector<std::string>& get_data_paths()
+	{
+		return s_data_paths;
+	}
+
+	const std::string& get_temp_dir()
+	{
+		static const std::string s_dir = []
+		{
+			const std::string dir = fs::get_cache_dir() + "test/";
+			fs::create_path(dir);
+			return dir;
+		}();
+
+		return s_dir;
+	}
+
+	void fail(const char* expr, const char* file, int line, const std::string& message)
+	{
+		std::string what = fmt::format("%s:%d: CHECK(%s) failed", file, line, expr);
+
+		if (!message.empty())
+		{
+			what += ": ";
+			what += message;
+		}
+
+		throw failure(what);
+	}
+
+	double measure(const std::string& label, const std::function<void()>& func, u64 units_per_call)
+	{
+		using clock = std::chrono::steady_clock;
+
+		// Warm up caches and lazily initialized state
+		func();
+
+		u64 calls = 1;
+		double elapsed = 0.;
+
+		while (true)
+		{
+			const auto start = clock::now();
+
+			for (u64 i = 0; i < calls; i++)
+			{
+				func();
+			}
+
+			elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+			if (elapsed >= 2e8 || calls >= (1ull << 30))
+			{
+				break;
+			}
+
+			calls *= 2;
+		}
+
+		const double ns = elapsed / double(calls * units_per_call);
+		std::printf("  %-56s %12.2f ns %14.0f /s\n", label.c_str(), ns, 1e9 / ns);
+		std::fflush(stdout);
+		return ns;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool run_benchmarks = false;
+	std::vector<const char*> filters;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--bench") == 0)
+		{
+			run_benchmarks = true;
+		}
+		else if (std::strcmp(argv[i], "--list") == 0)
+		{
+			for (const auto& entry : test::get_cases())
+			{
+				std::printf("%s%s\n", entry.name, entry.is_benchmark ? " (benchmark)" : "");
+			}
+
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--data") == 0 && i + 1 < argc)
+		{
+			test::s_data_paths.emplace_back(argv[++i]);
+		}
+		else if (argv[i][0] == '-')
+		{
+			std::printf("Usage: %s [--bench] [--list] [--data path...] [name filter...]\n", argv[0]);
+			return 1;
+		}
+		else
+		{
+			filters.push_back(argv[i]);
+		}
+	}
+
+	u32 passed = 0;
+	u32 failed = 0;
+
+	for (const auto& entry : test::get_cases())
+	{
+		if (entry.is_benchmark != run_benchmarks)
+		{
+			continue;
+		}
+
+		if (!filters.empty() && std::none_of(filters.begin(), filters.end(), [&](const char* filter) { return std::strstr(entry.name, filter) != nullptr; }))
+		{
+			continue;
+		}
+
+		std::printf("[ RUN  ] %s\n", entry.name);
+		std::fflush(stdout);
+
+		try
+		{
+			entry.func();
+			std::printf("[  OK  ] %s\n", entry.name);
+			passed++;
+		}
+		catch (const std::exception& e)
+		{
+			std::printf("[ FAIL ] %s\n  %s\n", entry.name, e.what());
+			failed++;
+		}
+
+		std::fflush(stdout);
+	}
+
+	std::printf("%u passed, %u failed\n", passed, failed);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,298 @@
+#include "stdafx.h"
+#include "test.h"
+#include "Utilities/pack_archive.h"
+
+namespace
+{
+	constexpr u32 c_version = 3;
+	constexpr u32 c_tag = "TEST"_u32;
+	constexpr u32 c_other_tag = "ANOT"_u32;
+
+	std::vector<u8> make_data(test::random& rng, u32 size)
+	{
+		std::vector<u8> result(size);
+		rng.fill(result.data(), size);
+		return result;
+	}
+
+	bool equals(const utils::pack_archive::blob& blob, const std::vector<u8>& data)
+	{
+		return blob && blob.size == data.size() && std::equal(data.begin(), data.end(), blob.data);
+	}
+
+	// Fresh archive file, removed when the test ends
+	struct temp_pack
+	{
+		const std::string path;
+
+		temp_pack(const std::string& name)
+			: path(test::get_temp_dir() + name)
+		{
+			fs::remove_file(path);
+			fs::remove_file(path + ".tmp");
+		}
+
+		~temp_pack()
+		{
+			fs::remove_file(path);
+			fs::remove_file(path + ".tmp");
+		}
+	};
+}
+
+TEST_CASE(pack_archive_round_trip)
+{
+	test::random rng;
+	temp_pack file("pack_archive_round_trip.pack");
+
+	std::vector<std::vector<u8>> blobs;
+
+	{
+		utils::pack_archive pack;
+		CHECK(pack.open(file.path, c_version));
+		CHECK(pack.is_writable());
+
+		for (u32 i = 0; i < 64; i++)
+		{
+			// Include empty and unaligned sizes, every other blob isn't kept in memory
+			blobs.push_back(make_data(rng, i * 13 % 97));
+			CHECK(pack.append(c_tag, i, blobs[i].data(), ::size32(blobs[i]), i % 2 == 0));
+		}
+
+		CHECK(pack.append(c_other_tag, 0, blobs[5].data(), ::size32(blobs[5])));
+
+		// Keys are unique per tag
+		CHECK(!pack.append(c_tag, 0, blobs[1].data(), ::size32(blobs[1])));
+
+		for (u32 i = 0; i < 64; i++)
+		{
+			CHECK_MSG(pack.contains(c_tag, i), "key %u", i);
+			CHECK_MSG(i % 2 ? !pack.find(c_tag, i) : equals(pack.find(c_tag, i), blobs[i]), "key %u", i);
+		}
+
+		CHECK(pack.count(c_tag) == 64);
+		CHECK(pack.get_all(c_tag).size() == 32);
+		CHECK(equals(pack.find(c_other_tag, 0), blobs[5]));
+		CHECK(!pack.find(c_other_tag, 1));
+		CHECK(pack.get_garbage_size() == 0);
+	}
+
+	// Everything can be read after reopening, in the order it was appended
+	utils::pack_archive pack;
+	CHECK(pack.open(file.path, c_version));
+
+	const auto all = pack.get_all(c_tag);
+	CHECK(all.size() == 64);
+
+	for (u32 i = 0; i < all.size(); i++)
+	{
+		CHECK_MSG(all[i].key == i && all[i].tag == c_tag && equals(all[i], blobs[i]), "key %u", i);
+	}
+
+	CHECK(pack.count(c_other_tag) == 1);
+}
+
+TEST_CASE(pack_archive_remove)
+{
+	test::random rng;
+	temp_pack file("pack_archive_remove.pack");
+
+	const auto a = make_data(rng, 100);
+	const auto b = make_data(rng, 40);
+
+	{
+		utils::pack_archive pack;
+		CHECK(pack.open(file.path, c_version));
+		CHECK(pack.append(c_tag, 1, a.data(), ::size32(a)));
+		CHECK(pack.append(c_tag, 2, a.data(), ::size32(a)));
+		CHECK(pack.append(c_tag, 3, a.data(), ::size32(a), false));
+
+		CHECK(pack.remove(c_tag, 1));
+		CHECK(!pack.remove(c_tag, 1));
+		CHECK(!pack.contains(c_tag, 1));
+		CHECK(!pack.find(c_tag, 1));
+
+		// A removed key can be appended again
+		CHECK(pack.append(c_tag, 1, b.data(), ::size32(b)));
+		CHECK(equals(pack.find(c_tag, 1), b));
+
+		CHECK(pack.remove(c_tag, 3));
+		CHECK(pack.get_garbage_size() != 0);
+		CHECK(pack.count(c_tag) == 2);
+	}
+
+	// Tombstones hide the records after reopening
+	utils::pack_archive pack;
+	CHECK(pack.open(file.path, c_version));
+	CHECK(equals(pack.find(c_tag, 1), b));
+	CHECK(equals(pack.find(c_tag, 2), a));
+	CHECK(!pack.contains(c_tag, 3));
+	CHECK(pack.count(c_tag) == 2);
+	CHECK(pack.get_garbage_size() != 0);
+
+	const auto all = pack.get_all(c_tag);
+	CHECK(all.size() == 2 && all[0].key == 2 && all[1].key == 1);
+}
+
+TEST_CASE(pack_archive_compact)
+{
+	test::random rng;
+	temp_pack file("pack_archive_compact.pack");
+
+	std::vector<std::vector<u8>> blobs;
+
+	utils::pack_archive pack;
+	CHECK(pack.open(file.path, c_version));
+
+	for (u32 i = 0; i < 32; i++)
+	{
+		blobs.push_back(make_data(rng, 1 + i * 7));
+		CHECK(pack.append(c_tag, i, blobs[i].data(), ::size32(blobs[i]), i % 3 != 0));
+	}
+
+	for (u32 i = 0; i < 32; i += 4)
+	{
+		CHECK(pack.remove(c_tag, i));
+	}
+
+	const u64 size_before = fs::file(file.path).size();
+	const u64 garbage = pack.get_garbage_size();
+
+	CHECK(pack.compact());
+	CHECK(pack.is_writable());
+	CHECK(pack.get_garbage_size() == 0);
+	CHECK(fs::file(file.path).size() == size_before - garbage);
+	CHECK(!fs::is_file(file.path + ".tmp"));
+
+	const auto check_contents = [&]()
+	{
+		CHECK(pack.count(c_tag) == 24);
+
+		for (u32 i = 0; i < 32; i++)
+		{
+			// Blobs that weren't kept in memory are read back from the old file
+			CHECK_MSG(i % 4 ? equals(pack.find(c_tag, i), blobs[i]) : !pack.contains(c_tag, i), "key %u", i);
+		}
+	};
+
+	check_contents();
+
+	// Compaction of a clean archive does nothing
+	CHECK(pack.compact());
+
+	pack.close();
+	CHECK(pack.open(file.path, c_version));
+	check_contents();
+	CHECK(pack.get_garbage_size() == 0);
+
+	// Appending continues after the compacted records
+	CHECK(pack.append(c_tag, 100, blobs[1].data(), ::size32(blobs[1])));
+	pack.close();
+	CHECK(pack.open(file.path, c_version));
+	CHECK(equals(pack.find(c_tag, 100), blobs[1]));
+}
+
+TEST_CASE(pack_archive_damaged_tail)
+{
+	test::random rng;
+	temp_pack file("pack_archive_damaged_tail.pack");
+
+	std::vector<std::vector<u8>> blobs;
+	std::vector<u64> sizes;
+
+	for (u32 i = 0; i < 9; i++)
+	{
+		blobs.push_back(make_data(rng, 50 + i));
+	}
+
+	{
+		utils::pack_archive pack;
+		CHECK(pack.open(file.path, c_version));
+
+		for (u32 i = 0; i < 8; i++)
+		{
+			CHECK(pack.append(c_tag, i, blobs[i].data(), ::size32(blobs[i])));
+			sizes.push_back(fs::file(file.path).size());
+		}
+	}
+
+	const auto check_prefix = [&](u32 count)
+	{
+		utils::pack_archive pack;
+		CHECK(pack.open(file.path, c_version));
+		CHECK(pack.is_writable());
+		CHECK_MSG(pack.count(c_tag) == count, "%u blobs, expected %u", pack.count(c_tag), count);
+
+		for (u32 i = 0; i < count; i++)
+		{
+			CHECK_MSG(equals(pack.find(c_tag, i), blobs[i]), "key %u", i);
+		}
+
+		// The incomplete record was cut off
+		CHECK(fs::file(file.path).size() == sizes[count - 1]);
+
+		// The key of the lost record can be appended again
+		CHECK(pack.append(c_tag, count, blobs[count].data(), ::size32(blobs[count])));
+	};
+
+	// Interrupted in the middle of the payload of the last record
+	CHECK(fs::truncate_file(file.path, sizes[7] - 10));
+	check_prefix(7);
+
+	// Interrupted in the middle of a record header
+	CHECK(fs::truncate_file(file.path, sizes[7] + 5));
+	check_prefix(8);
+
+	// Corrupted header, the records after it are dropped as well
+	{
+		fs::file f(file.path, fs::read + fs::write);
+		CHECK(f);
+		f.seek(sizes[6] + 4);
+
+		const u32 bad_size = 0x7fffffff;
+		f.write(bad_size);
+	}
+
+	check_prefix(7);
+}
+
+TEST_CASE(pack_archive_version_and_lock)
+{
+	test::random rng;
+	temp_pack file("pack_archive_version_and_lock.pack");
+
+	const auto data = make_data(rng, 64);
+
+	utils::pack_archive pack;
+	CHECK(pack.open(file.path, c_version));
+	CHECK(pack.append(c_tag, 1, data.data(), ::size32(data)));
+
+	// A second instance can only read while the file is locked
+	{
+		utils::pack_archive other;
+		CHECK(other.open(file.path, c_version));
+		CHECK(!other.is_writable());
+		CHECK(equals(other.find(c_tag, 1), data));
+		CHECK(!other.append(c_tag, 2, data.data(), ::size32(data)));
+		CHECK(!other.remove(c_tag, 1));
+		CHECK(!other.compact());
+	}
+
+	pack.close();
+
+	// Read-only access never discards an outdated archive
+	CHECK(!pack.open(file.path, c_version + 1, true));
+	CHECK(pack.open(file.path, c_version, true));
+	CHECK(!pack.is_writable());
+	CHECK(equals(pack.find(c_tag, 1), data));
+	pack.close();
+
+	// Writable access starts over
+	CHECK(pack.open(file.path, c_version + 1));
+	CHECK(pack.is_writable());
+	CHECK(pack.count(c_tag) == 0);
+	pack.close();
+
+	CHECK(pack.open(file.path, c_version + 1));
+	CHECK(pack.count(c_tag) == 0);
+}
@@ -0,0 +1,254 @@
+#include "stdafx.h"
+#include "test.h"
+#include "Utilities/StrUtil.h"
+#include "Utilities/pack_archive.h"
+#include "Emu/RSX/Common/ProgramStateCache.h"
+#include "Emu/RSX/GL/GLVertexProgram.h"
+#include "Emu/RSX/GL/GLFragmentProgram.h"
+#include "Emu/RSX/GL/GLHelpers.h"
+
+#include <cstdio>
+
+namespace
+{
+	// replace_all as it was before it was made single pass, rebuilding the string on every match
+	template <typename T, size_t list_size>
+	std::string replace_all_reference(std::string src, const std::pair<std::string, T> (&list)[list_size])
+	{
+		const auto get = [](const auto& value) -> std::string
+		{
+			if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::string>)
+			{
+				return value;
+			}
+			else
+			{
+				return value();
+			}
+		};
+
+		for (size_t pos = 0; pos < src.length(); ++pos)
+		{
+			for (size_t i = 0; i < list_size; ++i)
+			{
+				const size_t comp_length = list[i].first.length();
+
+				if (src.length() - pos < comp_length)
+					continue;
+
+				if (src.substr(pos, comp_length) == list[i].first)
+				{
+					const std::string to = get(list[i].second);
+					src = (pos ? src.substr(0, pos) + to : to) + src.substr(pos + comp_length);
+					pos += to.length() - 1;
+					break;
+				}
+			}
+		}
+
+		return src;
+	}
+
+	std::string random_string(test::random& rng, u32 max_length)
+	{
+		// Small alphabet so that the patterns match often and overlap
+		static constexpr char alphabet[] = "$ab01_";
+
+		std::string result(rng.next() % (max_length + 1), ' ');
+
+		for (char& c : result)
+		{
+			c = alphabet[rng.next() % (sizeof(alphabet) - 1)];
+		}
+
+		return result;
+	}
+
+	// Patterns in the style of the decompilers' Format() lists, the earlier entry wins at a given position
+	const std::pair<std::string, std::string> s_patterns[] =
+	{
+		{ "$a0", "vec4(0.)" },
+		{ "$a", "tmp0" },
+		{ "$ab", "never" },
+		{ "b0_", "b1" },
+		{ "$", "$$" },
+		{ "__", "_" },
+	};
+
+	// Decompiler input read from shader cache packs
+	struct program_set
+	{
+		std::vector<RSXVertexProgram> vertex_programs;
+		std::vector<std::vector<u8>> fragment_ucode;
+	};
+
+	program_set load_programs()
+	{
+		program_set result;
+
+		for (const auto& path : test::get_data_paths())
+		{
+			// Read-only access keeps the file intact whatever its record version
+			utils::pack_archive pack;
+
+			if (!pack.open(path, 0, true))
+			{
+				std::printf("  Failed to open %s\n", path.c_str());
+				continue;
+			}
+
+			for (const auto& blob : pack.get_all("RAVP"_u32))
+			{
+				// Raw vertex programs are stored relocated to instruction 0, analysing them again restores the
+				// instruction mask and jump table that the pipeline records would otherwise provide
+				std::vector<u32> ucode(512 * 4);
+				std::memcpy(ucode.data(), blob.data, std::min<std::size_t>(blob.size, ucode.size() * sizeof(u32)));
+
+				RSXVertexProgram vp = {};
+				vp.skip_vertex_input_check = true;
+				vp.output_mask = 0xffffffff;
+				program_hash_util::vertex_program_utils::analyse_vertex_program(ucode.data(), 0, vp);
+				result.vertex_programs.push_back(std::move(vp));
+			}
+
+			for (const auto& blob : pack.get_all("RAFP"_u32))
+			{
+				result.fragment_ucode.emplace_back(blob.data, blob.data + blob.size);
+			}
+		}
+
+		return result;
+	}
+}
+
+TEST_CASE(replace_all_matches_reference)
+{
+	test::random rng;
+
+	u32 calls = 0;
+	u32 reference_calls = 0;
+
+	std::pair<std::string, std::function<std::string()>> generators[std::size(s_patterns)];
+	std::pair<std::string, std::function<std::string()>> reference_generators[std::size(s_patterns)];
+
+	for (std::size_t i = 0; i < std::size(s_patterns); i++)
+	{
+		const std::string to = s_patterns[i].second;
+		generators[i] = { s_patterns[i].first, [&calls, to]() { calls++; return to; } };
+		reference_generators[i] = { s_patterns[i].first, [&reference_calls, to]() { reference_calls++; return to; } };
+	}
+
+	for (u32 i = 0; i < 100000; i++)
+	{
+		const std::string src = random_string(rng, 48);
+
+		const std::string expected = replace_all_reference(src, s_patterns);
+		CHECK_MSG(fmt::replace_all(src, s_patterns) == expected, "'%s' -> '%s', expected '%s'", src, fmt::replace_all(src, s_patterns), expected);
+
+		calls = 0;
+		reference_calls = 0;
+
+		const std::string generated = fmt::replace_all(src, generators);
+		CHECK_MSG(generated == replace_all_reference(src, reference_generators), "'%s' -> '%s', expected '%s'", src, generated, expected);
+
+		// Each match calls its generator exactly once
+		CHECK_MSG(calls == reference_calls, "'%s': %u generator calls for %u matches", src, calls, reference_calls);
+	}
+}
+
+BENCHMARK(replace_all)
+{
+	const std::string lines[] =
+	{
+		"$0 = $t.xyzw;",
+		"$0 = texture($t, $1.xy * $t_coord_scale);",
+		"$0 = ($1 * $2) + $3;",
+		"vec4 tmp = vec4(1.);",
+	};
+
+	const std::pair<std::string, std::function<std::string()>> repl_list[] =
+	{
+		{ "$$", []() { return "$"; } },
+		{ "$0", []() { return "r0.xyz"; } },
+		{ "$t_coord_scale", []() { return "texture_parameters[0]"; } },
+		{ "$t", []() { return "tex0"; } },
+		{ "$1", []() { return "h2.xyzw"; } },
+		{ "$2", []() { return "vec4(fc1.x, fc1.y, fc1.z, fc1.w)"; } },
+		{ "$3", []() { return "r3"; } },
+	};
+
+	std::size_t total = 0;
+
+	test::measure("replace_all (per line)", [&]()
+	{
+		for (const auto& line : lines)
+		{
+			total += fmt::replace_all(line, repl_list).size();
+		}
+	}, std::size(lines));
+
+	test::measure("reference replace_all (per line)", [&]()
+	{
+		for (const auto& line : lines)
+		{
+			total += replace_all_reference(line, repl_list).size();
+		}
+	}, std::size(lines));
+
+	CHECK(total != 0);
+}
+
+BENCHMARK(shader_decompiler)
+{
+	const program_set programs = load_programs();
+
+	if (programs.vertex_programs.empty() && programs.fragment_ucode.empty())
+	{
+		std::printf("  No programs to decompile, pass shader cache packs with --data <shaders_cache/pipelines/.../*.pack>\n");
+		return;
+	}
+
+	// The decompilers only read the driver capabilities, keep the defaults instead of querying a context that does not exist
+	gl::get_driver_caps().initialized = true;
+
+	std::vector<RSXFragmentProgram> fragment_programs(programs.fragment_ucode.size());
+
+	for (std::size_t i = 0; i < fragment_programs.size(); i++)
+	{
+		fragment_programs[i].addr = const_cast<u8*>(programs.fragment_ucode[i].data());
+		fragment_programs[i].ucode_length = ::size32(programs.fragment_ucode[i]);
+	}
+
+	std::size_t total = 0;
+
+	if (const u32 count = ::size32(programs.vertex_programs))
+	{
+		test::measure(fmt::format("%u vertex programs (per program)", count), [&]()
+		{
+			for (const auto& vp : programs.vertex_programs)
+			{
+				std::string shader;
+				ParamArray parr;
+				GLVertexDecompilerThread(vp, shader, parr).Task();
+				total += shader.size();
+			}
+		}, count);
+	}
+
+	if (const u32 count = ::size32(fragment_programs))
+	{
+		test::measure(fmt::format("%u fragment programs (per program)", count), [&]()
+		{
+			for (const auto& fp : fragment_programs)
+			{
+				std::string shader;
+				ParamArray parr;
+				u32 size;
+				GLFragmentDecompilerThread(shader, parr, fp, size).Task();
+				total += shader.size();
+			}
+		}, count);
+	}
+
+	CHECK(total != 0);
+}
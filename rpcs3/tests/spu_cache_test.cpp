@@ -0,0 +1,143 @@
+#include "stdafx.h"
+#include "test.h"
+#include "Emu/Cell/SPURecompiler.h"
+
+#include <map>
+
+namespace
+{
+	// Function as stored in the cache: entry address followed by the instructions
+	std::vector<u32> make_function(test::random& rng, u32 size)
+	{
+		std::vector<u32> result(size + 1);
+		result[0] = (rng.next() % 0x10000) * 4;
+
+		for (u32 i = 1; i <= size; i++)
+		{
+			// Small opcode set so that compression is used for some of the functions
+			result[i] = i % 3 ? 0x40800000 | (rng.next() % 4) : rng.next() | 1;
+		}
+
+		return result;
+	}
+
+	// Old cache format: big-endian size and address, then the instructions
+	void write_v1(const fs::file& file, const std::vector<u32>& func)
+	{
+		const be_t<u32> size = ::size32(func) - 1;
+		const be_t<u32> addr = func[0];
+		file.write(size);
+		file.write(addr);
+		file.write(func.data() + 1, (func.size() - 1) * 4);
+	}
+}
+
+TEST_CASE(spu_cache_import_v1)
+{
+	test::random rng;
+
+	const std::string pack_path = test::get_temp_dir() + "spu_cache_import.pack";
+	const std::string v1_path = test::get_temp_dir() + "spu_cache_import.dat";
+	fs::remove_file(pack_path);
+
+	std::vector<std::vector<u32>> funcs;
+
+	for (u32 i = 0; i < 50; i++)
+	{
+		funcs.push_back(make_function(rng, 1 + rng.next() % 300));
+	}
+
+	// The last functions are duplicated, they must come first
+	std::map<std::vector<u32>, u32> hits;
+
+	{
+		fs::file file(v1_path, fs::rewrite);
+		CHECK(file);
+
+		for (const auto& func : funcs)
+		{
+			write_v1(file, func);
+			hits[func]++;
+		}
+
+		for (u32 i = 45; i < 50; i++)
+		{
+			for (u32 j = 45; j <= i; j++)
+			{
+				write_v1(file, funcs[i]);
+				hits[funcs[i]]++;
+			}
+		}
+
+		// Old format Giga entries are skipped
+		write_v1(file, { 0x100, 0, 5, 6 });
+	}
+
+	const auto check_functions = [&](const std::vector<std::vector<u32>>& list)
+	{
+		CHECK_MSG(list.size() == funcs.size(), "%u functions, expected %u", list.size(), funcs.size());
+
+		std::map<std::vector<u32>, u32> found;
+
+		for (std::size_t i = 0; i < list.size(); i++)
+		{
+			CHECK_MSG(hits.count(list[i]) && ++found[list[i]] == 1, "function %u", i);
+
+			// Most requested first
+			CHECK_MSG(i == 0 || hits[list[i - 1]] >= hits[list[i]], "function %u", i);
+		}
+	};
+
+	{
+		spu_cache cache(pack_path);
+		CHECK(cache);
+
+		cache.import(v1_path);
+
+		// Available for precompilation in the session which imported them
+		check_functions(cache.get());
+
+		// The old file is only removed once the pack owns the functions
+		CHECK(!fs::is_file(v1_path));
+	}
+
+	// And in the next sessions, with the statistics saved by the first one
+	spu_cache cache(pack_path);
+	CHECK(cache);
+	check_functions(cache.get());
+
+	fs::remove_file(pack_path);
+}
+
+TEST_CASE(spu_cache_add)
+{
+	test::random rng;
+
+	const std::string pack_path = test::get_temp_dir() + "spu_cache_add.pack";
+	fs::remove_file(pack_path);
+
+	std::vector<std::vector<u32>> funcs;
+
+	{
+		spu_cache cache(pack_path);
+		CHECK(cache);
+
+		for (u32 i = 0; i < 20; i++)
+		{
+			funcs.push_back(make_function(rng, 1 + rng.next() % 100));
+			cache.add(funcs.back());
+			cache.add(funcs.back());
+		}
+
+		// Compiled functions aren't kept in memory
+		CHECK(cache.get().empty());
+	}
+
+	spu_cache cache(pack_path);
+	const auto list = cache.get();
+
+	// No statistics yet, so the functions come in the order they were added
+	CHECK(list == funcs);
+
+	fs::remove_file(pack_path);
+}
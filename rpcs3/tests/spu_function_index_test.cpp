@@ -0,0 +1,370 @@
+#include "stdafx.h"
+#include "test.h"
+#include "Emu/Cell/SPURecompiler.h"
+
+#include <map>
+#include <set>
+#include <thread>
+
+namespace
+{
+	constexpr u32 ls_words = 0x40000 / 4;
+
+	// Distinct fake function pointers, they are never called
+	spu_function_t make_func(std::size_t index)
+	{
+		return reinterpret_cast<spu_function_t>((index + 1) * 16);
+	}
+
+	struct function_set
+	{
+		// LS contents, functions are taken from it so that the lookups find them
+		std::vector<u32> ls;
+
+		std::vector<std::vector<u32>> functions;
+
+		// Start addresses of the functions in LS
+		std::vector<u32> addrs;
+	};
+
+	// Instructions are drawn from a set of opcodes distinct values
+	function_set make_functions(test::random& rng, u32 count, u32 opcodes)
+	{
+		function_set result;
+		result.ls.resize(ls_words);
+
+		for (u32& op : result.ls)
+		{
+			op = rng.next() % opcodes;
+		}
+
+		std::set<std::vector<u32>> unique;
+
+		while (result.functions.size() < count)
+		{
+			const u32 addr = (rng.next() % ls_words) * 4;
+			const u32 size = std::min<u32>(1 + rng.next() % 24, ls_words - addr / 4);
+
+			std::vector<u32> func(result.ls.begin() + addr / 4, result.ls.begin() + addr / 4 + size);
+
+			// spu_runtime never registers the same data twice
+			if (unique.insert(func).second)
+			{
+				result.functions.push_back(std::move(func));
+				result.addrs.push_back(addr);
+			}
+		}
+
+		return result;
+	}
+
+	// Longest registered function matching LS at addr, searching all of them
+	spu_function_t find_reference(const function_set& set, u32 addr)
+	{
+		std::size_t result = -1;
+		std::size_t result_size = 0;
+
+		for (std::size_t i = 0; i < set.functions.size(); i++)
+		{
+			const auto& func = set.functions[i];
+
+			if (func.size() > result_size && func.size() <= ls_words - addr / 4 && std::equal(func.begin(), func.end(), set.ls.begin() + addr / 4))
+			{
+				result = i;
+				result_size = func.size();
+			}
+		}
+
+		return result_size ? make_func(result) : nullptr;
+	}
+
+	// Lookup as spu_runtime did it before the index: the last PIC map entry not greater than the LS window, under the reader lock
+	struct locked_map
+	{
+		mutable shared_mutex mutex;
+		std::map<std::basic_string_view<u32>, spu_function_t> map;
+
+		spu_function_t find(const u32* ls, u32 addr) const
+		{
+			reader_lock lock(mutex);
+
+			const auto upper = map.upper_bound({ls + addr / 4, (0x40000 - addr) / 4});
+
+			if (upper != map.begin())
+			{
+				const auto found = std::prev(upper);
+
+				if (found->first.compare(0, found->first.size(), ls + addr / 4, found->first.size()) == 0)
+				{
+					return found->second;
+				}
+			}
+
+			return nullptr;
+		}
+	};
+}
+
+TEST_CASE(spu_function_index_matches_scalar)
+{
+	test::random rng;
+
+	// Few distinct instructions so that many functions share their first instructions or are prefixes of each other
+	const function_set set = make_functions(rng, 4000, 4);
+
+	spu_function_index index;
+
+	for (std::size_t i = 0; i < set.functions.size(); i++)
+	{
+		index.add({set.functions[i].data(), set.functions[i].size()}, make_func(i), i);
+	}
+
+	u32 found = 0;
+
+	// Exact lookups
+	for (std::size_t i = 0; i < set.functions.size(); i++)
+	{
+		CHECK_MSG(index.find({set.functions[i].data(), set.functions[i].size()}) == make_func(i), "function %u of size %u", i, set.functions[i].size());
+		found++;
+	}
+
+	const u32 missing[] = { 4, 5, 6 };
+	CHECK(index.find({missing, std::size(missing)}) == nullptr);
+	CHECK(index.find(std::basic_string_view<u32>{}) == nullptr);
+
+	// LS lookups at the function addresses, random addresses and the end of LS
+	std::vector<u32> addrs = set.addrs;
+
+	for (u32 i = 0; i < 20000; i++)
+	{
+		addrs.push_back((rng.next() % ls_words) * 4);
+	}
+
+	for (u32 i = 1; i <= 32; i++)
+	{
+		addrs.push_back(0x40000 - i * 4);
+	}
+
+	for (const u32 addr : addrs)
+	{
+		const spu_function_t expected = find_reference(set, addr);
+		CHECK_MSG(index.find(set.ls.data(), addr) == expected, "addr 0x%05x", addr);
+
+		if (expected)
+		{
+			found++;
+		}
+	}
+
+	// Every successful lookup is counted for the cache key of the function
+	std::unordered_map<u64, u32> hits;
+	index.take_hits(hits);
+
+	u32 total_hits = 0;
+
+	for (const auto& [key, count] : hits)
+	{
+		CHECK(key < set.functions.size());
+		total_hits += count;
+	}
+
+	CHECK_MSG(total_hits == found, "%u hits for %u lookups", total_hits, found);
+
+	hits.clear();
+	index.take_hits(hits);
+	CHECK(hits.empty());
+
+	// Readers of the old table keep it until they are done
+	const auto old = index.reset();
+	CHECK(old != nullptr);
+	CHECK(index.find({set.functions[0].data(), set.functions[0].size()}) == nullptr);
+	CHECK(index.find(set.ls.data(), set.addrs[0]) == nullptr);
+}
+
+TEST_CASE(spu_function_index_short_functions)
+{
+	// Single instruction functions are hashed with a zero second instruction
+	const std::vector<u32> functions[] =
+	{
+		{ 7 },
+		{ 7, 8 },
+		{ 7, 0 },
+		{ 7, 0, 9 },
+	};
+
+	spu_function_index index;
+
+	for (std::size_t i = 0; i < std::size(functions); i++)
+	{
+		index.add({functions[i].data(), functions[i].size()}, make_func(i), i);
+	}
+
+	std::vector<u32> ls(ls_words, 1);
+
+	const auto find_at = [&](u32 addr, std::initializer_list<u32> data)
+	{
+		std::copy(data.begin(), data.end(), ls.begin() + addr / 4);
+		return index.find(ls.data(), addr);
+	};
+
+	CHECK(find_at(0x100, { 7, 9 }) == make_func(0));
+	CHECK(find_at(0x100, { 7, 8 }) == make_func(1));
+	CHECK(find_at(0x100, { 7, 0, 8 }) == make_func(2));
+	CHECK(find_at(0x100, { 7, 0, 9 }) == make_func(3));
+	CHECK(find_at(0x100, { 6, 8 }) == nullptr);
+
+	// The LS window ends after the first instruction
+	CHECK(find_at(0x3fffc, { 7 }) == make_func(0));
+	CHECK(find_at(0x3fff8, { 7, 0 }) == make_func(2));
+}
+
+TEST_CASE(spu_function_index_concurrent_add)
+{
+	test::random rng(7);
+
+	const function_set set = make_functions(rng, 8000, 4);
+
+	spu_function_index index;
+
+	constexpr u32 writers = 4;
+
+	atomic_t<u32> done{0};
+
+	std::vector<std::thread> threads;
+
+	for (u32 t = 0; t < writers; t++)
+	{
+		threads.emplace_back([&, t]()
+		{
+			for (std::size_t i = t; i < set.functions.size(); i += writers)
+			{
+				index.add({set.functions[i].data(), set.functions[i].size()}, make_func(i), i);
+			}
+
+			done++;
+		});
+	}
+
+	// Lookups during the inserts only ever return registered functions
+	atomic_t<u32> bad_results{0};
+
+	threads.emplace_back([&]()
+	{
+		for (u32 i = 0; done < writers; i++)
+		{
+			const u32 addr = set.addrs[i % set.addrs.size()];
+
+			if (const auto func = index.find(set.ls.data(), addr))
+			{
+				const std::size_t id = reinterpret_cast<std::uintptr_t>(func) / 16 - 1;
+
+				if (id >= set.functions.size() || !std::equal(set.functions[id].begin(), set.functions[id].end(), set.ls.begin() + addr / 4))
+				{
+					bad_results++;
+				}
+			}
+		}
+	});
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	CHECK(bad_results == 0);
+
+	// No insert was lost
+	for (std::size_t i = 0; i < set.functions.size(); i++)
+	{
+		CHECK_MSG(index.find({set.functions[i].data(), set.functions[i].size()}) == make_func(i), "function %u", i);
+	}
+
+	for (const u32 addr : set.addrs)
+	{
+		CHECK_MSG(index.find(set.ls.data(), addr) == find_reference(set, addr), "addr 0x%05x", addr);
+	}
+}
+
+BENCHMARK(spu_function_lookup)
+{
+	for (const u32 count : { 256, 4096, 32768 })
+	{
+		test::random rng(count);
+
+		// Real SPU code spreads over a few hundred distinct instruction words at the start of a function
+		const function_set set = make_functions(rng, count, 256);
+
+		spu_function_index index;
+		locked_map map;
+
+		for (std::size_t i = 0; i < set.functions.size(); i++)
+		{
+			index.add({set.functions[i].data(), set.functions[i].size()}, make_func(i), i);
+			map.map.emplace(std::basic_string_view<u32>(set.functions[i].data(), set.functions[i].size()), make_func(i));
+		}
+
+		// Dispatch misses look up the addresses of the compiled functions most of the time
+		std::vector<u32> addrs;
+
+		for (u32 i = 0; i < 4096; i++)
+		{
+			addrs.push_back(i % 4 ? set.addrs[rng.next() % set.addrs.size()] : (rng.next() % ls_words) * 4);
+		}
+
+		const u32* ls = set.ls.data();
+
+		for (const u32 threads : { 1, 6 })
+		{
+			constexpr u32 passes = 16;
+
+			atomic_t<u64> sink{0};
+
+			const auto run = [&](auto&& find)
+			{
+				const auto lookup = [&]()
+				{
+					std::uintptr_t sum = 0;
+
+					for (u32 pass = 0; pass < passes; pass++)
+					{
+						for (const u32 addr : addrs)
+						{
+							sum += reinterpret_cast<std::uintptr_t>(find(ls, addr));
+						}
+					}
+
+					sink += sum;
+				};
+
+				std::vector<std::thread> workers;
+
+				for (u32 t = 1; t < threads; t++)
+				{
+					workers.emplace_back(lookup);
+				}
+
+				lookup();
+
+				for (auto& worker : workers)
+				{
+					worker.join();
+				}
+			};
+
+			// Per lookup on each thread, thread creation is included and is the same for both
+			const auto label = fmt::format("%u functions, %u thread%s", count, threads, threads > 1 ? "s" : "");
+
+			test::measure(label + " index", [&]()
+			{
+				run([&](const u32* ls, u32 addr) { return index.find(ls, addr); });
+			}, addrs.size() * passes);
+
+			test::measure(label + " locked map", [&]()
+			{
+				run([&](const u32* ls, u32 addr) { return map.find(ls, addr); });
+			}, addrs.size() * passes);
+
+			CHECK(sink != 0);
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Utilities/types.h"
+#include "Utilities/StrFmt.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal self-registering test and benchmark harness used by rpcs3_test
+namespace test
+{
+	struct test_case
+	{
+		const char* name;
+		void(*func)();
+		bool is_benchmark;
+	};
+
+	std::vector<test_case>& get_cases();
+
+	struct registrar
+	{
+		registrar(const char* name, void(*func)(), bool is_benchmark)
+		{
+			get_cases().push_back({ name, func, is_benchmark });
+		}
+	};
+
+	// Aborts the current test case
+	[[noreturn]] void fail(const char* expr, const char* file, int line, const std::string& message);
+
+	// Input files passed with --data, such as shader cache packs or captures
+	const std::vector<std::string>& get_data_paths();
+
+	// Scratch directory for files written by tests
+	const std::string& get_temp_dir();
+
+	// Runs func until enough time has passed to get a stable average, prints and returns nanoseconds per unit
+	double measure(const std::string& label, const std::function<void()>& func, u64 units_per_call = 1);
+
+	// Deterministic pseudo-random data so that failures are reproducible
+	struct random
+	{
+		u64 state;
+
+		random(u64 seed = 0x9e3779b97f4a7c15) : state(seed)
+		{
+		}
+
+		u32 next()
+		{
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			return static_cast<u32>(state >> 16);
+		}
+
+		void fill(void* dst, std::size_t size)
+		{
+			for (std::size_t i = 0; i < size; i++)
+			{
+				static_cast<u8*>(dst)[i] = static_cast<u8>(next());
+			}
+		}
+	};
+}
+
+#define TEST_CASE(name)\
+	static void test_##name();\
+	static const test::registrar s_register_##name(#name, test_##name, false);\
+	static void test_##name()
+
+#define BENCHMARK(name)\
+	static void bench_##name();\
+	static const test::registrar s_register_##name(#name, bench_##name, true);\
+	static void bench_##name()
+
+#define CHECK(expr) do { if (!(expr)) test::fail(#expr, __FILE__, __LINE__, {}); } while (0)
+#define CHECK_MSG(expr, ...) do { if (!(expr)) test::fail(#expr, __FILE__, __LINE__, fmt::format(__VA_ARGS__)); } while (0)
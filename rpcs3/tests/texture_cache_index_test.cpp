@@ -0,0 +1,241 @@
+#include "stdafx.h"
+#include "test.h"
+#include "Emu/RSX/Common/texture_cache_utils.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Ranged storage blocks cover 16MB of guest memory
+	constexpr u32 block_size = 0x1000000;
+
+	struct section
+	{
+		utils::address_range range;
+		bool live = false;
+	};
+
+	using index_type = rsx::ranged_storage_block_index<section>;
+
+	// Mostly texture sized sections, some of them as large as render targets
+	utils::address_range make_range(test::random& rng)
+	{
+		const u32 start = rng.next() % block_size;
+		const u32 length = 1 + (rng.next() % 8 ? rng.next() % 0x10000 : rng.next() % 0x800000);
+		return utils::address_range::start_length(start, std::min(length, block_size - start)).to_page_range();
+	}
+
+	// Inserts and erases sections at random, as the cache does when sections are created and destroyed
+	void churn(test::random& rng, index_type& index, std::vector<section>& sections, u32 count)
+	{
+		for (u32 i = 0; i < count; i++)
+		{
+			auto& s = sections[rng.next() % sections.size()];
+
+			if (s.live)
+			{
+				index.erase(s.range, &s);
+				s.live = false;
+			}
+			else
+			{
+				s.range = make_range(rng);
+				index.insert(s.range, &s);
+				s.live = true;
+			}
+		}
+	}
+
+	// Scan of the whole block, as the range iterator did before the index
+	std::vector<section*> find_reference(std::vector<section>& sections, const utils::address_range& range)
+	{
+		std::vector<section*> result;
+
+		for (auto& s : sections)
+		{
+			if (s.live && s.range.overlaps(range))
+			{
+				result.push_back(&s);
+			}
+		}
+
+		return result;
+	}
+
+	std::vector<section*> find_indexed(const index_type& index, const utils::address_range& range)
+	{
+		std::vector<section*> result;
+		index_type::cursor cursor;
+
+		for (auto s = index.query_begin(cursor, range); s; s = index.query_next(cursor, range))
+		{
+			result.push_back(s);
+		}
+
+		return result;
+	}
+
+	// Write faults hit pages of live sections most of the time, often several pages of the same section in a row
+	std::vector<utils::address_range> make_faults(test::random& rng, const std::vector<section>& sections, u32 count)
+	{
+		std::vector<utils::address_range> result;
+
+		while (result.size() < count)
+		{
+			const auto& s = sections[rng.next() % sections.size()];
+
+			if (!s.live || rng.next() % 4 == 0)
+			{
+				result.push_back(utils::address_range::start_length((rng.next() % block_size) & ~0xfff, 0x1000));
+				continue;
+			}
+
+			for (u32 addr = s.range.start, pages = 1 + rng.next() % 8; pages && addr < s.range.end; addr += 0x1000, pages--)
+			{
+				result.push_back(utils::address_range::start_length(addr, 0x1000));
+			}
+		}
+
+		return result;
+	}
+}
+
+TEST_CASE(texture_cache_index_matches_scalar)
+{
+	test::random rng;
+
+	std::vector<section> sections(20000);
+	index_type index;
+
+	for (u32 iteration = 0; iteration < 1000; iteration++)
+	{
+		churn(rng, index, sections, 300);
+
+		const auto range = utils::address_range::start_length(rng.next() % block_size, 1 + rng.next() % 0x4000);
+
+		auto expected = find_reference(sections, range);
+		auto result = find_indexed(index, range);
+
+		// Sections are visited in ascending start address order
+		CHECK_MSG(std::is_sorted(result.begin(), result.end(), [](section* a, section* b) { return a->range.start < b->range.start; }), "range %s", range.str());
+
+		std::sort(expected.begin(), expected.end());
+		std::sort(result.begin(), result.end());
+		CHECK_MSG(result == expected, "range %s: %u sections, expected %u", range.str(), result.size(), expected.size());
+	}
+
+	u32 live = 0;
+
+	for (const auto& s : sections)
+	{
+		live += s.live;
+	}
+
+	CHECK(index.size() == live);
+
+	index.clear();
+	CHECK(index.empty());
+	CHECK(find_indexed(index, utils::address_range::start_length(0, block_size)).empty());
+}
+
+TEST_CASE(texture_cache_index_growing_range)
+{
+	test::random rng(3);
+
+	std::vector<section> sections(4000);
+	index_type index;
+	churn(rng, index, sections, 6000);
+
+	std::vector<section*> sorted;
+
+	for (auto& s : sections)
+	{
+		if (s.live)
+		{
+			sorted.push_back(&s);
+		}
+	}
+
+	std::sort(sorted.begin(), sorted.end(), [](section* a, section* b) { return a->range.start < b->range.start; });
+
+	for (u32 iteration = 0; iteration < 2000; iteration++)
+	{
+		const auto initial = utils::address_range::start_length(rng.next() % block_size, 1 + rng.next() % 0x4000);
+
+		// Forward chaining in get_intersecting_set() extends the end of the range to cover every section found
+		auto range = initial;
+		std::vector<section*> result;
+		index_type::cursor cursor;
+
+		for (auto s = index.query_begin(cursor, range); s; s = index.query_next(cursor, range))
+		{
+			result.push_back(s);
+			range.end = std::max(range.end, s->range.end);
+		}
+
+		auto expected_range = initial;
+		std::vector<section*> expected;
+
+		for (section* s : sorted)
+		{
+			if (s->range.start > expected_range.end)
+			{
+				break;
+			}
+
+			if (s->range.end >= expected_range.start)
+			{
+				expected.push_back(s);
+				expected_range.end = std::max(expected_range.end, s->range.end);
+			}
+		}
+
+		std::sort(expected.begin(), expected.end());
+		std::sort(result.begin(), result.end());
+		CHECK_MSG(result == expected, "range %s: %u sections, expected %u", initial.str(), result.size(), expected.size());
+	}
+}
+
+BENCHMARK(texture_cache_fault_lookup)
+{
+	for (const u32 count : { 1000, 20000 })
+	{
+		test::random rng(count);
+
+		std::vector<section> sections(count);
+		index_type index;
+
+		// Leaves about half of the sections alive
+		churn(rng, index, sections, count * 4);
+
+		const auto faults = make_faults(rng, sections, 4096);
+
+		std::size_t total = 0;
+
+		test::measure(fmt::format("%u sections, index (per fault)", index.size()), [&]()
+		{
+			index_type::cursor cursor;
+
+			for (const auto& fault : faults)
+			{
+				for (auto s = index.query_begin(cursor, fault); s; s = index.query_next(cursor, fault))
+				{
+					total++;
+				}
+			}
+		}, faults.size());
+
+		test::measure(fmt::format("%u sections, block scan (per fault)", index.size()), [&]()
+		{
+			for (const auto& fault : faults)
+			{
+				for (const auto& s : sections)
+				{
+					total += s.live && s.range.overlaps(fault);
+				}
+			}
+		}, faults.size());
+
+		CHECK(total != 0);
+	}
+}
@@ -0,0 +1,382 @@
+#include "stdafx.h"
+#include "test.h"
+#include "Emu/RSX/Common/TextureUtils.h"
+#include "Emu/RSX/rsx_utils.h"
+#include "Emu/RSX/gcm_enums.h"
+#include "Emu/IdManager.h"
+
+namespace
+{
+	// Every format upload_texture_subresource decodes
+	const u32 s_formats[] =
+	{
+		CELL_GCM_TEXTURE_B8,
+		CELL_GCM_TEXTURE_A1R5G5B5,
+		CELL_GCM_TEXTURE_A4R4G4B4,
+		CELL_GCM_TEXTURE_R5G6B5,
+		CELL_GCM_TEXTURE_A8R8G8B8,
+		CELL_GCM_TEXTURE_COMPRESSED_DXT1,
+		CELL_GCM_TEXTURE_COMPRESSED_DXT23,
+		CELL_GCM_TEXTURE_COMPRESSED_DXT45,
+		CELL_GCM_TEXTURE_G8B8,
+		CELL_GCM_TEXTURE_R6G5B5,
+		CELL_GCM_TEXTURE_DEPTH24_D8,
+		CELL_GCM_TEXTURE_DEPTH24_D8_FLOAT,
+		CELL_GCM_TEXTURE_DEPTH16,
+		CELL_GCM_TEXTURE_DEPTH16_FLOAT,
+		CELL_GCM_TEXTURE_X16,
+		CELL_GCM_TEXTURE_Y16_X16,
+		CELL_GCM_TEXTURE_R5G5B5A1,
+		CELL_GCM_TEXTURE_COMPRESSED_HILO8,
+		CELL_GCM_TEXTURE_COMPRESSED_HILO_S8,
+		CELL_GCM_TEXTURE_W16_Z16_Y16_X16_FLOAT,
+		CELL_GCM_TEXTURE_W32_Z32_Y32_X32_FLOAT,
+		CELL_GCM_TEXTURE_X32_FLOAT,
+		CELL_GCM_TEXTURE_D1R5G5B5,
+		CELL_GCM_TEXTURE_D8R8G8B8,
+		CELL_GCM_TEXTURE_Y16_X16_FLOAT,
+		CELL_GCM_TEXTURE_COMPRESSED_B8R8_G8R8,
+		CELL_GCM_TEXTURE_COMPRESSED_R8B8_R8G8,
+	};
+
+	// Row pitch of the destination, as required by Vulkan
+	constexpr u32 dst_row_alignment = 256;
+
+	bool is_dxt(u32 format)
+	{
+		return get_format_block_size_in_texel(format) == 4;
+	}
+
+	struct texture_data
+	{
+		std::vector<u8> src;
+		std::vector<rsx_subresource_layout> layouts;
+
+		// Destination of every subresource
+		std::vector<std::pair<std::size_t, std::size_t>> dst_ranges;
+		std::size_t dst_size = 0;
+	};
+
+	// Random texture data, subresources are ordered per layer then per level like get_subresources_layout() orders them
+	texture_data make_texture(test::random& rng, u32 format, u16 width, u16 height, u16 depth, u16 layers, u16 levels, u32 pitch_in_block = 0)
+	{
+		texture_data result;
+
+		const u32 block_texel = get_format_block_size_in_texel(format);
+		const u32 block_size = get_format_block_size_in_bytes(format);
+
+		std::vector<std::size_t> src_offsets;
+		std::size_t src_size = 0;
+
+		for (u16 layer = 0; layer < layers; layer++)
+		{
+			for (u16 level = 0; level < levels; level++)
+			{
+				rsx_subresource_layout layout{};
+				layout.width_in_block = static_cast<u16>(std::max<u32>((std::max(width >> level, 1) + block_texel - 1) / block_texel, 1));
+				layout.height_in_block = static_cast<u16>(std::max<u32>((std::max(height >> level, 1) + block_texel - 1) / block_texel, 1));
+				layout.depth = static_cast<u16>(std::max(depth >> level, 1));
+				layout.pitch_in_block = level == 0 && pitch_in_block ? pitch_in_block : layout.width_in_block;
+
+				const std::size_t size = std::size_t{layout.pitch_in_block} * block_size * layout.height_in_block * layout.depth;
+				src_offsets.push_back(src_size);
+				src_size += size;
+
+				// The largest destination block is 16 bytes
+				const std::size_t dst_size = ::align<std::size_t>(layout.width_in_block * 16, dst_row_alignment) * layout.height_in_block * layout.depth;
+				result.dst_ranges.emplace_back(result.dst_size, dst_size);
+				result.dst_size += dst_size + dst_row_alignment;
+
+				result.layouts.push_back(layout);
+			}
+		}
+
+		result.src.resize(src_size);
+		rng.fill(result.src.data(), src_size);
+
+		for (std::size_t i = 0; i < result.layouts.size(); i++)
+		{
+			auto& layout = result.layouts[i];
+			const std::size_t size = std::size_t{layout.pitch_in_block} * block_size * layout.height_in_block * layout.depth;
+			layout.data = gsl::span<const gsl::byte>(reinterpret_cast<const gsl::byte*>(result.src.data() + src_offsets[i]), ::narrow<int>(size));
+		}
+
+		return result;
+	}
+
+	gsl::span<gsl::byte> get_dst(std::vector<u8>& dst, const texture_data& tex, std::size_t index)
+	{
+		const auto [offset, size] = tex.dst_ranges[index];
+		return { reinterpret_cast<gsl::byte*>(dst.data() + offset), ::narrow<int>(size) };
+	}
+
+	void decode_serial(std::vector<u8>& dst, const texture_data& tex, u32 format, bool is_swizzled, bool vtc_support)
+	{
+		for (std::size_t i = 0; i < tex.layouts.size(); i++)
+		{
+			upload_texture_subresource(get_dst(dst, tex, i), tex.layouts[i], format, is_swizzled, vtc_support, dst_row_alignment);
+		}
+	}
+
+	// The decoder pool used by texture_upload_batch is owned by fxm, which Emu.Init() initializes and Emu.Stop() clears
+	struct fxm_scope
+	{
+		fxm_scope()
+		{
+			fxm::init();
+		}
+
+		~fxm_scope()
+		{
+			fxm::clear();
+		}
+	};
+
+	void decode_batch(std::vector<u8>& dst, const texture_data& tex, u32 format, bool is_swizzled, bool vtc_support)
+	{
+		texture_upload_batch batch(tex.layouts, format, is_swizzled, vtc_support, dst_row_alignment);
+
+		for (u32 i = 0; i < tex.layouts.size(); i++)
+		{
+			batch.decode(i, get_dst(dst, tex, i));
+		}
+
+		batch.wait();
+	}
+
+	// Size of the words byteswapped by linear decoding (1 if copied as is), 0 for formats which are converted
+	u32 get_swapped_word_size(u32 format)
+	{
+		switch (format)
+		{
+		case CELL_GCM_TEXTURE_B8:
+		case CELL_GCM_TEXTURE_A8R8G8B8:
+		case CELL_GCM_TEXTURE_D8R8G8B8:
+		case CELL_GCM_TEXTURE_COMPRESSED_DXT1:
+		case CELL_GCM_TEXTURE_COMPRESSED_DXT23:
+		case CELL_GCM_TEXTURE_COMPRESSED_DXT45:
+			return 1;
+		case CELL_GCM_TEXTURE_DEPTH24_D8:
+		case CELL_GCM_TEXTURE_DEPTH24_D8_FLOAT:
+		case CELL_GCM_TEXTURE_X32_FLOAT:
+		case CELL_GCM_TEXTURE_W32_Z32_Y32_X32_FLOAT:
+			return 4;
+		case CELL_GCM_TEXTURE_R6G5B5:
+		case CELL_GCM_TEXTURE_COMPRESSED_B8R8_G8R8:
+		case CELL_GCM_TEXTURE_COMPRESSED_R8B8_R8G8:
+			return 0;
+		default:
+			return 2;
+		}
+	}
+
+	// Scalar reference of linear decoding, one byte at a time
+	void decode_linear_reference(std::vector<u8>& dst, const texture_data& tex, u32 format)
+	{
+		const u32 word_size = get_swapped_word_size(format);
+		const u32 block_size = get_format_block_size_in_bytes(format);
+
+		for (std::size_t i = 0; i < tex.layouts.size(); i++)
+		{
+			const auto& layout = tex.layouts[i];
+			const u8* src = reinterpret_cast<const u8*>(layout.data.data());
+			u8* out = dst.data() + tex.dst_ranges[i].first;
+
+			const u32 row_size = layout.width_in_block * block_size;
+			const u32 dst_pitch = ::align(row_size, dst_row_alignment);
+
+			for (u32 row = 0; row < u32{layout.height_in_block} * layout.depth; row++)
+			{
+				for (u32 b = 0; b < row_size; b++)
+				{
+					out[row * dst_pitch + b] = src[row * layout.pitch_in_block * block_size + (b - b % word_size) + (word_size - 1 - b % word_size)];
+				}
+			}
+		}
+	}
+
+	// Deswizzling as convert_linear_swizzle did it before it copied texel pairs
+	template <typename T>
+	void deswizzle_reference(const T* src, T* dst, u16 width, u16 height, u32 pitch)
+	{
+		const u32 log2width = rsx::ceil_log2(width);
+		const u32 log2height = rsx::ceil_log2(height);
+
+		u32 limit_mask = (log2width < log2height) ? log2width : log2height;
+		limit_mask = 1 << (limit_mask << 1);
+
+		const u32 x_mask = 0x55555555 | ~(limit_mask - 1);
+		const u32 y_mask = 0xAAAAAAAA & (limit_mask - 1);
+
+		u32 offs_y = 0;
+		u32 offs_x0 = 0;
+
+		for (u32 y = 0; y < height; ++y)
+		{
+			u32 offs_x = offs_x0;
+
+			for (u32 x = 0; x < width; ++x)
+			{
+				dst[y * (pitch / sizeof(T)) + x] = src[offs_y + offs_x];
+				offs_x = (offs_x - x_mask) & x_mask;
+			}
+
+			offs_y = (offs_y - y_mask) & y_mask;
+
+			if (offs_y == 0)
+			{
+				offs_x0 += limit_mask;
+			}
+		}
+	}
+
+	template <typename T>
+	void check_deswizzle(test::random& rng, u16 width, u16 height)
+	{
+		const u32 texels = 1u << (rsx::ceil_log2(width) + rsx::ceil_log2(height));
+		const u32 pitch = width * sizeof(T) + 16;
+
+		std::vector<T> src(texels);
+		rng.fill(src.data(), texels * sizeof(T));
+
+		std::vector<T> result(pitch / sizeof(T) * height + 1);
+		std::vector<T> expected(result.size());
+
+		rsx::convert_linear_swizzle<T>(src.data(), result.data(), width, height, pitch, true);
+		deswizzle_reference<T>(src.data(), expected.data(), width, height, pitch);
+
+		CHECK_MSG(std::memcmp(result.data(), expected.data(), result.size() * sizeof(T)) == 0, "%ux%u, %u bytes per texel", width, height, sizeof(T));
+	}
+}
+
+TEST_CASE(texture_deswizzle_matches_scalar)
+{
+	test::random rng;
+
+	const u16 sizes[] = { 1, 2, 3, 4, 7, 8, 16, 33, 64, 128, 256 };
+
+	for (const u16 width : sizes)
+	{
+		for (const u16 height : sizes)
+		{
+			check_deswizzle<u8>(rng, width, height);
+			check_deswizzle<u16>(rng, width, height);
+			check_deswizzle<u32>(rng, width, height);
+			check_deswizzle<u64>(rng, width, height);
+		}
+	}
+}
+
+TEST_CASE(texture_linear_decode_matches_scalar)
+{
+	test::random rng;
+
+	for (const u32 format : s_formats)
+	{
+		if (!get_swapped_word_size(format))
+		{
+			continue;
+		}
+
+		// Widths which leave a remainder after the 16 byte blocks, padded pitch and a mip chain
+		for (const u16 width : { 4, 28, 100, 260 })
+		{
+			const texture_data tex = make_texture(rng, format, width, 36, 1, 1, 3, (width / get_format_block_size_in_texel(format)) + 3);
+
+			std::vector<u8> result(tex.dst_size, 0xcd);
+			std::vector<u8> expected(tex.dst_size, 0xcd);
+
+			decode_serial(result, tex, format, false, true);
+			decode_linear_reference(expected, tex, format);
+
+			CHECK_MSG(result == expected, "format 0x%x, width %u", format, width);
+		}
+	}
+}
+
+TEST_CASE(texture_upload_batch_matches_serial)
+{
+	const fxm_scope fxm_init;
+
+	test::random rng;
+
+	struct shape
+	{
+		u16 width, height, depth, layers, levels;
+		u32 pitch_in_block;
+		bool linear_only;
+	};
+
+	const shape shapes[] =
+	{
+		{ 1024, 512, 1, 1, 11, 0, false },  // Mip chain large enough to be decoded in parallel and split into bands
+		{ 256, 256, 1, 6, 9, 0, false },    // Cubemap
+		{ 64, 64, 16, 1, 1, 0, false },     // Volume
+		{ 1000, 600, 1, 1, 1, 1100, true }, // Linear with padded rows
+	};
+
+	for (const u32 format : s_formats)
+	{
+		for (const bool is_swizzled : { false, true })
+		{
+			for (const auto& s : shapes)
+			{
+				if (is_swizzled && s.linear_only)
+				{
+					continue;
+				}
+
+				const u32 pitch = s.pitch_in_block / get_format_block_size_in_texel(format);
+				const texture_data tex = make_texture(rng, format, s.width, s.height, s.depth, s.layers, s.levels, pitch);
+
+				for (const bool vtc_support : { false, true })
+				{
+					if (vtc_support && !(is_dxt(format) && s.depth > 1))
+					{
+						continue;
+					}
+
+					std::vector<u8> result(tex.dst_size, 0xcd);
+					std::vector<u8> expected(tex.dst_size, 0xcd);
+
+					decode_batch(result, tex, format, is_swizzled, vtc_support);
+					decode_serial(expected, tex, format, is_swizzled, vtc_support);
+
+					CHECK_MSG(result == expected, "format 0x%x, %s %ux%ux%u, %u layers, %u levels", format, is_swizzled ? "swizzled" : "linear", s.width, s.height, s.depth, s.layers, s.levels);
+				}
+			}
+		}
+	}
+}
+
+BENCHMARK(texture_decode)
+{
+	const fxm_scope fxm_init;
+
+	test::random rng;
+
+	for (const u32 format : s_formats)
+	{
+		// A 512x512 texture with its mip chain, the upload is large enough to be decoded in parallel for most formats
+		const texture_data tex = make_texture(rng, format, 512, 512, 1, 1, 10);
+
+		std::vector<u8> dst(tex.dst_size);
+
+		const std::size_t size = tex.src.size();
+
+		for (const bool is_swizzled : { false, true })
+		{
+			const auto label = fmt::format("0x%02x %s (per KiB)", format, is_swizzled ? "swizzled" : "linear");
+
+			test::measure(label + " serial", [&]()
+			{
+				decode_serial(dst, tex, format, is_swizzled, true);
+			}, std::max<std::size_t>(size / 1024, 1));
+
+			test::measure(label + " batch", [&]()
+			{
+				decode_batch(dst, tex, format, is_swizzled, true);
+			}, std::max<std::size_t>(size / 1024, 1));
+		}
+	}
+}
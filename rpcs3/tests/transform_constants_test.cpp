@@ -0,0 +1,248 @@
+#include "stdafx.h"
+#include "test.h"
+#include "Emu/RSX/rsx_methods.h"
+#include "Emu/RSX/Capture/rsx_replay.h"
+
+#include "cereal/archives/binary.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+namespace
+{
+	// Run of NV4097_SET_TRANSFORM_CONSTANT + index commands
+	struct constant_run
+	{
+		u32 load;
+		u32 index;
+		std::vector<be_t<u32>> args;
+	};
+
+	// Per register path: decode() followed by the set_transform_constant handler for every word
+	bool decode_reference(rsx::rsx_state& state, u32 index, const be_t<u32>* args, u32 count)
+	{
+		bool dirty = false;
+
+		for (u32 i = 0; i < count; i++)
+		{
+			const u32 arg = args[i];
+			const u32 id = index + i;
+
+			state.decode(NV4097_SET_TRANSFORM_CONSTANT + id, arg);
+
+			const u32 load = state.transform_constant_load();
+
+			if (load + id / 4 >= 468)
+			{
+				continue;
+			}
+
+			auto& value = state.transform_constants[load + id / 4][id % 4];
+
+			if (value != arg)
+			{
+				value = arg;
+				dirty = true;
+			}
+		}
+
+		return dirty;
+	}
+
+	void apply_run(rsx::rsx_state& state, const constant_run& run, bool bulk)
+	{
+		state.decode(NV4097_SET_TRANSFORM_CONSTANT_LOAD, run.load);
+
+		// Runs longer than a method window are split like the FIFO splits them
+		for (u32 pos = 0, index = run.index; pos < run.args.size(); index = 0)
+		{
+			const u32 count = std::min<u32>(::size32(run.args) - pos, 32 - index);
+
+			if (bulk)
+			{
+				state.decode_transform_constants(index, run.args.data() + pos, count);
+			}
+			else
+			{
+				decode_reference(state, index, run.args.data() + pos, count);
+			}
+
+			pos += count;
+		}
+	}
+
+	// Transform constant runs recorded in rsx captures, the capture keeps every command separately
+	std::vector<constant_run> load_capture_runs(const std::string& path)
+	{
+		rsx::capture_storage storage;
+
+		if (!storage.open(path))
+		{
+			return {};
+		}
+
+		// Empty for files which aren't captures
+		const std::string frame_data = storage.read_frame();
+
+		if (frame_data.empty())
+		{
+			return {};
+		}
+
+		std::istringstream f(frame_data);
+		cereal::BinaryInputArchive archive(f);
+
+		const auto frame = std::make_unique<rsx::frame_capture_data>();
+		archive(*frame);
+
+		if (frame->magic != rsx::FRAME_CAPTURE_MAGIC || frame->version != rsx::FRAME_CAPTURE_VERSION)
+		{
+			std::printf("  Unsupported capture %s\n", path.c_str());
+			return {};
+		}
+
+		std::vector<constant_run> result;
+
+		u32 load = frame->reg_state.transform_constant_load();
+		u32 last_reg = 0;
+
+		for (const auto& rc : frame->replay_commands)
+		{
+			const u32 reg = (rc.rsx_command.first & 0xfffc) >> 2;
+			const u32 value = rc.rsx_command.second;
+
+			if (reg == NV4097_SET_TRANSFORM_CONSTANT_LOAD)
+			{
+				load = value;
+			}
+			else if (reg - NV4097_SET_TRANSFORM_CONSTANT < 32)
+			{
+				if (!result.empty() && reg == last_reg + 1 && result.back().load == load)
+				{
+					result.back().args.push_back(value);
+				}
+				else
+				{
+					result.push_back({ load, reg - NV4097_SET_TRANSFORM_CONSTANT, { value } });
+				}
+			}
+
+			last_reg = reg;
+		}
+
+		return result;
+	}
+
+	// Whole vectors uploaded from the start of the window, as most games do
+	std::vector<constant_run> make_runs(test::random& rng, u32 count)
+	{
+		std::vector<constant_run> result;
+
+		for (u32 i = 0; i < count; i++)
+		{
+			constant_run run{ rng.next() % 460, 0, std::vector<be_t<u32>>(32) };
+
+			for (auto& arg : run.args)
+			{
+				// Some constants keep their values between draws
+				arg = rng.next() % 2 ? rng.next() : 0;
+			}
+
+			result.push_back(std::move(run));
+		}
+
+		return result;
+	}
+}
+
+TEST_CASE(transform_constant_decode_matches_scalar)
+{
+	test::random rng;
+
+	const auto state = std::make_unique<rsx::rsx_state>();
+	const auto expected = std::make_unique<rsx::rsx_state>();
+
+	for (u32 iteration = 0; iteration < 20000; iteration++)
+	{
+		const u32 index = rng.next() % 32;
+		const u32 count = 1 + rng.next() % (32 - index);
+
+		// Include loads which reach past the usable [0, 467] range
+		const u32 load = iteration % 4 ? rng.next() % 468 : 460 + rng.next() % 16;
+
+		std::vector<be_t<u32>> args(count);
+
+		for (auto& arg : args)
+		{
+			// Few distinct values so that some runs don't change anything
+			arg = rng.next() % 3;
+		}
+
+		state->decode(NV4097_SET_TRANSFORM_CONSTANT_LOAD, load);
+		expected->decode(NV4097_SET_TRANSFORM_CONSTANT_LOAD, load);
+
+		const bool dirty = state->decode_transform_constants(index, args.data(), count);
+		const bool expected_dirty = decode_reference(*expected, index, args.data(), count);
+
+		CHECK_MSG(dirty == expected_dirty, "load=%u index=%u count=%u", load, index, count);
+		CHECK_MSG(state->register_previous_value == expected->register_previous_value, "load=%u index=%u count=%u", load, index, count);
+		CHECK_MSG(state->registers == expected->registers, "load=%u index=%u count=%u", load, index, count);
+		CHECK_MSG(std::memcmp(state->transform_constants.data(), expected->transform_constants.data(), sizeof(state->transform_constants)) == 0, "load=%u index=%u count=%u", load, index, count);
+	}
+}
+
+BENCHMARK(transform_constant_decode)
+{
+	std::vector<std::pair<std::string, std::vector<constant_run>>> workloads;
+
+	test::random rng;
+	workloads.emplace_back("synthetic 8 vector runs", make_runs(rng, 1024));
+
+	for (const auto& path : test::get_data_paths())
+	{
+		auto runs = load_capture_runs(path);
+
+		if (!runs.empty())
+		{
+			workloads.emplace_back(path, std::move(runs));
+		}
+	}
+
+	const auto state = std::make_unique<rsx::rsx_state>();
+
+	for (const auto& [name, runs] : workloads)
+	{
+		u64 words = 0;
+
+		for (const auto& run : runs)
+		{
+			words += run.args.size();
+		}
+
+		std::printf("  %s\n", fmt::format("%s: %u runs, %u constants", name, runs.size(), words).c_str());
+
+		// Every other pass uploads different values, so that the constants change as they do between draws
+		auto flipped = runs;
+
+		for (auto& run : flipped)
+		{
+			for (auto& arg : run.args)
+			{
+				arg = ~arg;
+			}
+		}
+
+		for (const bool bulk : { true, false })
+		{
+			u32 pass = 0;
+
+			test::measure(bulk ? "bulk decode (per constant)" : "per register decode (per constant)", [&]()
+			{
+				for (const auto& run : pass++ % 2 ? flipped : runs)
+				{
+					apply_run(*state, run, bulk);
+				}
+			}, words);
+		}
+	}
+}
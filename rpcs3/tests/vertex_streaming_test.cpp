@@ -0,0 +1,238 @@
+#include "stdafx.h"
+#include "test.h"
+#include "Emu/RSX/Common/BufferUtils.h"
+#include "Emu/RSX/RSXThread.h"
+
+namespace
+{
+	// Slack around every buffer, the SIMD kernels are allowed to touch whole 16 byte blocks
+	constexpr u32 buffer_slack = 64;
+
+	struct aligned_buffer
+	{
+		std::vector<u8> storage;
+		u8* data;
+
+		aligned_buffer(u32 size, u32 misalignment = 0)
+			: storage(size + buffer_slack * 2)
+		{
+			data = reinterpret_cast<u8*>(::align(reinterpret_cast<u64>(storage.data()), 16)) + misalignment;
+		}
+	};
+
+	u32 get_component_size(rsx::vertex_base_type type)
+	{
+		switch (type)
+		{
+		case rsx::vertex_base_type::ub:
+		case rsx::vertex_base_type::ub256:
+			return 1;
+		case rsx::vertex_base_type::f:
+		case rsx::vertex_base_type::cmp:
+			return 4;
+		default:
+			return 2;
+		}
+	}
+
+	// Scalar reference, one component at a time
+	void write_vertex_array_reference(u8* dst, const u8* src, u32 src_size, u32 count, rsx::vertex_base_type type, u32 element_count, u32 src_stride, u8 dst_stride, bool swap_endianness)
+	{
+		if (src_stride == 0) src_stride = rsx::get_vertex_type_size_on_host(type, element_count);
+
+		const u32 real_count = src_size / src_stride;
+		const u32 component_size = get_component_size(type);
+		const bool swap_bytes = swap_endianness && component_size > 1;
+
+		for (u32 i = 0; i < count; i++)
+		{
+			const u8* in = src + (i % real_count) * src_stride;
+			u8* out = dst + i * dst_stride;
+
+			if (type == rsx::vertex_base_type::cmp)
+			{
+				u32 value;
+				std::memcpy(&value, in, sizeof(u32));
+
+				if (swap_endianness) value = se_storage<u32>::swap(value);
+
+				const u16 decoded[4] = { u16((value & 0x7FF) << 5), u16(((value >> 11) & 0x7FF) << 5), u16((value >> 22) << 6), 1 };
+				std::memcpy(out, decoded, sizeof(decoded));
+				continue;
+			}
+
+			for (u32 c = 0; c < element_count; c++)
+			{
+				for (u32 b = 0; b < component_size; b++)
+				{
+					out[c * component_size + b] = in[c * component_size + (swap_bytes ? component_size - 1 - b : b)];
+				}
+			}
+		}
+	}
+
+	const char* get_type_name(rsx::vertex_base_type type)
+	{
+		switch (type)
+		{
+		case rsx::vertex_base_type::s1: return "s1";
+		case rsx::vertex_base_type::f: return "f";
+		case rsx::vertex_base_type::sf: return "sf";
+		case rsx::vertex_base_type::ub: return "ub";
+		case rsx::vertex_base_type::s32k: return "s32k";
+		case rsx::vertex_base_type::cmp: return "cmp";
+		case rsx::vertex_base_type::ub256: return "ub256";
+		}
+
+		return "?";
+	}
+
+	/**
+	 * Convert count vertices with both implementations and compare the bytes that hold attribute data.
+	 * src_vertices is the number of vertices present in the source, fewer than count makes the array repeat.
+	 */
+	void check_vertex_conversion(rsx::vertex_base_type type, u32 element_count, u32 count, u32 src_vertices, u32 src_stride, u8 dst_stride, bool swap_endianness, u32 misalignment)
+	{
+		const u32 read_stride = rsx::get_vertex_type_size_on_host(type, element_count);
+		const u32 src_size = src_vertices * (src_stride ? src_stride : read_stride);
+
+		aligned_buffer src(src_size, misalignment);
+		aligned_buffer dst(count * dst_stride);
+		aligned_buffer expected(count * dst_stride);
+
+		test::random rng(count * 131 + src_stride * 7 + element_count);
+		rng.fill(src.storage.data(), src.storage.size());
+
+		write_vertex_array_data_to_buffer({ reinterpret_cast<gsl::byte*>(dst.data), ::narrow<int>(count * dst_stride) },
+			{ reinterpret_cast<const gsl::byte*>(src.data), ::narrow<int>(src_size) }, count, type, element_count, src_stride, dst_stride, swap_endianness);
+
+		write_vertex_array_reference(expected.data, src.data, src_size, count, type, element_count, src_stride, dst_stride, swap_endianness);
+
+		const u32 output_size = type == rsx::vertex_base_type::cmp ? 8 : element_count * get_component_size(type);
+
+		for (u32 i = 0; i < count; i++)
+		{
+			CHECK_MSG(std::memcmp(dst.data + i * dst_stride, expected.data + i * dst_stride, output_size) == 0,
+				"type=%s elements=%u count=%u src_vertices=%u src_stride=%u dst_stride=%u swap=%d misalignment=%u: vertex %u differs",
+				get_type_name(type), element_count, count, src_vertices, src_stride, dst_stride, swap_endianness, misalignment, i);
+		}
+	}
+}
+
+TEST_CASE(vertex_conversion_matches_scalar)
+{
+	const rsx::vertex_base_type types[] =
+	{
+		rsx::vertex_base_type::s1,
+		rsx::vertex_base_type::f,
+		rsx::vertex_base_type::sf,
+		rsx::vertex_base_type::ub,
+		rsx::vertex_base_type::s32k,
+		rsx::vertex_base_type::ub256,
+	};
+
+	// Odd counts leave tails for the 256, 128 bit and scalar loops
+	const u32 counts[] = { 1, 2, 3, 4, 5, 7, 8, 16, 17, 33, 255, 256, 1000 };
+
+	for (const auto type : types)
+	{
+		for (u32 element_count = 1; element_count <= 4; element_count++)
+		{
+			if (type == rsx::vertex_base_type::ub256 && element_count != 4)
+			{
+				continue;
+			}
+
+			const u32 read_stride = rsx::get_vertex_type_size_on_host(type, element_count);
+
+			for (const u32 count : counts)
+			{
+				for (const bool swap : { true, false })
+				{
+					for (const u32 misalignment : { 0u, 4u })
+					{
+						// Packed source and destination
+						check_vertex_conversion(type, element_count, count, count, 0, read_stride, swap, misalignment);
+
+						// Interleaved source
+						check_vertex_conversion(type, element_count, count, count, read_stride + 4, read_stride, swap, misalignment);
+						check_vertex_conversion(type, element_count, count, count, 32, 16, swap, misalignment);
+
+						// Padded destination
+						check_vertex_conversion(type, element_count, count, count, 0, 16, swap, misalignment);
+
+						// Repeating source
+						check_vertex_conversion(type, element_count, count, 1, 0, read_stride, swap, misalignment);
+						check_vertex_conversion(type, element_count, count, std::max(count / 3, 1u), read_stride + 4, 16, swap, misalignment);
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE(cmp_conversion_matches_scalar)
+{
+	for (u32 count = 1; count <= 67; count++)
+	{
+		for (const u32 src_stride : { 0u, 4u, 8u, 12u, 32u })
+		{
+			for (const bool swap : { true, false })
+			{
+				for (const u32 misalignment : { 0u, 4u })
+				{
+					check_vertex_conversion(rsx::vertex_base_type::cmp, 1, count, count, src_stride, 8, swap, misalignment);
+				}
+			}
+		}
+
+		check_vertex_conversion(rsx::vertex_base_type::cmp, 1, count, 1, 0, 8, true, 0);
+	}
+}
+
+BENCHMARK(vertex_conversion)
+{
+	constexpr u32 count = 1 << 16;
+
+	struct layout
+	{
+		rsx::vertex_base_type type;
+		u32 element_count;
+		u32 src_stride;
+		u8 dst_stride;
+	};
+
+	const layout layouts[] =
+	{
+		{ rsx::vertex_base_type::f, 4, 0, 16 },
+		{ rsx::vertex_base_type::f, 3, 32, 16 },
+		{ rsx::vertex_base_type::s1, 4, 0, 8 },
+		{ rsx::vertex_base_type::s32k, 2, 16, 16 },
+		{ rsx::vertex_base_type::cmp, 1, 0, 8 },
+		{ rsx::vertex_base_type::cmp, 1, 16, 8 },
+		{ rsx::vertex_base_type::ub, 4, 16, 4 },
+	};
+
+	for (const auto& entry : layouts)
+	{
+		const u32 read_stride = rsx::get_vertex_type_size_on_host(entry.type, entry.element_count);
+		const u32 src_size = count * (entry.src_stride ? entry.src_stride : read_stride);
+
+		aligned_buffer src(src_size);
+		aligned_buffer dst(count * entry.dst_stride);
+		test::random().fill(src.storage.data(), src.storage.size());
+
+		const gsl::span<gsl::byte> dst_span{ reinterpret_cast<gsl::byte*>(dst.data), ::narrow<int>(count * entry.dst_stride) };
+		const gsl::span<const gsl::byte> src_span{ reinterpret_cast<const gsl::byte*>(src.data), ::narrow<int>(src_size) };
+
+		test::measure(fmt::format("%s x%u src_stride=%u dst_stride=%u kernel", get_type_name(entry.type), entry.element_count, entry.src_stride, entry.dst_stride), [&]()
+		{
+			write_vertex_array_data_to_buffer(dst_span, src_span, count, entry.type, entry.element_count, entry.src_stride, entry.dst_stride, true);
+		}, count);
+
+		test::measure(fmt::format("%s x%u src_stride=%u dst_stride=%u scalar reference", get_type_name(entry.type), entry.element_count, entry.src_stride, entry.dst_stride), [&]()
+		{
+			write_vertex_array_reference(dst.data, src.data, src_size, count, entry.type, entry.element_count, entry.src_stride, entry.dst_stride, true);
+		}, count);
+	}
+}